@@ -1,5 +1,6 @@
 #pragma once
 
+#include <optional>
 #include <string>
 
 #include "resource_loader.hpp"
@@ -117,6 +118,38 @@ namespace nova::renderer {
 
     private:
         std::string name;
+
+        /*!
+         * \brief Everything that the camera's matrices are calculated from
+         */
+        struct MatrixInputs {
+            glm::vec3 position;
+            glm::vec3 rotation;
+            float field_of_view;
+            float aspect_ratio;
+            float near_plane;
+            float far_plane;
+
+            /*!
+             * \brief Size of the framebuffer, which screen-space cameras use to build their projection matrix
+             */
+            glm::uvec2 framebuffer_size;
+
+            bool operator==(const MatrixInputs& other) const = default;
+        };
+
+        /*!
+         * \brief The inputs the camera's matrices were last calculated from, or nullopt if they've never been calculated
+         */
+        std::optional<MatrixInputs> last_matrix_inputs;
+
+        /*!
+         * \brief True if the previous frame matrices in the camera's UBO don't match the current frame matrices yet
+         *
+         * A camera that just moved needs one more update after it stops moving, to copy its current matrices into its previous
+         * matrices
+         */
+        bool has_stale_previous_matrices = false;
     };
 
     using CameraAccessor = VectorAccessor<Camera>;
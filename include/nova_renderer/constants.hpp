@@ -20,13 +20,36 @@ namespace nova::renderer {
 
     constexpr uint32_t MAX_NUM_CAMERAS = 256;
 
+    /*!
+     * \brief Most keywords that a pipeline may have, since a variant's keywords are a bitmask
+     */
+    constexpr uint32_t MAX_PIPELINE_KEYWORDS = 64;
+
     /*!
      * \brief Maximum number of textures that Nova can handle
+     *
+     * The bindless texture table is as large as the device allows, but never larger than this. Some devices report limits in the
+     * millions, and we allocate a slot for every texture in every in-flight frame's descriptor set
      */
-    constexpr uint32_t MAX_NUM_TEXTURES = 1024;
+    constexpr uint32_t MAX_NUM_TEXTURES = 65536;
 
+    /*!
+     * \brief Initial size of each in-flight frame's arena
+     */
     constexpr mem::Bytes PER_FRAME_MEMORY_SIZE = 2_mb;
 
+    /*!
+     * \brief Number of threads that record rendering commands, and thus need their own command pools
+     */
+    constexpr uint32_t NUM_RENDER_THREADS = 1;
+
+    /*!
+     * \brief Size of each frame's region of the ring that procedural meshes stream their geometry through
+     *
+     * All procedural meshes together can't use more than this much space
+     */
+    constexpr mem::Bytes PROCEDURAL_GEOMETRY_RING_SIZE = 4_mb;
+
     constexpr const char* RENDERPACK_DIRECTORY = "renderpacks";
     constexpr const char* MATERIALS_DIRECTORY = "materials";
     constexpr const char* SHADERS_DIRECTORY = "shaders";
@@ -1,11 +1,12 @@
 #pragma once
 
 #include <stddef.h>
+#include <span>
 
-#include <rx/core/memory/allocator.h>
-
-#include "nova_renderer/rhi/forward_decls.hpp"
+#include "nova_renderer/camera.hpp"
 #include "nova_renderer/resource_loader.hpp"
+#include "nova_renderer/rhi/forward_decls.hpp"
+#include "nova_renderer/util/frame_arena.hpp"
 
 namespace nova::renderer {
     class NovaRenderer;
@@ -46,8 +47,23 @@ namespace nova::renderer {
 
         size_t cur_model_matrix_index = 0;
 
-        rx::memory::allocator* allocator = nullptr;
+        /*!
+         * \brief Arena for memory that only needs to live until the end of the frame, such as temporary vectors
+         *
+         * Reset once the GPU has finished the last frame that used it
+         */
+        mem::FrameArena* allocator = nullptr;
 
         BufferResourceAccessor material_buffer;
+
+        /*!
+         * \brief Every camera, including the inactive ones
+         */
+        std::span<const Camera> cameras;
+
+        /*!
+         * \brief Height of the swapchain, in pixels
+         */
+        float viewport_height = 0;
     };
 } // namespace nova::renderer
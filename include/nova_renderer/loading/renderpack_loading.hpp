@@ -6,6 +6,10 @@
 #include "nova_renderer/renderpack_data.hpp"
 #include "nova_renderer/rhi/rhi_enums.hpp"
 
+namespace nova::renderer {
+    class WorkerPool;
+}
+
 namespace nova::renderer::renderpack {
     /*!
      * \brief Loads all the data for a single renderpack
@@ -20,17 +24,35 @@ namespace nova::renderer::renderpack {
      * Note: This function is NOT thread-safe. It should only be called for a single thread at a time
      *
      * \param renderpack_name The name of the renderpack to loads
+     * The calling thread reads the renderpack's files, and the worker pool parses them and compiles their shaders. The result, and the
+     * order that problems are reported in, doesn't depend on which jobs finish first
+     *
+     * \param worker_pool Worker pool to parse files and compile shaders on. If nullptr, the calling thread does all of it
      * \return The renderpack, if it can be loaded, or an empty optional if it cannot
      */
-    RenderpackData load_renderpack_data(const std::string& renderpack_name);
+    RenderpackData load_renderpack_data(const std::string& renderpack_name, WorkerPool* worker_pool = nullptr);
 
     std::vector<uint32_t> load_shader_file(const std::string& filename,
                                           filesystem::FolderAccessorBase* folder_access,
                                           rhi::ShaderStage stage,
                                           const std::vector<std::string>& defines = {});
 
+    /*!
+     * \brief Compiles a shader to SPIR-V, or loads it from the shader cache if we've compiled it before
+     *
+     * \param source The shader's source code
+     * \param stage The stage the shader is for
+     * \param source_language The language the shader is written in
+     * \param folder_accessor The renderpack to look for included files in. If nullptr, shaders may only include Nova's builtin files
+     * \param defines Preprocessor defines, in the form `NAME` or `NAME=VALUE`
+     * \param included_files If not nullptr, set to the name of every file that the shader included, even if it couldn't be compiled
+     *
+     * \return The shader's SPIR-V, or an empty vector if it couldn't be compiled
+     */
     std::vector<uint32_t> compile_shader(const std::string& source,
                                         rhi::ShaderStage stage,
                                         rhi::ShaderLanguage source_language,
-                                        filesystem::FolderAccessorBase* folder_accessor = nullptr);
+                                        filesystem::FolderAccessorBase* folder_accessor = nullptr,
+                                        const std::vector<std::string>& defines = {},
+                                        std::vector<std::string>* included_files = nullptr);
 } // namespace nova::renderer::renderpack
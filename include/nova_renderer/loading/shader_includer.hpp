@@ -7,6 +7,7 @@
 
 #include <dxc/dxcapi.h>
 #include <rx/core/concurrency/mutex.h>
+#include <optional>
 #include <unordered_map>
 #include <string>
 
@@ -23,6 +24,20 @@ namespace rx {
 } // namespace rx
 
 namespace nova::renderer {
+    /*!
+     * \brief Finds the contents of a file that a shader includes
+     *
+     * Looks in Nova's builtin snippets first, then in the renderpack. This is exactly what `NovaDxcIncludeHandler` does, so the shader
+     * cache can use it to check if a shader's includes changed without running the compiler. Safe to call from many threads at once
+     *
+     * \param filename The name of the included file, as DXC gives it to us
+     * \param folder_accessor The renderpack to look in. May be nullptr, in which case we only look at the builtin snippets
+     *
+     * \return The file's contents, or an empty optional if it doesn't exist
+     */
+    [[nodiscard]] std::optional<std::string> read_shader_include(const std::string& filename,
+                                                                 filesystem::FolderAccessorBase* folder_accessor);
+
     /*!
      * \brief Include handler to let Nova shaders include other files
      */
@@ -47,6 +62,11 @@ namespace nova::renderer {
 
         HRESULT LoadSource(LPCWSTR wide_filename, IDxcBlob** included_source) override;
 
+        /*!
+         * \brief Every file that this handler has included, and the contents that it included
+         */
+        [[nodiscard]] const std::unordered_map<std::string, std::string>& get_included_files() const;
+
     private:
         rx::memory::allocator& allocator;
 
@@ -54,7 +74,11 @@ namespace nova::renderer {
 
         filesystem::FolderAccessorBase* folder_accessor;
 
-        std::unordered_map<std::string, std::string> builtin_files;
+        /*!
+         * \brief Contents of every file we've included. DXC reads the included source after `LoadSource` returns, so this must keep it
+         * alive until we're destroyed
+         */
+        std::unordered_map<std::string, std::string> included_files;
 
 #if NOVA_WINDOWS
         std::mutex mtx;
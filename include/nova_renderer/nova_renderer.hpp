@@ -1,6 +1,7 @@
 #pragma once
 
 #include <rx/core/log.h>
+#include <atomic>
 #include <unordered_map>
 #include  <optional>
 #include <rx/core/ptr.h>
@@ -18,8 +19,14 @@
 #include "nova_renderer/rhi/forward_decls.hpp"
 #include "nova_renderer/rhi/render_device.hpp"
 #include "nova_renderer/util/container_accessor.hpp"
+#include "nova_renderer/util/worker_pool.hpp"
 
+#include "../../src/render_objects/procedural_geometry_ring.hpp"
 #include "../../src/renderer/material_data_buffer.hpp"
+#include "../../src/renderer/memory_budget_tracker.hpp"
+#include "../../src/renderer/shader_reloader.hpp"
+#include "../../src/renderer/texture_streamer.hpp"
+#include "../../src/renderer/virtual_texture_system.hpp"
 
 namespace rx {
     namespace memory {
@@ -64,9 +71,43 @@ namespace nova::renderer {
 
         uint32_t num_indices = 0;
         size_t num_vertex_attributes{};
+
+        /*!
+         * \brief Center of a sphere that contains every vertex of the mesh, in model space
+         */
+        glm::vec3 bounding_center{};
+        float bounding_radius = 0;
+
+        /*!
+         * \brief Meshlets for the mesh shader path
+         *
+         * These are only created when the device supports mesh shaders. See `build_meshlets` for their layout
+         */
+        rhi::RhiBuffer* meshlet_buffer = nullptr;
+        rhi::RhiBuffer* meshlet_vertex_buffer = nullptr;
+        rhi::RhiBuffer* meshlet_primitive_buffer = nullptr;
+
+        uint32_t num_meshlets = 0;
     };
 #pragma endregion
 
+    /*!
+     * \brief How far Nova has got with compiling the loaded renderpack's pipelines
+     *
+     * Nova compiles pipelines on the worker pool while it renders. Objects whose pipelines aren't ready yet are drawn with their
+     * pipeline's fallback, or not at all if the fallback isn't ready either
+     */
+    struct PipelineCompileProgress {
+        uint32_t num_compiled = 0;
+
+        uint32_t num_failed = 0;
+
+        /*!
+         * \brief Number of pipeline and renderpass combinations that the renderpack needs
+         */
+        uint32_t num_total = 0;
+    };
+
     using ProceduralMeshAccessor = MapAccessor<MeshId, ProceduralMesh>;
 
     /*!
@@ -170,16 +211,40 @@ namespace nova::renderer {
 
 #pragma region Resources
         [[nodiscard]] rhi::RhiSampler* get_point_sampler() const;
+
+        /*!
+         * \brief Gets one of the samplers that the loaded renderpack declared, or nullptr if it didn't declare a sampler with that name
+         */
+        [[nodiscard]] rhi::RhiSampler* get_renderpack_sampler(const std::string& name) const;
 #pragma endregion
 
 #pragma region Materials
         /*!
          * \brief Creates a new material of the specified type
          *
-         * \return A pointer to the new material, or nullptr if the material can't be created for whatever reason
+         * \param material The material's initial data
+         *
+         * \return The material's index, in units of `MaterialType`. Send it to your shaders, and use it to update or destroy the material
+         */
+        template <typename MaterialType>
+        [[nodiscard]] uint32_t create_material(const MaterialType& material = {});
+
+        /*!
+         * \brief Replaces a material's data. The new data is uploaded to each in-flight frame's material buffer before that frame renders
+         *
+         * \param idx The index that `create_material` returned
+         * \param material The material's new data
+         */
+        template <typename MaterialType>
+        void update_material(uint32_t idx, const MaterialType& material);
+
+        /*!
+         * \brief Frees a material's slot in the material buffer, so that a later material can use it
+         *
+         * Nothing may draw with the material after this, since its index may be given to a different material
          */
         template <typename MaterialType>
-        [[nodiscard]] std::pair<uint32_t, MaterialType*> create_material();
+        void destroy_material(uint32_t idx);
 
         /*!
          * \brief Gets the pipeline with the provided name
@@ -211,6 +276,19 @@ namespace nova::renderer {
 
         [[nodiscard]] DeviceResources& get_resource_manager() const;
 
+        [[nodiscard]] TextureStreamer& get_texture_streamer() const;
+
+        [[nodiscard]] VirtualTextureSystem& get_virtual_texture_system() const;
+
+        [[nodiscard]] WorkerPool& get_worker_pool() const;
+
+        /*!
+         * \brief Tells you how much GPU memory Nova is using, and how close it is to running out
+         */
+        [[nodiscard]] MemoryBudgetTracker& get_memory_budget_tracker() const;
+
+        [[nodiscard]] PipelineCompileProgress get_pipeline_compile_progress() const;
+
     private:
         NovaSettingsAccessManager settings;
 
@@ -226,6 +304,27 @@ namespace nova::renderer {
 
         std::unique_ptr<DeviceResources> device_resources;
 
+        /*!
+         * \brief Streams texture mips in and out of VRAM. Declared after `device_resources` so that it's destroyed first
+         */
+        std::unique_ptr<TextureStreamer> texture_streamer;
+
+        std::unique_ptr<VirtualTextureSystem> virtual_texture_system;
+
+        std::unique_ptr<MemoryBudgetTracker> memory_budget_tracker;
+
+        /*!
+         * \brief Recompiles the current renderpack's pipelines when their shaders change. Null if hot reload is off or the renderpack isn't
+         * in a regular folder
+         */
+        std::unique_ptr<ShaderReloader> shader_reloader;
+
+        /*!
+         * \brief Threads for background work. Declared after everything that submits jobs, so that the threads are stopped before the
+         * things that their jobs use are destroyed
+         */
+        std::unique_ptr<WorkerPool> worker_pool;
+
         rhi::RhiDescriptorPool* global_descriptor_pool;
 
         void* staging_buffer_memory_ptr;
@@ -278,6 +377,18 @@ namespace nova::renderer {
 
         void create_dynamic_textures(const std::vector<renderpack::TextureCreateInfo>& texture_create_infos);
 
+        /*!
+         * \brief Samplers that the loaded renderpack declared, by name
+         */
+        std::unordered_map<std::string, rhi::RhiSampler*> renderpack_samplers;
+
+        void create_renderpack_samplers(const std::vector<renderpack::SamplerCreateInfo>& sampler_create_infos);
+
+        /*!
+         * \brief Releases the renderpack's samplers. Only call this once the GPU is done with them
+         */
+        void destroy_renderpack_samplers();
+
         void create_render_passes(const std::vector<renderpack::RenderPassCreateInfo>& pass_create_infos,
                                   const std::vector<renderpack::PipelineData>& pipelines) const;
 
@@ -295,12 +406,54 @@ namespace nova::renderer {
         std::unordered_map<FullMaterialPassName, MaterialPassMetadata> material_metadatas;
 
         void create_pipelines_and_materials(const std::vector<renderpack::PipelineData>& pipeline_create_infos,
-                                            const std::vector<renderpack::MaterialData>& materials);
+                                            const std::vector<renderpack::MaterialData>& materials,
+                                            filesystem::FolderAccessorBase* renderpack_folder);
+
+        /*!
+         * \brief Creates a pipeline from the renderpack's description of it. Safe to call from the worker pool
+         *
+         * \param generation How many times the pipeline's shaders have been reloaded. See `PipelineVariants`
+         */
+        [[nodiscard]] std::optional<Pipeline> create_pipeline(const renderpack::PipelineData& rp_pipeline_state,
+                                                              filesystem::FolderAccessorBase* renderpack_folder,
+                                                              uint32_t generation);
 
         void create_materials_for_pipeline(const renderer::Pipeline& pipeline,
                                            const std::vector<renderpack::MaterialData>& materials,
                                            const std::string& pipeline_name);
 
+        std::atomic<uint32_t> num_pipelines_compiled = 0;
+
+        std::atomic<uint32_t> num_pipelines_failed = 0;
+
+        /*!
+         * \brief Compiled plus failed. Separate so that exactly one job sees every pipeline finish
+         */
+        std::atomic<uint32_t> num_pipelines_finished = 0;
+
+        uint32_t num_pipelines_to_compile = 0;
+
+        struct PipelineCompileJob {
+            const rhi::RhiPipeline* pipeline;
+
+            rhi::RhiRenderpass* renderpass;
+
+            /*!
+             * \brief Jobs for the pipelines which derive from this one, which we start once this one is done
+             */
+            std::vector<size_t> children;
+        };
+
+        /*!
+         * \brief Starts compiling every pipeline for the renderpass it renders in, on the worker pool
+         *
+         * This keeps pipeline compilation out of command recording, where it would cause hitches. Pipelines with a parent in the same
+         * renderpass wait for their parent, so that the device can derive them from it
+         */
+        void compile_pipelines_for_renderpasses(const std::vector<renderpack::PipelineData>& pipeline_create_infos);
+
+        void submit_pipeline_compile(std::shared_ptr<std::vector<PipelineCompileJob>> jobs, size_t job_idx);
+
         void destroy_pipelines();
 
         void destroy_materials();
@@ -310,7 +463,42 @@ namespace nova::renderer {
         MeshId next_mesh_id = 0;
 
         std::unordered_map<MeshId, Mesh> meshes;
+        std::unique_ptr<ProceduralGeometryRing> procedural_geometry_ring;
         std::unordered_map<MeshId, ProceduralMesh> proc_meshes;
+
+        /*!
+         * \brief Copies every procedural mesh's data into this frame's region of the procedural geometry ring
+         */
+        void write_procedural_meshes_to_ring(uint32_t frame_idx);
+
+        /*!
+         * \brief Meshes which `destroy_mesh` removed, and the frame they were removed in
+         */
+        struct RetiredMesh {
+            Mesh mesh;
+            uint64_t frame_retired = 0;
+        };
+
+        /*!
+         * \brief Meshes that in-flight frames may still be drawing. Their buffers are destroyed once those frames have finished
+         */
+        std::vector<RetiredMesh> retired_meshes;
+
+        /*!
+         * \brief Builds meshlets for a mesh and uploads them to the GPU, so the mesh can be drawn with the mesh shader path
+         *
+         * The uploads are submitted but not waited on. Their staging buffers and fences are added to the provided vectors, so the caller
+         * can clean them up once the uploads have finished
+         */
+        void create_meshlets_for_mesh(const MeshData& mesh_data,
+                                      Mesh& mesh,
+                                      std::vector<rhi::RhiBuffer*>& staging_buffers,
+                                      std::vector<rhi::RhiFence*>& upload_fences);
+
+        /*!
+         * \brief Destroys the buffers of every retired mesh that no in-flight frame can still be using
+         */
+        void destroy_retired_meshes();
 #pragma endregion
 
 #pragma region Rendering
@@ -322,12 +510,53 @@ namespace nova::renderer {
 
         std::vector<rhi::RhiFence*> frame_fences;
 
+        /*!
+         * \brief Arenas for per-frame temporary memory, indexed by in-flight frame index
+         */
+        std::vector<mem::FrameArena> frame_arenas;
+
+        void create_frame_arenas();
+
+        /*!
+         * \brief Resets the arena for the given frame. Only call this after waiting for the frame's fence
+         */
+        void reset_frame_arena(uint32_t frame_idx);
+
         std::unordered_map<FullMaterialPassName, MaterialPassKey> material_pass_keys;
         std::unordered_map<std::string, Pipeline> pipelines;
 
+        /*!
+         * \brief A pipeline which hot reloading replaced, and the frame it was replaced in
+         */
+        struct ReplacedPipeline {
+            Pipeline pipeline;
+            uint64_t frame_replaced = 0;
+        };
+
+        /*!
+         * \brief Pipelines which hot reloading replaced. In-flight frames and queued compile jobs may still use them, so we keep them until
+         * those are done
+         */
+        std::vector<ReplacedPipeline> replaced_pipelines;
+
+        /*!
+         * \brief Swaps in the pipelines that the shader reloader finished since last frame
+         */
+        void swap_in_reloaded_pipelines();
+
         std::unique_ptr<MaterialDataBuffer> material_buffer;
         std::vector<BufferResourceAccessor> material_device_buffers;
 
+        /*!
+         * \brief Recreates the given frame's material device buffer if the CPU-side material buffer has outgrown it
+         */
+        void resize_material_device_buffer(uint32_t frame_idx);
+
+        /*!
+         * \brief Uploads the parts of the material buffer which changed since the last time this frame's device buffer was updated
+         */
+        void upload_material_buffer(uint32_t frame_idx);
+
         struct RenderableKey {
             std::string pipeline_name{};
             uint32_t material_pass_idx{};
@@ -342,8 +571,6 @@ namespace nova::renderer {
         std::unique_ptr<PerFrameDeviceArray<CameraUboData>> camera_data;
 
         void update_camera_matrix_buffer(uint32_t frame_idx);
-
-        std::vector<rhi::RhiImage*> get_all_images();
 #pragma endregion
     };
 
@@ -353,10 +580,23 @@ namespace nova::renderer {
     }
 
     template <typename MaterialType>
-    std::pair<uint32_t, MaterialType*> NovaRenderer::create_material() {
-        // We need to return the index so that we can send the index to the shader
-        // WE NEED TO RETURN THE INDEX, NOT JUST A POINTER TO THE MATERIAL
+    uint32_t NovaRenderer::create_material(const MaterialType& material) {
+        // Only hand out the index. A pointer into the material buffer would dangle as soon as the buffer grows, and writes through it
+        // would never be uploaded
         const auto idx = material_buffer->get_next_free_index<MaterialType>();
-        return {idx, &material_buffer->at<MaterialType>(idx)};
+        material_buffer->write(idx, material);
+        return idx;
+    }
+
+    template <typename MaterialType>
+    void NovaRenderer::update_material(const uint32_t idx, const MaterialType& material) {
+        material_buffer->write(idx, material);
+    }
+
+    template <typename MaterialType>
+    void NovaRenderer::destroy_material(const uint32_t idx) {
+        // Each in-flight frame has its own device buffer, which is only updated when that frame comes around again, so the slot can be
+        // reused right away
+        material_buffer->free_index<MaterialType>(idx);
     }
 } // namespace nova::renderer
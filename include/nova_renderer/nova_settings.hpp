@@ -187,6 +187,11 @@ namespace nova::renderer {
              * \brief The application version to pass to Vulkan
              */
             Semver application_version = {0, 8, 4};
+
+            /*!
+             * \brief Where Nova saves compiled pipelines, so that it doesn't have to compile them again the next time it runs
+             */
+            const char* pipeline_cache_path = "cache/pipelines.bin";
         } vulkan;
 
         /*!
@@ -199,6 +204,197 @@ namespace nova::renderer {
             bool is_uma = false;
         } system_info;
 
+        /*!
+         * \brief Options for streaming texture mips in and out of VRAM
+         */
+        struct TextureStreamingOptions {
+            /*!
+             * \brief How much VRAM streamed textures may use, in megabytes
+             *
+             * When the mips that Nova wants to be resident don't fit in this budget, it drops the finest mips of the textures which are
+             * smallest on screen until they do fit
+             */
+            uint32_t vram_budget_mb = 1024;
+
+            /*!
+             * \brief How many megabytes of texture data Nova may upload each frame. Higher values make textures sharpen faster, lower
+             * values keep frame times more stable
+             */
+            uint32_t max_upload_mb_per_frame = 32;
+
+            /*!
+             * \brief Mips this size or smaller are always resident, so every texture has something to sample
+             */
+            uint32_t min_resident_mip_size = 64;
+
+            /*!
+             * \brief Number of frames that a texture may go without being seen before Nova evicts everything but its smallest mips
+             */
+            uint32_t frames_until_eviction = 120;
+
+            /*!
+             * \brief Where Nova writes the mips of streamed textures, so that it can load them again without keeping them all in RAM
+             *
+             * The files are deleted when their textures are destroyed
+             */
+            const char* spilled_mip_directory = "cache/streamed_mips";
+        } texture_streaming;
+
+        /*!
+         * \brief Options for virtual textures, which stream fixed-size pages of huge textures into a page cache
+         */
+        struct VirtualTextureOptions {
+            /*!
+             * \brief Width and height of the physical page cache, in pages. Must be at most 256
+             *
+             * The cache is one RGBA8 texture, so the default of 32 pages of 128x128 pixels is a 4096x4096 texture that uses 64 MB
+             */
+            uint32_t cache_size_in_pages = 32;
+
+            /*!
+             * \brief Most pages that Nova copies into the page cache each frame
+             */
+            uint32_t max_page_uploads_per_frame = 32;
+
+            /*!
+             * \brief Most page requests that shaders can write to the feedback buffer in one frame
+             */
+            uint32_t max_feedback_entries = 16384;
+        } virtual_textures;
+
+        /*!
+         * \brief Options for how Nova prepares texture data when it uploads it
+         */
+        struct TextureLoadingOptions {
+            /*!
+             * \brief If true, Nova generates a full mip chain for textures that are uploaded without one
+             */
+            bool generate_mips = true;
+
+            /*!
+             * \brief If true, Nova generates mips by blitting them on the GPU rather than filtering them on the CPU
+             *
+             * The GPU path is faster but filters in whatever space the image's format is in, so it isn't gamma-correct for non-sRGB
+             * formats. It's also unavailable when Nova compresses textures, since the compressor needs every mip on the CPU
+             */
+            bool generate_mips_on_gpu = false;
+
+            /*!
+             * \brief If true, Nova compresses RGBA8 textures to BC1 or BC7 before it uploads them
+             */
+            bool compress_textures = true;
+
+            /*!
+             * \brief Where Nova saves compressed textures, so that it only has to compress each texture once
+             */
+            const char* compressed_texture_cache_directory = "cache/textures";
+        } texture_loading;
+
+        /*!
+         * \brief Options for the cache of compiled shaders
+         */
+        struct ShaderCacheOptions {
+            /*!
+             * \brief If false, Nova compiles every shader every time it loads a renderpack
+             */
+            bool enabled = true;
+
+            /*!
+             * \brief Where Nova saves compiled shaders
+             */
+            const char* directory = "cache/shaders";
+
+            /*!
+             * \brief Most space that the shader cache may use on disk, in megabytes. Nova deletes the shaders it used least recently when the
+             * cache gets bigger than this
+             */
+            uint32_t max_size_mb = 256;
+        } shader_cache;
+
+        /*!
+         * \brief Options for what Nova does to shaders after it compiles them
+         */
+        struct ShaderCompilationOptions {
+            enum class Optimization {
+                /*!
+                 * \brief Use the SPIR-V that the compiler produced
+                 */
+                None,
+
+                /*!
+                 * \brief Optimize shaders to run quickly
+                 */
+                Performance,
+
+                /*!
+                 * \brief Optimize shaders to be small, which makes them quicker for the driver to compile
+                 */
+                Size,
+            };
+
+            Optimization optimization = Optimization::Performance;
+
+            /*!
+             * \brief If true, Nova validates shaders after it optimizes them, and refuses to use any which aren't valid
+             */
+            bool validate = true;
+
+            /*!
+             * \brief If true, Nova strips names and other debug information from shaders before it gives them to the driver
+             *
+             * Nova reflects on shaders before it strips them, so this doesn't change which resources shaders can use. Turn this off to see
+             * names in graphics debuggers
+             */
+            bool strip_debug_info = true;
+
+            /*!
+             * \brief If true, Nova recompiles a renderpack's pipelines when their shaders, or any files they include, change on disk
+             *
+             * Only works for renderpacks in regular folders
+             */
+            bool hot_reload = true;
+        } shader_compilation;
+
+        /*!
+         * \brief Options for how Nova reacts when it's running out of VRAM
+         *
+         * Pressure is how much of the fullest device-local heap we're using, as a fraction of the budget that the driver gives us
+         */
+        struct MemoryBudgetOptions {
+            /*!
+             * \brief Above this pressure, Nova starts dropping texture mips and releasing its cached staging buffers
+             */
+            float elevated_pressure = 0.85f;
+
+            /*!
+             * \brief Above this pressure, Nova drops every streamed texture to its smallest mips
+             */
+            float critical_pressure = 0.95f;
+
+            /*!
+             * \brief Nova lets textures have their full budget again once pressure falls below this
+             */
+            float relieved_pressure = 0.75f;
+
+            /*!
+             * \brief How much of the streamed textures' VRAM Nova takes away each time it shrinks their budget
+             */
+            float texture_budget_shrink_rate = 0.05f;
+
+            /*!
+             * \brief How many frames Nova waits after shrinking the texture budget before shrinking it again, if pressure's still elevated
+             *
+             * Dropped mips only leave VRAM after their in-flight frames finish, so the measured usage takes a few frames to catch up with a
+             * smaller budget
+             */
+            uint32_t frames_between_budget_shrinks = 30;
+        } memory_budget;
+
+        /*!
+         * \brief Number of threads that Nova uses for background work, such as loading texture data
+         */
+        uint32_t num_worker_threads = 4;
+
         uint32_t max_in_flight_frames = 3;
 
         /*!
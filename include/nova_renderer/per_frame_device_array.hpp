@@ -1,7 +1,9 @@
 #pragma once
 
-#include <Tracy.hpp>
+#include <algorithm>
 #include <vector>
+
+#include <Tracy.hpp>
 #include <spdlog/sinks/stdout_color_sinks.h>
 
 
@@ -13,6 +15,9 @@ namespace nova::renderer {
 
     /*!
      * \brief Array of data which is unique for each frame of execution
+     *
+     * The array remembers which elements were written since each frame's buffer was last uploaded, and only uploads those elements.
+     * Getting a mutable reference to an element counts as writing to it, so use the const accessors if you only want to read
      */
     template <typename ElementType>
     class PerFrameDeviceArray {
@@ -32,8 +37,24 @@ namespace nova::renderer {
 
         ElementType& operator[](uint32_t idx);
 
+        const ElementType& operator[](uint32_t idx) const;
+
         ElementType& at(uint32_t idx);
 
+        const ElementType& at(uint32_t idx) const;
+
+        /*!
+         * \brief Marks an element as needing to be uploaded to every frame's buffer
+         *
+         * `at` and `operator[]` already do this, you only need to call it if you hold on to a reference across frames
+         */
+        void mark_dirty(uint32_t idx);
+
+        /*!
+         * \brief Uploads every element that was written since the last time this frame's buffer was uploaded
+         *
+         * Adjacent dirty elements are uploaded with a single write
+         */
         void upload_to_device(uint32_t frame_idx);
 
         [[nodiscard]] uint32_t get_next_free_slot();
@@ -51,14 +72,18 @@ namespace nova::renderer {
         std::vector<ElementType> data;
 
         std::vector<uint32_t> free_indices;
+
+        /*!
+         * \brief One bit per element for each in-flight frame. A set bit means that element needs to be uploaded to that frame's buffer
+         */
+        std::vector<std::vector<uint64_t>> dirty_elements_per_frame;
     };
 
     template <typename ElementType>
     PerFrameDeviceArray<ElementType>::PerFrameDeviceArray(const size_t num_elements,
                                                           const uint32_t num_in_flight_frames,
                                                           rhi::RenderDevice& device)
-        : device{device},
-          data{num_elements}{
+        : device{device}, data(num_elements), dirty_elements_per_frame(num_in_flight_frames, std::vector<uint64_t>((num_elements + 63) / 64)) {
         rhi::RhiBufferCreateInfo create_info;
         create_info.size = sizeof(ElementType) * data.size();
         create_info.buffer_usage = rhi::BufferUsage::UniformBuffer;
@@ -67,7 +92,12 @@ namespace nova::renderer {
         for(uint32_t i = 0; i < num_in_flight_frames; i++) {
             create_info.name = fmt::format("CameraBuffer{}", i);
 
-            per_frame_buffers.emplace_back(device.create_buffer(create_info, internal_allocator));
+            per_frame_buffers.emplace_back(device.create_buffer(create_info));
+        }
+
+        // The buffers start out with garbage in them, so every element needs to be uploaded at least once
+        for(uint32_t i = 0; i < num_elements; i++) {
+            mark_dirty(i);
         }
 
         // All camera indices are free at program startup
@@ -78,25 +108,70 @@ namespace nova::renderer {
 
     template <typename ElementType>
     ElementType& PerFrameDeviceArray<ElementType>::operator[](const uint32_t idx) {
+        mark_dirty(idx);
+        return data[idx];
+    }
+
+    template <typename ElementType>
+    const ElementType& PerFrameDeviceArray<ElementType>::operator[](const uint32_t idx) const {
         return data[idx];
     }
 
     template <typename ElementType>
-    ElementType& PerFrameDeviceArray<ElementType>::at(uint32_t idx) {
+    ElementType& PerFrameDeviceArray<ElementType>::at(const uint32_t idx) {
+        mark_dirty(idx);
         return data[idx];
     }
 
+    template <typename ElementType>
+    const ElementType& PerFrameDeviceArray<ElementType>::at(const uint32_t idx) const {
+        return data[idx];
+    }
+
+    template <typename ElementType>
+    void PerFrameDeviceArray<ElementType>::mark_dirty(const uint32_t idx) {
+        for(auto& dirty_elements : dirty_elements_per_frame) {
+            dirty_elements[idx / 64] |= 1ull << (idx % 64);
+        }
+    }
+
     template <typename ElementType>
     void PerFrameDeviceArray<ElementType>::upload_to_device(const uint32_t frame_idx) {
         ZoneScoped;
-        const auto num_bytes_to_write = sizeof(ElementType) * data.size();
+        auto& dirty_elements = dirty_elements_per_frame[frame_idx];
+        const auto is_dirty = [&](const size_t idx) { return (dirty_elements[idx / 64] & (1ull << (idx % 64))) != 0; };
+
+        size_t idx = 0;
+        while(idx < data.size()) {
+            // Most elements don't change most frames, so skip clean words without looking at every bit
+            if(dirty_elements[idx / 64] == 0) {
+                idx = (idx / 64 + 1) * 64;
+                continue;
+            }
+
+            if(!is_dirty(idx)) {
+                idx++;
+                continue;
+            }
+
+            const auto first_dirty_idx = idx;
+            while(idx < data.size() && is_dirty(idx)) {
+                idx++;
+            }
+
+            const auto num_dirty_elements = idx - first_dirty_idx;
+            device.write_data_to_buffer(&data[first_dirty_idx],
+                                        sizeof(ElementType) * num_dirty_elements,
+                                        sizeof(ElementType) * first_dirty_idx,
+                                        per_frame_buffers[frame_idx]);
+        }
 
-        device.write_data_to_buffer(data.data(), num_bytes_to_write, per_frame_buffers[frame_idx]);
+        std::fill(dirty_elements.begin(), dirty_elements.end(), 0);
     }
 
     template <typename ElementType>
     uint32_t PerFrameDeviceArray<ElementType>::get_next_free_slot() {
-        const auto val = free_indices.last();
+        const auto val = free_indices.back();
 
         free_indices.pop_back();
 
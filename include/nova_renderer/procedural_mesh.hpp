@@ -2,24 +2,32 @@
 
 #include <array>
 #include <rx/core/concepts/no_copy.h>
-#include <string>
 #include <cstdint>
+#include <string>
+#include <vector>
 
 #include "nova_renderer/constants.hpp"
 #include "nova_renderer/rhi/forward_decls.hpp"
+#include "nova_renderer/util/bytes.hpp"
 
 namespace nova::renderer {
+    class ProceduralGeometryRing;
+
     /*!
      * \brief ProceduralMesh is a mesh which the user will modify every frame
      *
-     * ProceduralMesh should _not_ be used if you're not going to update the mesh frequently. It stores four copies of the mesh data - once
-     * in host memory, and three times in device memory (one for each in-flight frame)
+     * ProceduralMesh should _not_ be used if you're not going to update the mesh frequently. It keeps a copy of the mesh data in host
+     * memory, and copies it into Nova's procedural geometry ring every frame. The ring is shared by all procedural meshes, so procedural
+     * meshes don't own any GPU buffers of their own
      */
     class ProceduralMesh : rx::concepts::no_copy {
     public:
         struct Buffers {
             rhi::RhiBuffer* vertex_buffer;
             rhi::RhiBuffer* index_buffer;
+
+            mem::Bytes vertex_offset = 0;
+            mem::Bytes index_offset = 0;
         };
 
         ProceduralMesh() = default;
@@ -29,20 +37,18 @@ namespace nova::renderer {
          *
          * \param vertex_buffer_size The number of bytes the vertex buffer needs
          * \param index_buffer_size The number of bytes that the index buffer needs
-         * \param num_in_flight_frames Number of in-flight frames that this proc mesh supports
-         * \param device The device to create the buffers on
+         * \param ring The ring to stream this mesh's data through. This mesh reserves space for its data in every frame of the ring
          * \param name Name of this procedural mesh
          */
         ProceduralMesh(uint64_t vertex_buffer_size,
                        uint64_t index_buffer_size,
-                       uint32_t num_in_flight_frames,
-                       rhi::RenderDevice* device,
+                       ProceduralGeometryRing& ring,
                        const std::string& name = "ProceduralMesh");
 
         ProceduralMesh(ProceduralMesh&& old) noexcept;
         ProceduralMesh& operator=(ProceduralMesh&& old) noexcept;
 
-        ~ProceduralMesh() = default;
+        ~ProceduralMesh();
 
         /*!
          * \brief Sets the data to upload to the vertex buffer
@@ -61,40 +67,38 @@ namespace nova::renderer {
         void set_index_data(const void* data, uint64_t size);
 
         /*!
-         * \brief Records commands to copy the staging buffers to the device buffers for the specified frame
+         * \brief Copies this mesh's data into the current frame's region of the procedural geometry ring
          *
-         * Intent is that you call this method at the beginning or the frame that will use the buffers you're uploading to. It's a method on
-         * this class mostly because writing accessors is hard
+         * Nova calls this at the beginning of every frame, after the ring has started the frame. The ring records the actual upload for
+         * all procedural meshes at once
          *
-         * \param cmds The command list to record commands into
          * \param frame_idx The index of the frame to write the data to
          */
-        void record_commands_to_upload_data(rhi::RhiRenderCommandList* cmds, uint8_t frame_idx) const;
+        void write_to_ring(uint32_t frame_idx);
 
         /*!
-         * \brief Returns the vertex and index buffer for the provided frame
+         * \brief Returns the vertex and index buffer for the provided frame, and where in them this mesh's data is
+         *
+         * The buffers are nullptr if the mesh's data couldn't be written to the ring
          */
         [[nodiscard]] Buffers get_buffers_for_frame(uint8_t frame_idx) const;
 
     private:
-        rhi::RenderDevice* device = nullptr;
+        ProceduralGeometryRing* ring = nullptr;
 
         std::string name;
 
-        std::vector<rhi::RhiBuffer*> vertex_buffers;
-        std::vector<rhi::RhiBuffer*> index_buffers;
-
-        rhi::RhiBuffer* cached_vertex_buffer;
-        rhi::RhiBuffer* cached_index_buffer;
+        std::vector<uint8_t> vertex_data;
+        std::vector<uint8_t> index_data;
 
-        uint64_t num_vertex_bytes_to_upload = 0;
-        uint64_t num_index_bytes_to_upload = 0;
+        uint64_t vertex_buffer_size = 0;
+        uint64_t index_buffer_size = 0;
 
-        rx::memory::allocator* allocator;
+        std::vector<Buffers> buffers_per_frame;
 
-#ifdef NOVA_DEBUG
-        uint64_t vertex_buffer_size;
-        uint64_t index_buffer_size;
-#endif
+        /*!
+         * \brief Number of bytes this mesh reserved in the ring
+         */
+        mem::Bytes num_reserved_bytes = 0;
     };
 } // namespace nova::renderer
@@ -1,9 +1,11 @@
 #pragma once
 
 #include <rx/core/log.h>
+#include <memory>
 #include <unordered_map>
 #include  <optional>
 
+#include "nova_renderer/constants.hpp"
 #include "nova_renderer/frame_context.hpp"
 #include "nova_renderer/procedural_mesh.hpp"
 #include "nova_renderer/renderables.hpp"
@@ -20,6 +22,14 @@ namespace nova::renderer {
     RX_LOG("rendergraph", rg_log);
 
     class DeviceResources;
+    class PipelineVariants;
+
+    /*!
+     * \brief Which of a pipeline's keywords a variant of the pipeline turns on. Bit `i` is the pipeline's `i`th keyword
+     */
+    using PipelineVariantKey = uint64_t;
+
+    static_assert(sizeof(PipelineVariantKey) * 8 >= MAX_PIPELINE_KEYWORDS, "Variant keys need a bit for every keyword");
 
     namespace renderpack {
         struct RenderPassCreateInfo;
@@ -64,6 +74,20 @@ namespace nova::renderer {
         rhi::RhiBuffer* vertex_buffer = nullptr;
         rhi::RhiBuffer* index_buffer = nullptr;
 
+        /*!
+         * \brief Meshlet buffers, for the mesh shader path. Null if the device doesn't support mesh shaders
+         */
+        rhi::RhiBuffer* meshlet_buffer = nullptr;
+        rhi::RhiBuffer* meshlet_vertex_buffer = nullptr;
+        rhi::RhiBuffer* meshlet_primitive_buffer = nullptr;
+        uint32_t num_meshlets = 0;
+
+        /*!
+         * \brief The mesh's bounding sphere, in model space. See `Mesh::bounding_center`
+         */
+        glm::vec3 bounding_center{};
+        float bounding_radius = 0;
+
         /*!
          * \brief A buffer to hold all the per-draw data
          *
@@ -105,20 +129,69 @@ namespace nova::renderer {
         std::vector<rhi::RhiDescriptorSet*> descriptor_sets;
         const rhi::RhiPipelineInterface* pipeline_interface = nullptr;
 
+        /*!
+         * \brief The variant of the pipeline that this pass draws with
+         */
+        PipelineVariantKey variant_key = 0;
+
+        /*!
+         * \brief Whether this pass's pipeline draws with mesh shaders instead of vertex shaders
+         */
+        bool uses_mesh_shaders = false;
+        bool uses_task_shader = false;
+
+        /*!
+         * \brief Names of the resources that this pass binds. The texture streamer picks out the ones that are streamed textures
+         */
+        std::vector<std::string> bound_resource_names;
+
         void record(rhi::RhiRenderCommandList& cmds, FrameContext& ctx) const;
 
+        /*!
+         * \brief Tells the texture streamer how large this pass's textures are on screen, from the bounds of the meshes it draws
+         *
+         * Procedural meshes don't have bounds, so they don't report anything. Textures that nothing reports get every mip the budget
+         * allows
+         */
+        void report_texture_screen_sizes(FrameContext& ctx) const;
+
         static void record_rendering_static_mesh_batch(const MeshBatch<StaticMeshRenderCommand>& batch,
                                                        rhi::RhiRenderCommandList& cmds,
                                                        FrameContext& ctx);
         static void record_rendering_static_mesh_batch(const ProceduralMeshBatch<StaticMeshRenderCommand>& batch,
                                                        rhi::RhiRenderCommandList& cmds,
                                                        FrameContext& ctx);
+
+        /*!
+         * \brief Records drawing a static mesh batch with the mesh shader path
+         *
+         * The task shader, if any, is responsible for culling meshlets
+         */
+        void record_rendering_static_meshlet_batch(const MeshBatch<StaticMeshRenderCommand>& batch,
+                                                   rhi::RhiRenderCommandList& cmds,
+                                                   FrameContext& ctx) const;
     };
 
     struct Pipeline {
+        /*!
+         * \brief The pipeline's base variant, which has all its keywords turned off
+         */
         std::unique_ptr<rhi::RhiPipeline> pipeline{};
         rhi::RhiPipelineInterface* pipeline_interface = nullptr;
 
+        bool uses_mesh_shaders = false;
+        bool uses_task_shader = false;
+
+        /*!
+         * \brief The pipeline's other variants. Null if the pipeline has no keywords
+         */
+        std::shared_ptr<PipelineVariants> variants;
+
+        /*!
+         * \brief Gets the pipeline to draw a variant with, which may be the base variant while the variant is compiling
+         */
+        [[nodiscard]] const rhi::RhiPipeline& get_pipeline_for_variant(PipelineVariantKey key) const;
+
         void record(rhi::RhiRenderCommandList& cmds, FrameContext& ctx) const;
     };
 #pragma endregion
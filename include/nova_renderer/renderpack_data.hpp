@@ -152,6 +152,8 @@ namespace nova::renderer::renderpack {
          */
         WrapMode wrap_mode{};
 
+        bool operator==(const SamplerCreateInfo& other) const = default;
+
         static SamplerCreateInfo from_json(const nlohmann::json& json);
     };
 
@@ -163,12 +165,26 @@ namespace nova::renderer::renderpack {
         uint32_t compare_mask;
         uint32_t write_mask;
 
+        bool operator==(const StencilOpState& other) const = default;
+
         static StencilOpState from_json(const nlohmann::json& json);
     };
 
     struct RenderpackShaderSource {
         std::string filename;
         std::vector<uint32_t> source;
+
+        /*!
+         * \brief The shader's HLSL or GLSL, kept so that Nova can compile the pipeline's other variants later. Empty for SPIR-V files
+         */
+        std::string source_text;
+
+        /*!
+         * \brief Every file that the shader included the last time it was compiled, so that Nova can recompile it when one of them changes
+         */
+        std::vector<std::string> included_files;
+
+        bool operator==(const RenderpackShaderSource& other) const = default;
     };
 
     /*!
@@ -195,6 +211,23 @@ namespace nova::renderer::renderpack {
          */
         std::vector<std::string> defines{};
 
+        /*!
+         * \brief Keywords that material passes may turn on, to pick a variant of this pipeline
+         *
+         * Each keyword is defined in the shaders of the variants that turn it on. Variants are only compiled when something draws with
+         * them, so pipelines can have many keywords without making renderpacks slower to load. A pipeline may have at most
+         * `MAX_PIPELINE_KEYWORDS` keywords
+         */
+        std::vector<std::string> keywords{};
+
+        /*!
+         * \brief Values of the shaders' specialization constants, by name
+         *
+         * Each value is text such as `16`, `0.5`, or `true`. Nova bakes these values into the shaders when it loads the pipeline, then
+         * optimizes away whatever code they turn off
+         */
+        std::unordered_map<std::string, std::string> specialization_constants{};
+
         /*!
          * \brief Defines the rasterizer state that's active for this pipeline
          */
@@ -291,6 +324,17 @@ namespace nova::renderer::renderpack {
         std::optional<RenderpackShaderSource> tessellation_evaluation_shader;
         std::optional<RenderpackShaderSource> fragment_shader;
 
+        /*!
+         * \brief Task shader for the mesh shader path
+         *
+         * If the pipeline has a mesh shader and the GPU supports mesh shaders, Nova uses the task and mesh shaders instead of the vertex
+         * shader. Otherwise, Nova falls back to the vertex shader
+         */
+        std::optional<RenderpackShaderSource> task_shader;
+        std::optional<RenderpackShaderSource> mesh_shader;
+
+        bool operator==(const PipelineData& other) const = default;
+
         static PipelineData from_json(const nlohmann::json& json);
     };
 
@@ -368,6 +412,13 @@ namespace nova::renderer::renderpack {
 
         TextureFormat format{};
 
+        /*!
+         * \brief Number of mip levels in the texture. Not read from renderpacks, render targets only ever have one mip
+         */
+        uint32_t num_mips = 1;
+
+        bool operator==(const TextureCreateInfo& other) const = default;
+
         static TextureCreateInfo from_json(const nlohmann::json& json);
     };
 
@@ -375,6 +426,8 @@ namespace nova::renderer::renderpack {
         std::vector<TextureCreateInfo> render_targets;
         std::vector<SamplerCreateInfo> samplers;
 
+        bool operator==(const RenderpackResourcesData& other) const = default;
+
         static RenderpackResourcesData from_json(const nlohmann::json& json);
     };
 
@@ -460,6 +513,8 @@ namespace nova::renderer::renderpack {
 
         RenderPassCreateInfo() = default;
 
+        bool operator==(const RenderPassCreateInfo& other) const = default;
+
         static RenderPassCreateInfo from_json(const nlohmann::json& json);
     };
 
@@ -477,6 +532,8 @@ namespace nova::renderer::renderpack {
          */
         std::vector<std::string> builtin_passes;
 
+        bool operator==(const RendergraphData& other) const = default;
+
         static RendergraphData from_json(const nlohmann::json& json);
     };
 
@@ -487,6 +544,11 @@ namespace nova::renderer::renderpack {
 
         std::unordered_map<std::string, std::string> bindings;
 
+        /*!
+         * \brief Which of the pipeline's keywords this pass turns on
+         */
+        std::vector<std::string> keywords;
+
         /*!
          * \brief All the descriptor sets needed to bind everything used by this material to its pipeline
          *
@@ -496,6 +558,8 @@ namespace nova::renderer::renderpack {
          */
         std::vector<vk::DescriptorSet> descriptor_sets;
 
+        bool operator==(const MaterialPass& other) const = default;
+
         static MaterialPass from_json(const nlohmann::json& json);
     };
 
@@ -504,6 +568,8 @@ namespace nova::renderer::renderpack {
         std::vector<MaterialPass> passes;
         std::string geometry_filter;
 
+        bool operator==(const MaterialData& other) const = default;
+
         static MaterialData from_json(const nlohmann::json& json);
     };
 
@@ -523,6 +589,8 @@ namespace nova::renderer::renderpack {
         RenderpackResourcesData resources;
 
         std::string name;
+
+        bool operator==(const RenderpackData& other) const = default;
     };
 
     [[nodiscard]] rhi::PixelFormat pixel_format_enum_from_string(const std::string& str);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include  <optional>
+#include <vector>
 
 #include "rhi/pipeline_create_info.hpp"
 
@@ -18,4 +19,9 @@ namespace nova::renderer::renderpack {
 
     std::optional<RhiGraphicsPipelineState> to_pipeline_state_create_info(const renderpack::PipelineData& data,
                                                                         const Rendergraph& rendergraph);
+
+    /*!
+     * \brief Finds the vertex fields that a vertex shader reads
+     */
+    std::vector<rhi::RhiVertexField> get_vertex_fields(const ShaderSource& vertex_shader);
 };
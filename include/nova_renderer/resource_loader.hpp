@@ -1,5 +1,8 @@
 #pragma once
 
+#include <memory>
+#include <span>
+
 #include "nova_renderer/rhi/forward_decls.hpp"
 #include "nova_renderer/rhi/rhi_types.hpp"
 #include "nova_renderer/util/container_accessor.hpp"
@@ -10,6 +13,8 @@ namespace nova::mem {
 
 namespace nova::renderer {
     class NovaRenderer;
+    class TextureCompressor;
+    class TextureStreamer;
 
     namespace rhi {
         enum class PixelFormat;
@@ -41,6 +46,13 @@ namespace nova::renderer {
 
     using BufferResourceAccessor = MapAccessor<std::string, BufferResource>;
 
+    /*!
+     * \brief Size of one pixel of the given format, in bytes
+     *
+     * Block-compressed formats don't have a size per pixel, use `rhi::get_image_size_in_bytes` for those
+     */
+    [[nodiscard]] size_t size_in_bytes(rhi::PixelFormat pixel_format);
+
     /*!
      * \brief Provides a means to access Nova's resources, and also helps in creating resources? IDK yet but that's fine
      *
@@ -50,6 +62,8 @@ namespace nova::renderer {
     public:
         explicit DeviceResources(NovaRenderer& renderer);
 
+        ~DeviceResources();
+
         [[nodiscard]] std::optional<BufferResourceAccessor> create_uniform_buffer(const std::string& name, mem::Bytes size);
 
         [[nodiscard]] std::optional<BufferResourceAccessor> get_uniform_buffer(const std::string& name);
@@ -59,13 +73,20 @@ namespace nova::renderer {
         /*!
          * \brief Creates a new dynamic texture with the provided initial texture data
          *
+         * If `data` is RGBA8 pixels, this generates the rest of the texture's mip chain and compresses it to BC1 or BC7, depending on
+         * `NovaSettings::texture_loading`
+         *
+         * Once the texture streamer has been set, textures with a CPU-side mip chain are streamed: they start with only their smallest
+         * mips resident, and the streamer loads the rest when the texture gets used
+         *
          * \param name The name of the texture. After the texture can been created, you can use this to refer to it
          * \param width The width of the texture
          * \param height The height of the texture
          * \param pixel_format The format of the pixels in this texture
          * \param data The initial data for this texture. Must be large enough to have all the pixels in the texture
          * \param allocator The allocator to allocate with
-         * \return The newly-created image, or nullptr if the image could not be created. Check the Nova logs to find out why
+         * \return The newly-created image, or nullptr if the image could not be created. Check the Nova logs to find out why. The
+         * accessor's index is the texture's slot in the bindless texture table
          */
         [[nodiscard]] std::optional<TextureResourceAccessor> create_texture(const std::string& name,
                                                                            size_t width,
@@ -74,6 +95,94 @@ namespace nova::renderer {
                                                                            const void* data,
                                                                            rx::memory::allocator& allocator);
 
+        /*!
+         * \brief Creates a texture from the contents of a DDS or KTX2 file
+         *
+         * Block-compressed files are uploaded as-is. RGBA8 files with a single mip go through `create_texture`, so they get mips and
+         * compression like any other RGBA8 texture
+         *
+         * \param name The name of the texture
+         * \param file_data The whole file
+         *
+         * \return The new texture, or an empty optional if the file couldn't be parsed or the texture couldn't be created
+         */
+        [[nodiscard]] std::optional<TextureResourceAccessor> create_texture_from_file(const std::string& name,
+                                                                                     std::span<const uint8_t> file_data);
+
+        /*!
+         * \brief Creates a new texture with some or all of its mips
+         *
+         * \param num_mips The number of mips that the texture has
+         * \param mip_data Tightly-packed pixels for each mip, starting at the first. See `create_texture_image`
+         *
+         * See `create_texture` for the other parameters and the return value
+         */
+        [[nodiscard]] std::optional<TextureResourceAccessor> create_texture_with_mips(const std::string& name,
+                                                                                     size_t width,
+                                                                                     size_t height,
+                                                                                     rhi::PixelFormat pixel_format,
+                                                                                     uint32_t num_mips,
+                                                                                     std::span<const void* const> mip_data,
+                                                                                     rx::memory::allocator& allocator);
+
+        /*!
+         * \brief Creates a sampled image and uploads its mips, without adding it to the texture table
+         *
+         * \param name The name of the image, for debugging
+         * \param width The width of the image's first mip
+         * \param height The height of the image's first mip
+         * \param pixel_format The format of the pixels in the image
+         * \param num_mips The number of mips that the image has
+         * \param mip_data Tightly-packed pixels for each mip, starting at the first. May have fewer elements than `num_mips`, in which
+         * case the remaining mips are left uninitialized
+         * \param allocator The allocator to allocate with
+         * \param generate_remaining_mips If true, fill the mips that `mip_data` doesn't have by blitting them from the first mip on the GPU.
+         * Doesn't work for block-compressed formats
+         *
+         * \return The new image, or nullptr if the image could not be created
+         */
+        [[nodiscard]] rhi::RhiImage* create_texture_image(const std::string& name,
+                                                          size_t width,
+                                                          size_t height,
+                                                          rhi::PixelFormat pixel_format,
+                                                          uint32_t num_mips,
+                                                          std::span<const void* const> mip_data,
+                                                          rx::memory::allocator& allocator,
+                                                          bool generate_remaining_mips = false);
+
+        /*!
+         * \brief Points a texture, and its slot in the texture table, at a different image
+         *
+         * \param idx The texture's slot in the texture table
+         * \param image The texture's new image
+         * \param width The width of the new image's first mip
+         * \param height The height of the new image's first mip
+         *
+         * \return The texture's old image. The GPU may still be reading from it, so don't destroy it until every in-flight frame is done
+         */
+        [[nodiscard]] rhi::RhiImage* replace_texture_image(uint32_t idx, rhi::RhiImage* image, size_t width, size_t height);
+
+        /*!
+         * \brief Records commands that upload mips to an image that was just created with `create_texture_image`
+         *
+         * The image ends up ready for shaders on the graphics queue to read
+         *
+         * \param queue The queue that `cmds` will be submitted to
+         * \param staging_buffers_out Receives the staging buffers that the upload reads from. Return them with `return_staging_buffer`
+         * once the GPU is done with `cmds`
+         *
+         * See `create_texture_image` for the other parameters
+         */
+        void record_texture_image_upload(rhi::RhiImage* image,
+                                         size_t width,
+                                         size_t height,
+                                         rhi::PixelFormat pixel_format,
+                                         std::span<const void* const> mip_data,
+                                         rhi::RhiRenderCommandList& cmds,
+                                         rhi::QueueType queue,
+                                         std::vector<rhi::RhiBuffer*>& staging_buffers_out,
+                                         bool generate_remaining_mips = false);
+
         [[nodiscard]] std::optional<uint32_t> get_texture_idx_for_name(const std::string& name) const;
 
         /*!
@@ -113,6 +222,23 @@ namespace nova::renderer {
 
         void destroy_render_target(const std::string& texture_name, rx::memory::allocator& allocator);
 
+        /*!
+         * \brief Removes a texture from the texture table without destroying its image
+         *
+         * The texture's slot samples the white texture until a new texture reuses it
+         *
+         * \return The texture's image, or nullptr if there's no texture with that name. The GPU may still be reading from it, so don't
+         * destroy it until every in-flight frame is done
+         */
+        [[nodiscard]] rhi::RhiImage* remove_texture_from_table(const std::string& texture_name);
+
+        /*!
+         * \brief Makes `create_texture` and `create_texture_from_file` stream their textures with the given streamer
+         *
+         * The default textures are created before the streamer exists, so they're always fully resident
+         */
+        void set_texture_streamer(TextureStreamer* streamer);
+
         /*!
          * \brief Retrieves a staging buffer at least the specified size
          *
@@ -124,6 +250,18 @@ namespace nova::renderer {
 
         void return_staging_buffer(rhi::RhiBuffer* buffer);
 
+        /*!
+         * \brief Destroys every staging buffer in the pool, to give their memory back when we're running low
+         *
+         * Staging buffers which haven't been returned yet are left alone
+         */
+        void release_staging_buffers();
+
+        /*!
+         * \brief All the textures, in the order of their slots in the bindless texture table
+         *
+         * Slots which were freed and haven't been reused yet have a null image
+         */
         [[nodiscard]] const std::vector<TextureResource>& get_all_textures() const;
 
     private:
@@ -137,12 +275,41 @@ namespace nova::renderer {
 
         std::unordered_map<std::string, uint32_t> texture_name_to_idx;
 
+        /*!
+         * \brief Slots in the texture table whose textures have been destroyed, so new textures can use them
+         */
+        std::vector<uint32_t> free_texture_slots;
+
         std::unordered_map<std::string, TextureResource> render_targets;
 
         std::unordered_map<size_t, std::vector<rhi::RhiBuffer*>> staging_buffers;
 
         std::unordered_map<std::string, BufferResource> uniform_buffers;
 
+        std::unique_ptr<TextureCompressor> texture_compressor;
+
+        TextureStreamer* texture_streamer = nullptr;
+
+        /*!
+         * \brief Puts an image in the next free slot of the texture table. Destroys the image if the table is full
+         */
+        [[nodiscard]] std::optional<TextureResourceAccessor> add_texture_to_table(const std::string& name,
+                                                                                 size_t width,
+                                                                                 size_t height,
+                                                                                 rhi::PixelFormat pixel_format,
+                                                                                 rhi::RhiImage* image,
+                                                                                 rx::memory::allocator& allocator);
+
+        /*!
+         * \brief Creates a texture from a whole mip chain, streaming it if there's a texture streamer
+         */
+        [[nodiscard]] std::optional<TextureResourceAccessor> create_texture_from_mip_chain(const std::string& name,
+                                                                                          size_t width,
+                                                                                          size_t height,
+                                                                                          rhi::PixelFormat pixel_format,
+                                                                                          std::vector<std::vector<uint8_t>> mips,
+                                                                                          rx::memory::allocator& allocator);
+
         void create_default_textures();
     };
 } // namespace nova::renderer
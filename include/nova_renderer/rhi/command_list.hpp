@@ -1,12 +1,17 @@
 #pragma once
 
 #include <cstdint> // needed for uint****
+#include <span>
 
 #include "nova_renderer/rhi/forward_decls.hpp"
 #include "nova_renderer/rhi/rhi_enums.hpp"
 #include "nova_renderer/rhi/rhi_types.hpp"
 
 namespace nova {
+    namespace mem {
+        class FrameArena;
+    }
+
     namespace renderer {
         struct RhiGraphicsPipelineState;
         class Camera;
@@ -49,6 +54,20 @@ namespace nova::renderer::rhi {
         RhiRenderCommandList(const RhiRenderCommandList& other) = delete;
         RhiRenderCommandList& operator=(const RhiRenderCommandList& other) = delete;
 
+        /*!
+         * \brief Sets the arena that this command list allocates its temporary memory from
+         *
+         * The arena must stay alive until the command list is done recording. Command lists without an arena use the heap
+         */
+        void set_frame_arena(mem::FrameArena* arena) { frame_arena = arena; }
+
+        /*!
+         * \brief The arena that this command list allocates its per-frame memory from, or nullptr if it uses the heap
+         *
+         * Code which records into the command list can put its own temporary allocations here too
+         */
+        [[nodiscard]] mem::FrameArena* get_frame_arena() const { return frame_arena; }
+
         /*!
          * \brief Sets the debug name of this command list, so that API debugging tools can give you a nice name
          */
@@ -56,19 +75,31 @@ namespace nova::renderer::rhi {
 
         /*!
          * \brief Bind the buffers of all the resources that Nova needs to render an object
+         *
+         * Textures come from the device's bindless texture table, see `RenderDevice::set_texture_table_slot`
+         *
+         * \param virtual_texture_info_buffer Describes every virtual texture's page table. See `VirtualTextureSystem`
+         * \param virtual_texture_feedback_buffer Shaders write the virtual texture pages they wanted into this buffer
+         *
+         * \param frame_idx The in-flight frame that this command list will be submitted for. Each frame has its own standard descriptor
+         * set, which is only updated when the resources in it change
          */
         virtual void bind_material_resources(RhiBuffer* camera_buffer,
                                              RhiBuffer* material_buffer,
                                              RhiSampler* point_sampler,
                                              RhiSampler* bilinear_sampler,
                                              RhiSampler* trilinear_sampler,
-                                             const std::vector<RhiImage*>& images,
-                                             rx::memory::allocator& allocator) = 0;
+                                             RhiBuffer* virtual_texture_info_buffer,
+                                             RhiBuffer* virtual_texture_feedback_buffer,
+                                             uint32_t frame_idx) = 0;
 
         /*!
          * \brief Uses the provided resource binder to bind resources to the command list
+         *
+         * \param frame_idx The in-flight frame that this command list will be submitted for. Resource binders keep separate descriptors
+         * for each frame, so that changing a binding never touches descriptors that the GPU might be using
          */
-        virtual void bind_resources(RhiResourceBinder& binder) = 0;
+        virtual void bind_resources(RhiResourceBinder& binder, uint32_t frame_idx) = 0;
 
         /*!
          * \brief Inserts a barrier so that all access to a resource before the barrier is resolved before any access
@@ -80,7 +111,7 @@ namespace nova::renderer::rhi {
          */
         virtual void resource_barriers(PipelineStage stages_before_barrier,
                                        PipelineStage stages_after_barrier,
-                                       const std::vector<RhiResourceBarrier>& barriers) = 0;
+                                       std::span<const RhiResourceBarrier> barriers) = 0;
 
         /*!
          * \brief Records a command to copy one region of a buffer to another buffer
@@ -112,15 +143,45 @@ namespace nova::renderer::rhi {
          * \param image The image to upload the data to. Must be in the CopyDestination state
          * \param width The width of the image in pixels
          * \param height The height of the image in pixels
-         * \param bytes_per_pixel The number of bytes that each pixel uses
+         * \param num_bytes The size of the data, in bytes. See `get_image_size_in_bytes`
          * \param staging_buffer The buffer to use to upload the data to the image. This buffer must be host writable, and must be in the
          * CopySource state
          * \param data A pointer to the data to upload to the image
+         * \param mip_level The mip level to upload to. `width` and `height` are the size of that mip level
          *
          * \note The image must be in the Common layout prior to uploading data to it
          */
-        virtual void upload_data_to_image(
-            RhiImage* image, size_t width, size_t height, size_t bytes_per_pixel, RhiBuffer* staging_buffer, const void* data) = 0;
+        virtual void upload_data_to_image(RhiImage* image,
+                                          size_t width,
+                                          size_t height,
+                                          mem::Bytes num_bytes,
+                                          RhiBuffer* staging_buffer,
+                                          const void* data,
+                                          uint32_t mip_level) = 0;
+
+        /*!
+         * \brief Records a command to copy tightly-packed pixels from a buffer to a region of an image
+         *
+         * \param image The image to copy to. Must be in the CopyDestination state
+         * \param region The region of the image to write to
+         * \param source_buffer The buffer to read the pixels from
+         * \param source_offset Where in the buffer the pixels start
+         */
+        virtual void copy_buffer_to_image(RhiImage* image,
+                                          const RhiImageRegion& region,
+                                          RhiBuffer* source_buffer,
+                                          mem::Bytes source_offset) = 0;
+
+        /*!
+         * \brief Records commands to fill every mip of an image after the first by downsampling the mip before it
+         *
+         * Only works on command lists for the graphics queue, and only for formats which support linear blits - so not for
+         * block-compressed formats
+         *
+         * \param image The image to generate mips for. Must be in the CopyDestination state, and its first mip must have data. Ends up in
+         * the ShaderRead state
+         */
+        virtual void generate_mips(RhiImage* image) = 0;
 
         /*!
          * \brief Executed a number of command lists
@@ -151,6 +212,11 @@ namespace nova::renderer::rhi {
 
         virtual void set_material_index(uint32_t index) = 0;
 
+        /*!
+         * \brief Sets the index of the model matrix that subsequent drawcalls will use
+         */
+        virtual void set_model_matrix_index(uint32_t index) = 0;
+
         virtual void set_pipeline(const RhiPipeline& pipeline) = 0;
 
         virtual void bind_descriptor_sets(const std::vector<RhiDescriptorSet*>& descriptor_sets,
@@ -164,7 +230,17 @@ namespace nova::renderer::rhi {
          *
          * \param buffers The buffers to bind
          */
-        virtual void bind_vertex_buffers(const std::vector<RhiBuffer*>& buffers) = 0;
+        virtual void bind_vertex_buffers(std::span<RhiBuffer* const> buffers) = 0;
+
+        /*!
+         * \brief Binds the provided vertex buffers to the command list, starting at the provided offsets
+         *
+         * Useful when many meshes share one buffer, like the procedural geometry ring
+         *
+         * \param buffers The buffers to bind
+         * \param offsets The offset into each buffer where the vertex data starts. Must be the same size as `buffers`
+         */
+        virtual void bind_vertex_buffers(std::span<RhiBuffer* const> buffers, std::span<const mem::Bytes> offsets) = 0;
 
         /*!
          * \brief Binds the provided index buffer to the command list
@@ -173,6 +249,13 @@ namespace nova::renderer::rhi {
          */
         virtual void bind_index_buffer(const RhiBuffer* buffer, IndexType index_size) = 0;
 
+        /*!
+         * \brief Binds the provided index buffer to the command list, starting at the provided offset
+         *
+         * The offset must be a multiple of the index size
+         */
+        virtual void bind_index_buffer(const RhiBuffer* buffer, IndexType index_size, mem::Bytes offset) = 0;
+
         /*!
          * \brief Records rendering instances of an indexed mesh
          *
@@ -182,8 +265,37 @@ namespace nova::renderer::rhi {
          */
         virtual void draw_indexed_mesh(uint32_t num_indices, uint32_t offset = 0, uint32_t num_instances = 1) = 0;
 
+        /*!
+         * \brief Binds the buffers that the mesh shader path reads a mesh's geometry from
+         *
+         * Only valid when the device supports mesh shaders and a pipeline with a mesh shader is bound
+         *
+         * \param vertex_buffer The mesh's vertex buffer
+         * \param meshlet_buffer Buffer with all the mesh's meshlets
+         * \param meshlet_vertex_buffer Buffer with the meshlets' vertex indices
+         * \param meshlet_primitive_buffer Buffer with the meshlets' packed triangles
+         */
+        virtual void bind_meshlet_buffers(RhiBuffer* vertex_buffer,
+                                          RhiBuffer* meshlet_buffer,
+                                          RhiBuffer* meshlet_vertex_buffer,
+                                          RhiBuffer* meshlet_primitive_buffer) = 0;
+
+        /*!
+         * \brief Launches mesh shader work
+         *
+         * If the current pipeline has a task shader, this launches `num_tasks` task shader workgroups. Otherwise it launches `num_tasks`
+         * mesh shader workgroups
+         *
+         * \param num_tasks The number of workgroups to launch
+         * \param first_task The index of the first workgroup
+         */
+        virtual void draw_mesh_tasks(uint32_t num_tasks, uint32_t first_task = 0) = 0;
+
         virtual void set_scissor_rect(uint32_t x, uint32_t y, uint32_t width, uint32_t height) = 0;
 
         virtual ~RhiRenderCommandList() = default;
+
+    protected:
+        mem::FrameArena* frame_arena = nullptr;
     };
 } // namespace nova::renderer::rhi
@@ -10,11 +10,13 @@ namespace nova::renderer {
         struct RhiRenderpass;
         struct RhiFramebuffer;
         struct RhiPipelineInterface;
+        struct RhiRecompiledPipeline;
         struct RhiFence;
         struct RhiSemaphore;
         struct RhiResource;
         struct RhiBuffer;
         struct RhiImage;
+        struct RhiImageRange;
         struct RhiDeviceMemory;
         struct RhiSampler;
         struct RhiPresentSemaphore;
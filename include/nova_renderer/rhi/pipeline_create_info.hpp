@@ -110,6 +110,12 @@ namespace nova::renderer {
          * \brief Maximum amount of allowed depth bias
          */
         float maximum_depth_bias = 0;
+
+        /*!
+         * \brief Checks if the depth bias is turned on. The amount of bias is dynamic state, so pipelines which only differ in their
+         * amount of bias can share a PSO
+         */
+        [[nodiscard]] bool uses_depth_bias() const { return depth_bias != 0 || slope_scaled_depth_bias != 0; }
     };
 
     struct MultisamplingState {
@@ -158,6 +164,8 @@ namespace nova::renderer {
 
         /*!
          * \brief Reference value to use in the stencil test
+         *
+         * This is dynamic state, so pipelines which only differ in their reference values can share a PSO
          */
         uint32_t reference_value{};
     };
@@ -350,6 +358,22 @@ namespace nova::renderer {
          */
         std::string name{};
 
+        /*!
+         * \brief Name of the pipeline to render with while this one is still compiling
+         *
+         * The fallback must render in the same renderpass as this pipeline. If it isn't ready either, draws that use this pipeline are
+         * skipped until it is
+         */
+        std::optional<std::string> fallback{};
+
+        /*!
+         * \brief Name of the pipeline that this pipeline derives from
+         *
+         * Devices may build this pipeline from its parent, if the parent is ready by then, which is quicker when they only differ in a
+         * little state. The parent must render in the same renderpass as this pipeline
+         */
+        std::optional<std::string> parent{};
+
         /*!
          * \brief Vertex shader to use
          */
@@ -366,17 +390,31 @@ namespace nova::renderer {
         std::optional<ShaderSource> pixel_shader{};
 
         /*!
-         * \brief Description of the fields in the vertex data
+         * \brief Task shader to use
+         *
+         * Only used when the pipeline has a mesh shader
          */
-        std::vector<rhi::RhiVertexField> vertex_fields{};
+        std::optional<ShaderSource> task_shader{};
 
         /*!
-         * \brief Size of the viewport that this pipeline state renders to, measured in pixels
+         * \brief Mesh shader to use
+         *
+         * If this is present, the pipeline uses the mesh shader path instead of the vertex shader path. The vertex shader and vertex
+         * fields are ignored. Only set this if the device supports mesh shaders
          */
-        glm::vec2 viewport_size{};
+        std::optional<ShaderSource> mesh_shader{};
+
+        /*!
+         * \brief Description of the fields in the vertex data
+         */
+        std::vector<rhi::RhiVertexField> vertex_fields{};
 
         /*!
          * \brief Enables the scissor test, allowing e.g. UI elements to only render to a specific portion of the screen
+         *
+         * The viewport and scissor rect are always dynamic state, so pipelines don't depend on the size of the framebuffer that they
+         * render to, and resizing it doesn't recompile them. Pipelines without the scissor test get a scissor rect that covers the whole
+         * framebuffer
          */
         bool enable_scissor_test = false;
 
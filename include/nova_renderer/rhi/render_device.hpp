@@ -1,5 +1,7 @@
 #pragma once
 
+#include <span>
+
 #include "nova_renderer/nova_settings.hpp"
 #include "nova_renderer/renderpack_data.hpp"
 #include "nova_renderer/rhi/command_list.hpp"
@@ -47,6 +49,13 @@ namespace nova::renderer::rhi {
 
         mem::Bytes max_texture_size = 0;
 
+        /*!
+         * \brief Number of slots in the bindless texture table
+         *
+         * This is as many textures as the device can put in a single descriptor binding, up to MAX_NUM_TEXTURES
+         */
+        uint32_t max_num_textures = 0;
+
         bool is_uma = false;
 
         bool supports_raytracing = false;
@@ -116,6 +125,45 @@ namespace nova::renderer::rhi {
 
         [[nodiscard]] virtual std::unique_ptr<RhiResourceBinder> create_resource_binder_for_pipeline(const RhiPipeline& pipeline) = 0;
 
+        /*!
+         * \brief Compiles a pipeline for a renderpass ahead of time, so that command lists don't have to compile it the first time they use
+         * it
+         *
+         * Safe to call from many threads at once. Command lists which use the pipeline while it's compiling use its fallback pipeline instead
+         * of waiting for it. Does nothing if the pipeline is already compiled for the renderpass, or is being compiled on another thread
+         *
+         * \return False if the pipeline couldn't be compiled, true otherwise
+         */
+        virtual bool compile_pipeline_for_renderpass(const RhiPipeline& pipeline, RhiRenderpass& renderpass) = 0;
+
+        /*!
+         * \brief Marks a pipeline as waiting to be compiled for a renderpass, such as by a job that's queued on the worker pool
+         *
+         * Until `compile_pipeline_for_renderpass` finishes with the pipeline, command lists treat it like it's compiling: they use its
+         * fallback rather than compiling it themselves
+         */
+        virtual void mark_pipeline_pending(const RhiPipeline& pipeline, RhiRenderpass& renderpass) = 0;
+
+        /*!
+         * \brief Compiles a new version of a pipeline which may already be compiled for a renderpass, such as after its shaders were
+         * reloaded
+         *
+         * Safe to call from many threads at once. Command lists keep using the old version until you install the new one with
+         * `install_recompiled_pipeline`, so the caller decides exactly when to switch
+         *
+         * \return The new version, or nullptr if the pipeline couldn't be compiled, in which case command lists keep using the old version
+         */
+        [[nodiscard]] virtual std::unique_ptr<RhiRecompiledPipeline> recompile_pipeline_for_renderpass(const RhiPipeline& pipeline,
+                                                                                                       RhiRenderpass& renderpass) = 0;
+
+        /*!
+         * \brief Makes command lists use a recompiled pipeline from now on
+         *
+         * Call this from the render thread between frames, so a frame never draws with both versions. The old version is destroyed once
+         * the in-flight frames are done with it
+         */
+        virtual void install_recompiled_pipeline(RhiRecompiledPipeline& pipeline) = 0;
+
         /*!
          * \brief Creates a buffer with undefined contents
          */
@@ -137,7 +185,38 @@ namespace nova::renderer::rhi {
         virtual void write_data_to_buffer(const void* data, mem::Bytes num_bytes, const RhiBuffer* buffer) = 0;
 
         /*!
-         * \brief Creates a new Sampler object
+         * \brief Writes data to a range of a buffer
+         *
+         * Reads num_bytes bytes from data, and writes them to the buffer starting at offset. Useful when you only changed part of a
+         * buffer and don't want to re-upload the whole thing
+         *
+         * Like the other overload, the CPU must be able to write directly to the buffer
+         *
+         * \param data The data to upload
+         * \param num_bytes The number of bytes to write
+         * \param offset Where in the buffer to start writing
+         * \param buffer The buffer to write to
+         */
+        virtual void write_data_to_buffer(const void* data, mem::Bytes num_bytes, mem::Bytes offset, const RhiBuffer* buffer) = 0;
+
+        /*!
+         * \brief Reads data that the GPU wrote to a buffer
+         *
+         * The buffer must be a `BufferUsage::ReadbackBuffer`, and the GPU must be done writing to it - wait for the fence of the frame
+         * that wrote it first
+         *
+         * \param data Where to write the data to
+         * \param num_bytes The number of bytes to read
+         * \param offset Where in the buffer to start reading
+         * \param buffer The buffer to read from
+         */
+        virtual void read_data_from_buffer(void* data, mem::Bytes num_bytes, mem::Bytes offset, const RhiBuffer* buffer) = 0;
+
+        /*!
+         * \brief Gets a sampler with the given parameters
+         *
+         * Samplers are shared: asking for a sampler with the same create info as an existing sampler gives you the existing sampler.
+         * Every call to this method must be matched with a call to `destroy_sampler`
          */
         [[nodiscard]] virtual RhiSampler* create_sampler(const RhiSamplerCreateInfo& create_info) = 0;
 
@@ -163,9 +242,9 @@ namespace nova::renderer::rhi {
          *
          * \param fences All the fences to wait for
          */
-        virtual void wait_for_fences(std::vector<RhiFence*> fences) = 0;
+        virtual void wait_for_fences(std::span<RhiFence* const> fences) = 0;
 
-        virtual void reset_fences(const std::vector<RhiFence*>& fences) = 0;
+        virtual void reset_fences(std::span<RhiFence* const> fences) = 0;
 
         /*!
          * \brief Clean up any GPU objects a Renderpass may own
@@ -191,6 +270,31 @@ namespace nova::renderer::rhi {
          */
         virtual void destroy_texture(RhiImage* resource) = 0;
 
+        /*!
+         * \brief Releases a sampler from `create_sampler`. The sampler is destroyed when nothing is using it anymore
+         */
+        virtual void destroy_sampler(RhiSampler* sampler) = 0;
+
+        /*!
+         * \brief Puts an image in a slot of the bindless texture table
+         *
+         * Surface pipelines can read every texture in the table. Each in-flight frame has its own copy of the table, and a frame only
+         * rewrites the slots which changed since the last time it was rendered, so this is cheap to call whenever a texture is created
+         *
+         * The device doesn't track which slots are in use, that's the caller's job
+         *
+         * \param slot The slot to write to. Must be less than `info.max_num_textures`
+         * \param image The image to put in the slot
+         */
+        virtual void set_texture_table_slot(uint32_t slot, RhiImage* image) = 0;
+
+        /*!
+         * \brief Clean up any GPU objects a Buffer may own
+         *
+         * You must make sure that the GPU is done with the buffer before you destroy it
+         */
+        virtual void destroy_buffer(RhiBuffer* buffer) = 0;
+
         /*!
          * \brief Clean up any GPU objects a Semaphores may own
          *
@@ -233,6 +337,28 @@ namespace nova::renderer::rhi {
                                          const std::vector<RhiSemaphore*>& wait_semaphores = {},
                                          const std::vector<RhiSemaphore*>& signal_semaphores = {}) = 0;
 
+        /*!
+         * \brief Gets how much memory we're using in each heap and each category, and how much the driver says we can use
+         *
+         * The heap budgets are refreshed at most once a frame, in `begin_frame`
+         */
+        [[nodiscard]] virtual RhiMemoryStats get_memory_stats() const = 0;
+
+        /*!
+         * \brief Writes the pipeline cache to disk, so that the next run of Nova can skip compiling the pipelines we've already compiled
+         *
+         * The device also saves the cache when it's destroyed. This is for saving at other good times, such as when a renderpack is
+         * unloaded
+         */
+        virtual void save_pipeline_cache() = 0;
+
+        /*!
+         * \brief Lets the device reclaim the transient resources of the given frame
+         *
+         * Call this after waiting for the frame's fence, and before recording any commands for the frame
+         */
+        virtual void begin_frame(uint32_t frame_idx) = 0;
+
         /*!
          * \brief Performs any work that's needed to end the provided frame
          */
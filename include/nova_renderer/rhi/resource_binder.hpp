@@ -18,6 +18,11 @@ namespace nova::renderer {
 
         virtual void bind_image(const std::string& binding_name, rhi::RhiImage* image) = 0;
 
+        /*!
+         * \brief Binds only some of an image's mip levels and array layers
+         */
+        virtual void bind_image_range(const std::string& binding_name, rhi::RhiImage* image, const rhi::RhiImageRange& range) = 0;
+
         virtual void bind_buffer(const std::string& binding_name, rhi::RhiBuffer* buffer) = 0;
 
         virtual void bind_sampler(const std::string& binding_name, rhi::RhiSampler* sampler) = 0;
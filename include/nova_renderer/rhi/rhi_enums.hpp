@@ -23,6 +23,25 @@ namespace nova::renderer::rhi {
         Rgba32F,
         Depth32,
         Depth24Stencil8,
+
+        /*!
+         * \brief RGBA8 with sRGB-encoded color. Nova generates mips for these textures in linear space
+         */
+        Rgba8Srgb,
+
+        // Block-compressed formats. Each 4x4 block of pixels is stored in 8 or 16 bytes
+        Bc1Rgba,
+        Bc1RgbaSrgb,
+        Bc2Rgba,
+        Bc2RgbaSrgb,
+        Bc3Rgba,
+        Bc3RgbaSrgb,
+        Bc4R,
+        Bc5Rg,
+        Bc6hRgbUfloat,
+        Bc6hRgbSfloat,
+        Bc7Rgba,
+        Bc7RgbaSrgb,
     };
 
     enum class TextureUsage {
@@ -158,6 +177,21 @@ namespace nova::renderer::rhi {
         IndexBuffer,
         VertexBuffer,
         StagingBuffer,
+
+        /*!
+         * \brief A device-local buffer that shaders read as a structured buffer, such as meshlet data
+         */
+        StorageBuffer,
+
+        /*!
+         * \brief A device-local buffer that holds both vertices and indices, and is filled with copies from a staging buffer
+         */
+        GeometryBuffer,
+
+        /*!
+         * \brief A buffer that shaders write to and the CPU reads back, such as the virtual texture feedback buffer
+         */
+        ReadbackBuffer,
     };
 
     enum class ResourceType {
@@ -165,6 +199,37 @@ namespace nova::renderer::rhi {
         Image,
     };
 
+    /*!
+     * \brief What a GPU allocation is for, so that we can see what's using up VRAM
+     */
+    enum class MemoryCategory {
+        /*!
+         * \brief Vertex, index, and geometry buffers
+         */
+        Geometry,
+
+        /*!
+         * \brief Sampled images
+         */
+        Textures,
+
+        RenderTargets,
+
+        /*!
+         * \brief Staging and readback buffers
+         */
+        Staging,
+
+        /*!
+         * \brief Uniform and storage buffers
+         */
+        Other,
+
+        Count,
+    };
+
+    constexpr size_t NUM_MEMORY_CATEGORIES = static_cast<size_t>(MemoryCategory::Count);
+
     enum class TextureFilter {
         Point,
         Bilinear,
@@ -181,7 +246,20 @@ namespace nova::renderer::rhi {
 
     bool is_depth_format(PixelFormat format);
 
+    bool is_block_compressed_format(PixelFormat format);
+
+    /*!
+     * \brief Number of bytes that an image of the given size and format takes up
+     *
+     * Block-compressed images are rounded up to a whole number of 4x4 blocks
+     */
+    size_t get_image_size_in_bytes(PixelFormat format, uint32_t width, uint32_t height);
+
     uint32_t get_byte_size(VertexFieldFormat format);
 
     std::string descriptor_type_to_string(DescriptorType type);
+
+    const char* to_string(MemoryCategory category);
+
+    [[nodiscard]] MemoryCategory get_memory_category(BufferUsage usage);
 } // namespace nova::renderer::rhi
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+
 #include <glm/glm.hpp>
 
 #include "nova_renderer/renderpack_data.hpp"
@@ -46,10 +48,78 @@ namespace nova::renderer::rhi {
 
         float min_lod = 0;
         float max_lod = 0;
+
+        bool operator==(const RhiSamplerCreateInfo& other) const = default;
     };
 
     struct RhiSampler {};
 
+    /*!
+     * \brief A range of mip levels and array layers in an image
+     *
+     * Lets shaders read from just part of an image, e.g. a single mip level
+     */
+    struct RhiImageRange {
+        uint32_t base_mip_level = 0;
+        uint32_t num_mip_levels = 1;
+
+        uint32_t base_array_layer = 0;
+        uint32_t num_array_layers = 1;
+
+        bool operator==(const RhiImageRange& other) const = default;
+    };
+
+    /*!
+     * \brief A rectangle of pixels in one mip level of an image
+     */
+    struct RhiImageRegion {
+        uint32_t mip_level = 0;
+
+        uint32_t x = 0;
+        uint32_t y = 0;
+
+        uint32_t width = 0;
+        uint32_t height = 0;
+    };
+
+    /*!
+     * \brief How much of one memory heap we're using, and how much we can use before things get slow or allocations fail
+     */
+    struct RhiMemoryHeapBudget {
+        mem::Bytes usage = 0;
+
+        /*!
+         * \brief How much of the heap we can use. This is an estimate from the driver, and it changes as other programs use the GPU
+         */
+        mem::Bytes budget = 0;
+
+        /*!
+         * \brief Whether the heap is VRAM. On UMA devices every heap is
+         */
+        bool is_device_local = false;
+    };
+
+    /*!
+     * \brief The most memory heaps that a device can have. Same as VK_MAX_MEMORY_HEAPS
+     */
+    constexpr uint32_t MAX_MEMORY_HEAPS = 16;
+
+    struct RhiMemoryStats {
+        /*!
+         * \brief The budget of each of the device's heaps. Only the first `num_heaps` are valid
+         *
+         * This is a fixed-size array so that reading the stats every frame doesn't allocate
+         */
+        std::array<RhiMemoryHeapBudget, MAX_MEMORY_HEAPS> heaps = {};
+
+        uint32_t num_heaps = 0;
+
+        /*!
+         * \brief Bytes allocated for each `MemoryCategory`, across all heaps. Index with the category
+         */
+        std::array<size_t, NUM_MEMORY_CATEGORIES> usage_per_category = {};
+    };
+
     struct RhiTextureCreateInfo {
         TextureUsage usage;
     };
@@ -74,6 +144,14 @@ namespace nova::renderer::rhi {
         std::string name;
     };
 
+    /*!
+     * \brief A new version of a pipeline in a renderpass, which command lists don't use until it's installed with
+     * `RenderDevice::install_recompiled_pipeline`
+     */
+    struct RhiRecompiledPipeline {
+        virtual ~RhiRecompiledPipeline() = default;
+    };
+
     struct RhiFramebuffer {
         glm::uvec2 size;
 
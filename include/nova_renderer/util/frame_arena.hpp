@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "nova_renderer/util/bytes.hpp"
+
+namespace nova::mem {
+    /*!
+     * \brief Bump allocator for memory that only needs to live for a single frame
+     *
+     * Allocating is just bumping a pointer, and nothing is freed until the whole arena is reset. Nova keeps one arena per in-flight frame,
+     * and resets a frame's arena once that frame's fence has signaled
+     *
+     * If the arena runs out of space it falls back to the heap, then grows to fit everything the next time it's reset. This means that
+     * after the first few frames, a frame that allocates the same amount of memory as the frames before it won't touch the heap at all
+     */
+    class FrameArena {
+    public:
+        explicit FrameArena(Bytes size);
+
+        FrameArena(const FrameArena& other) = delete;
+        FrameArena& operator=(const FrameArena& other) = delete;
+
+        FrameArena(FrameArena&& old) noexcept = default;
+        FrameArena& operator=(FrameArena&& old) noexcept = default;
+
+        ~FrameArena();
+
+        /*!
+         * \brief Allocates some memory from the arena
+         *
+         * The memory is valid until the next call to `reset`
+         */
+        [[nodiscard]] void* allocate(size_t num_bytes, size_t alignment);
+
+        /*!
+         * \brief Frees everything that was allocated from this arena
+         *
+         * If the arena overflowed since the last reset, it grows so that it can hold everything that was allocated
+         */
+        void reset();
+
+        /*!
+         * \brief Number of bytes allocated since the last reset, including allocations which overflowed to the heap
+         */
+        [[nodiscard]] Bytes get_num_allocated_bytes() const;
+
+        [[nodiscard]] Bytes get_capacity() const;
+
+        /*!
+         * \brief Number of allocations since the last reset which didn't fit in the arena and went to the heap instead
+         *
+         * This should be zero for every frame except the first few. If it isn't, some code is allocating more and more memory every frame
+         */
+        [[nodiscard]] size_t get_num_heap_allocations() const;
+
+    private:
+        struct HeapAllocation {
+            void* memory;
+            size_t alignment;
+        };
+
+        std::unique_ptr<std::byte[]> memory;
+
+        size_t capacity;
+
+        size_t head = 0;
+
+        /*!
+         * \brief Number of bytes requested since the last reset, including the ones that overflowed to the heap
+         */
+        size_t num_requested_bytes = 0;
+
+        std::vector<HeapAllocation> heap_allocations;
+
+        void free_heap_allocations();
+    };
+
+    /*!
+     * \brief Standard-compatible allocator which allocates from a FrameArena
+     *
+     * Deallocation is a no-op, since the arena frees everything at once. If the allocator has no arena it uses the heap, so code that
+     * takes a FrameArena* can still work when there isn't an arena available
+     */
+    template <typename ValueType>
+    class FrameArenaAllocator {
+    public:
+        using value_type = ValueType;
+
+        FrameArena* arena = nullptr;
+
+        FrameArenaAllocator() noexcept = default;
+
+        // ReSharper disable once CppNonExplicitConvertingConstructor
+        FrameArenaAllocator(FrameArena* arena) noexcept : arena{arena} {}
+
+        template <typename OtherType>
+        // ReSharper disable once CppNonExplicitConvertingConstructor
+        FrameArenaAllocator(const FrameArenaAllocator<OtherType>& other) noexcept : arena{other.arena} {}
+
+        [[nodiscard]] ValueType* allocate(const size_t num_elements) {
+            if(arena == nullptr) {
+                return std::allocator<ValueType>{}.allocate(num_elements);
+            }
+
+            return static_cast<ValueType*>(arena->allocate(num_elements * sizeof(ValueType), alignof(ValueType)));
+        }
+
+        void deallocate(ValueType* ptr, const size_t num_elements) noexcept {
+            if(arena == nullptr) {
+                std::allocator<ValueType>{}.deallocate(ptr, num_elements);
+            }
+        }
+
+        template <typename OtherType>
+        bool operator==(const FrameArenaAllocator<OtherType>& other) const noexcept {
+            return arena == other.arena;
+        }
+    };
+
+    /*!
+     * \brief A vector which allocates from a FrameArena. Don't let it outlive the frame
+     */
+    template <typename ValueType>
+    using FrameVector = std::vector<ValueType, FrameArenaAllocator<ValueType>>;
+} // namespace nova::mem
@@ -2,6 +2,7 @@
 
 // MUST be before <algorithm> to keep gcc happy
 #include <algorithm>
+#include <functional>
 #include <memory_resource>
 #include <string>
 #include <vector>
@@ -34,6 +35,16 @@ namespace nova::renderer {
 
     bool ends_with(const std::string& string, const std::string& ending);
 
+    /*!
+     * \brief Mixes the hash of a value into an existing hash
+     *
+     * Same mixing function as boost::hash_combine. Useful when you need to hash a struct made of things that std::hash already knows about
+     */
+    template <typename ValueType>
+    void hash_combine(size_t& seed, const ValueType& value) {
+        seed ^= std::hash<ValueType>{}(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+
 #define FORMAT(s, ...) fmt::format(fmt(s), __VA_ARGS__)
 
 #define PROFILE_VOID_EXPR(expr, category, event_name)                                                                                      \
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace nova::renderer {
+    /*!
+     * \brief A fixed set of threads which run jobs in the background
+     *
+     * Jobs with a higher priority run first. Jobs with the same priority run in the order they were submitted. Jobs may submit more jobs
+     *
+     * Nova has one of these, which everything that wants to do work off the render thread shares. See `NovaRenderer::get_worker_pool`
+     */
+    class WorkerPool {
+    public:
+        explicit WorkerPool(uint32_t num_threads);
+
+        WorkerPool(const WorkerPool& other) = delete;
+        WorkerPool& operator=(const WorkerPool& other) = delete;
+
+        WorkerPool(WorkerPool&& old) noexcept = delete;
+        WorkerPool& operator=(WorkerPool&& old) noexcept = delete;
+
+        /*!
+         * \brief Stops the threads. Jobs which haven't started yet never run
+         */
+        ~WorkerPool();
+
+        void submit(std::function<void()> job, float priority = 0);
+
+        /*!
+         * \brief Blocks until every job that's been submitted, and every job that they submitted, has finished
+         */
+        void wait_idle();
+
+        [[nodiscard]] uint32_t get_num_threads() const;
+
+    private:
+        struct Job {
+            std::function<void()> work;
+
+            float priority;
+
+            /*!
+             * \brief Order that the job was submitted in, so that jobs with equal priorities run first-in-first-out
+             */
+            uint64_t sequence;
+        };
+
+        std::mutex jobs_mutex;
+
+        std::condition_variable_any jobs_cv;
+
+        std::condition_variable idle_cv;
+
+        /*!
+         * \brief Jobs that haven't started yet, as a heap with the next job to run at the front
+         */
+        std::vector<Job> jobs;
+
+        uint64_t next_sequence = 0;
+
+        uint32_t num_running_jobs = 0;
+
+        /*!
+         * \brief Declared last so the threads are stopped before anything they use is destroyed
+         */
+        std::vector<std::jthread> threads;
+
+        void worker_thread(const std::stop_token& stop_token);
+
+        [[nodiscard]] static bool runs_after(const Job& a, const Job& b);
+    };
+} // namespace nova::renderer
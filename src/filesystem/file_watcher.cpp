@@ -0,0 +1,248 @@
+#include "file_watcher.hpp"
+
+#include <algorithm>
+#include <array>
+#include <unordered_map>
+
+#include <Tracy.hpp>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+#include "nova_renderer/util/platform.hpp"
+
+#ifdef NOVA_LINUX
+#include <cerrno>
+#include <climits>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#elif defined(NOVA_WINDOWS)
+#include "nova_renderer/util/windows.hpp"
+
+#endif
+
+namespace nova::filesystem {
+    static auto logger = spdlog::stdout_color_mt("FileWatcher");
+
+#ifdef NOVA_LINUX
+    /*!
+     * \brief inotify doesn't watch subfolders, so we watch every folder separately
+     */
+    struct FileWatcher::PlatformWatch {
+        int inotify_fd = -1;
+
+        /*!
+         * \brief Path of every folder we watch, relative to the root, by watch descriptor
+         */
+        std::unordered_map<int, std::filesystem::path> folders;
+
+        void watch_folder(const std::filesystem::path& root, const std::filesystem::path& relative_path) {
+            const auto full_path = root / relative_path;
+            const auto wd = inotify_add_watch(inotify_fd, full_path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+            if(wd < 0) {
+                logger->warn("Could not watch folder {} for changes", full_path.string());
+                return;
+            }
+
+            folders[wd] = relative_path;
+
+            std::error_code error;
+            for(const auto& entry : std::filesystem::directory_iterator{full_path, error}) {
+                if(entry.is_directory(error)) {
+                    watch_folder(root, relative_path / entry.path().filename());
+                }
+            }
+        }
+    };
+
+    FileWatcher::FileWatcher(std::filesystem::path root) : root{std::move(root)}, watch{std::make_unique<PlatformWatch>()} {
+        watch->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if(watch->inotify_fd < 0) {
+            logger->error("Could not initialize inotify, so Nova won't notice changes to {}", this->root.string());
+            return;
+        }
+
+        watch->watch_folder(this->root, {});
+    }
+
+    FileWatcher::~FileWatcher() {
+        if(watch->inotify_fd >= 0) {
+            close(watch->inotify_fd);
+        }
+    }
+
+    bool FileWatcher::is_valid() const { return watch->inotify_fd >= 0; }
+
+    std::vector<std::string> FileWatcher::get_changed_files() {
+        ZoneScoped;
+        std::vector<std::string> changed_files;
+        if(!is_valid()) {
+            return changed_files;
+        }
+
+        alignas(inotify_event) std::array<char, 16 * (sizeof(inotify_event) + NAME_MAX + 1)> buffer;
+        while(true) {
+            const auto num_bytes = read(watch->inotify_fd, buffer.data(), buffer.size());
+            if(num_bytes <= 0) {
+                if(num_bytes < 0 && errno != EAGAIN) {
+                    logger->warn("Could not read file changes in {}", root.string());
+                }
+                break;
+            }
+
+            for(ssize_t offset = 0; offset < num_bytes;) {
+                const auto* event = reinterpret_cast<const inotify_event*>(buffer.data() + offset);
+                offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+                if((event->mask & IN_Q_OVERFLOW) != 0) {
+                    logger->warn("Too many files in {} changed at once, some changes will be missed", root.string());
+                    continue;
+                }
+
+                const auto folder_itr = watch->folders.find(event->wd);
+                if(folder_itr == watch->folders.end() || event->len == 0) {
+                    continue;
+                }
+
+                const auto relative_path = folder_itr->second / event->name;
+                if((event->mask & IN_ISDIR) != 0) {
+                    // Watch new folders, so that we see files which are saved in them later
+                    if((event->mask & (IN_CREATE | IN_MOVED_TO)) != 0) {
+                        watch->watch_folder(root, relative_path);
+                    }
+
+                } else if((event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) != 0) {
+                    changed_files.push_back(relative_path.lexically_normal().generic_string());
+                }
+            }
+        }
+
+        std::sort(changed_files.begin(), changed_files.end());
+        changed_files.erase(std::unique(changed_files.begin(), changed_files.end()), changed_files.end());
+
+        return changed_files;
+    }
+
+#elif defined(NOVA_WINDOWS)
+    /*!
+     * \brief One overlapped `ReadDirectoryChangesW` that's always outstanding. We check if it finished without waiting for it
+     */
+    struct FileWatcher::PlatformWatch {
+        HANDLE directory = INVALID_HANDLE_VALUE;
+
+        OVERLAPPED overlapped{};
+
+        alignas(DWORD) std::array<uint8_t, 64 * 1024> buffer{};
+
+        bool start_read() {
+            return ReadDirectoryChangesW(directory,
+                                         buffer.data(),
+                                         static_cast<DWORD>(buffer.size()),
+                                         TRUE,
+                                         FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME,
+                                         nullptr,
+                                         &overlapped,
+                                         nullptr) != FALSE;
+        }
+    };
+
+    FileWatcher::FileWatcher(std::filesystem::path root) : root{std::move(root)}, watch{std::make_unique<PlatformWatch>()} {
+        watch->directory = CreateFileW(this->root.c_str(),
+                                       FILE_LIST_DIRECTORY,
+                                       FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                       nullptr,
+                                       OPEN_EXISTING,
+                                       FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+                                       nullptr);
+        if(watch->directory == INVALID_HANDLE_VALUE) {
+            logger->error("Could not open {}, so Nova won't notice changes to it", this->root.string());
+            return;
+        }
+
+        watch->overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        if(watch->overlapped.hEvent == nullptr || !watch->start_read()) {
+            logger->error("Could not watch {} for changes", this->root.string());
+            CloseHandle(watch->directory);
+            watch->directory = INVALID_HANDLE_VALUE;
+        }
+    }
+
+    FileWatcher::~FileWatcher() {
+        if(watch->directory != INVALID_HANDLE_VALUE) {
+            // The kernel writes to our buffer until the read is cancelled, so wait for that before the buffer goes away
+            CancelIo(watch->directory);
+            DWORD num_bytes;
+            GetOverlappedResult(watch->directory, &watch->overlapped, &num_bytes, TRUE);
+            CloseHandle(watch->directory);
+        }
+
+        if(watch->overlapped.hEvent != nullptr) {
+            CloseHandle(watch->overlapped.hEvent);
+        }
+    }
+
+    bool FileWatcher::is_valid() const { return watch->directory != INVALID_HANDLE_VALUE; }
+
+    std::vector<std::string> FileWatcher::get_changed_files() {
+        ZoneScoped;
+        std::vector<std::string> changed_files;
+        if(!is_valid()) {
+            return changed_files;
+        }
+
+        DWORD num_bytes;
+        while(GetOverlappedResult(watch->directory, &watch->overlapped, &num_bytes, FALSE) != FALSE) {
+            if(num_bytes == 0) {
+                logger->warn("Too many files in {} changed at once, some changes will be missed", root.string());
+            }
+
+            for(DWORD offset = 0; offset < num_bytes;) {
+                const auto* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(watch->buffer.data() + offset);
+
+                if(info->Action == FILE_ACTION_MODIFIED || info->Action == FILE_ACTION_ADDED ||
+                   info->Action == FILE_ACTION_RENAMED_NEW_NAME) {
+                    const std::filesystem::path relative_path{std::wstring{info->FileName, info->FileNameLength / sizeof(WCHAR)}};
+
+                    std::error_code error;
+                    if(!std::filesystem::is_directory(root / relative_path, error)) {
+                        changed_files.push_back(relative_path.lexically_normal().generic_string());
+                    }
+                }
+
+                if(info->NextEntryOffset == 0) {
+                    break;
+                }
+                offset += info->NextEntryOffset;
+            }
+
+            ResetEvent(watch->overlapped.hEvent);
+            if(!watch->start_read()) {
+                logger->error("Could not keep watching {} for changes", root.string());
+                CloseHandle(watch->directory);
+                watch->directory = INVALID_HANDLE_VALUE;
+                break;
+            }
+        }
+
+        std::sort(changed_files.begin(), changed_files.end());
+        changed_files.erase(std::unique(changed_files.begin(), changed_files.end()), changed_files.end());
+
+        return changed_files;
+    }
+
+#else
+    struct FileWatcher::PlatformWatch {};
+
+    FileWatcher::FileWatcher(std::filesystem::path root) : root{std::move(root)}, watch{std::make_unique<PlatformWatch>()} {
+        logger->warn("Nova can't watch files on this platform, so it won't notice changes to {}", this->root.string());
+    }
+
+    FileWatcher::~FileWatcher() = default;
+
+    bool FileWatcher::is_valid() const { return false; }
+
+    std::vector<std::string> FileWatcher::get_changed_files() { return {}; }
+
+#endif
+} // namespace nova::filesystem
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace nova::filesystem {
+    /*!
+     * \brief Tells you which files in a folder, or any of its subfolders, changed
+     *
+     * Uses inotify on Linux and `ReadDirectoryChangesW` on Windows, so checking for changes is one non-blocking system call and doesn't
+     * touch the files themselves. Not thread-safe
+     */
+    class FileWatcher {
+    public:
+        /*!
+         * \param root The folder to watch. Must be a regular folder on disk
+         */
+        explicit FileWatcher(std::filesystem::path root);
+
+        FileWatcher(const FileWatcher& other) = delete;
+        FileWatcher& operator=(const FileWatcher& other) = delete;
+
+        FileWatcher(FileWatcher&& old) noexcept = delete;
+        FileWatcher& operator=(FileWatcher&& old) noexcept = delete;
+
+        ~FileWatcher();
+
+        /*!
+         * \brief False if we couldn't start watching the folder, in which case `get_changed_files` never returns anything
+         */
+        [[nodiscard]] bool is_valid() const;
+
+        /*!
+         * \brief Finds the files which were written, created, or renamed into place since the last time you called this
+         *
+         * \return The files' paths relative to the root folder, with forward slashes. Each file is listed once, no matter how many times it
+         * changed
+         */
+        [[nodiscard]] std::vector<std::string> get_changed_files();
+
+    private:
+        struct PlatformWatch;
+
+        std::filesystem::path root;
+
+        std::unique_ptr<PlatformWatch> watch;
+    };
+} // namespace nova::filesystem
@@ -115,6 +115,22 @@ namespace nova::renderer::renderpack {
         return state;
     }
 
+    static std::optional<std::unordered_map<std::string, std::string>> specialization_constants_from_json(const nlohmann::json& json) {
+        std::unordered_map<std::string, std::string> map;
+
+        json.each([&](const nlohmann::json& elem) {
+            std::string name;
+            FILL_REQUIRED_FIELD(name, get_json_opt<std::string>(elem, "name"));
+
+            std::string value;
+            FILL_REQUIRED_FIELD(value, get_json_opt<std::string>(elem, "value"));
+
+            map.emplace(name, value);
+        });
+
+        return map;
+    }
+
     PipelineData PipelineData::from_json(const nlohmann::json& json) {
         PipelineData pipeline = {};
 
@@ -123,6 +139,13 @@ namespace nova::renderer::renderpack {
         pipeline.parent_name = get_json_value(json, "parent", "");
 
         pipeline.defines = get_json_array<std::string>(json, "defined");
+        pipeline.keywords = get_json_array<std::string>(json, "keywords");
+        const auto specialization_constants = get_json_opt<std::unordered_map<std::string, std::string>>(json,
+                                                                                                        "specializationConstants",
+                                                                                                        specialization_constants_from_json);
+        if(specialization_constants) {
+            pipeline.specialization_constants = *specialization_constants;
+        }
 
         pipeline.states = get_json_array<RasterizerState>(json, "states", state_enum_from_json);
         pipeline.front_face = get_json_opt<StencilOpState>(json, "frontFace");
@@ -185,6 +208,18 @@ namespace nova::renderer::renderpack {
             pipeline.fragment_shader->filename = *fragment_shader_name;
         }
 
+        const auto task_shader_name = get_json_opt<std::string>(json, "taskShader");
+        if(task_shader_name) {
+            pipeline.task_shader = RenderpackShaderSource{};
+            pipeline.task_shader->filename = *task_shader_name;
+        }
+
+        const auto mesh_shader_name = get_json_opt<std::string>(json, "meshShader");
+        if(mesh_shader_name) {
+            pipeline.mesh_shader = RenderpackShaderSource{};
+            pipeline.mesh_shader->filename = *mesh_shader_name;
+        }
+
         return pipeline;
     }
 
@@ -227,6 +262,8 @@ namespace nova::renderer::renderpack {
             pass.bindings = *val;
         }
 
+        pass.keywords = get_json_array<std::string>(json, "keywords");
+
         // FILL_REQUIRED_FIELD(pass.bindings, get_json_opt<std::unordered_map<std::string, std::string>>(json, "bindings", map_from_json_object));
 
         return pass;
@@ -246,6 +283,9 @@ namespace nova::renderer::renderpack {
         if(str == "RGBA8") {
             return rhi::PixelFormat::Rgba8;
         }
+        if(str == "RGBA8_SRGB") {
+            return rhi::PixelFormat::Rgba8Srgb;
+        }
         if(str == "RGBA16F") {
             return rhi::PixelFormat::Rgba16F;
         }
@@ -533,6 +573,45 @@ namespace nova::renderer::renderpack {
 
             case rhi::PixelFormat::Depth24Stencil8:
                 return "DepthStencil";
+
+            case rhi::PixelFormat::Rgba8Srgb:
+                return "RGBA8_SRGB";
+
+            case rhi::PixelFormat::Bc1Rgba:
+                return "BC1";
+
+            case rhi::PixelFormat::Bc1RgbaSrgb:
+                return "BC1_SRGB";
+
+            case rhi::PixelFormat::Bc2Rgba:
+                return "BC2";
+
+            case rhi::PixelFormat::Bc2RgbaSrgb:
+                return "BC2_SRGB";
+
+            case rhi::PixelFormat::Bc3Rgba:
+                return "BC3";
+
+            case rhi::PixelFormat::Bc3RgbaSrgb:
+                return "BC3_SRGB";
+
+            case rhi::PixelFormat::Bc4R:
+                return "BC4";
+
+            case rhi::PixelFormat::Bc5Rg:
+                return "BC5";
+
+            case rhi::PixelFormat::Bc6hRgbUfloat:
+                return "BC6H_UFLOAT";
+
+            case rhi::PixelFormat::Bc6hRgbSfloat:
+                return "BC6H_SFLOAT";
+
+            case rhi::PixelFormat::Bc7Rgba:
+                return "BC7";
+
+            case rhi::PixelFormat::Bc7RgbaSrgb:
+                return "BC7_SRGB";
         }
 
         return "Unknown value";
@@ -754,6 +833,8 @@ namespace nova::renderer::renderpack {
     uint32_t pixel_format_to_pixel_width(const rhi::PixelFormat format) {
         switch(format) {
             case rhi::PixelFormat::Rgba8:
+                [[fallthrough]];
+            case rhi::PixelFormat::Rgba8Srgb:
                 return 4 * 8;
 
             case rhi::PixelFormat::Rgba16F:
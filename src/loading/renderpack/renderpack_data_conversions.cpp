@@ -5,11 +5,10 @@
 #include "nova_renderer/rhi/rhi_enums.hpp"
 
 #include "rx/core/log.h"
-#include "spirv_glsl.hpp"
 
-namespace nova::renderer::renderpack {
-    using namespace spirv_cross;
+#include "../../renderer/shader_reflection.hpp"
 
+namespace nova::renderer::renderpack {
     RX_LOG("RenderpackConvert", logger);
 
     ShaderSource to_shader_source(const RenderpackShaderSource& rp_source) {
@@ -21,89 +20,14 @@ namespace nova::renderer::renderpack {
         return source;
     }
 
-    rhi::VertexFieldFormat to_rhi_vertex_format(const SPIRType& spirv_type) {
-        switch(spirv_type.basetype) {
-            case SPIRType::UInt:
-                return rhi::VertexFieldFormat::Uint;
-
-            case SPIRType::Float: {
-                switch(spirv_type.vecsize) {
-                    case 2:
-                        return rhi::VertexFieldFormat::Float2;
-
-                    case 3:
-                        return rhi::VertexFieldFormat::Float3;
-
-                    case 4:
-                        return rhi::VertexFieldFormat::Float4;
-
-                    default:
-                        logger->error("Nova does not support float fields with %u vector elements", spirv_type.vecsize);
-                        return rhi::VertexFieldFormat::Invalid;
-                }
-            };
-
-            case SPIRType::Unknown:
-                [[fallthrough]];
-            case SPIRType::Void:
-                [[fallthrough]];
-            case SPIRType::Boolean:
-                [[fallthrough]];
-            case SPIRType::SByte:
-                [[fallthrough]];
-            case SPIRType::UByte:
-                [[fallthrough]];
-            case SPIRType::Short:
-                [[fallthrough]];
-            case SPIRType::UShort:
-                [[fallthrough]];
-            case SPIRType::Int:
-                [[fallthrough]];
-            case SPIRType::Int64:
-                [[fallthrough]];
-            case SPIRType::UInt64:
-                [[fallthrough]];
-            case SPIRType::AtomicCounter:
-                [[fallthrough]];
-            case SPIRType::Half:
-                [[fallthrough]];
-            case SPIRType::Double:
-                [[fallthrough]];
-            case SPIRType::Struct:
-                [[fallthrough]];
-            case SPIRType::Image:
-                [[fallthrough]];
-            case SPIRType::SampledImage:
-                [[fallthrough]];
-            case SPIRType::Sampler:
-                [[fallthrough]];
-            case SPIRType::AccelerationStructureNV:
-                [[fallthrough]];
-            case SPIRType::ControlPointArray:
-                [[fallthrough]];
-            case SPIRType::Char:
-                [[fallthrough]];
-            default:
-                logger->error("Nova does not support vertex fields of type %u", spirv_type.basetype);
-        }
-
-        return {};
-    }
-
     std::vector<rhi::RhiVertexField> get_vertex_fields(const ShaderSource& vertex_shader) {
-        // TODO: Figure out if there's a better way to reflect on the shader
-        const CompilerGLSL shader_compiler{vertex_shader.source.data(), vertex_shader.source.size()};
-
-        const auto& shader_vertex_fields = shader_compiler.get_shader_resources().stage_inputs;
+        const auto& reflection = get_shader_reflection_database().get_reflection(vertex_shader.source);
 
         std::vector<rhi::RhiVertexField> vertex_fields;
-        vertex_fields.reserve(shader_vertex_fields.size());
-
-        for(const auto& spirv_field : shader_vertex_fields) {
-            const auto& spirv_type = shader_compiler.get_type(spirv_field.base_type_id);
-            const auto format = to_rhi_vertex_format(spirv_type);
+        vertex_fields.reserve(reflection.stage_inputs.size());
 
-            vertex_fields.emplace_back(spirv_field.name.c_str(), format);
+        for(const auto& input : reflection.stage_inputs) {
+            vertex_fields.emplace_back(input.name.c_str(), input.format);
         }
 
         return vertex_fields;
@@ -227,6 +151,10 @@ namespace nova::renderer::renderpack {
         RhiGraphicsPipelineState info{};
 
         info.name = data.name;
+        info.fallback = data.fallback;
+        if(data.parent_name && !data.parent_name->empty()) {
+            info.parent = *data.parent_name;
+        }
 
         // Shaders
         info.vertex_shader = to_shader_source(data.vertex_shader);
@@ -238,15 +166,22 @@ namespace nova::renderer::renderpack {
             info.pixel_shader = to_shader_source(*data.fragment_shader);
         }
 
+        if(data.mesh_shader) {
+            info.mesh_shader = to_shader_source(*data.mesh_shader);
+
+            if(data.task_shader) {
+                info.task_shader = to_shader_source(*data.task_shader);
+            }
+        }
+
         info.vertex_fields = get_vertex_fields(info.vertex_shader);
 
-        // Viewport and scissor test
+        // Scissor test. The viewport and scissor rect are dynamic state, which command lists set when a renderpass begins
         const auto* pass = rendergraph.get_renderpass(data.pass);
         if(pass == nullptr) {
             logger->error("Could not find render pass %s, which pipeline %s needs", data.pass, data.name);
             return rx::nullopt;
         }
-        info.viewport_size = pass->framebuffer->size;
 
         info.enable_scissor_test = data.scissor_mode == ScissorTestMode::DynamicScissorRect;
 
@@ -1,7 +1,16 @@
 #include "nova_renderer/loading/renderpack_loading.hpp"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <latch>
+#include <memory>
+
 #include <rx/core/json.h>
 #include <rx/core/log.h>
+#include <spdlog/spdlog.h>
 
 #include "nova_renderer/util/platform.hpp"
 
@@ -10,26 +19,46 @@
 #include "nova_renderer/filesystem/folder_accessor.hpp"
 #include "nova_renderer/filesystem/virtual_filesystem.hpp"
 #include "nova_renderer/loading/shader_includer.hpp"
+#include "nova_renderer/util/worker_pool.hpp"
 
 #include "../json_utils.hpp"
 #include "Tracy.hpp"
 #include "render_graph_builder.hpp"
 #include "renderpack_validator.hpp"
+#include "shader_cache.hpp"
+#include "spirv_optimizer.hpp"
 
 namespace nova::renderer::renderpack {
     RX_LOG("RenderpackLoading", logger);
 
     using namespace filesystem;
 
-    std::optional<RenderpackResourcesData> load_dynamic_resources_file(FolderAccessorBase* folder_access);
+    /*!
+     * \brief The text of a file in the renderpack, and where it came from
+     */
+    struct RenderpackFile {
+        std::string path;
+
+        std::string text;
+    };
+
+    std::optional<RenderpackResourcesData> parse_dynamic_resources_file(const std::string& resources_text, ValidationReport& report);
+
+    ntl::Result<RendergraphData> parse_rendergraph_file(const std::string& rendergraph_text);
+
+    std::optional<PipelineData> parse_pipeline_file(const RenderpackFile& pipeline_file, ValidationReport& report);
 
-    ntl::Result<RendergraphData> load_rendergraph_file(FolderAccessorBase* folder_access);
+    MaterialData parse_material_file(const RenderpackFile& material_file, ValidationReport& report);
 
-    std::vector<PipelineData> load_pipeline_files(FolderAccessorBase* folder_access);
-    std::optional<PipelineData> load_single_pipeline(FolderAccessorBase* folder_access, const std::string& pipeline_path);
+    static void compile_pipeline_shaders(std::vector<PipelineData>& pipelines, FolderAccessorBase* folder_access, WorkerPool* worker_pool);
 
-    std::vector<MaterialData> load_material_files(FolderAccessorBase* folder_access);
-    MaterialData load_single_material(FolderAccessorBase* folder_access, const std::string& material_path);
+    static std::vector<uint32_t> compile_shader_to_spirv(const std::string& source,
+                                                        rhi::ShaderStage stage,
+                                                        rhi::ShaderLanguage source_language,
+                                                        FolderAccessorBase* folder_accessor,
+                                                        const std::vector<std::string>& defines,
+                                                        std::string& error_message,
+                                                        std::vector<std::string>* included_files);
 
     void fill_in_render_target_formats(RenderpackData& data) {
         const auto& textures = data.resources.render_targets;
@@ -87,8 +116,85 @@ namespace nova::renderer::renderpack {
 
     void cache_pipelines_by_renderpass(RenderpackData& data);
 
-    RenderpackData load_renderpack_data(const std::string& renderpack_name) {
+    /*!
+     * \brief A batch of jobs which run on the worker pool, and on the calling thread when it waits for them
+     *
+     * Workers and the waiting thread all pull jobs off the same counter, so this works even if the waiting thread is a worker. The batch
+     * is shared because workers that start after every job is done still look at it
+     */
+    struct JobBatch {
+        /*!
+         * \brief Runs one job. Only called for job indices less than `num_jobs`, so it may refer to things which only live until `wait`
+         * returns
+         */
+        std::function<void(size_t)> run_job;
+
+        size_t num_jobs;
+
+        std::atomic<size_t> next_job = 0;
+
+        std::latch jobs_remaining;
+
+        JobBatch(const size_t num_jobs, std::function<void(size_t)> run_job)
+            : run_job{std::move(run_job)}, num_jobs{num_jobs}, jobs_remaining{static_cast<std::ptrdiff_t>(num_jobs)} {}
+
+        void run_jobs() {
+            for(auto job_idx = next_job++; job_idx < num_jobs; job_idx = next_job++) {
+                run_job(job_idx);
+                jobs_remaining.count_down();
+            }
+        }
+
+        /*!
+         * \brief Helps with the jobs which haven't started yet, then waits for the rest
+         */
+        void wait() {
+            run_jobs();
+            jobs_remaining.wait();
+        }
+    };
+
+    /*!
+     * \brief Starts running `num_jobs` jobs on the worker pool. If there's no worker pool, they all run in `JobBatch::wait`
+     */
+    static std::shared_ptr<JobBatch> start_jobs(const size_t num_jobs, WorkerPool* worker_pool, std::function<void(size_t)> run_job) {
+        auto batch = std::make_shared<JobBatch>(num_jobs, std::move(run_job));
+
+        if(worker_pool != nullptr) {
+            const auto num_worker_jobs = std::min(static_cast<size_t>(worker_pool->get_num_threads()), num_jobs);
+            for(size_t i = 0; i < num_worker_jobs; i++) {
+                // Someone's waiting for the renderpack, so get in front of texture loading
+                worker_pool->submit([batch] { batch->run_jobs(); }, 1.0f);
+            }
+        }
+
+        return batch;
+    }
+
+    /*!
+     * \brief Reads every file in the materials folder that ends with the extension, sorted by name so that they load, and report errors,
+     * in the same order every time
+     */
+    static std::vector<RenderpackFile> read_files_with_extension(FolderAccessorBase* folder_access,
+                                                                 const std::vector<std::string>& material_folder_files,
+                                                                 const char* extension) {
+        ZoneScoped;
+        std::vector<RenderpackFile> files;
+        for(const auto& potential_file : material_folder_files) {
+            if(potential_file.ends_with(extension)) {
+                auto& file = files.emplace_back();
+                file.path = std::string::format("%s/%s", MATERIALS_DIRECTORY, potential_file);
+                file.text = folder_access->read_text_file(file.path);
+            }
+        }
+
+        return files;
+    }
+
+    RenderpackData load_renderpack_data(const std::string& renderpack_name, WorkerPool* worker_pool) {
         ZoneScoped;
+        const auto start_time = std::chrono::steady_clock::now();
+
         FolderAccessorBase* folder_access = VirtualFilesystem::get_instance()->get_folder_accessor(renderpack_name);
 
         // The renderpack has a number of items: There's the shaders themselves, of course, but there's so, so much more
@@ -98,33 +204,103 @@ namespace nova::renderer::renderpack {
         // - All the pipeline descriptions
         // - All the material descriptions
         //
-        // All these things are loaded from the filesystem
+        // All these things are loaded from the filesystem. Not every folder accessor can read files from many threads at once, so this
+        // thread reads the files, and the worker pool parses them. Pipelines go first because their shaders take the longest, and the
+        // materials parse while the shaders compile
+        auto material_folder_files = folder_access->get_all_items_in_folder(MATERIALS_DIRECTORY);
+        std::sort(material_folder_files.begin(), material_folder_files.end());
+
+        const auto pipeline_files = read_files_with_extension(folder_access, material_folder_files, ".pipeline");
+
+        std::vector<std::optional<PipelineData>> parsed_pipelines(pipeline_files.size());
+        std::vector<ValidationReport> pipeline_reports(pipeline_files.size());
+        const auto pipeline_batch = start_jobs(pipeline_files.size(), worker_pool, [&](const size_t i) {
+            parsed_pipelines[i] = parse_pipeline_file(pipeline_files[i], pipeline_reports[i]);
+        });
+
+        // Read the rest of the files while the workers parse the pipelines
+        const auto resources_text = folder_access->read_text_file(RESOURCES_FILE);
+        const auto rendergraph_text = folder_access->read_text_file("rendergraph.json");
+        const auto material_files = read_files_with_extension(folder_access, material_folder_files, ".mat");
 
+        std::optional<RenderpackResourcesData> resources;
+        ValidationReport resources_report;
+        std::optional<ntl::Result<RendergraphData>> graph_data;
+        std::vector<MaterialData> materials(material_files.size());
+        std::vector<ValidationReport> material_reports(material_files.size());
+
+        // The resources and the rendergraph are the first two jobs, and every material is a job after them
+        constexpr size_t NUM_NON_MATERIAL_JOBS = 2;
+        const auto other_batch = start_jobs(material_files.size() + NUM_NON_MATERIAL_JOBS, worker_pool, [&](const size_t i) {
+            if(i == 0) {
+                resources = parse_dynamic_resources_file(resources_text, resources_report);
+
+            } else if(i == 1) {
+                graph_data = parse_rendergraph_file(rendergraph_text);
+
+            } else {
+                materials[i - NUM_NON_MATERIAL_JOBS] = parse_material_file(material_files[i - NUM_NON_MATERIAL_JOBS],
+                                                                           material_reports[i - NUM_NON_MATERIAL_JOBS]);
+            }
+        });
+
+        pipeline_batch->wait();
+
+        // Report problems in the order of the files, no matter what order they were parsed in
         RenderpackData data{};
-        data.resources = *load_dynamic_resources_file(folder_access);
-        const auto& graph_data = load_rendergraph_file(folder_access);
-        if(graph_data) {
-            data.graph_data = *graph_data;
+        data.pipelines.reserve(pipeline_files.size());
+        for(size_t i = 0; i < pipeline_files.size(); i++) {
+            print(pipeline_reports[i]);
+            if(parsed_pipelines[i]) {
+                logger->debug("Load of pipeline %s succeeded", pipeline_files[i].path);
+                data.pipelines.push_back(std::move(*parsed_pipelines[i]));
+
+            } else {
+                logger->error("Loading pipeline file %s failed", pipeline_files[i].path);
+            }
+        }
+
+        // Compile every pipeline's shaders at once, rather than one pipeline at a time
+        compile_pipeline_shaders(data.pipelines, folder_access, worker_pool);
+
+        other_batch->wait();
+
+        print(resources_report);
+        data.resources = *resources;
+
+        if(*graph_data) {
+            data.graph_data = **graph_data;
         } else {
-            logger->error("Could not load render graph file. Error: %s", graph_data.error.to_string());
+            logger->error("Could not load render graph file. Error: %s", graph_data->error.to_string());
+        }
+
+        data.materials.reserve(material_files.size());
+        for(size_t i = 0; i < material_files.size(); i++) {
+            print(material_reports[i]);
+            if(material_reports[i].errors.is_empty()) {
+                logger->debug("Load of material %s succeeded - name %s", material_files[i].path, materials[i].name);
+
+            } else {
+                logger->error("Load of material %s failed", material_files[i].path);
+            }
+
+            data.materials.push_back(std::move(materials[i]));
         }
-        data.pipelines = load_pipeline_files(folder_access);
-        data.materials = load_material_files(folder_access);
 
         fill_in_render_target_formats(data);
 
         cache_pipelines_by_renderpass(data);
 
+        const auto load_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time);
+        logger->info("Loaded renderpack %s in %.1f ms", renderpack_name, load_time.count());
+
         return data;
     }
 
-    std::optional<RenderpackResourcesData> load_dynamic_resources_file(FolderAccessorBase* folder_access) {
+    std::optional<RenderpackResourcesData> parse_dynamic_resources_file(const std::string& resources_text, ValidationReport& report) {
         ZoneScoped;
-        const std::string resources_string = folder_access->read_text_file(RESOURCES_FILE);
-
-        auto json_resources = nlohmann::json(resources_string);
-        const ValidationReport report = validate_renderpack_resources_data(json_resources);
-        print(report);
+        auto json_resources = nlohmann::json(resources_text);
+        report = validate_renderpack_resources_data(json_resources);
         if(!report.errors.is_empty()) {
             return rx::nullopt;
         }
@@ -132,11 +308,9 @@ namespace nova::renderer::renderpack {
         return RenderpackResourcesData::from_json(json_resources);
     }
 
-    ntl::Result<RendergraphData> load_rendergraph_file(FolderAccessorBase* folder_access) {
+    ntl::Result<RendergraphData> parse_rendergraph_file(const std::string& rendergraph_text) {
         ZoneScoped;
-        const auto passes_bytes = folder_access->read_text_file("rendergraph.json");
-
-        const auto json_passes = nlohmann::json(passes_bytes);
+        const auto json_passes = nlohmann::json(rendergraph_text);
 
         auto rendergraph_file = json_passes.decode<RendergraphData>({});
 
@@ -169,78 +343,168 @@ namespace nova::renderer::renderpack {
         }
     }
 
-    std::vector<PipelineData> load_pipeline_files(FolderAccessorBase* folder_access) {
-        ZoneScoped;
-        std::vector<std::string> potential_pipeline_files = folder_access->get_all_items_in_folder("materials");
+    /*!
+     * \brief One shader stage of one pipeline, which needs to be compiled
+     */
+    struct ShaderCompileJob {
+        RenderpackShaderSource* shader;
+
+        rhi::ShaderStage stage;
+
+        rhi::ShaderLanguage language;
 
-        std::vector<PipelineData> output;
+        const std::vector<std::string>* defines;
 
-        // The resize will make this vector about twice as big as it should be, but there won't be any reallocating
-        // so I'm into it
-        output.reserve(potential_pipeline_files.size());
+        const std::unordered_map<std::string, std::string>* specialization_constants;
 
-        potential_pipeline_files.each_fwd([&](const std::string& potential_file) {
-            if(potential_file.ends_with(".pipeline")) {
-                // Pipeline file!
-                const auto pipeline_relative_path = std::string::format("%s/%s", "materials", potential_file);
-                const auto& pipeline = load_single_pipeline(folder_access, pipeline_relative_path);
-                if(pipeline) {
-                    output.push_back(*pipeline);
+        size_t pipeline_idx;
+
+        /*!
+         * \brief Why the shader couldn't be compiled. Empty if it compiled
+         */
+        std::string error_message;
+    };
+
+    /*!
+     * \brief Compiles every shader of every pipeline, on the worker pool if we have one
+     *
+     * Pipelines with any shaders that couldn't be compiled are removed. Errors are reported in the order of the pipelines and their
+     * stages, no matter what order the shaders finished compiling in
+     */
+    static void compile_pipeline_shaders(std::vector<PipelineData>& pipelines, FolderAccessorBase* folder_access, WorkerPool* worker_pool) {
+        ZoneScoped;
+        std::vector<ShaderCompileJob> jobs;
+        std::vector<bool> is_pipeline_valid(pipelines.size(), true);
+
+        const auto add_job = [&](const size_t pipeline_idx, RenderpackShaderSource& shader, const rhi::ShaderStage stage) {
+            if(shader.filename.ends_with(".spirv")) {
+                // Already compiled, nothing for the workers to do
+                shader.source = load_shader_file(shader.filename, folder_access, stage);
+                if(shader.source.empty()) {
+                    logger->error("Could not load SPIR-V file %s for pipeline %s", shader.filename, pipelines[pipeline_idx].name);
+                    is_pipeline_valid[pipeline_idx] = false;
+                    return;
+                }
+
+                std::string error_message;
+                shader.source = get_spirv_optimizer().specialize(shader.source,
+                                                                 pipelines[pipeline_idx].specialization_constants,
+                                                                 error_message);
+                if(shader.source.empty()) {
+                    logger->error("Could not specialize SPIR-V file %s for pipeline %s:\n%s",
+                                  shader.filename,
+                                  pipelines[pipeline_idx].name,
+                                  error_message);
+                    is_pipeline_valid[pipeline_idx] = false;
                 }
+                return;
+            }
+
+            // Read the source now, since not every folder accessor can read files from many threads at once
+            ShaderCompileJob job{};
+            job.shader = &shader;
+            job.stage = stage;
+            job.language = shader.filename.ends_with(".hlsl") ? rhi::ShaderLanguage::Hlsl : rhi::ShaderLanguage::Glsl;
+            job.defines = &pipelines[pipeline_idx].defines;
+            job.specialization_constants = &pipelines[pipeline_idx].specialization_constants;
+            job.pipeline_idx = pipeline_idx;
+            shader.source_text = folder_access->read_text_file(shader.filename);
+            jobs.push_back(job);
+        };
+
+        for(size_t i = 0; i < pipelines.size(); i++) {
+            auto& pipeline = pipelines[i];
+            add_job(i, pipeline.vertex_shader, rhi::ShaderStage::Vertex);
+
+            if(pipeline.geometry_shader) {
+                add_job(i, *pipeline.geometry_shader, rhi::ShaderStage::Geometry);
+            }
+
+            if(pipeline.tessellation_control_shader) {
+                add_job(i, *pipeline.tessellation_control_shader, rhi::ShaderStage::TessellationControl);
+            }
+
+            if(pipeline.tessellation_evaluation_shader) {
+                add_job(i, *pipeline.tessellation_evaluation_shader, rhi::ShaderStage::TessellationEvaluation);
+            }
+
+            if(pipeline.fragment_shader) {
+                add_job(i, *pipeline.fragment_shader, rhi::ShaderStage::Pixel);
+            }
+
+            if(pipeline.task_shader) {
+                add_job(i, *pipeline.task_shader, rhi::ShaderStage::Task);
+            }
+
+            if(pipeline.mesh_shader) {
+                add_job(i, *pipeline.mesh_shader, rhi::ShaderStage::Mesh);
+            }
+        }
+
+        const auto batch = start_jobs(jobs.size(), worker_pool, [&](const size_t job_idx) {
+            auto& job = jobs[job_idx];
+            job.shader->source = compile_shader_to_spirv(job.shader->source_text,
+                                                         job.stage,
+                                                         job.language,
+                                                         folder_access,
+                                                         *job.defines,
+                                                         job.error_message,
+                                                         &job.shader->included_files);
+            if(job.shader->source.empty() && job.error_message.empty()) {
+                job.error_message = "The compiler produced no SPIR-V";
+
+            } else if(!job.shader->source.empty()) {
+                // Specialize after the shader cache, so that pipelines which share a shader share its cache entry
+                job.shader->source = get_spirv_optimizer().specialize(job.shader->source, *job.specialization_constants, job.error_message);
             }
         });
+        batch->wait();
+
+        for(const auto& job : jobs) {
+            if(!job.error_message.empty()) {
+                logger->error("Could not compile shader %s for pipeline %s:\n%s",
+                              job.shader->filename,
+                              pipelines[job.pipeline_idx].name,
+                              job.error_message);
+                is_pipeline_valid[job.pipeline_idx] = false;
+            }
+        }
+
+        std::vector<PipelineData> valid_pipelines;
+        valid_pipelines.reserve(pipelines.size());
+        for(size_t i = 0; i < pipelines.size(); i++) {
+            if(is_pipeline_valid[i]) {
+                valid_pipelines.push_back(std::move(pipelines[i]));
+
+            } else {
+                logger->error("Pipeline %s has shaders that couldn't be compiled, so it won't be loaded", pipelines[i].name);
+            }
+        }
+
+        logger->debug("Compiled %zu shaders for %zu pipelines", jobs.size(), valid_pipelines.size());
 
-        return output;
+        pipelines = std::move(valid_pipelines);
     }
 
-    std::optional<PipelineData> load_single_pipeline(FolderAccessorBase* folder_access, const std::string& pipeline_path) {
+    std::optional<PipelineData> parse_pipeline_file(const RenderpackFile& pipeline_file, ValidationReport& report) {
         ZoneScoped;
-        const auto pipeline_bytes = folder_access->read_text_file(pipeline_path);
-
-        auto json_pipeline = nlohmann::json{pipeline_bytes};
-        const ValidationReport report = validate_graphics_pipeline(json_pipeline);
-        print(report);
+        auto json_pipeline = nlohmann::json{pipeline_file.text};
+        report = validate_graphics_pipeline(json_pipeline);
         if(!report.errors.is_empty()) {
-            logger->error("Loading pipeline file %s failed", pipeline_path);
             return rx::nullopt;
         }
 
+        // The shaders are compiled later, all at once, by `compile_pipeline_shaders`
         auto new_pipeline = json_pipeline.decode<PipelineData>({});
-        new_pipeline.vertex_shader.source = load_shader_file(new_pipeline.vertex_shader.filename,
-                                                             folder_access,
-                                                             rhi::ShaderStage::Vertex,
-                                                             new_pipeline.defines);
-
-        if(new_pipeline.geometry_shader) {
-            (*new_pipeline.geometry_shader).source = load_shader_file((*new_pipeline.geometry_shader).filename,
-                                                                      folder_access,
-                                                                      rhi::ShaderStage::Geometry,
-                                                                      new_pipeline.defines);
-        }
-
-        if(new_pipeline.tessellation_control_shader) {
-            (*new_pipeline.tessellation_control_shader).source = load_shader_file((*new_pipeline.tessellation_control_shader).filename,
-                                                                                  folder_access,
-                                                                                  rhi::ShaderStage::TessellationControl,
-                                                                                  new_pipeline.defines);
-        }
-        if(new_pipeline.tessellation_evaluation_shader) {
-            (*new_pipeline.tessellation_evaluation_shader)
-                .source = load_shader_file((*new_pipeline.tessellation_evaluation_shader).filename,
-                                           folder_access,
-                                           rhi::ShaderStage::TessellationEvaluation,
-                                           new_pipeline.defines);
-        }
 
-        if(new_pipeline.fragment_shader) {
-            (*new_pipeline.fragment_shader).source = load_shader_file((*new_pipeline.fragment_shader).filename,
-                                                                      folder_access,
-                                                                      rhi::ShaderStage::Pixel,
-                                                                      new_pipeline.defines);
+        if(new_pipeline.keywords.size() > MAX_PIPELINE_KEYWORDS) {
+            report.errors.push_back(std::string::format("Pipeline %s has %zu keywords, but pipelines may only have %u",
+                                                        new_pipeline.name,
+                                                        new_pipeline.keywords.size(),
+                                                        MAX_PIPELINE_KEYWORDS));
+            return rx::nullopt;
         }
 
-        logger->debug("Load of pipeline %s succeeded", pipeline_path);
-
         return new_pipeline;
     }
 
@@ -261,10 +525,10 @@ namespace nova::renderer::renderpack {
 
         const auto& compiled_shader = [&] {
             if(filename.ends_with(".hlsl")) {
-                return compile_shader(shader_source, stage, rhi::ShaderLanguage::Hlsl, folder_access);
+                return compile_shader(shader_source, stage, rhi::ShaderLanguage::Hlsl, folder_access, defines);
 
             } else {
-                return compile_shader(shader_source, stage, rhi::ShaderLanguage::Glsl, folder_access);
+                return compile_shader(shader_source, stage, rhi::ShaderLanguage::Glsl, folder_access, defines);
             }
         }();
 
@@ -275,40 +539,16 @@ namespace nova::renderer::renderpack {
         return compiled_shader;
     }
 
-    std::vector<MaterialData> load_material_files(FolderAccessorBase* folder_access) {
-        ZoneScoped;
-        std::vector<std::string> potential_material_files = folder_access->get_all_items_in_folder("materials");
-
-        // The resize will make this vector about twice as big as it should be, but there won't be any reallocating
-        // so I'm into it
-        std::vector<MaterialData> output;
-        output.reserve(potential_material_files.size());
-
-        potential_material_files.each_fwd([&](const std::string& potential_file) {
-            if(potential_file.ends_with(".mat")) {
-                const auto material_filename = std::string::format("%s/%s", MATERIALS_DIRECTORY, potential_file);
-                const MaterialData& material = load_single_material(folder_access, material_filename);
-                output.push_back(material);
-            }
-        });
-
-        return output;
-    }
-
-    MaterialData load_single_material(FolderAccessorBase* folder_access, const std::string& material_path) {
+    MaterialData parse_material_file(const RenderpackFile& material_file, ValidationReport& report) {
         ZoneScoped;
-        const std::string material_text = folder_access->read_text_file(material_path);
-
-        const auto json_material = nlohmann::json{material_text};
-        const auto report = validate_material(json_material);
-        print(report);
+        const auto json_material = nlohmann::json{material_file.text};
+        report = validate_material(json_material);
         if(!report.errors.is_empty()) {
             // There were errors, this material can't be loaded
-            logger->error("Load of material %s failed", material_path);
             return {};
         }
 
-        const auto material_file_name = get_file_name(material_path);
+        const auto material_file_name = get_file_name(material_file.path);
         const auto material_extension_begin_idx = material_file_name.size() - 4; // ".mat"
 
         auto material = json_material.decode<MaterialData>({});
@@ -316,7 +556,6 @@ namespace nova::renderer::renderpack {
 
         material.passes.each_fwd([&](MaterialPass& pass) { pass.material_name = material.name; });
 
-        logger->debug("Load of material &s succeeded - name %s", material_path, material.name);
         return material;
     }
 
@@ -372,10 +611,124 @@ namespace nova::renderer::renderpack {
         }
     }
 
-    std::vector<uint32_t> compile_shader(const std::string& source,
-                                        const rhi::ShaderStage stage,
-                                        const rhi::ShaderLanguage source_language,
-                                        FolderAccessorBase* folder_accessor) {
+    /*!
+     * \brief Arguments we give DXC for every shader
+     */
+    static const std::array<LPCWSTR, 3> DXC_ARGS = {L"-spirv", L"-fspv-target-env=vulkan1.1", L"-fspv-reflect"};
+
+    /*!
+     * \brief The DXC objects for one thread
+     *
+     * DXC's objects aren't thread-safe, and creating them loads the compiler, so every thread which compiles shaders creates its own the
+     * first time it needs them and keeps them until it exits
+     */
+    class ThreadDxcInstances {
+    public:
+        IDxcLibrary* library = nullptr;
+
+        IDxcCompiler* compiler = nullptr;
+
+        ThreadDxcInstances() {
+            if(FAILED(DxcCreateInstance(CLSID_DxcLibrary, IID_PPV_ARGS(&library)))) {
+                logger->error("Could not create DXC Library instance");
+                library = nullptr;
+                return;
+            }
+
+            if(FAILED(DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&compiler)))) {
+                logger->error("Could not create DXC instance");
+                compiler = nullptr;
+            }
+        }
+
+        ThreadDxcInstances(const ThreadDxcInstances& other) = delete;
+        ThreadDxcInstances& operator=(const ThreadDxcInstances& other) = delete;
+
+        ThreadDxcInstances(ThreadDxcInstances&& old) noexcept = delete;
+        ThreadDxcInstances& operator=(ThreadDxcInstances&& old) noexcept = delete;
+
+        ~ThreadDxcInstances() {
+            if(compiler != nullptr) {
+                compiler->Release();
+            }
+
+            if(library != nullptr) {
+                library->Release();
+            }
+        }
+
+        [[nodiscard]] bool is_valid() const { return library != nullptr && compiler != nullptr; }
+    };
+
+    static ThreadDxcInstances& get_dxc_instances() {
+        thread_local ThreadDxcInstances instances;
+        return instances;
+    }
+
+    /*!
+     * \brief Describes the compiler and the arguments we give it, so that the shader cache can tell when either changes
+     */
+    static const std::string& get_compiler_version() {
+        static const auto version = [] {
+            std::string version_string = "dxc";
+
+            auto& dxc = get_dxc_instances();
+            if(dxc.is_valid()) {
+                IDxcVersionInfo* version_info;
+                if(SUCCEEDED(dxc.compiler->QueryInterface(IID_PPV_ARGS(&version_info)))) {
+                    UINT32 major = 0;
+                    UINT32 minor = 0;
+                    version_info->GetVersion(&major, &minor);
+                    version_string += fmt::format(" {}.{}", major, minor);
+
+                    version_info->Release();
+                }
+            }
+
+            for(const auto* arg : DXC_ARGS) {
+                version_string += " ";
+                for(const auto* c = arg; *c != L'\0'; c++) {
+                    version_string.push_back(static_cast<char>(*c));
+                }
+            }
+
+            return version_string;
+        }();
+
+        return version;
+    }
+
+    /*!
+     * \brief Compiles a shader, or loads it from the shader cache
+     *
+     * Safe to call from many threads at once
+     *
+     * \param error_message Set to why the shader couldn't be compiled, if it couldn't be
+     * \param included_files If not nullptr, set to the name of every file that the shader included. Set even if the shader couldn't be
+     * compiled, since fixing one of those files may fix the shader
+     *
+     * \return The shader's SPIR-V, or an empty vector if it couldn't be compiled
+     */
+    static std::vector<uint32_t> compile_shader_to_spirv(const std::string& source,
+                                                        const rhi::ShaderStage stage,
+                                                        const rhi::ShaderLanguage source_language,
+                                                        FolderAccessorBase* folder_accessor,
+                                                        const std::vector<std::string>& defines,
+                                                        std::string& error_message,
+                                                        std::vector<std::string>* included_files) {
+        ZoneScoped;
+        auto& shader_cache = get_shader_cache();
+        const auto& optimizer = get_spirv_optimizer();
+
+        // The cache holds optimized shaders, so shaders which were optimized differently must not share entries
+        const auto compiler_version = fmt::format("{} {}", get_compiler_version(), optimizer.get_cache_key());
+        const ShaderCacheKeyInfo cache_key_info{source, stage, source_language, defines, compiler_version};
+
+        const auto read_include = [&](const std::string& filename) { return read_shader_include(filename, folder_accessor); };
+        if(auto cached_spirv = shader_cache.find(cache_key_info, read_include, included_files)) {
+            return *cached_spirv;
+        }
+
         /*
          * Compile HLSL -> SPIR-V, using delicious DXC
          *
@@ -384,64 +737,109 @@ namespace nova::renderer::renderpack {
          * Microsoft knows how to the new API for their compiler. Thus, I'm using the old and deprecated API - because it actually works
          */
 
-        IDxcLibrary* lib;
-        auto hr = DxcCreateInstance(CLSID_DxcLibrary, IID_PPV_ARGS(&lib));
-        if(FAILED(hr)) {
-            logger->error("Could not create DXC Library instance");
-            return {};
-        }
-
-        IDxcCompiler* compiler;
-        hr = DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&compiler));
-        if(FAILED(hr)) {
-            logger->error("Could not create DXC instance");
+        auto& dxc = get_dxc_instances();
+        if(!dxc.is_valid()) {
+            error_message = "DXC isn't available";
             return {};
         }
 
         IDxcBlobEncoding* encoding;
-        hr = lib->CreateBlobWithEncodingFromPinned(source.data(), static_cast<UINT32>(source.size()), CP_UTF8, &encoding);
+        auto hr = dxc.library->CreateBlobWithEncodingFromPinned(source.data(), static_cast<UINT32>(source.size()), CP_UTF8, &encoding);
         if(FAILED(hr)) {
-            logger->error("Could not create blob from shader");
+            error_message = "Could not create blob from shader";
             return {};
         }
 
         const auto profile = to_hlsl_profile(stage);
 
-        std::vector<LPCWSTR> args = std::array{L"-spirv", L"-fspv-target-env=vulkan1.1", L"-fspv-reflect"};
+        std::vector<LPCWSTR> args{DXC_ARGS.begin(), DXC_ARGS.end()};
 
-        auto* includer = new NovaDxcIncludeHandler{*(&rx::memory::g_system_allocator), *lib, folder_accessor};
+        // Defines are NAME or NAME=VALUE. DXC wants them split, and wide
+        std::vector<std::pair<std::wstring, std::wstring>> wide_defines;
+        wide_defines.reserve(defines.size());
+        for(const auto& define : defines) {
+            const auto equals_pos = define.find('=');
+            const auto name = define.substr(0, equals_pos);
+            const auto value = equals_pos == std::string::npos ? std::string{} : define.substr(equals_pos + 1);
+            wide_defines.emplace_back(std::wstring{name.begin(), name.end()}, std::wstring{value.begin(), value.end()});
+        }
+
+        std::vector<DxcDefine> dxc_defines;
+        dxc_defines.reserve(wide_defines.size());
+        for(const auto& [name, value] : wide_defines) {
+            dxc_defines.push_back(DxcDefine{name.c_str(), value.empty() ? nullptr : value.c_str()});
+        }
+
+        auto* includer = new NovaDxcIncludeHandler{*(&rx::memory::g_system_allocator), *dxc.library, folder_accessor};
+
+        // Hold a reference so that the includer survives the compile, since we need it to tell the cache which files the shader included
+        includer->AddRef();
 
         IDxcOperationResult* compile_result;
-        hr = compiler->Compile(encoding,
-                               L"unknown", // File name, for error messages
-                               L"main",    // Entry point
-                               profile,
-                               args.data(),
-                               static_cast<UINT32>(args.size()),
-                               nullptr,
-                               0,
-                               includer,
-                               &compile_result);
+        hr = dxc.compiler->Compile(encoding,
+                                   L"unknown", // File name, for error messages
+                                   L"main",    // Entry point
+                                   profile,
+                                   args.data(),
+                                   static_cast<UINT32>(args.size()),
+                                   dxc_defines.data(),
+                                   static_cast<UINT32>(dxc_defines.size()),
+                                   includer,
+                                   &compile_result);
+        encoding->Release();
         if(FAILED(hr)) {
-            logger->error("Could not compile shader");
+            error_message = "Could not compile shader";
+            includer->Release();
             return {};
         }
 
+        if(included_files != nullptr) {
+            included_files->clear();
+            for(const auto& [name, contents] : includer->get_included_files()) {
+                included_files->push_back(name);
+            }
+        }
+
+        std::vector<uint32_t> spirv;
+
         compile_result->GetStatus(&hr);
         if(SUCCEEDED(hr)) {
             IDxcBlob* result_blob;
-            hr = compile_result->GetResult(&result_blob);
-            std::vector<uint32_t> spirv{result_blob->GetBufferSize() / sizeof(uint32_t)};
-            memcpy(spirv.data(), result_blob->GetBufferPointer(), result_blob->GetBufferSize());
-            return spirv;
+            compile_result->GetResult(&result_blob);
+            spirv.resize(result_blob->GetBufferSize() / sizeof(uint32_t));
+            memcpy(spirv.data(), result_blob->GetBufferPointer(), spirv.size() * sizeof(uint32_t));
+            result_blob->Release();
+
+            spirv = optimizer.optimize(spirv, error_message);
+            if(!spirv.empty()) {
+                shader_cache.add(cache_key_info, includer->get_included_files(), spirv);
+            }
 
         } else {
             IDxcBlobEncoding* error_buffer;
             compile_result->GetErrorBuffer(&error_buffer);
-            logger->error("Error compiling shader:\n%s\n", static_cast<char const*>(error_buffer->GetBufferPointer()));
+            error_message = std::string{static_cast<const char*>(error_buffer->GetBufferPointer()), error_buffer->GetBufferSize()};
             error_buffer->Release();
+        }
 
-            return {};
+        compile_result->Release();
+        includer->Release();
+
+        return spirv;
+    }
+
+    std::vector<uint32_t> compile_shader(const std::string& source,
+                                        const rhi::ShaderStage stage,
+                                        const rhi::ShaderLanguage source_language,
+                                        FolderAccessorBase* folder_accessor,
+                                        const std::vector<std::string>& defines,
+                                        std::vector<std::string>* included_files) {
+        std::string error_message;
+        auto spirv = compile_shader_to_spirv(source, stage, source_language, folder_accessor, defines, error_message, included_files);
+        if(spirv.empty()) {
+            logger->error("Error compiling shader:\n%s\n", error_message);
         }
+
+        return spirv;
     }
 } // namespace nova::renderer::renderpack
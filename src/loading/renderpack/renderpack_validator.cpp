@@ -12,7 +12,7 @@
 namespace nova::renderer::renderpack {
     RX_LOG("RenderpackValidator", logger);
 
-    constexpr uint32_t NUM_REQUIRED_FIELDS = 23;
+    constexpr uint32_t NUM_REQUIRED_FIELDS = 25;
 
     /*!
      * \brief All the default values for a JSON pipeline
@@ -42,7 +42,9 @@ namespace nova::renderer::renderpack {
                                                         "fragmentShader",
                                                         "tessellationControlShader",
                                                         "tessellationEvaluationShader",
-                                                        "geometryShader"};
+                                                        "geometryShader",
+                                                        "taskShader",
+                                                        "meshShader"};
     ;
 
     const std::array<std::string[3]> required_graphics_pipeline_fields = {"name", "pass", "vertexShader"};
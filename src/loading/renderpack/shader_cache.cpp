@@ -0,0 +1,310 @@
+#include "shader_cache.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+#include <Tracy.hpp>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+#include "../../util/binary_io.hpp"
+
+namespace nova::renderer::renderpack {
+    /*!
+     * \brief Nova compiles its builtin shaders during static initialization, which may happen before a static logger in this file would be
+     * initialized
+     */
+    static spdlog::logger& get_logger() {
+        static auto logger = spdlog::stdout_color_mt("ShaderCache");
+        return *logger;
+    }
+
+    constexpr uint32_t SHADER_CACHE_ENTRY_MAGIC = 0x4853564E; // "NVSH"
+
+    /*!
+     * \brief Version of the entry format, and of how we compile shaders. Increment this whenever either changes
+     */
+    constexpr uint32_t SHADER_CACHE_VERSION = 1;
+
+    constexpr const char* SHADER_CACHE_ENTRY_EXTENSION = ".spv";
+
+    constexpr const char* SHADER_CACHE_TEMP_EXTENSION = ".tmp";
+
+    static Sha256Digest hash_string(const std::string& string) {
+        Sha256 hasher;
+        hasher.update(string);
+        return hasher.finish();
+    }
+
+    ShaderCache::ShaderCache(const NovaSettings::ShaderCacheOptions& options) { set_options(options); }
+
+    std::optional<std::vector<uint32_t>> ShaderCache::find(const ShaderCacheKeyInfo& key_info,
+                                                           const ShaderIncludeReader& read_include,
+                                                           std::vector<std::string>* included_files) {
+        ZoneScoped;
+        const auto key = make_key(key_info);
+        const auto data = find_data(key, SHADER_CACHE_ENTRY_EXTENSION);
+        if(!data) {
+            return std::nullopt;
+        }
+
+        BinaryReader reader{*data};
+        if(reader.read<uint32_t>() != SHADER_CACHE_ENTRY_MAGIC || reader.read<uint32_t>() != SHADER_CACHE_VERSION) {
+            return std::nullopt;
+        }
+
+        const auto num_includes = reader.read<uint32_t>();
+        if(!num_includes) {
+            return std::nullopt;
+        }
+
+        std::vector<std::string> include_names;
+        include_names.reserve(*num_includes);
+
+        for(uint32_t i = 0; i < *num_includes; i++) {
+            const auto name_length = reader.read<uint32_t>();
+            if(!name_length || *name_length > reader.get_num_remaining_bytes()) {
+                return std::nullopt;
+            }
+
+            std::string name(*name_length, '\0');
+            Sha256Digest contents_hash;
+            if(!reader.read_bytes(name.data(), name.size()) || !reader.read_bytes(contents_hash.data(), contents_hash.size())) {
+                return std::nullopt;
+            }
+
+            // The shader was compiled with a different version of this file, so the SPIR-V is stale
+            const auto contents = read_include(name);
+            if(!contents || hash_string(*contents) != contents_hash) {
+                get_logger().debug("Included file {} changed since shader {} was cached", name, to_hex_string(key));
+                return std::nullopt;
+            }
+
+            include_names.push_back(std::move(name));
+        }
+
+        const auto num_words = reader.read<uint64_t>();
+        if(!num_words || *num_words > reader.get_num_remaining_bytes() / sizeof(uint32_t)) {
+            return std::nullopt;
+        }
+
+        std::vector<uint32_t> spirv(*num_words);
+        if(!reader.read_bytes(spirv.data(), spirv.size() * sizeof(uint32_t))) {
+            return std::nullopt;
+        }
+
+        if(included_files != nullptr) {
+            *included_files = std::move(include_names);
+        }
+
+        return spirv;
+    }
+
+    void ShaderCache::add(const ShaderCacheKeyInfo& key_info,
+                          const std::unordered_map<std::string, std::string>& included_files,
+                          const std::vector<uint32_t>& spirv) {
+        ZoneScoped;
+        std::vector<uint8_t> data;
+        write_value(data, SHADER_CACHE_ENTRY_MAGIC);
+        write_value(data, SHADER_CACHE_VERSION);
+
+        write_value(data, static_cast<uint32_t>(included_files.size()));
+        for(const auto& [name, contents] : included_files) {
+            write_value(data, static_cast<uint32_t>(name.size()));
+            data.insert(data.end(), name.begin(), name.end());
+
+            const auto contents_hash = hash_string(contents);
+            data.insert(data.end(), contents_hash.begin(), contents_hash.end());
+        }
+
+        write_value(data, static_cast<uint64_t>(spirv.size()));
+        const auto* spirv_bytes = reinterpret_cast<const uint8_t*>(spirv.data());
+        data.insert(data.end(), spirv_bytes, spirv_bytes + spirv.size() * sizeof(uint32_t));
+
+        add_data(make_key(key_info), SHADER_CACHE_ENTRY_EXTENSION, std::move(data));
+    }
+
+    std::optional<std::vector<uint8_t>> ShaderCache::find_data(const Sha256Digest& key, const std::string_view extension) {
+        ZoneScoped;
+        std::filesystem::path entry_path;
+        {
+            std::lock_guard lock{mutex};
+            if(!enabled) {
+                return std::nullopt;
+            }
+
+            entry_path = get_entry_path(key, extension);
+        }
+
+        std::ifstream file{entry_path, std::ios::binary | std::ios::ate};
+        if(!file) {
+            return std::nullopt;
+        }
+
+        const auto file_size = static_cast<size_t>(file.tellg());
+        file.seekg(0);
+
+        std::vector<uint8_t> data(file_size);
+        if(file_size <= sizeof(Sha256Digest) || !file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(file_size))) {
+            return std::nullopt;
+        }
+        file.close();
+
+        // Check the checksum at the end of the entry before we trust anything in it
+        const auto contents_size = data.size() - sizeof(Sha256Digest);
+        Sha256 checksum_hasher;
+        checksum_hasher.update(std::span{data.data(), contents_size});
+        if(std::memcmp(checksum_hasher.finish().data(), data.data() + contents_size, sizeof(Sha256Digest)) != 0) {
+            get_logger().warn("Shader cache entry {} is corrupt, ignoring it", entry_path.string());
+            return std::nullopt;
+        }
+
+        data.resize(contents_size);
+
+        // Touch the entry so that eviction knows we used it recently
+        std::error_code error;
+        std::filesystem::last_write_time(entry_path, std::filesystem::file_time_type::clock::now(), error);
+
+        return data;
+    }
+
+    void ShaderCache::add_data(const Sha256Digest& key, const std::string_view extension, std::vector<uint8_t> data) {
+        ZoneScoped;
+        Sha256 checksum_hasher;
+        checksum_hasher.update(data);
+        const auto checksum = checksum_hasher.finish();
+        data.insert(data.end(), checksum.begin(), checksum.end());
+
+        std::lock_guard lock{mutex};
+        if(!enabled) {
+            return;
+        }
+
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        if(error) {
+            get_logger().error("Could not create shader cache directory {}: {}", directory.string(), error.message());
+            return;
+        }
+
+        evict_entries_if_needed(data.size());
+
+        // Write to a file that nobody else will touch, then move it into place, so that nobody ever reads a half-written entry
+        const auto entry_path = get_entry_path(key, extension);
+        auto temp_path = entry_path;
+        temp_path += fmt::format(".{}{}", std::hash<std::thread::id>{}(std::this_thread::get_id()), SHADER_CACHE_TEMP_EXTENSION);
+
+        {
+            std::ofstream file{temp_path, std::ios::binary | std::ios::trunc};
+            file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+            if(!file) {
+                get_logger().error("Could not write shader cache entry {}", temp_path.string());
+                file.close();
+                std::filesystem::remove(temp_path, error);
+                return;
+            }
+        }
+
+        std::filesystem::rename(temp_path, entry_path, error);
+        if(error) {
+            get_logger().error("Could not move shader cache entry to {}: {}", entry_path.string(), error.message());
+            std::filesystem::remove(temp_path, error);
+            return;
+        }
+
+        if(cur_size) {
+            *cur_size += data.size();
+        }
+    }
+
+    void ShaderCache::set_options(const NovaSettings::ShaderCacheOptions& new_options) {
+        std::lock_guard lock{mutex};
+        enabled = new_options.enabled;
+        directory = new_options.directory;
+        max_size = static_cast<uint64_t>(new_options.max_size_mb) * 1024 * 1024;
+        cur_size = std::nullopt;
+    }
+
+    Sha256Digest ShaderCache::make_key(const ShaderCacheKeyInfo& key_info) {
+        Sha256 hasher;
+        hasher.update_value(SHADER_CACHE_VERSION);
+        hasher.update_with_length(key_info.compiler_version);
+        hasher.update_value(static_cast<uint32_t>(key_info.stage));
+        hasher.update_value(static_cast<uint32_t>(key_info.language));
+
+        hasher.update_value(static_cast<uint64_t>(key_info.defines.size()));
+        for(const auto& define : key_info.defines) {
+            hasher.update_with_length(define);
+        }
+
+        hasher.update_with_length(key_info.source);
+
+        return hasher.finish();
+    }
+
+    std::filesystem::path ShaderCache::get_entry_path(const Sha256Digest& key, const std::string_view extension) const {
+        return directory / (to_hex_string(key) + std::string{extension});
+    }
+
+    void ShaderCache::evict_entries_if_needed(const uint64_t new_entry_size) {
+        ZoneScoped;
+        if(cur_size && *cur_size + new_entry_size <= max_size) {
+            return;
+        }
+
+        // Other copies of Nova may have changed the cache, so look at what's actually on disk
+        struct Entry {
+            std::filesystem::path path;
+            uint64_t size;
+            std::filesystem::file_time_type last_used_time;
+        };
+
+        std::vector<Entry> entries;
+        uint64_t total_size = 0;
+
+        std::error_code error;
+        for(const auto& dir_entry : std::filesystem::directory_iterator{directory, error}) {
+            // Temporary files belong to whoever is writing them
+            if(!dir_entry.is_regular_file(error) || dir_entry.path().extension() == SHADER_CACHE_TEMP_EXTENSION) {
+                continue;
+            }
+
+            const auto size = dir_entry.file_size(error);
+            const auto last_used_time = dir_entry.last_write_time(error);
+            if(error) {
+                // Another process probably deleted it
+                continue;
+            }
+
+            entries.emplace_back(Entry{dir_entry.path(), size, last_used_time});
+            total_size += size;
+        }
+
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.last_used_time < b.last_used_time; });
+
+        uint32_t num_evicted = 0;
+        for(const auto& entry : entries) {
+            if(total_size + new_entry_size <= max_size) {
+                break;
+            }
+
+            if(std::filesystem::remove(entry.path, error)) {
+                num_evicted++;
+            }
+            total_size -= entry.size;
+        }
+
+        if(num_evicted > 0) {
+            get_logger().debug("Evicted {} entries from the shader cache", num_evicted);
+        }
+
+        cur_size = total_size;
+    }
+
+    ShaderCache& get_shader_cache() {
+        static ShaderCache cache{NovaSettings::ShaderCacheOptions{}};
+        return cache;
+    }
+} // namespace nova::renderer::renderpack
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "nova_renderer/nova_settings.hpp"
+#include "nova_renderer/rhi/rhi_enums.hpp"
+
+#include "../../util/sha256.hpp"
+
+namespace nova::renderer::renderpack {
+    /*!
+     * \brief Everything that goes into compiling a shader, apart from the files it includes
+     */
+    struct ShaderCacheKeyInfo {
+        const std::string& source;
+
+        rhi::ShaderStage stage;
+
+        rhi::ShaderLanguage language;
+
+        const std::vector<std::string>& defines;
+
+        /*!
+         * \brief Version of the compiler, so that upgrading the compiler throws away the old shaders
+         */
+        const std::string& compiler_version;
+    };
+
+    /*!
+     * \brief Finds the contents of an included file, or returns an empty optional if it doesn't exist
+     */
+    using ShaderIncludeReader = std::function<std::optional<std::string>(const std::string& filename)>;
+
+    /*!
+     * \brief Saves compiled SPIR-V to disk, so that Nova only compiles each shader once
+     *
+     * Entries are keyed by a SHA-256 of the shader's source, defines, stage, language, and the compiler version. We don't know which
+     * files a shader includes until we compile it, so each entry also records the SHA-256 of every file that the compiler included. A
+     * lookup reads those files again and only hits if none of them changed
+     *
+     * Each entry is one file, which is written to a temporary file and renamed into place, so several threads or several copies of Nova
+     * can share the cache. Entries have a checksum, and we ignore any entry which doesn't match it. When the cache gets bigger than its
+     * size limit, we delete the least recently used entries until it fits
+     */
+    class ShaderCache {
+    public:
+        explicit ShaderCache(const NovaSettings::ShaderCacheOptions& options);
+
+        /*!
+         * \brief Finds the SPIR-V for a shader
+         *
+         * \param key_info The shader to look for
+         * \param read_include How to read the files that the shader includes, to check that they haven't changed
+         * \param included_files If not nullptr and the shader is in the cache, set to the name of every file that the shader includes
+         *
+         * \return The shader's SPIR-V, or an empty optional if it's not in the cache
+         */
+        [[nodiscard]] std::optional<std::vector<uint32_t>> find(const ShaderCacheKeyInfo& key_info,
+                                                                const ShaderIncludeReader& read_include,
+                                                                std::vector<std::string>* included_files = nullptr);
+
+        /*!
+         * \brief Adds a shader to the cache
+         *
+         * \param key_info The shader that we compiled
+         * \param included_files Name and contents of every file that the shader included
+         * \param spirv The compiled shader
+         */
+        void add(const ShaderCacheKeyInfo& key_info,
+                 const std::unordered_map<std::string, std::string>& included_files,
+                 const std::vector<uint32_t>& spirv);
+
+        /*!
+         * \brief Finds some other data that's stored in the cache, such as a shader's reflection information
+         *
+         * \param key What the data is keyed by
+         * \param extension Extension of the data's file, so that different kinds of data with the same key don't overwrite each other
+         *
+         * \return The data, or an empty optional if it's not in the cache or its checksum doesn't match
+         */
+        [[nodiscard]] std::optional<std::vector<uint8_t>> find_data(const Sha256Digest& key, std::string_view extension);
+
+        /*!
+         * \brief Adds some other data to the cache. It's checksummed and evicted just like SPIR-V is
+         */
+        void add_data(const Sha256Digest& key, std::string_view extension, std::vector<uint8_t> data);
+
+        /*!
+         * \brief Changes the cache's options. Entries which are already in the cache stay in the old directory
+         */
+        void set_options(const NovaSettings::ShaderCacheOptions& new_options);
+
+    private:
+        std::mutex mutex;
+
+        bool enabled;
+
+        std::filesystem::path directory;
+
+        uint64_t max_size;
+
+        /*!
+         * \brief Size of the cache's directory, or an empty optional if we haven't looked at it yet
+         */
+        std::optional<uint64_t> cur_size;
+
+        [[nodiscard]] static Sha256Digest make_key(const ShaderCacheKeyInfo& key_info);
+
+        [[nodiscard]] std::filesystem::path get_entry_path(const Sha256Digest& key, std::string_view extension) const;
+
+        /*!
+         * \brief Deletes the least recently used entries until the cache fits in its size limit. Must be called with the mutex held
+         */
+        void evict_entries_if_needed(uint64_t new_entry_size);
+    };
+
+    /*!
+     * \brief The shader cache that `compile_shader` uses
+     *
+     * Nova compiles some builtin shaders during static initialization, before it's read its settings, so this starts out with the default
+     * options. `NovaRenderer` gives it the real options once it has them
+     */
+    [[nodiscard]] ShaderCache& get_shader_cache();
+} // namespace nova::renderer::renderpack
@@ -1,5 +1,7 @@
 #include "nova_renderer/loading/shader_includer.hpp"
 
+#include <mutex>
+
 #include <rx/core/log.h>
 
 #include "nova_renderer/filesystem/folder_accessor.hpp"
@@ -8,12 +10,16 @@ namespace nova::renderer {
     RX_LOG("NovaDxcIncludeHandler", logger);
 
     constexpr const char* STANDARD_PIPELINE_LAYOUT_FILE_NAME = "./nova/standard_pipeline_layout.hlsl";
+    constexpr const char* MESHLETS_FILE_NAME = "./nova/meshlets.hlsl";
 
-    NovaDxcIncludeHandler::NovaDxcIncludeHandler(rx::memory::allocator& allocator,
-                                                 IDxcLibrary& library,
-                                                 filesystem::FolderAccessorBase* folder_accessor)
-        : allocator{allocator}, library{library}, folder_accessor{folder_accessor}, builtin_files{&allocator} {
-        const auto standard_pipeline_layout_hlsl = R"(
+    /*!
+     * \brief Files that every shader can include, no matter which renderpack it's from
+     */
+    static const std::unordered_map<std::string, std::string>& get_builtin_files() {
+        static const auto builtin_files = [] {
+            std::unordered_map<std::string, std::string> files;
+
+            const auto standard_pipeline_layout_hlsl = R"(
 struct Camera {
     float4x4 view;
     float4x4 projection;
@@ -35,6 +41,11 @@ struct StandardPushConstants {
      * \brief Index of the material data for the current draw
      */
     uint material_index;
+
+    /*!
+     * \brief Index of the model matrix of the instance that this draw renders
+     */
+    uint model_matrix_index;
 } constants;
 
 /*!
@@ -68,15 +79,215 @@ SamplerState bilinear_filter : register(s1);
 SamplerState trilinear_filter : register(s3);
 
 /*!
- * \brief Array of all the textures that are available for a shader to sample from
+ * \brief Must match VirtualTextureInfo in virtual_texture_system.hpp
+ */
+struct VirtualTextureInfo {
+    uint page_table_texture;
+    uint width;
+    uint height;
+    uint num_mips;
+    uint physical_cache_texture;
+    uint cache_size_in_pages;
+    uint2 padding;
+};
+
+/*!
+ * \brief Array of all the virtual textures. Index it with a vertex's virtual texture ID
  */
 [[vk::binding(5, 0)]]
+StructuredBuffer<VirtualTextureInfo> virtual_textures : register(t4);
+
+/*!
+ * \brief The virtual texture pages that shaders wanted this frame. The first element is the number of pages that shaders tried to write
+ */
+[[vk::binding(6, 0)]]
+RWStructuredBuffer<uint> virtual_texture_feedback : register(u0);
+
+/*!
+ * \brief Array of all the textures that are available for a shader to sample from
+ */
+[[vk::binding(7, 0)]]
 Texture2D textures[] : register(t3);
-        )";
 
-        builtin_files.insert(STANDARD_PIPELINE_LAYOUT_FILE_NAME, standard_pipeline_layout_hlsl);
+#define VIRTUAL_TEXTURE_PAGE_SIZE 128
+
+/*!
+ * \brief Must match VirtualPageId::pack in virtual_texture_page_cache.cpp
+ */
+uint pack_virtual_page(uint virtual_texture_id, uint mip, uint2 page) {
+    return (virtual_texture_id << 24) | (mip << 20) | (page.x << 10) | page.y;
+}
+
+void write_virtual_texture_feedback(uint packed_page) {
+    uint num_elements;
+    uint stride;
+    virtual_texture_feedback.GetDimensions(num_elements, stride);
+
+    uint idx;
+    InterlockedAdd(virtual_texture_feedback[0], 1, idx);
+    if(idx + 1 < num_elements) {
+        virtual_texture_feedback[idx + 1] = packed_page;
+    }
+}
+
+/*!
+ * \brief Samples a virtual texture, and asks Nova to load the page it wanted if it isn't resident
+ *
+ * Falls back to the closest coarser page that's resident. Returns transparent black if nothing is resident yet
+ *
+ * \param virtual_texture_id The virtual texture to sample, e.g. from load_vertex_uvs_and_virtual_texture_id
+ * \param uv Texture coordinates. The texture repeats outside of [0, 1]
+ * \param pixel_position SV_Position of the current pixel. Only one pixel in each 4x4 block writes feedback, so that the feedback
+ * buffer doesn't overflow
+ */
+float4 sample_virtual_texture(uint virtual_texture_id, float2 uv, float4 pixel_position) {
+    VirtualTextureInfo info = virtual_textures[virtual_texture_id];
+
+    float2 texel = uv * float2(info.width, info.height);
+    float2 dx = ddx(texel);
+    float2 dy = ddy(texel);
+    float wanted_lod = max(0.5 * log2(max(dot(dx, dx), dot(dy, dy))), 0);
+    uint wanted_mip = min((uint)wanted_lod, info.num_mips - 1);
+
+    uv = frac(uv);
+    uint2 wanted_page = (uint2)(uv * float2(info.width >> wanted_mip, info.height >> wanted_mip)) / VIRTUAL_TEXTURE_PAGE_SIZE;
+
+    if((((uint)pixel_position.x | (uint)pixel_position.y) & 3) == 0) {
+        write_virtual_texture_feedback(pack_virtual_page(virtual_texture_id, wanted_mip, wanted_page));
+    }
+
+    uint4 entry = (uint4)(textures[NonUniformResourceIndex(info.page_table_texture)].Load(int3(wanted_page, wanted_mip)) * 255.0 + 0.5);
+    if(entry.a == 0) {
+        return float4(0, 0, 0, 0);
+    }
+
+    // The entry may point at a coarser page than the one we wanted, so find where we are in that page
+    uint resident_mip = entry.b;
+    float2 page_coord = uv * float2(info.width >> resident_mip, info.height >> resident_mip) / VIRTUAL_TEXTURE_PAGE_SIZE;
+
+    // Stay half a texel away from the page's edges so that filtering doesn't bleed in the neighboring pages in the cache
+    float2 texel_in_page = clamp(frac(page_coord) * VIRTUAL_TEXTURE_PAGE_SIZE, 0.5, VIRTUAL_TEXTURE_PAGE_SIZE - 0.5);
+    float2 cache_uv = (entry.xy * VIRTUAL_TEXTURE_PAGE_SIZE + texel_in_page) / (info.cache_size_in_pages * VIRTUAL_TEXTURE_PAGE_SIZE);
+
+    return textures[NonUniformResourceIndex(info.physical_cache_texture)].SampleLevel(bilinear_filter, cache_uv, 0);
+}
+            )";
+
+            files.emplace(STANDARD_PIPELINE_LAYOUT_FILE_NAME, standard_pipeline_layout_hlsl);
+
+            // Must match the Meshlet struct in meshlet_builder.hpp, and the meshlet descriptor set in VulkanRenderDevice
+            const auto meshlets_hlsl = R"(
+struct Meshlet {
+    uint vertex_offset;
+    uint vertex_count;
+    uint primitive_offset;
+    uint primitive_count;
+    float4 bounding_sphere;
+    float4 cone_apex;
+    float4 cone_axis_cutoff;
+};
+
+/*!
+ * \brief Raw vertex data of the current mesh, in the FullVertex layout. Use the load_* functions below to read it
+ */
+[[vk::binding(0, 1)]]
+ByteAddressBuffer vertices : register(t0, space1);
+
+/*!
+ * \brief All the meshlets of the current mesh
+ */
+[[vk::binding(1, 1)]]
+StructuredBuffer<Meshlet> meshlets : register(t1, space1);
+
+/*!
+ * \brief Indices into `vertices`. Each meshlet uses the range [vertex_offset, vertex_offset + vertex_count)
+ */
+[[vk::binding(2, 1)]]
+StructuredBuffer<uint> meshlet_vertices : register(t2, space1);
+
+/*!
+ * \brief Meshlet triangles. Each triangle is three meshlet-local vertex indices packed into the low three bytes
+ */
+[[vk::binding(3, 1)]]
+StructuredBuffer<uint> meshlet_primitives : register(t3, space1);
+
+/*!
+ * \brief Number of meshlets that a task shader workgroup processes. Task shaders should use this as their workgroup size
+ */
+#define MESHLETS_PER_TASK_WORKGROUP 32
+
+#define FULL_VERTEX_SIZE 64
+
+float3 load_vertex_position(uint vertex_idx) { return asfloat(vertices.Load3(vertex_idx * FULL_VERTEX_SIZE)); }
+
+float3 load_vertex_normal(uint vertex_idx) { return asfloat(vertices.Load3(vertex_idx * FULL_VERTEX_SIZE + 12)); }
+
+float3 load_vertex_tangent(uint vertex_idx) { return asfloat(vertices.Load3(vertex_idx * FULL_VERTEX_SIZE + 24)); }
+
+uint3 load_vertex_uvs_and_virtual_texture_id(uint vertex_idx) { return vertices.Load3(vertex_idx * FULL_VERTEX_SIZE + 36); }
+
+float4 load_vertex_additional_stuff(uint vertex_idx) { return asfloat(vertices.Load4(vertex_idx * FULL_VERTEX_SIZE + 48)); }
+
+uint3 unpack_meshlet_triangle(uint packed_triangle) {
+    return uint3(packed_triangle & 0xFF, (packed_triangle >> 8) & 0xFF, (packed_triangle >> 16) & 0xFF);
+}
+
+/*!
+ * \brief Checks if a meshlet is entirely backfacing from the point of view of the camera
+ *
+ * camera_position must be in the same space as the meshlet, e.g. model space
+ */
+bool is_meshlet_backfacing(Meshlet meshlet, float3 camera_position) {
+    return dot(normalize(meshlet.cone_apex.xyz - camera_position), meshlet.cone_axis_cutoff.xyz) >= meshlet.cone_axis_cutoff.w;
+}
+
+/*!
+ * \brief Checks if a meshlet's bounding sphere is completely outside of any of the provided frustum planes
+ *
+ * The planes must be in the same space as the meshlet and have normals which point into the frustum
+ */
+bool is_meshlet_outside_frustum(Meshlet meshlet, float4 frustum_planes[6]) {
+    for(uint i = 0; i < 6; i++) {
+        if(dot(frustum_planes[i].xyz, meshlet.bounding_sphere.xyz) + frustum_planes[i].w < -meshlet.bounding_sphere.w) {
+            return true;
+        }
     }
 
+    return false;
+}
+            )";
+
+            files.emplace(MESHLETS_FILE_NAME, meshlets_hlsl);
+
+            return files;
+        }();
+
+        return builtin_files;
+    }
+
+    std::optional<std::string> read_shader_include(const std::string& filename, filesystem::FolderAccessorBase* folder_accessor) {
+        const auto& builtin_files = get_builtin_files();
+        if(const auto itr = builtin_files.find(filename); itr != builtin_files.end()) {
+            return itr->second;
+
+        } else if(folder_accessor != nullptr) {
+            // Shaders compile on many threads at once, and not every folder accessor can read files from many threads at once
+            static std::mutex folder_accessor_mutex;
+            std::lock_guard lock{folder_accessor_mutex};
+
+            if(folder_accessor->does_resource_exist(filename)) {
+                return folder_accessor->read_text_file(filename);
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    NovaDxcIncludeHandler::NovaDxcIncludeHandler(rx::memory::allocator& allocator,
+                                                 IDxcLibrary& library,
+                                                 filesystem::FolderAccessorBase* folder_accessor)
+        : allocator{allocator}, library{library}, folder_accessor{folder_accessor} {}
+
     HRESULT NovaDxcIncludeHandler::QueryInterface(const REFIID class_id, void** output_object) {
         if(!output_object) {
             return E_INVALIDARG;
@@ -121,27 +332,21 @@ Texture2D textures[] : register(t3);
 
         logger->debug("Trying to include file (%s)", filename);
 
-        if(const auto* file = builtin_files.find(filename)) {
-            IDxcBlobEncoding* encoding;
-            library.CreateBlobWithEncodingFromPinned(file->data(), static_cast<uint32_t>(file->size()), CP_UTF8, &encoding);
-            *included_source = encoding;
-
-            logger->debug("Included %s from builtin snippets", filename);
-
-            return 0;
-
-        } else if(folder_accessor != nullptr && folder_accessor->does_resource_exist(filename)) {
-            const auto included_shader = folder_accessor->read_text_file(filename);
+        auto file = read_shader_include(filename, folder_accessor);
+        if(!file) {
+            return ERROR_FILE_NOT_FOUND;
+        }
 
-            IDxcBlobEncoding* encoding;
-            library.CreateBlobWithEncodingFromPinned(filename.data(), static_cast<uint32_t>(filename.size()), CP_UTF8, &encoding);
-            *included_source = encoding;
+        // A file may be included more than once. Keep the first copy, since DXC may still be reading it
+        const auto [itr, inserted] = included_files.try_emplace(filename, std::move(*file));
+        const auto& contents = itr->second;
 
-            logger->debug("Included %s from renderpack", filename);
+        IDxcBlobEncoding* encoding;
+        library.CreateBlobWithEncodingFromPinned(contents.data(), static_cast<uint32_t>(contents.size()), CP_UTF8, &encoding);
+        *included_source = encoding;
 
-            return 0;
-        }
-
-        return ERROR_FILE_NOT_FOUND;
+        return 0;
     }
+
+    const std::unordered_map<std::string, std::string>& NovaDxcIncludeHandler::get_included_files() const { return included_files; }
 } // namespace nova::renderer
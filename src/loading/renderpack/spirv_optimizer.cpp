@@ -0,0 +1,219 @@
+#include "spirv_optimizer.hpp"
+
+#include <Tracy.hpp>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+#include <spirv-tools/libspirv.hpp>
+#include <spirv-tools/optimizer.hpp>
+
+#include "../../renderer/shader_reflection.hpp"
+
+namespace nova::renderer::renderpack {
+    /*!
+     * \brief We optimize the builtin shaders during static initialization, which may happen before a static logger in this file would be
+     * initialized
+     */
+    static spdlog::logger& get_logger() {
+        static auto logger = spdlog::stdout_color_mt("SpirvOptimizer");
+        return *logger;
+    }
+
+    /*!
+     * \brief Must match the target environment that we ask DXC for
+     */
+    constexpr spv_target_env TARGET_ENV = SPV_ENV_VULKAN_1_1;
+
+    static spvtools::MessageConsumer make_message_consumer(std::string& error_message) {
+        return [&](const spv_message_level_t level, const char* /* source */, const spv_position_t& position, const char* message) {
+            if(level <= SPV_MSG_ERROR) {
+                error_message += fmt::format("{}: {}\n", position.index, message);
+            }
+        };
+    }
+
+    static spvtools::ValidatorOptions make_validator_options() {
+        // Relaxed block layout is core in Vulkan 1.1, and DXC relies on it for cbuffers
+        spvtools::ValidatorOptions validator_options;
+        validator_options.SetRelaxBlockLayout(true);
+        return validator_options;
+    }
+
+    static void register_optimization_passes(spvtools::Optimizer& optimizer,
+                                             const NovaSettings::ShaderCompilationOptions::Optimization optimization) {
+        switch(optimization) {
+            case NovaSettings::ShaderCompilationOptions::Optimization::Performance:
+                optimizer.RegisterPerformancePasses();
+                break;
+
+            case NovaSettings::ShaderCompilationOptions::Optimization::Size:
+                optimizer.RegisterSizePasses();
+                break;
+
+            case NovaSettings::ShaderCompilationOptions::Optimization::None:
+                break;
+        }
+    }
+
+    static std::vector<uint32_t> run_optimizer(spvtools::Optimizer& optimizer,
+                                               const std::vector<uint32_t>& spirv,
+                                               const bool validate_input,
+                                               std::string& error_message) {
+        optimizer.SetMessageConsumer(make_message_consumer(error_message));
+
+        spvtools::OptimizerOptions optimizer_options;
+        optimizer_options.set_run_validator(validate_input);
+        optimizer_options.set_validator_options(make_validator_options());
+
+        std::vector<uint32_t> optimized_spirv;
+        if(!optimizer.Run(spirv.data(), spirv.size(), &optimized_spirv, optimizer_options)) {
+            if(error_message.empty()) {
+                error_message = "spirv-opt failed without saying why";
+            }
+            return {};
+        }
+
+        return optimized_spirv;
+    }
+
+    static bool validate(const std::vector<uint32_t>& spirv, std::string& error_message) {
+        ZoneScoped;
+        spvtools::SpirvTools tools{TARGET_ENV};
+        tools.SetMessageConsumer(make_message_consumer(error_message));
+
+        const auto validator_options = make_validator_options();
+        return tools.Validate(spirv.data(), spirv.size(), validator_options);
+    }
+
+    SpirvOptimizer::SpirvOptimizer(const NovaSettings::ShaderCompilationOptions& options) : options{options} {}
+
+    std::vector<uint32_t> SpirvOptimizer::optimize(const std::vector<uint32_t>& spirv, std::string& error_message) const {
+        ZoneScoped;
+        const auto cur_options = get_options();
+
+        auto optimized_spirv = spirv;
+        if(cur_options.optimization != NovaSettings::ShaderCompilationOptions::Optimization::None) {
+            spvtools::Optimizer optimizer{TARGET_ENV};
+            register_optimization_passes(optimizer, cur_options.optimization);
+
+            // The passes assume that their input is valid, so let spirv-opt check that first if we're going to validate anyways
+            optimized_spirv = run_optimizer(optimizer, spirv, cur_options.validate, error_message);
+            if(optimized_spirv.empty()) {
+                return {};
+            }
+
+            get_logger().debug("Optimized shader from {} bytes to {} bytes",
+                               spirv.size() * sizeof(uint32_t),
+                               optimized_spirv.size() * sizeof(uint32_t));
+        }
+
+        if(cur_options.validate && !validate(optimized_spirv, error_message)) {
+            return {};
+        }
+
+        return optimized_spirv;
+    }
+
+    std::vector<uint32_t> SpirvOptimizer::specialize(const std::vector<uint32_t>& spirv,
+                                                     const std::unordered_map<std::string, std::string>& values,
+                                                     std::string& error_message) const {
+        ZoneScoped;
+        if(values.empty()) {
+            return spirv;
+        }
+
+        const auto& reflection = get_shader_reflection_database().get_reflection(spirv);
+
+        std::unordered_map<uint32_t, std::string> values_by_id;
+        for(const auto& constant : reflection.specialization_constants) {
+            if(const auto itr = values.find(constant.name); itr != values.end()) {
+                values_by_id.emplace(constant.constant_id, itr->second);
+            }
+        }
+
+        if(values_by_id.empty()) {
+            return spirv;
+        }
+
+        const auto cur_options = get_options();
+
+        spvtools::Optimizer optimizer{TARGET_ENV};
+        optimizer.RegisterPass(spvtools::CreateSetSpecConstantDefaultValuePass(values_by_id));
+        optimizer.RegisterPass(spvtools::CreateFreezeSpecConstantValuePass());
+        optimizer.RegisterPass(spvtools::CreateFoldSpecConstantOpAndCompositePass());
+        optimizer.RegisterPass(spvtools::CreateUnifyConstantPass());
+
+        // The optimization passes fold branches on the now-constant values and remove the code that they turned off
+        register_optimization_passes(optimizer, cur_options.optimization);
+
+        auto specialized_spirv = run_optimizer(optimizer, spirv, false, error_message);
+        if(specialized_spirv.empty()) {
+            return {};
+        }
+
+        if(cur_options.validate && !validate(specialized_spirv, error_message)) {
+            return {};
+        }
+
+        return specialized_spirv;
+    }
+
+    std::vector<uint32_t> SpirvOptimizer::strip(const std::vector<uint32_t>& spirv) const {
+        ZoneScoped;
+        if(!get_options().strip_debug_info) {
+            return spirv;
+        }
+
+        spvtools::Optimizer optimizer{TARGET_ENV};
+        optimizer.RegisterPass(spvtools::CreateStripDebugInfoPass());
+        optimizer.RegisterPass(spvtools::CreateStripReflectInfoPass());
+
+        std::string error_message;
+        auto stripped_spirv = run_optimizer(optimizer, spirv, false, error_message);
+        if(stripped_spirv.empty()) {
+            get_logger().warn("Could not strip debug info from shader, using it as is: {}", error_message);
+            return spirv;
+        }
+
+        return stripped_spirv;
+    }
+
+    std::string SpirvOptimizer::get_cache_key() const {
+        const auto cur_options = get_options();
+
+        std::string key;
+        switch(cur_options.optimization) {
+            case NovaSettings::ShaderCompilationOptions::Optimization::None:
+                key = "spirv-opt none";
+                break;
+
+            case NovaSettings::ShaderCompilationOptions::Optimization::Performance:
+                key = "spirv-opt performance";
+                break;
+
+            case NovaSettings::ShaderCompilationOptions::Optimization::Size:
+                key = "spirv-opt size";
+                break;
+        }
+
+        if(cur_options.validate) {
+            key += " validated";
+        }
+
+        return key;
+    }
+
+    void SpirvOptimizer::set_options(const NovaSettings::ShaderCompilationOptions& new_options) {
+        std::lock_guard lock{mutex};
+        options = new_options;
+    }
+
+    NovaSettings::ShaderCompilationOptions SpirvOptimizer::get_options() const {
+        std::lock_guard lock{mutex};
+        return options;
+    }
+
+    SpirvOptimizer& get_spirv_optimizer() {
+        static SpirvOptimizer optimizer{NovaSettings::ShaderCompilationOptions{}};
+        return optimizer;
+    }
+} // namespace nova::renderer::renderpack
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "nova_renderer/nova_settings.hpp"
+
+namespace nova::renderer::renderpack {
+    /*!
+     * \brief Runs spirv-opt's passes over compiled shaders
+     *
+     * We optimize shaders once, right after we compile them, and the shader cache stores the optimized SPIR-V. Stripping debug info
+     * happens much later, right before the RHI gives a shader to the driver, since reflection needs the names that stripping removes
+     *
+     * Safe to call from many threads at once. Every call builds its own spirv-opt optimizer, since those aren't thread-safe
+     */
+    class SpirvOptimizer {
+    public:
+        explicit SpirvOptimizer(const NovaSettings::ShaderCompilationOptions& options);
+
+        /*!
+         * \brief Optimizes a shader with the passes that the options ask for, then validates the result if the options ask for that
+         *
+         * \param spirv The shader to optimize
+         * \param error_message Set to why the shader couldn't be optimized, if it couldn't be
+         *
+         * \return The optimized shader, or an empty vector if the shader isn't valid
+         */
+        [[nodiscard]] std::vector<uint32_t> optimize(const std::vector<uint32_t>& spirv, std::string& error_message) const;
+
+        /*!
+         * \brief Bakes values into a shader's specialization constants, then optimizes away whatever code they turned off
+         *
+         * \param spirv The shader to specialize
+         * \param values Text of the value of each specialization constant, by name, such as `16`, `0.5`, or `true`. Constants which the
+         * shader doesn't have are ignored, since a pipeline's constants are often only used by some of its stages
+         * \param error_message Set to why the shader couldn't be specialized, if it couldn't be
+         *
+         * \return The specialized shader, or an empty vector if it couldn't be specialized
+         */
+        [[nodiscard]] std::vector<uint32_t> specialize(const std::vector<uint32_t>& spirv,
+                                                       const std::unordered_map<std::string, std::string>& values,
+                                                       std::string& error_message) const;
+
+        /*!
+         * \brief Removes names, line info, and reflection decorations from a shader, if the options ask for that
+         *
+         * \return The stripped shader, or `spirv` if we shouldn't or couldn't strip it
+         */
+        [[nodiscard]] std::vector<uint32_t> strip(const std::vector<uint32_t>& spirv) const;
+
+        /*!
+         * \brief Describes the options which change what `optimize` produces, so that the shader cache can tell shaders which were
+         * optimized differently apart
+         */
+        [[nodiscard]] std::string get_cache_key() const;
+
+        void set_options(const NovaSettings::ShaderCompilationOptions& new_options);
+
+    private:
+        mutable std::mutex mutex;
+
+        NovaSettings::ShaderCompilationOptions options;
+
+        [[nodiscard]] NovaSettings::ShaderCompilationOptions get_options() const;
+    };
+
+    /*!
+     * \brief The optimizer that `compile_shader` uses
+     *
+     * Like the shader cache, this starts out with the default options, since Nova compiles some builtin shaders during static
+     * initialization. `NovaRenderer` gives it the real options once it has them
+     */
+    [[nodiscard]] SpirvOptimizer& get_spirv_optimizer();
+} // namespace nova::renderer::renderpack
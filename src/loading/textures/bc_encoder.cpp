@@ -0,0 +1,302 @@
+#include "bc_encoder.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace nova::renderer {
+    /*!
+     * \brief Finds the line through a block's pixels that best fits them, and the two points on that line that bracket every pixel
+     *
+     * Uses the principal axis of the pixels' covariance, found with a few rounds of power iteration. `NumChannels` is 3 to fit only
+     * color, or 4 to fit color and alpha
+     */
+    template <uint32_t NumChannels>
+    static void fit_endpoints(const uint8_t pixels[16 * 4], std::array<float, 4>& start, std::array<float, 4>& end) {
+        std::array<float, 4> mean = {};
+        for(uint32_t i = 0; i < 16; i++) {
+            for(uint32_t c = 0; c < NumChannels; c++) {
+                mean[c] += pixels[i * 4 + c];
+            }
+        }
+        for(uint32_t c = 0; c < NumChannels; c++) {
+            mean[c] /= 16.0f;
+        }
+
+        float covariance[4][4] = {};
+        for(uint32_t i = 0; i < 16; i++) {
+            for(uint32_t a = 0; a < NumChannels; a++) {
+                for(uint32_t b = a; b < NumChannels; b++) {
+                    covariance[a][b] += (pixels[i * 4 + a] - mean[a]) * (pixels[i * 4 + b] - mean[b]);
+                }
+            }
+        }
+        for(uint32_t a = 0; a < NumChannels; a++) {
+            for(uint32_t b = 0; b < a; b++) {
+                covariance[a][b] = covariance[b][a];
+            }
+        }
+
+        std::array<float, 4> axis = {};
+        for(uint32_t c = 0; c < NumChannels; c++) {
+            axis[c] = 1.0f;
+        }
+
+        for(uint32_t iteration = 0; iteration < 8; iteration++) {
+            std::array<float, 4> next = {};
+            for(uint32_t a = 0; a < NumChannels; a++) {
+                for(uint32_t b = 0; b < NumChannels; b++) {
+                    next[a] += covariance[a][b] * axis[b];
+                }
+            }
+
+            float length = 0;
+            for(uint32_t c = 0; c < NumChannels; c++) {
+                length = std::max(length, std::abs(next[c]));
+            }
+
+            // Every pixel is the same, so any axis works
+            if(length < 1e-6f) {
+                break;
+            }
+
+            for(uint32_t c = 0; c < NumChannels; c++) {
+                axis[c] = next[c] / length;
+            }
+        }
+
+        float axis_length_squared = 0;
+        for(uint32_t c = 0; c < NumChannels; c++) {
+            axis_length_squared += axis[c] * axis[c];
+        }
+
+        float min_t = 0;
+        float max_t = 0;
+        for(uint32_t i = 0; i < 16; i++) {
+            float t = 0;
+            for(uint32_t c = 0; c < NumChannels; c++) {
+                t += (pixels[i * 4 + c] - mean[c]) * axis[c];
+            }
+            t /= axis_length_squared;
+
+            min_t = std::min(min_t, t);
+            max_t = std::max(max_t, t);
+        }
+
+        for(uint32_t c = 0; c < NumChannels; c++) {
+            start[c] = std::clamp(mean[c] + axis[c] * min_t, 0.0f, 255.0f);
+            end[c] = std::clamp(mean[c] + axis[c] * max_t, 0.0f, 255.0f);
+        }
+    }
+
+    static uint16_t to_rgb565(const std::array<float, 4>& color) {
+        const auto r = static_cast<uint16_t>(std::lround(color[0] * 31.0f / 255.0f));
+        const auto g = static_cast<uint16_t>(std::lround(color[1] * 63.0f / 255.0f));
+        const auto b = static_cast<uint16_t>(std::lround(color[2] * 31.0f / 255.0f));
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    static std::array<int32_t, 3> from_rgb565(const uint16_t color) {
+        const auto r = (color >> 11) & 0x1F;
+        const auto g = (color >> 5) & 0x3F;
+        const auto b = color & 0x1F;
+        return {(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)};
+    }
+
+    void encode_bc1_block(const uint8_t pixels[16 * 4], uint8_t block[BC1_BYTES_PER_BLOCK]) {
+        std::array<float, 4> start = {};
+        std::array<float, 4> end = {};
+        fit_endpoints<3>(pixels, start, end);
+
+        auto color0 = to_rgb565(end);
+        auto color1 = to_rgb565(start);
+
+        // color0 must be greater than color1 for the four-color mode. If they're equal every pixel is color0 anyways
+        if(color0 < color1) {
+            std::swap(color0, color1);
+        }
+
+        uint32_t indices = 0;
+        if(color0 != color1) {
+            const auto c0 = from_rgb565(color0);
+            const auto c1 = from_rgb565(color1);
+
+            // Palette order is color0, color1, 2/3 color0 + 1/3 color1, 1/3 color0 + 2/3 color1
+            std::array<std::array<int32_t, 3>, 4> palette = {c0, c1};
+            for(uint32_t c = 0; c < 3; c++) {
+                palette[2][c] = (2 * c0[c] + c1[c]) / 3;
+                palette[3][c] = (c0[c] + 2 * c1[c]) / 3;
+            }
+
+            for(uint32_t i = 0; i < 16; i++) {
+                uint32_t best_index = 0;
+                int32_t best_error = std::numeric_limits<int32_t>::max();
+                for(uint32_t p = 0; p < 4; p++) {
+                    int32_t error = 0;
+                    for(uint32_t c = 0; c < 3; c++) {
+                        const auto diff = pixels[i * 4 + c] - palette[p][c];
+                        error += diff * diff;
+                    }
+
+                    if(error < best_error) {
+                        best_error = error;
+                        best_index = p;
+                    }
+                }
+
+                indices |= best_index << (i * 2);
+            }
+        }
+
+        block[0] = static_cast<uint8_t>(color0 & 0xFF);
+        block[1] = static_cast<uint8_t>(color0 >> 8);
+        block[2] = static_cast<uint8_t>(color1 & 0xFF);
+        block[3] = static_cast<uint8_t>(color1 >> 8);
+        std::memcpy(block + 4, &indices, sizeof(indices));
+    }
+
+    /*!
+     * \brief Writes bits to a block, least significant bit first
+     */
+    class BlockBitWriter {
+    public:
+        explicit BlockBitWriter(uint8_t* block) : block{block} {}
+
+        void write(const uint32_t value, const uint32_t num_bits) {
+            for(uint32_t bit = 0; bit < num_bits; bit++) {
+                if((value >> bit) & 1) {
+                    block[cur_bit / 8] |= static_cast<uint8_t>(1 << (cur_bit % 8));
+                }
+                cur_bit++;
+            }
+        }
+
+    private:
+        uint8_t* block;
+
+        uint32_t cur_bit = 0;
+    };
+
+    constexpr std::array<int32_t, 16> BC7_INDEX_WEIGHTS = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    struct Bc7Endpoint {
+        /*!
+         * \brief Each channel's top seven bits
+         */
+        std::array<uint32_t, 4> values;
+
+        /*!
+         * \brief Lowest bit of every channel
+         */
+        uint32_t p_bit;
+
+        [[nodiscard]] int32_t get_channel(const uint32_t channel) const { return static_cast<int32_t>((values[channel] << 1) | p_bit); }
+    };
+
+    /*!
+     * \brief Quantizes an endpoint to mode 6's seven bits per channel plus a shared p-bit, picking the p-bit that loses the least
+     */
+    static Bc7Endpoint quantize_bc7_endpoint(const std::array<float, 4>& color) {
+        Bc7Endpoint best = {};
+        float best_error = std::numeric_limits<float>::max();
+
+        for(uint32_t p_bit = 0; p_bit < 2; p_bit++) {
+            Bc7Endpoint endpoint = {};
+            endpoint.p_bit = p_bit;
+
+            float error = 0;
+            for(uint32_t c = 0; c < 4; c++) {
+                const auto value = std::lround((color[c] - static_cast<float>(p_bit)) / 2.0f);
+                endpoint.values[c] = static_cast<uint32_t>(std::clamp<long>(value, 0, 127));
+
+                const auto diff = color[c] - static_cast<float>(endpoint.get_channel(c));
+                error += diff * diff;
+            }
+
+            if(error < best_error) {
+                best_error = error;
+                best = endpoint;
+            }
+        }
+
+        return best;
+    }
+
+    void encode_bc7_block(const uint8_t pixels[16 * 4], uint8_t block[BC7_BYTES_PER_BLOCK]) {
+        std::array<float, 4> start = {};
+        std::array<float, 4> end = {};
+        fit_endpoints<4>(pixels, start, end);
+
+        auto endpoint0 = quantize_bc7_endpoint(start);
+        auto endpoint1 = quantize_bc7_endpoint(end);
+
+        std::array<std::array<int32_t, 4>, 16> palette = {};
+        for(uint32_t p = 0; p < 16; p++) {
+            for(uint32_t c = 0; c < 4; c++) {
+                const auto weight = BC7_INDEX_WEIGHTS[p];
+                palette[p][c] = ((64 - weight) * endpoint0.get_channel(c) + weight * endpoint1.get_channel(c) + 32) >> 6;
+            }
+        }
+
+        std::array<uint32_t, 16> indices = {};
+        for(uint32_t i = 0; i < 16; i++) {
+            int32_t best_error = std::numeric_limits<int32_t>::max();
+            for(uint32_t p = 0; p < 16; p++) {
+                int32_t error = 0;
+                for(uint32_t c = 0; c < 4; c++) {
+                    const auto diff = pixels[i * 4 + c] - palette[p][c];
+                    error += diff * diff;
+                }
+
+                if(error < best_error) {
+                    best_error = error;
+                    indices[i] = p;
+                }
+            }
+        }
+
+        // The first index only gets three bits, so its top bit must be zero. Swapping the endpoints flips every index, which makes it so
+        if(indices[0] >= 8) {
+            std::swap(endpoint0, endpoint1);
+            for(auto& index : indices) {
+                index = 15 - index;
+            }
+        }
+
+        std::memset(block, 0, BC7_BYTES_PER_BLOCK);
+        BlockBitWriter writer{block};
+
+        // Mode 6 is six zero bits then a one
+        writer.write(1 << 6, 7);
+
+        for(uint32_t c = 0; c < 4; c++) {
+            writer.write(endpoint0.values[c], 7);
+            writer.write(endpoint1.values[c], 7);
+        }
+
+        writer.write(endpoint0.p_bit, 1);
+        writer.write(endpoint1.p_bit, 1);
+
+        writer.write(indices[0], 3);
+        for(uint32_t i = 1; i < 16; i++) {
+            writer.write(indices[i], 4);
+        }
+    }
+
+    void read_block(const uint8_t* image,
+                    const uint32_t width,
+                    const uint32_t height,
+                    const uint32_t block_x,
+                    const uint32_t block_y,
+                    uint8_t pixels[16 * 4]) {
+        for(uint32_t y = 0; y < BC_BLOCK_SIZE; y++) {
+            const auto image_y = std::min(block_y * BC_BLOCK_SIZE + y, height - 1);
+            for(uint32_t x = 0; x < BC_BLOCK_SIZE; x++) {
+                const auto image_x = std::min(block_x * BC_BLOCK_SIZE + x, width - 1);
+                std::memcpy(pixels + (y * BC_BLOCK_SIZE + x) * 4, image + (static_cast<size_t>(image_y) * width + image_x) * 4, 4);
+            }
+        }
+    }
+} // namespace nova::renderer
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+
+namespace nova::renderer {
+    constexpr uint32_t BC_BLOCK_SIZE = 4;
+
+    constexpr uint32_t BC1_BYTES_PER_BLOCK = 8;
+
+    constexpr uint32_t BC7_BYTES_PER_BLOCK = 16;
+
+    /*!
+     * \brief Version of the encoders. Increment this whenever they change what they output, so that cached compressed textures are
+     * compressed again
+     */
+    constexpr uint32_t BC_ENCODER_VERSION = 1;
+
+    /*!
+     * \brief Compresses a 4x4 block of RGBA8 pixels to BC1, ignoring alpha
+     *
+     * Only use this for opaque images, since it always uses BC1's four-color mode
+     *
+     * \param pixels The block's 16 pixels, in row-major order
+     * \param block Where to write the block's 8 bytes
+     */
+    void encode_bc1_block(const uint8_t pixels[16 * 4], uint8_t block[BC1_BYTES_PER_BLOCK]);
+
+    /*!
+     * \brief Compresses a 4x4 block of RGBA8 pixels to BC7
+     *
+     * Only uses mode 6 - one RGBA endpoint pair with 4-bit indices. That's the highest-quality single-subset mode, and good enough for
+     * most textures without the search time of a full BC7 encoder
+     *
+     * \param pixels The block's 16 pixels, in row-major order
+     * \param block Where to write the block's 16 bytes
+     */
+    void encode_bc7_block(const uint8_t pixels[16 * 4], uint8_t block[BC7_BYTES_PER_BLOCK]);
+
+    /*!
+     * \brief Copies the 4x4 block of pixels that starts at (`block_x` * 4, `block_y` * 4) out of an RGBA8 image
+     *
+     * Pixels past the edge of the image repeat the last row or column
+     */
+    void read_block(const uint8_t* image, uint32_t width, uint32_t height, uint32_t block_x, uint32_t block_y, uint8_t pixels[16 * 4]);
+} // namespace nova::renderer
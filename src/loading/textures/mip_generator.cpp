@@ -0,0 +1,186 @@
+#include "mip_generator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include <Tracy.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NOVA_MIP_GENERATOR_SSE2 1
+#include <emmintrin.h>
+#else
+#define NOVA_MIP_GENERATOR_SSE2 0
+#endif
+
+namespace nova::renderer {
+    /*!
+     * \brief Number of entries in the linear to sRGB table. Enough that every 8-bit sRGB value has at least one entry, even in the darks
+     */
+    constexpr uint32_t LINEAR_TO_SRGB_TABLE_SIZE = 4096;
+
+    struct ConversionTables {
+        std::array<float, 256> srgb_to_linear;
+
+        std::array<float, 256> unorm_to_float;
+
+        std::array<uint8_t, LINEAR_TO_SRGB_TABLE_SIZE> linear_to_srgb;
+
+        ConversionTables() {
+            for(uint32_t i = 0; i < 256; i++) {
+                const auto value = static_cast<float>(i) / 255.0f;
+                unorm_to_float[i] = value;
+                srgb_to_linear[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+            }
+
+            for(uint32_t i = 0; i < LINEAR_TO_SRGB_TABLE_SIZE; i++) {
+                const auto value = static_cast<float>(i) / static_cast<float>(LINEAR_TO_SRGB_TABLE_SIZE - 1);
+                const auto srgb = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+                linear_to_srgb[i] = static_cast<uint8_t>(std::clamp(srgb * 255.0f + 0.5f, 0.0f, 255.0f));
+            }
+        }
+    };
+
+    static const ConversionTables& get_conversion_tables() {
+        static const ConversionTables tables;
+        return tables;
+    }
+
+    static uint8_t encode_unorm(const float value) { return static_cast<uint8_t>(std::clamp(value * 255.0f + 0.5f, 0.0f, 255.0f)); }
+
+    static uint8_t encode_srgb(const float value, const ConversionTables& tables) {
+        const auto idx = static_cast<uint32_t>(std::clamp(value, 0.0f, 1.0f) * (LINEAR_TO_SRGB_TABLE_SIZE - 1) + 0.5f);
+        return tables.linear_to_srgb[idx];
+    }
+
+    /*!
+     * \brief Averages the 2x2 block of source pixels that one destination pixel covers, in linear space
+     *
+     * Writes the average to `out` as four floats
+     */
+    static void average_block(const uint8_t* p00,
+                              const uint8_t* p10,
+                              const uint8_t* p01,
+                              const uint8_t* p11,
+                              const std::array<float, 256>& color_table,
+                              const std::array<float, 256>& alpha_table,
+                              float* out) {
+        for(uint32_t c = 0; c < 4; c++) {
+            const auto& table = c < 3 ? color_table : alpha_table;
+            out[c] = (table[p00[c]] + table[p10[c]] + table[p01[c]] + table[p11[c]]) * 0.25f;
+        }
+    }
+
+#if NOVA_MIP_GENERATOR_SSE2
+    /*!
+     * \brief Box-filters four destination pixels of a linear RGBA8 image from eight pixels of each of two source rows
+     *
+     * Works on 16-bit sums, which is exact, and rounds the same way `encode_unorm` does
+     */
+    static void downsample_four_pixels_linear(const uint8_t* row0, const uint8_t* row1, uint8_t* out) {
+        const auto zero = _mm_setzero_si128();
+        const auto two = _mm_set1_epi16(2);
+
+        const auto box_filter_two_pixels = [&](const __m128i top, const __m128i bottom) {
+            // Each register holds two source pixels, so these are the vertical sums of pixels 0 and 1, then pixels 2 and 3
+            const auto sums01 = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+            const auto sums23 = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+
+            // Line up pixels 0 and 2 against pixels 1 and 3, so one add gives the sums of both 2x2 blocks
+            const auto sums = _mm_add_epi16(_mm_unpacklo_epi64(sums01, sums23), _mm_unpackhi_epi64(sums01, sums23));
+            return _mm_srli_epi16(_mm_add_epi16(sums, two), 2);
+        };
+
+        const auto first_half = box_filter_two_pixels(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0)),
+                                                      _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1)));
+        const auto second_half = box_filter_two_pixels(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 16)),
+                                                       _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 16)));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(first_half, second_half));
+    }
+#endif
+
+    static void downsample(const uint8_t* src,
+                           const uint32_t src_width,
+                           const uint32_t src_height,
+                           uint8_t* dst,
+                           const uint32_t dst_width,
+                           const uint32_t dst_height,
+                           const bool is_srgb) {
+        const auto& tables = get_conversion_tables();
+        const auto& color_table = is_srgb ? tables.srgb_to_linear : tables.unorm_to_float;
+
+        for(uint32_t y = 0; y < dst_height; y++) {
+            // Clamp so that odd-sized and 1-pixel-wide mips read the last row or column twice, instead of reading past the end
+            const auto y0 = std::min(y * 2, src_height - 1);
+            const auto y1 = std::min(y * 2 + 1, src_height - 1);
+            const auto* row0 = src + static_cast<size_t>(y0) * src_width * 4;
+            const auto* row1 = src + static_cast<size_t>(y1) * src_width * 4;
+
+            auto* dst_row = dst + static_cast<size_t>(y) * dst_width * 4;
+
+            uint32_t x = 0;
+#if NOVA_MIP_GENERATOR_SSE2
+            // sRGB needs a table lookup per channel, which SSE2 can't do, so only linear images take the vector path. When the source is
+            // at least two pixels wide, no destination pixel reads a clamped column
+            if(!is_srgb && src_width >= 2) {
+                for(; x + 4 <= dst_width; x += 4) {
+                    downsample_four_pixels_linear(row0 + x * 8, row1 + x * 8, dst_row + x * 4);
+                }
+            }
+#endif
+
+            for(; x < dst_width; x++) {
+                const auto x0 = std::min(x * 2, src_width - 1) * 4;
+                const auto x1 = std::min(x * 2 + 1, src_width - 1) * 4;
+
+                float average[4];
+                average_block(row0 + x0, row0 + x1, row1 + x0, row1 + x1, color_table, tables.unorm_to_float, average);
+
+                auto* out = dst_row + x * 4;
+                for(uint32_t c = 0; c < 3; c++) {
+                    out[c] = is_srgb ? encode_srgb(average[c], tables) : encode_unorm(average[c]);
+                }
+                out[3] = encode_unorm(average[3]);
+            }
+        }
+    }
+
+    uint32_t get_num_mips_for_size(const uint32_t width, const uint32_t height) {
+        uint32_t num_mips = 1;
+        for(auto size = std::max(width, height); size > 1; size /= 2) {
+            num_mips++;
+        }
+
+        return num_mips;
+    }
+
+    std::vector<std::vector<uint8_t>> generate_mip_chain(const uint8_t* pixels,
+                                                         const uint32_t width,
+                                                         const uint32_t height,
+                                                         const bool is_srgb) {
+        ZoneScoped;
+        const auto num_mips = get_num_mips_for_size(width, height);
+
+        std::vector<std::vector<uint8_t>> mips;
+        mips.reserve(num_mips - 1);
+
+        const auto* src = pixels;
+        auto src_width = width;
+        auto src_height = height;
+
+        for(uint32_t mip = 1; mip < num_mips; mip++) {
+            const auto dst_width = std::max(src_width / 2, 1u);
+            const auto dst_height = std::max(src_height / 2, 1u);
+
+            auto& dst = mips.emplace_back(static_cast<size_t>(dst_width) * dst_height * 4);
+            downsample(src, src_width, src_height, dst.data(), dst_width, dst_height, is_srgb);
+
+            src = dst.data();
+            src_width = dst_width;
+            src_height = dst_height;
+        }
+
+        return mips;
+    }
+} // namespace nova::renderer
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace nova::renderer {
+    /*!
+     * \brief Number of mips in a full mip chain for an image of the given size, including the first mip
+     */
+    [[nodiscard]] uint32_t get_num_mips_for_size(uint32_t width, uint32_t height);
+
+    /*!
+     * \brief Generates every mip after the first for an RGBA8 image, with a box filter
+     *
+     * If the image is sRGB, we filter the color channels in linear space, then convert them back to sRGB. Averaging sRGB values directly
+     * darkens mips, which makes distant textures look muddy. Alpha is always linear
+     *
+     * \param pixels Tightly-packed RGBA8 pixels of the first mip
+     * \param width Width of the first mip, in pixels
+     * \param height Height of the first mip, in pixels
+     * \param is_srgb Whether the color channels are sRGB-encoded
+     *
+     * \return Tightly-packed RGBA8 pixels for the second mip onward, down to 1x1
+     */
+    [[nodiscard]] std::vector<std::vector<uint8_t>> generate_mip_chain(const uint8_t* pixels, uint32_t width, uint32_t height, bool is_srgb);
+} // namespace nova::renderer
@@ -0,0 +1,282 @@
+#include "texture_compressor.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <latch>
+#include <memory>
+#include <thread>
+
+#include <Tracy.hpp>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+#include "nova_renderer/util/worker_pool.hpp"
+
+#include "bc_encoder.hpp"
+
+namespace nova::renderer {
+    using namespace rhi;
+
+    static auto logger = spdlog::stdout_color_mt("TextureCompressor");
+
+    constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+    constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+    constexpr uint32_t COMPRESSED_TEXTURE_CACHE_MAGIC = 0x4342564E; // "NVBC"
+
+    /*!
+     * \brief Version of the cache file format. Increment this whenever it changes
+     */
+    constexpr uint32_t COMPRESSED_TEXTURE_CACHE_VERSION = 1;
+
+    constexpr const char* COMPRESSED_TEXTURE_CACHE_TEMP_EXTENSION = ".tmp";
+
+    /*!
+     * \brief The start of every cache file. The compressed mips follow it, then a checksum of the header and the mips
+     */
+    struct CompressedTextureCacheHeader {
+        uint32_t magic = COMPRESSED_TEXTURE_CACHE_MAGIC;
+        uint32_t version = COMPRESSED_TEXTURE_CACHE_VERSION;
+        uint32_t encoder_version = BC_ENCODER_VERSION;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t format = 0;
+        uint32_t num_mips = 0;
+
+        bool operator==(const CompressedTextureCacheHeader& other) const = default;
+    };
+
+    static void hash_bytes(uint64_t& hash, const void* data, const size_t size) {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        for(size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= FNV_PRIME;
+        }
+    }
+
+    static bool is_bc1_format(const PixelFormat format) { return format == PixelFormat::Bc1Rgba || format == PixelFormat::Bc1RgbaSrgb; }
+
+    static bool is_bc7_format(const PixelFormat format) { return format == PixelFormat::Bc7Rgba || format == PixelFormat::Bc7RgbaSrgb; }
+
+    TextureCompressor::TextureCompressor(WorkerPool& worker_pool, std::filesystem::path cache_directory)
+        : worker_pool{worker_pool}, cache_directory{std::move(cache_directory)} {}
+
+    PixelFormat TextureCompressor::choose_compressed_format(const uint8_t* pixels,
+                                                           const uint32_t width,
+                                                           const uint32_t height,
+                                                           const bool is_srgb) {
+        const auto num_pixels = static_cast<size_t>(width) * height;
+        for(size_t i = 0; i < num_pixels; i++) {
+            if(pixels[i * 4 + 3] != 0xFF) {
+                return is_srgb ? PixelFormat::Bc7RgbaSrgb : PixelFormat::Bc7Rgba;
+            }
+        }
+
+        return is_srgb ? PixelFormat::Bc1RgbaSrgb : PixelFormat::Bc1Rgba;
+    }
+
+    std::optional<std::vector<std::vector<uint8_t>>> TextureCompressor::compress(const std::vector<const uint8_t*>& mips,
+                                                                                  const uint32_t width,
+                                                                                  const uint32_t height,
+                                                                                  const PixelFormat format) {
+        ZoneScoped;
+        if(!is_bc1_format(format) && !is_bc7_format(format)) {
+            logger->error("Can't compress to {}, we only have encoders for BC1 and BC7", static_cast<uint32_t>(format));
+            return std::nullopt;
+        }
+
+        uint64_t hash = FNV_OFFSET_BASIS;
+        hash_bytes(hash, &COMPRESSED_TEXTURE_CACHE_VERSION, sizeof(COMPRESSED_TEXTURE_CACHE_VERSION));
+        hash_bytes(hash, &BC_ENCODER_VERSION, sizeof(BC_ENCODER_VERSION));
+        hash_bytes(hash, &width, sizeof(width));
+        hash_bytes(hash, &height, sizeof(height));
+        hash_bytes(hash, &format, sizeof(format));
+        for(uint32_t mip = 0; mip < mips.size(); mip++) {
+            const auto mip_width = std::max(width >> mip, 1u);
+            const auto mip_height = std::max(height >> mip, 1u);
+            hash_bytes(hash, mips[mip], static_cast<size_t>(mip_width) * mip_height * 4);
+        }
+
+        const auto cache_path = cache_directory / fmt::format("{:016x}.bc", hash);
+        if(auto cached_mips = load_from_cache(cache_path, width, height, mips.size(), format)) {
+            return cached_mips;
+        }
+
+        const auto bytes_per_block = is_bc1_format(format) ? BC1_BYTES_PER_BLOCK : BC7_BYTES_PER_BLOCK;
+        const auto encode_block = is_bc1_format(format) ? &encode_bc1_block : &encode_bc7_block;
+
+        struct BlockRow {
+            uint32_t mip;
+            uint32_t row;
+        };
+
+        std::vector<std::vector<uint8_t>> compressed_mips(mips.size());
+        std::vector<BlockRow> rows;
+        for(uint32_t mip = 0; mip < mips.size(); mip++) {
+            const auto mip_width = std::max(width >> mip, 1u);
+            const auto mip_height = std::max(height >> mip, 1u);
+            compressed_mips[mip].resize(get_image_size_in_bytes(format, mip_width, mip_height));
+
+            const auto height_in_blocks = (mip_height + BC_BLOCK_SIZE - 1) / BC_BLOCK_SIZE;
+            for(uint32_t row = 0; row < height_in_blocks; row++) {
+                rows.push_back({mip, row});
+            }
+        }
+
+        // Workers and the calling thread all pull rows of blocks off the same counter. The state is shared because workers that start after
+        // every row is done still look at it
+        struct CompressionState {
+            std::atomic<size_t> next_row = 0;
+
+            size_t num_rows;
+
+            std::latch rows_remaining;
+
+            explicit CompressionState(const size_t num_rows)
+                : num_rows{num_rows}, rows_remaining{static_cast<std::ptrdiff_t>(num_rows)} {}
+        };
+
+        auto state = std::make_shared<CompressionState>(rows.size());
+
+        const auto compress_rows = [=, &rows, &mips, &compressed_mips] {
+            // Only touch the captured references after claiming a row, since the calling thread can't return until every row is done
+            for(auto row_idx = state->next_row++; row_idx < state->num_rows; row_idx = state->next_row++) {
+                const auto [mip, row] = rows[row_idx];
+                const auto mip_width = std::max(width >> mip, 1u);
+                const auto mip_height = std::max(height >> mip, 1u);
+                const auto width_in_blocks = (mip_width + BC_BLOCK_SIZE - 1) / BC_BLOCK_SIZE;
+
+                auto* dst = compressed_mips[mip].data() + static_cast<size_t>(row) * width_in_blocks * bytes_per_block;
+
+                uint8_t pixels[16 * 4];
+                for(uint32_t block_x = 0; block_x < width_in_blocks; block_x++) {
+                    read_block(mips[mip], mip_width, mip_height, block_x, row, pixels);
+                    encode_block(pixels, dst + block_x * bytes_per_block);
+                }
+
+                state->rows_remaining.count_down();
+            }
+        };
+
+        const auto num_jobs = std::min(static_cast<size_t>(worker_pool.get_num_threads()), rows.size());
+        for(size_t i = 0; i < num_jobs; i++) {
+            worker_pool.submit(compress_rows);
+        }
+
+        compress_rows();
+        state->rows_remaining.wait();
+
+        logger->debug("Compressed {} mips of a {}x{} image", mips.size(), width, height);
+
+        save_to_cache(cache_path, width, height, format, compressed_mips);
+
+        return compressed_mips;
+    }
+
+    std::optional<std::vector<std::vector<uint8_t>>> TextureCompressor::load_from_cache(const std::filesystem::path& path,
+                                                                                         const uint32_t width,
+                                                                                         const uint32_t height,
+                                                                                         const size_t num_mips,
+                                                                                         const PixelFormat format) const {
+        ZoneScoped;
+        std::ifstream file{path, std::ios::binary};
+        if(!file) {
+            return std::nullopt;
+        }
+
+        CompressedTextureCacheHeader expected_header;
+        expected_header.width = width;
+        expected_header.height = height;
+        expected_header.format = static_cast<uint32_t>(format);
+        expected_header.num_mips = static_cast<uint32_t>(num_mips);
+
+        CompressedTextureCacheHeader header;
+        if(!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header != expected_header) {
+            logger->warn("Compressed texture cache file {} is from a different version or a different image, compressing the texture again",
+                         path.string());
+            return std::nullopt;
+        }
+
+        uint64_t checksum = FNV_OFFSET_BASIS;
+        hash_bytes(checksum, &header, sizeof(header));
+
+        std::vector<std::vector<uint8_t>> compressed_mips(num_mips);
+        for(uint32_t mip = 0; mip < num_mips; mip++) {
+            const auto mip_width = std::max(width >> mip, 1u);
+            const auto mip_height = std::max(height >> mip, 1u);
+            auto& data = compressed_mips[mip];
+            data.resize(get_image_size_in_bytes(format, mip_width, mip_height));
+
+            if(!file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()))) {
+                logger->warn("Compressed texture cache file {} is truncated, compressing the texture again", path.string());
+                return std::nullopt;
+            }
+
+            hash_bytes(checksum, data.data(), data.size());
+        }
+
+        uint64_t saved_checksum = 0;
+        if(!file.read(reinterpret_cast<char*>(&saved_checksum), sizeof(saved_checksum)) || saved_checksum != checksum ||
+           file.peek() != std::ifstream::traits_type::eof()) {
+            logger->warn("Compressed texture cache file {} is corrupt, compressing the texture again", path.string());
+            return std::nullopt;
+        }
+
+        return compressed_mips;
+    }
+
+    void TextureCompressor::save_to_cache(const std::filesystem::path& path,
+                                          const uint32_t width,
+                                          const uint32_t height,
+                                          const PixelFormat format,
+                                          const std::vector<std::vector<uint8_t>>& compressed_mips) const {
+        ZoneScoped;
+        std::error_code error;
+        std::filesystem::create_directories(cache_directory, error);
+        if(error) {
+            logger->warn("Could not create compressed texture cache directory {}: {}", cache_directory.string(), error.message());
+            return;
+        }
+
+        CompressedTextureCacheHeader header;
+        header.width = width;
+        header.height = height;
+        header.format = static_cast<uint32_t>(format);
+        header.num_mips = static_cast<uint32_t>(compressed_mips.size());
+
+        uint64_t checksum = FNV_OFFSET_BASIS;
+        hash_bytes(checksum, &header, sizeof(header));
+        for(const auto& data : compressed_mips) {
+            hash_bytes(checksum, data.data(), data.size());
+        }
+
+        // Several threads may compress the same image at once. Each writes its own file and moves it into place, so nobody ever reads a
+        // half-written cache file
+        auto temp_path = path;
+        const auto thread_hash = std::hash<std::thread::id>{}(std::this_thread::get_id());
+        temp_path += fmt::format(".{}{}", thread_hash, COMPRESSED_TEXTURE_CACHE_TEMP_EXTENSION);
+
+        {
+            std::ofstream file{temp_path, std::ios::binary | std::ios::trunc};
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            for(const auto& data : compressed_mips) {
+                file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+            }
+            file.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+
+            if(!file) {
+                logger->warn("Could not write compressed texture cache file {}", temp_path.string());
+                file.close();
+                std::filesystem::remove(temp_path, error);
+                return;
+            }
+        }
+
+        std::filesystem::rename(temp_path, path, error);
+        if(error) {
+            logger->warn("Could not move compressed texture cache file to {}: {}", path.string(), error.message());
+            std::filesystem::remove(temp_path, error);
+        }
+    }
+} // namespace nova::renderer
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+#include "nova_renderer/rhi/rhi_enums.hpp"
+
+namespace nova::renderer {
+    class WorkerPool;
+
+    /*!
+     * \brief Compresses RGBA8 mip chains to BC1 or BC7 on the worker pool, and caches the results on disk
+     *
+     * Compression is slow enough that we don't want to do it every time Nova starts, so we save every compressed mip chain in the cache
+     * directory under a hash of its source pixels and the encoder version. The next time someone asks for the same pixels in the same
+     * format, we load the compressed mips instead. Cache files have a header and a checksum, and anything that doesn't match is compressed
+     * again
+     */
+    class TextureCompressor {
+    public:
+        TextureCompressor(WorkerPool& worker_pool, std::filesystem::path cache_directory);
+
+        /*!
+         * \brief Picks the compressed format for an image: BC1 if every pixel is opaque, BC7 if not
+         */
+        [[nodiscard]] static rhi::PixelFormat choose_compressed_format(const uint8_t* pixels, uint32_t width, uint32_t height, bool is_srgb);
+
+        /*!
+         * \brief Compresses every mip of an image
+         *
+         * Blocks until the mips are compressed. The calling thread compresses blocks too, so this is safe to call from the worker pool
+         *
+         * \param mips Tightly-packed RGBA8 pixels for each mip, starting at the first
+         * \param width Width of the first mip, in pixels
+         * \param height Height of the first mip, in pixels
+         * \param format The format to compress to. Must be one of the BC1 or BC7 formats
+         *
+         * \return The compressed data for each mip, or an empty optional if `format` isn't a format we can compress to
+         */
+        [[nodiscard]] std::optional<std::vector<std::vector<uint8_t>>> compress(const std::vector<const uint8_t*>& mips,
+                                                                                 uint32_t width,
+                                                                                 uint32_t height,
+                                                                                 rhi::PixelFormat format);
+
+    private:
+        WorkerPool& worker_pool;
+
+        std::filesystem::path cache_directory;
+
+        [[nodiscard]] std::optional<std::vector<std::vector<uint8_t>>> load_from_cache(const std::filesystem::path& path,
+                                                                                        uint32_t width,
+                                                                                        uint32_t height,
+                                                                                        size_t num_mips,
+                                                                                        rhi::PixelFormat format) const;
+
+        void save_to_cache(const std::filesystem::path& path,
+                           uint32_t width,
+                           uint32_t height,
+                           rhi::PixelFormat format,
+                           const std::vector<std::vector<uint8_t>>& compressed_mips) const;
+    };
+} // namespace nova::renderer
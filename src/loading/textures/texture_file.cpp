@@ -0,0 +1,382 @@
+#include "texture_file.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#include <Tracy.hpp>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+namespace nova::renderer {
+    using namespace rhi;
+
+    static auto logger = spdlog::stdout_color_mt("TextureFile");
+
+    constexpr uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+    constexpr size_t DDS_HEADER_SIZE = 124;
+    constexpr size_t DDS_DX10_HEADER_SIZE = 20;
+
+    constexpr uint32_t DDS_PIXEL_FORMAT_FOURCC = 0x4;
+    constexpr uint32_t DDS_PIXEL_FORMAT_RGB = 0x40;
+    constexpr uint32_t DDS_CAPS2_CUBEMAP = 0x200;
+    constexpr uint32_t DDS_CAPS2_VOLUME = 0x200000;
+
+    constexpr uint32_t DXGI_FORMAT_R8G8B8A8_UNORM = 28;
+    constexpr uint32_t DXGI_FORMAT_R8G8B8A8_UNORM_SRGB = 29;
+    constexpr uint32_t DXGI_FORMAT_BC1_UNORM = 71;
+    constexpr uint32_t DXGI_FORMAT_BC1_UNORM_SRGB = 72;
+    constexpr uint32_t DXGI_FORMAT_BC2_UNORM = 74;
+    constexpr uint32_t DXGI_FORMAT_BC2_UNORM_SRGB = 75;
+    constexpr uint32_t DXGI_FORMAT_BC3_UNORM = 77;
+    constexpr uint32_t DXGI_FORMAT_BC3_UNORM_SRGB = 78;
+    constexpr uint32_t DXGI_FORMAT_BC4_UNORM = 80;
+    constexpr uint32_t DXGI_FORMAT_BC5_UNORM = 83;
+    constexpr uint32_t DXGI_FORMAT_BC6H_UF16 = 95;
+    constexpr uint32_t DXGI_FORMAT_BC6H_SF16 = 96;
+    constexpr uint32_t DXGI_FORMAT_BC7_UNORM = 98;
+    constexpr uint32_t DXGI_FORMAT_BC7_UNORM_SRGB = 99;
+
+    constexpr uint32_t D3D10_RESOURCE_DIMENSION_TEXTURE2D = 3;
+
+    constexpr uint8_t KTX2_IDENTIFIER[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+    constexpr size_t KTX2_HEADER_SIZE = 80;
+    constexpr size_t KTX2_LEVEL_INDEX_ENTRY_SIZE = 24;
+
+    // The vkFormat field of KTX2 files is a VkFormat, but we don't want to drag Vulkan into the loader
+    constexpr uint32_t KTX2_VK_FORMAT_R8G8B8A8_UNORM = 37;
+    constexpr uint32_t KTX2_VK_FORMAT_R8G8B8A8_SRGB = 43;
+    constexpr uint32_t KTX2_VK_FORMAT_BC1_RGBA_UNORM = 133;
+    constexpr uint32_t KTX2_VK_FORMAT_BC1_RGBA_SRGB = 134;
+    constexpr uint32_t KTX2_VK_FORMAT_BC2_UNORM = 135;
+    constexpr uint32_t KTX2_VK_FORMAT_BC2_SRGB = 136;
+    constexpr uint32_t KTX2_VK_FORMAT_BC3_UNORM = 137;
+    constexpr uint32_t KTX2_VK_FORMAT_BC3_SRGB = 138;
+    constexpr uint32_t KTX2_VK_FORMAT_BC4_UNORM = 139;
+    constexpr uint32_t KTX2_VK_FORMAT_BC5_UNORM = 141;
+    constexpr uint32_t KTX2_VK_FORMAT_BC6H_UFLOAT = 143;
+    constexpr uint32_t KTX2_VK_FORMAT_BC6H_SFLOAT = 144;
+    constexpr uint32_t KTX2_VK_FORMAT_BC7_UNORM = 145;
+    constexpr uint32_t KTX2_VK_FORMAT_BC7_SRGB = 146;
+
+    constexpr uint32_t make_fourcc(const char a, const char b, const char c, const char d) {
+        return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) |
+               (static_cast<uint32_t>(d) << 24);
+    }
+
+    template <typename IntType>
+    static IntType read(const std::span<const uint8_t> data, const size_t offset) {
+        IntType value;
+        std::memcpy(&value, data.data() + offset, sizeof(IntType));
+        return value;
+    }
+
+    static std::optional<PixelFormat> pixel_format_from_fourcc(const uint32_t fourcc) {
+        switch(fourcc) {
+            case make_fourcc('D', 'X', 'T', '1'):
+                return PixelFormat::Bc1Rgba;
+
+            case make_fourcc('D', 'X', 'T', '2'):
+                [[fallthrough]];
+            case make_fourcc('D', 'X', 'T', '3'):
+                return PixelFormat::Bc2Rgba;
+
+            case make_fourcc('D', 'X', 'T', '4'):
+                [[fallthrough]];
+            case make_fourcc('D', 'X', 'T', '5'):
+                return PixelFormat::Bc3Rgba;
+
+            case make_fourcc('A', 'T', 'I', '1'):
+                [[fallthrough]];
+            case make_fourcc('B', 'C', '4', 'U'):
+                return PixelFormat::Bc4R;
+
+            case make_fourcc('A', 'T', 'I', '2'):
+                [[fallthrough]];
+            case make_fourcc('B', 'C', '5', 'U'):
+                return PixelFormat::Bc5Rg;
+
+            default:
+                return std::nullopt;
+        }
+    }
+
+    static std::optional<PixelFormat> pixel_format_from_dxgi_format(const uint32_t dxgi_format) {
+        switch(dxgi_format) {
+            case DXGI_FORMAT_R8G8B8A8_UNORM:
+                return PixelFormat::Rgba8;
+            case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+                return PixelFormat::Rgba8Srgb;
+            case DXGI_FORMAT_BC1_UNORM:
+                return PixelFormat::Bc1Rgba;
+            case DXGI_FORMAT_BC1_UNORM_SRGB:
+                return PixelFormat::Bc1RgbaSrgb;
+            case DXGI_FORMAT_BC2_UNORM:
+                return PixelFormat::Bc2Rgba;
+            case DXGI_FORMAT_BC2_UNORM_SRGB:
+                return PixelFormat::Bc2RgbaSrgb;
+            case DXGI_FORMAT_BC3_UNORM:
+                return PixelFormat::Bc3Rgba;
+            case DXGI_FORMAT_BC3_UNORM_SRGB:
+                return PixelFormat::Bc3RgbaSrgb;
+            case DXGI_FORMAT_BC4_UNORM:
+                return PixelFormat::Bc4R;
+            case DXGI_FORMAT_BC5_UNORM:
+                return PixelFormat::Bc5Rg;
+            case DXGI_FORMAT_BC6H_UF16:
+                return PixelFormat::Bc6hRgbUfloat;
+            case DXGI_FORMAT_BC6H_SF16:
+                return PixelFormat::Bc6hRgbSfloat;
+            case DXGI_FORMAT_BC7_UNORM:
+                return PixelFormat::Bc7Rgba;
+            case DXGI_FORMAT_BC7_UNORM_SRGB:
+                return PixelFormat::Bc7RgbaSrgb;
+            default:
+                return std::nullopt;
+        }
+    }
+
+    static std::optional<PixelFormat> pixel_format_from_ktx2_format(const uint32_t vk_format) {
+        switch(vk_format) {
+            case KTX2_VK_FORMAT_R8G8B8A8_UNORM:
+                return PixelFormat::Rgba8;
+            case KTX2_VK_FORMAT_R8G8B8A8_SRGB:
+                return PixelFormat::Rgba8Srgb;
+            case KTX2_VK_FORMAT_BC1_RGBA_UNORM:
+                return PixelFormat::Bc1Rgba;
+            case KTX2_VK_FORMAT_BC1_RGBA_SRGB:
+                return PixelFormat::Bc1RgbaSrgb;
+            case KTX2_VK_FORMAT_BC2_UNORM:
+                return PixelFormat::Bc2Rgba;
+            case KTX2_VK_FORMAT_BC2_SRGB:
+                return PixelFormat::Bc2RgbaSrgb;
+            case KTX2_VK_FORMAT_BC3_UNORM:
+                return PixelFormat::Bc3Rgba;
+            case KTX2_VK_FORMAT_BC3_SRGB:
+                return PixelFormat::Bc3RgbaSrgb;
+            case KTX2_VK_FORMAT_BC4_UNORM:
+                return PixelFormat::Bc4R;
+            case KTX2_VK_FORMAT_BC5_UNORM:
+                return PixelFormat::Bc5Rg;
+            case KTX2_VK_FORMAT_BC6H_UFLOAT:
+                return PixelFormat::Bc6hRgbUfloat;
+            case KTX2_VK_FORMAT_BC6H_SFLOAT:
+                return PixelFormat::Bc6hRgbSfloat;
+            case KTX2_VK_FORMAT_BC7_UNORM:
+                return PixelFormat::Bc7Rgba;
+            case KTX2_VK_FORMAT_BC7_SRGB:
+                return PixelFormat::Bc7RgbaSrgb;
+            default:
+                return std::nullopt;
+        }
+    }
+
+    /*!
+     * \brief Checks the size and mip count that a file's header claims, before we use them to size anything or shift by them
+     */
+    static bool has_valid_size(const uint32_t width, const uint32_t height, const uint32_t num_mips, const uint32_t max_dimension) {
+        if(width == 0 || height == 0) {
+            logger->error("Texture file has no pixels");
+            return false;
+        }
+
+        if(width > max_dimension || height > max_dimension) {
+            logger->error("Texture file is {}x{}, but the device only supports textures up to {}x{}",
+                          width,
+                          height,
+                          max_dimension,
+                          max_dimension);
+            return false;
+        }
+
+        // A full mip chain goes down to 1x1, which takes floor(log2(max(width, height))) + 1 mips
+        const auto max_num_mips = static_cast<uint32_t>(std::bit_width(std::max(width, height)));
+        if(num_mips > max_num_mips) {
+            logger->error("Texture file has {} mips, but a {}x{} texture can only have {}", num_mips, width, height, max_num_mips);
+            return false;
+        }
+
+        return true;
+    }
+
+    static bool is_dds_file(const std::span<const uint8_t> file_data) {
+        return file_data.size() >= 4 && read<uint32_t>(file_data, 0) == DDS_MAGIC;
+    }
+
+    static bool is_ktx2_file(const std::span<const uint8_t> file_data) {
+        return file_data.size() >= sizeof(KTX2_IDENTIFIER) && std::memcmp(file_data.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0;
+    }
+
+    static std::optional<TextureFileData> parse_dds_file(const std::span<const uint8_t> file_data, const uint32_t max_dimension) {
+        if(file_data.size() < 4 + DDS_HEADER_SIZE) {
+            logger->error("DDS file is too small to have a header");
+            return std::nullopt;
+        }
+
+        // Offsets are from the start of the file, which is four bytes of magic and then the header
+        TextureFileData texture = {};
+        texture.height = read<uint32_t>(file_data, 12);
+        texture.width = read<uint32_t>(file_data, 16);
+        const auto num_mips = std::max(read<uint32_t>(file_data, 28), 1u);
+        const auto pixel_format_flags = read<uint32_t>(file_data, 80);
+        const auto fourcc = read<uint32_t>(file_data, 84);
+        const auto rgb_bit_count = read<uint32_t>(file_data, 88);
+        const auto red_mask = read<uint32_t>(file_data, 92);
+        const auto green_mask = read<uint32_t>(file_data, 96);
+        const auto blue_mask = read<uint32_t>(file_data, 100);
+        const auto alpha_mask = read<uint32_t>(file_data, 104);
+        const auto caps2 = read<uint32_t>(file_data, 112);
+
+        if((caps2 & (DDS_CAPS2_CUBEMAP | DDS_CAPS2_VOLUME)) != 0) {
+            logger->error("DDS file is a cubemap or volume texture, but we only support 2D textures");
+            return std::nullopt;
+        }
+
+        if(!has_valid_size(texture.width, texture.height, num_mips, max_dimension)) {
+            return std::nullopt;
+        }
+
+        size_t data_offset = 4 + DDS_HEADER_SIZE;
+
+        if((pixel_format_flags & DDS_PIXEL_FORMAT_FOURCC) != 0 && fourcc == make_fourcc('D', 'X', '1', '0')) {
+            if(file_data.size() < data_offset + DDS_DX10_HEADER_SIZE) {
+                logger->error("DDS file is too small to have a DX10 header");
+                return std::nullopt;
+            }
+
+            const auto dxgi_format = read<uint32_t>(file_data, data_offset);
+            const auto dimension = read<uint32_t>(file_data, data_offset + 4);
+            const auto array_size = read<uint32_t>(file_data, data_offset + 12);
+            if(dimension != D3D10_RESOURCE_DIMENSION_TEXTURE2D || array_size > 1) {
+                logger->error("DDS file is not a 2D texture with a single layer");
+                return std::nullopt;
+            }
+
+            const auto format = pixel_format_from_dxgi_format(dxgi_format);
+            if(!format) {
+                logger->error("DDS file has unsupported DXGI format {}", dxgi_format);
+                return std::nullopt;
+            }
+
+            texture.format = *format;
+            data_offset += DDS_DX10_HEADER_SIZE;
+
+        } else if((pixel_format_flags & DDS_PIXEL_FORMAT_FOURCC) != 0) {
+            const auto format = pixel_format_from_fourcc(fourcc);
+            if(!format) {
+                logger->error("DDS file has unsupported FourCC {:#x}", fourcc);
+                return std::nullopt;
+            }
+
+            texture.format = *format;
+
+        } else if((pixel_format_flags & DDS_PIXEL_FORMAT_RGB) != 0 && rgb_bit_count == 32 && red_mask == 0x000000FF &&
+                  green_mask == 0x0000FF00 && blue_mask == 0x00FF0000 && (alpha_mask == 0xFF000000 || alpha_mask == 0)) {
+            texture.format = PixelFormat::Rgba8;
+
+        } else {
+            logger->error("DDS file has an unsupported uncompressed pixel format");
+            return std::nullopt;
+        }
+
+        texture.mips.reserve(num_mips);
+        for(uint32_t mip = 0; mip < num_mips; mip++) {
+            const auto mip_width = std::max(texture.width >> mip, 1u);
+            const auto mip_height = std::max(texture.height >> mip, 1u);
+            const auto mip_size = get_image_size_in_bytes(texture.format, mip_width, mip_height);
+
+            if(data_offset + mip_size > file_data.size()) {
+                logger->error("DDS file is truncated in mip {}", mip);
+                return std::nullopt;
+            }
+
+            texture.mips.push_back(file_data.subspan(data_offset, mip_size));
+            data_offset += mip_size;
+        }
+
+        return texture;
+    }
+
+    static std::optional<TextureFileData> parse_ktx2_file(const std::span<const uint8_t> file_data, const uint32_t max_dimension) {
+        if(file_data.size() < KTX2_HEADER_SIZE) {
+            logger->error("KTX2 file is too small to have a header");
+            return std::nullopt;
+        }
+
+        TextureFileData texture = {};
+        const auto vk_format = read<uint32_t>(file_data, 12);
+        texture.width = read<uint32_t>(file_data, 20);
+        texture.height = read<uint32_t>(file_data, 24);
+        const auto depth = read<uint32_t>(file_data, 28);
+        const auto num_layers = read<uint32_t>(file_data, 32);
+        const auto num_faces = read<uint32_t>(file_data, 36);
+        // A level count of 0 asks the loader to generate mips, which we do anyways
+        const auto num_mips = std::max(read<uint32_t>(file_data, 40), 1u);
+        const auto supercompression_scheme = read<uint32_t>(file_data, 44);
+
+        if(texture.height == 0 || depth > 0 || num_layers > 1 || num_faces != 1) {
+            logger->error("KTX2 file is not a 2D texture with a single layer");
+            return std::nullopt;
+        }
+
+        if(!has_valid_size(texture.width, texture.height, num_mips, max_dimension)) {
+            return std::nullopt;
+        }
+
+        if(supercompression_scheme != 0) {
+            logger->error("KTX2 file uses supercompression scheme {}, which we don't support", supercompression_scheme);
+            return std::nullopt;
+        }
+
+        const auto format = pixel_format_from_ktx2_format(vk_format);
+        if(!format) {
+            logger->error("KTX2 file has unsupported format {}", vk_format);
+            return std::nullopt;
+        }
+        texture.format = *format;
+
+        if(file_data.size() < KTX2_HEADER_SIZE + num_mips * KTX2_LEVEL_INDEX_ENTRY_SIZE) {
+            logger->error("KTX2 file is too small to have a level index");
+            return std::nullopt;
+        }
+
+        texture.mips.reserve(num_mips);
+        for(uint32_t mip = 0; mip < num_mips; mip++) {
+            const auto entry_offset = KTX2_HEADER_SIZE + mip * KTX2_LEVEL_INDEX_ENTRY_SIZE;
+            const auto level_offset = read<uint64_t>(file_data, entry_offset);
+            const auto level_size = read<uint64_t>(file_data, entry_offset + 8);
+
+            const auto mip_width = std::max(texture.width >> mip, 1u);
+            const auto mip_height = std::max(texture.height >> mip, 1u);
+            const auto expected_size = get_image_size_in_bytes(texture.format, mip_width, mip_height);
+
+            if(level_size != expected_size || level_offset > file_data.size() || level_size > file_data.size() - level_offset) {
+                logger->error("KTX2 file has a malformed level index entry for mip {}", mip);
+                return std::nullopt;
+            }
+
+            texture.mips.push_back(file_data.subspan(static_cast<size_t>(level_offset), static_cast<size_t>(level_size)));
+        }
+
+        return texture;
+    }
+
+    bool is_texture_file(const std::span<const uint8_t> file_data) { return is_dds_file(file_data) || is_ktx2_file(file_data); }
+
+    std::optional<TextureFileData> parse_texture_file(const std::span<const uint8_t> file_data, const uint32_t max_dimension) {
+        ZoneScoped;
+        std::optional<TextureFileData> texture;
+        if(is_dds_file(file_data)) {
+            texture = parse_dds_file(file_data, max_dimension);
+
+        } else if(is_ktx2_file(file_data)) {
+            texture = parse_ktx2_file(file_data, max_dimension);
+
+        } else {
+            logger->error("Texture file is neither a DDS nor a KTX2 file");
+            return std::nullopt;
+        }
+
+        return texture;
+    }
+} // namespace nova::renderer
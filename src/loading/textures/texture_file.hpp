@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "nova_renderer/rhi/rhi_enums.hpp"
+
+namespace nova::renderer {
+    /*!
+     * \brief The images in a texture file, ready to upload
+     */
+    struct TextureFileData {
+        uint32_t width = 0;
+
+        uint32_t height = 0;
+
+        rhi::PixelFormat format = rhi::PixelFormat::Rgba8;
+
+        /*!
+         * \brief Data for each mip in the file, starting at the first. Points into the file's data, so don't let the file's data go away
+         * while you're using these
+         */
+        std::vector<std::span<const uint8_t>> mips;
+    };
+
+    /*!
+     * \brief Checks if some data looks like a DDS or KTX2 file
+     */
+    [[nodiscard]] bool is_texture_file(std::span<const uint8_t> file_data);
+
+    /*!
+     * \brief Reads the mips out of a DDS or KTX2 file
+     *
+     * We only support 2D textures with one layer, in RGBA8 or one of the BC formats. Supercompressed KTX2 files aren't supported
+     *
+     * \param file_data The whole file
+     * \param max_dimension The largest width or height that the device supports. Files that are larger, or that claim more mips than
+     * their size allows, are rejected
+     *
+     * \return The file's mips, or an empty optional if the file is malformed or unsupported. Check the logs to find out why
+     */
+    [[nodiscard]] std::optional<TextureFileData> parse_texture_file(std::span<const uint8_t> file_data, uint32_t max_dimension);
+} // namespace nova::renderer
@@ -1,7 +1,9 @@
 #include "nova_renderer/nova_renderer.hpp"
 
+#include <algorithm>
 #include <array>
 #include <future>
+#include <map>
 #include <unordered_map>
 
 #include <Tracy.hpp>
@@ -22,10 +24,16 @@
 #include "nova_renderer/util/platform.hpp"
 
 #include "debugging/renderdoc.hpp"
+#include "filesystem/regular_folder_accessor.hpp"
 #include "loading/renderpack/render_graph_builder.hpp"
+#include "loading/renderpack/shader_cache.hpp"
+#include "loading/renderpack/spirv_optimizer.hpp"
 #include "logging/console_log_stream.hpp"
 #include "render_objects/uniform_structs.hpp"
 #include "renderer/builtin/backbuffer_output_pass.hpp"
+#include "renderer/meshlet_builder.hpp"
+#include "renderer/pipeline_variants.hpp"
+#include "renderer/shader_reflection.hpp"
 
 using namespace nova::mem;
 using namespace operators;
@@ -110,6 +118,9 @@ namespace nova::renderer {
         ZoneScoped;
         create_global_allocators();
 
+        renderpack::get_shader_cache().set_options(settings.shader_cache);
+        renderpack::get_spirv_optimizer().set_options(settings.shader_compilation);
+
         initialize_virtual_filesystem();
 
         window = std::make_unique<NovaWindow>(settings);
@@ -163,11 +174,23 @@ namespace nova::renderer {
 
         create_builtin_renderpasses();
 
+        create_frame_arenas();
+
         cameras.reserve(MAX_NUM_CAMERAS);
         camera_data = std::make_unique<PerFrameDeviceArray<CameraUboData>>(MAX_NUM_CAMERAS, settings.max_in_flight_frames, *device);
+
+        procedural_geometry_ring = std::make_unique<ProceduralGeometryRing>(PROCEDURAL_GEOMETRY_RING_SIZE,
+                                                                            settings.max_in_flight_frames,
+                                                                            *device);
     }
 
-    NovaRenderer::~NovaRenderer() {}
+    NovaRenderer::~NovaRenderer() {
+        // Samplers are shared and reference counted by the device, so we have to release ours. Wait for the GPU to finish with them first
+        device->wait_for_fences(frame_fences);
+
+        destroy_renderpack_samplers();
+        device->destroy_sampler(point_sampler);
+    }
 
     NovaSettingsAccessManager& NovaRenderer::get_settings() { return settings; }
 
@@ -178,33 +201,60 @@ namespace nova::renderer {
 
             cur_frame_idx = device->get_swapchain()->acquire_next_swapchain_image();
 
-            std::vector<rhi::RhiFence*> cur_frame_fences{frame_fences[cur_frame_idx]};
+            const std::array<rhi::RhiFence*, 1> cur_frame_fences = {frame_fences[cur_frame_idx]};
 
             device->wait_for_fences(cur_frame_fences);
             device->reset_fences(cur_frame_fences);
 
+            destroy_retired_meshes();
+
+            // Swap in reloaded pipelines before the frame begins, so that the whole frame draws with one version of each pipeline
+            swap_in_reloaded_pipelines();
+
+            device->begin_frame(cur_frame_idx);
+            reset_frame_arena(cur_frame_idx);
+
             FrameContext ctx = {};
             ctx.frame_count = frame_count;
             ctx.frame_idx = cur_frame_idx;
             ctx.nova = this;
+            ctx.allocator = &frame_arenas[cur_frame_idx];
             ctx.swapchain_framebuffer = swapchain->get_framebuffer(cur_frame_idx);
             ctx.swapchain_image = swapchain->get_image(cur_frame_idx);
             ctx.camera_matrix_buffer = camera_data->get_buffer_for_frame(cur_frame_idx);
+            ctx.cameras = cameras;
+            ctx.viewport_height = static_cast<float>(swapchain->get_size().y);
+
+            // The CPU-side material buffer may have grown since this frame's device buffer was created. Now that we've waited for this
+            // frame's fence the GPU is done with the old buffer, so we can replace it
+            resize_material_device_buffer(cur_frame_idx);
             ctx.material_buffer = material_device_buffers[cur_frame_idx];
 
+            // This frame's fence has signaled, so the GPU is done with everything in this frame's region of the ring
+            write_procedural_meshes_to_ring(cur_frame_idx);
+
+            memory_budget_tracker->update(frame_count);
+            texture_streamer->update(frame_count, ctx.allocator);
+            virtual_texture_system->begin_frame(cur_frame_idx, frame_count);
+
             rhi::RhiRenderCommandList* cmds = device->create_command_list(0,
                                                                           rhi::QueueType::Graphics,
                                                                           rhi::RhiRenderCommandList::Level::Primary);
             cmds->set_debug_name("RendergraphCommands");
+            cmds->set_frame_arena(ctx.allocator);
 
-            const auto images = get_all_images();
+            procedural_geometry_ring->record_upload(*cmds);
+            virtual_texture_system->record_uploads(*cmds, cur_frame_idx);
+            texture_streamer->record_uploads(*cmds, cur_frame_idx);
 
             cmds->bind_material_resources(ctx.camera_matrix_buffer,
                                           ctx.material_buffer->buffer,
                                           point_sampler,
                                           point_sampler,
                                           point_sampler,
-                                          images);
+                                          virtual_texture_system->get_info_buffer_for_frame(cur_frame_idx),
+                                          virtual_texture_system->get_feedback_buffer_for_frame(cur_frame_idx),
+                                          cur_frame_idx);
 
             const auto& renderpass_order = rendergraph->calculate_renderpass_execution_order();
 
@@ -215,7 +265,7 @@ namespace nova::renderer {
 
             // The rendergraph may update the camera and material data, so we upload the data at the end of the frame
             update_camera_matrix_buffer(cur_frame_idx);
-            device->write_data_to_buffer(material_buffer->data(), ctx.material_buffer->size, ctx.material_buffer->buffer);
+            upload_material_buffer(cur_frame_idx);
 
             device->submit_command_list(cmds, rhi::QueueType::Graphics, frame_fences[cur_frame_idx]);
 
@@ -236,6 +286,33 @@ namespace nova::renderer {
     void NovaRenderer::set_num_meshes(const uint32_t /* num_meshes */) { /* TODO? */
     }
 
+    /*!
+     * \brief Fits a sphere around the mesh's vertices, so the texture streamer can tell how large the mesh is on screen
+     */
+    static void calculate_mesh_bounds(const MeshData& mesh_data, Mesh& mesh) {
+        const auto num_vertices = mesh_data.vertex_data_size / sizeof(FullVertex);
+        if(num_vertices == 0) {
+            return;
+        }
+
+        const auto* vertices = static_cast<const FullVertex*>(mesh_data.vertex_data_ptr);
+
+        auto min_pos = vertices[0].position;
+        auto max_pos = vertices[0].position;
+        for(size_t i = 1; i < num_vertices; i++) {
+            min_pos = glm::min(min_pos, vertices[i].position);
+            max_pos = glm::max(max_pos, vertices[i].position);
+        }
+
+        mesh.bounding_center = (min_pos + max_pos) * 0.5f;
+
+        float radius = 0;
+        for(size_t i = 0; i < num_vertices; i++) {
+            radius = std::max(radius, glm::length(vertices[i].position - mesh.bounding_center));
+        }
+        mesh.bounding_radius = radius;
+    }
+
     MeshId NovaRenderer::create_mesh(const MeshData& mesh_data) {
         if(mesh_data.num_vertex_attributes == 0) {
             logger->error("Can not add a mesh with zero vertex attributes");
@@ -252,6 +329,8 @@ namespace nova::renderer {
         rhi::RhiBuffer* vertex_buffer = device->create_buffer(vertex_buffer_create_info);
 
         // TODO: Try to get staging buffers from a pool
+        std::vector<rhi::RhiBuffer*> staging_buffers;
+        std::vector<rhi::RhiFence*> upload_fences;
 
         {
             rhi::RhiBufferCreateInfo staging_vertex_buffer_create_info = vertex_buffer_create_info;
@@ -277,9 +356,13 @@ namespace nova::renderer {
             vertex_barrier.buffer_memory_barrier.offset = 0;
             vertex_barrier.buffer_memory_barrier.size = vertex_buffer->size;
 
-            vertex_upload_cmds->resource_barriers(rhi::PipelineStage::Transfer, rhi::PipelineStage::VertexInput, {vertex_barrier});
+            vertex_upload_cmds->resource_barriers(rhi::PipelineStage::Transfer, rhi::PipelineStage::VertexInput, std::array{vertex_barrier});
+
+            auto* upload_fence = device->create_fence(false);
+            device->submit_command_list(vertex_upload_cmds, rhi::QueueType::Transfer, upload_fence);
 
-            device->submit_command_list(vertex_upload_cmds, rhi::QueueType::Transfer);
+            staging_buffers.push_back(staging_vertex_buffer);
+            upload_fences.push_back(upload_fence);
 
             // TODO: Barrier on the mesh's first usage
         }
@@ -313,20 +396,34 @@ namespace nova::renderer {
             index_barrier.buffer_memory_barrier.offset = 0;
             index_barrier.buffer_memory_barrier.size = index_buffer->size;
 
-            indices_upload_cmds->resource_barriers(rhi::PipelineStage::Transfer, rhi::PipelineStage::VertexInput, {index_barrier});
+            indices_upload_cmds->resource_barriers(rhi::PipelineStage::Transfer, rhi::PipelineStage::VertexInput, std::array{index_barrier});
 
-            device->submit_command_list(indices_upload_cmds, rhi::QueueType::Transfer);
+            auto* upload_fence = device->create_fence(false);
+            device->submit_command_list(indices_upload_cmds, rhi::QueueType::Transfer, upload_fence);
+
+            staging_buffers.push_back(staging_index_buffer);
+            upload_fences.push_back(upload_fence);
 
             // TODO: Barrier on the mesh's first usage
         }
 
-        // TODO: Clean up staging buffers
-
         Mesh mesh;
         mesh.num_vertex_attributes = mesh_data.num_vertex_attributes;
         mesh.vertex_buffer = vertex_buffer;
         mesh.index_buffer = index_buffer;
         mesh.num_indices = mesh_data.num_indices;
+        calculate_mesh_bounds(mesh_data, mesh);
+
+        if(device->info.supports_mesh_shaders) {
+            create_meshlets_for_mesh(mesh_data, mesh, staging_buffers, upload_fences);
+        }
+
+        // The staging buffers are only safe to destroy once the transfer queue has finished copying out of them
+        device->wait_for_fences(upload_fences);
+        device->destroy_fences(upload_fences);
+        for(auto* staging_buffer : staging_buffers) {
+            device->destroy_buffer(staging_buffer);
+        }
 
         const MeshId new_mesh_id = next_mesh_id;
         next_mesh_id++;
@@ -335,15 +432,109 @@ namespace nova::renderer {
         return new_mesh_id;
     }
 
+    void NovaRenderer::create_meshlets_for_mesh(const MeshData& mesh_data,
+                                                Mesh& mesh,
+                                                std::vector<rhi::RhiBuffer*>& staging_buffers,
+                                                std::vector<rhi::RhiFence*>& upload_fences) {
+        ZoneScoped;
+        const auto meshlet_data = build_meshlets(mesh_data);
+        if(meshlet_data.meshlets.empty()) {
+            logger->warn("Could not build any meshlets for mesh, it will only render with the vertex shader path");
+            return;
+        }
+
+        const auto upload_storage_buffer = [&](const void* data, const size_t num_bytes, const char* debug_name) {
+            rhi::RhiBufferCreateInfo buffer_create_info;
+            buffer_create_info.name = debug_name;
+            buffer_create_info.buffer_usage = rhi::BufferUsage::StorageBuffer;
+            buffer_create_info.size = num_bytes;
+
+            rhi::RhiBuffer* buffer = device->create_buffer(buffer_create_info);
+
+            rhi::RhiBufferCreateInfo staging_buffer_create_info = buffer_create_info;
+            staging_buffer_create_info.buffer_usage = rhi::BufferUsage::StagingBuffer;
+
+            rhi::RhiBuffer* staging_buffer = device->create_buffer(staging_buffer_create_info);
+            device->write_data_to_buffer(data, num_bytes, staging_buffer);
+
+            rhi::RhiRenderCommandList* upload_cmds = device->create_command_list(0,
+                                                                                 rhi::QueueType::Transfer,
+                                                                                 rhi::RhiRenderCommandList::Level::Primary);
+            upload_cmds->set_debug_name(debug_name);
+            upload_cmds->copy_buffer(buffer, 0, staging_buffer, 0, num_bytes);
+
+            rhi::RhiResourceBarrier barrier = {};
+            barrier.resource_to_barrier = buffer;
+            barrier.old_state = rhi::ResourceState::CopyDestination;
+            barrier.new_state = rhi::ResourceState::Common;
+            barrier.access_before_barrier = rhi::ResourceAccess::CopyWrite;
+            barrier.access_after_barrier = rhi::ResourceAccess::ShaderRead;
+            barrier.source_queue = rhi::QueueType::Transfer;
+            barrier.destination_queue = rhi::QueueType::Graphics;
+            barrier.buffer_memory_barrier.offset = 0;
+            barrier.buffer_memory_barrier.size = buffer->size;
+
+            upload_cmds->resource_barriers(rhi::PipelineStage::Transfer, rhi::PipelineStage::BottomOfPipe, std::array{barrier});
+
+            auto* upload_fence = device->create_fence(false);
+            device->submit_command_list(upload_cmds, rhi::QueueType::Transfer, upload_fence);
+
+            staging_buffers.push_back(staging_buffer);
+            upload_fences.push_back(upload_fence);
+
+            return buffer;
+        };
+
+        mesh.meshlet_buffer = upload_storage_buffer(meshlet_data.meshlets.data(),
+                                                    meshlet_data.meshlets.size() * sizeof(Meshlet),
+                                                    "MeshletDataUpload");
+        mesh.meshlet_vertex_buffer = upload_storage_buffer(meshlet_data.vertex_indices.data(),
+                                                           meshlet_data.vertex_indices.size() * sizeof(uint32_t),
+                                                           "MeshletVertexDataUpload");
+        mesh.meshlet_primitive_buffer = upload_storage_buffer(meshlet_data.primitives.data(),
+                                                              meshlet_data.primitives.size() * sizeof(uint32_t),
+                                                              "MeshletPrimitiveDataUpload");
+        mesh.num_meshlets = static_cast<uint32_t>(meshlet_data.meshlets.size());
+    }
+
     ProceduralMeshAccessor NovaRenderer::create_procedural_mesh(const uint64_t vertex_size, const uint64_t index_size) {
         const MeshId our_id = next_mesh_id;
         next_mesh_id++;
 
-        proc_meshes.emplace(our_id, ProceduralMesh{vertex_size, index_size, settings->max_in_flight_frames, device.get()});
+        proc_meshes.emplace(our_id, ProceduralMesh{vertex_size, index_size, *procedural_geometry_ring});
 
         return ProceduralMeshAccessor{&proc_meshes, our_id};
     }
 
+    void NovaRenderer::create_frame_arenas() {
+        // Only the render thread records commands, so each frame needs a single arena
+        frame_arenas.reserve(settings->max_in_flight_frames);
+        for(uint32_t frame_idx = 0; frame_idx < settings->max_in_flight_frames; frame_idx++) {
+            frame_arenas.emplace_back(PER_FRAME_MEMORY_SIZE);
+        }
+    }
+
+    void NovaRenderer::reset_frame_arena(const uint32_t frame_idx) {
+        ZoneScoped;
+        auto& arena = frame_arenas[frame_idx];
+        if(arena.get_num_heap_allocations() > 0) {
+            logger->debug("Frame arena {} overflowed with {} bytes allocated. It'll grow to fit",
+                          frame_idx,
+                          arena.get_num_allocated_bytes().b_count());
+        }
+
+        arena.reset();
+    }
+
+    void NovaRenderer::write_procedural_meshes_to_ring(const uint32_t frame_idx) {
+        ZoneScoped;
+        procedural_geometry_ring->begin_frame(frame_idx);
+
+        for(auto& [id, proc_mesh] : proc_meshes) {
+            proc_mesh.write_to_ring(frame_idx);
+        }
+    }
+
     std::optional<Mesh> NovaRenderer::get_mesh(const MeshId mesh_id) {
         if(const auto mesh_itr = meshes.find(mesh_id); mesh_itr != meshes.end()) {
             return mesh_itr->second;
@@ -353,11 +544,75 @@ namespace nova::renderer {
         }
     }
 
+    void NovaRenderer::destroy_mesh(const MeshId mesh_to_destroy) {
+        ZoneScoped;
+        const auto mesh_itr = meshes.find(mesh_to_destroy);
+        if(mesh_itr == meshes.end()) {
+            logger->error("Can not destroy mesh {} because it does not exist", mesh_to_destroy);
+            return;
+        }
+
+#ifdef NOVA_DEBUG
+        for(const auto& [pipeline_name, passes] : passes_by_pipeline) {
+            for(const auto& pass : passes) {
+                for(const auto& batch : pass.static_mesh_draws) {
+                    if(batch.vertex_buffer == mesh_itr->second.vertex_buffer && !batch.commands.empty()) {
+                        logger->error("Destroying mesh {} while {} renderables in pipeline {} still use it",
+                                      mesh_to_destroy,
+                                      batch.commands.size(),
+                                      pipeline_name);
+                    }
+                }
+            }
+        }
+#endif
+
+        // Frames which are still in flight may be drawing the mesh, so we destroy its buffers once they've finished
+        retired_meshes.emplace_back(RetiredMesh{mesh_itr->second, frame_count});
+        meshes.erase(mesh_itr);
+    }
+
+    void NovaRenderer::destroy_retired_meshes() {
+        const auto first_expired_itr = std::partition(retired_meshes.begin(), retired_meshes.end(), [&](const RetiredMesh& retired_mesh) {
+            return retired_mesh.frame_retired + settings->max_in_flight_frames > frame_count;
+        });
+
+        for(auto itr = first_expired_itr; itr != retired_meshes.end(); ++itr) {
+            auto& mesh = itr->mesh;
+            device->destroy_buffer(mesh.vertex_buffer);
+            device->destroy_buffer(mesh.index_buffer);
+
+            if(mesh.meshlet_buffer != nullptr) {
+                device->destroy_buffer(mesh.meshlet_buffer);
+                device->destroy_buffer(mesh.meshlet_vertex_buffer);
+                device->destroy_buffer(mesh.meshlet_primitive_buffer);
+            }
+        }
+
+        retired_meshes.erase(first_expired_itr, retired_meshes.end());
+    }
+
     void NovaRenderer::load_renderpack(const std::string& renderpack_name) {
         ZoneScoped;
-        const renderpack::RenderpackData data = renderpack::load_renderpack_data(renderpack_name);
+        const renderpack::RenderpackData data = renderpack::load_renderpack_data(renderpack_name, worker_pool.get());
 
         if(renderpacks_loaded) {
+            // The old renderpack's pipelines might still be compiling, and they need its renderpasses
+            worker_pool->wait_idle();
+
+            // Nothing new gets reloaded until we're done loading, so no reload jobs can be running now
+            shader_reloader.reset();
+            replaced_pipelines.clear();
+
+            // Save the old renderpack's pipelines, so switching back to it is quick
+            device->save_pipeline_cache();
+
+            // This also forgets the new renderpack's reflections, but those are cheap to read back from the shader cache
+            get_shader_reflection_database().clear();
+
+            // In-flight frames may still be using the old renderpack's resources
+            device->wait_for_fences(frame_fences);
+
             destroy_dynamic_resources();
 
             destroy_renderpasses();
@@ -367,14 +622,37 @@ namespace nova::renderer {
         create_dynamic_textures(data.resources.render_targets);
         logger->debug("Dynamic textures created");
 
+        create_renderpack_samplers(data.resources.samplers);
+
         create_render_passes(data.graph_data.passes, data.pipelines);
 
         logger->debug("Created render passes");
 
-        create_pipelines_and_materials(data.pipelines, data.materials);
+        // Pipelines with keywords compile their variants later, and their shaders may include files from the renderpack
+        auto* renderpack_folder = filesystem::VirtualFilesystem::get_instance()->get_folder_accessor(renderpack_name);
+        create_pipelines_and_materials(data.pipelines, data.materials, renderpack_folder);
 
         logger->debug("Created pipelines and materials");
 
+        compile_pipelines_for_renderpasses(data.pipelines);
+
+        if(settings->shader_compilation.hot_reload) {
+            if(dynamic_cast<filesystem::RegularFolderAccessor*>(renderpack_folder) != nullptr) {
+                shader_reloader = std::make_unique<ShaderReloader>(
+                    data.pipelines,
+                    *renderpack_folder,
+                    *rendergraph,
+                    *device,
+                    *worker_pool,
+                    [this, renderpack_folder](const renderpack::PipelineData& pipeline_data, const uint32_t generation) {
+                        return create_pipeline(pipeline_data, renderpack_folder, generation);
+                    });
+
+            } else {
+                logger->info("Renderpack {} isn't in a regular folder, so its shaders won't be reloaded when they change", renderpack_name);
+            }
+        }
+
         renderpacks_loaded = true;
 
         logger->debug("Renderpack %s loaded successfully", renderpack_name);
@@ -403,6 +681,40 @@ namespace nova::renderer {
         }
     }
 
+    void NovaRenderer::create_renderpack_samplers(const std::vector<renderpack::SamplerCreateInfo>& sampler_create_infos) {
+        ZoneScoped;
+        for(const renderpack::SamplerCreateInfo& create_info : sampler_create_infos) {
+            rhi::RhiSamplerCreateInfo rhi_create_info = {};
+
+            // Nova doesn't have a texel AA filter, bilinear is the closest
+            const auto filter = create_info.filter == renderpack::TextureFilter::Point ? rhi::TextureFilter::Point :
+                                                                                         rhi::TextureFilter::Bilinear;
+            rhi_create_info.min_filter = filter;
+            rhi_create_info.mag_filter = filter;
+
+            const auto wrap_mode = create_info.wrap_mode == renderpack::WrapMode::Repeat ? rhi::TextureCoordWrapMode::Repeat :
+                                                                                           rhi::TextureCoordWrapMode::ClampToEdge;
+            rhi_create_info.x_wrap_mode = wrap_mode;
+            rhi_create_info.y_wrap_mode = wrap_mode;
+            rhi_create_info.z_wrap_mode = wrap_mode;
+
+            auto* sampler = device->create_sampler(rhi_create_info);
+            if(const auto [itr, was_inserted] = renderpack_samplers.emplace(create_info.name, sampler); !was_inserted) {
+                logger->error("Renderpack declares sampler {} more than once, using the last one", create_info.name);
+                device->destroy_sampler(itr->second);
+                itr->second = sampler;
+            }
+        }
+    }
+
+    void NovaRenderer::destroy_renderpack_samplers() {
+        for(const auto& [name, sampler] : renderpack_samplers) {
+            device->destroy_sampler(sampler);
+        }
+
+        renderpack_samplers.clear();
+    }
+
     void NovaRenderer::create_render_passes(const std::vector<renderpack::RenderPassCreateInfo>& pass_create_infos,
                                             const std::vector<renderpack::PipelineData>& pipelines) const {
         ZoneScoped;
@@ -424,26 +736,201 @@ namespace nova::renderer {
     }
 
     void NovaRenderer::create_pipelines_and_materials(const std::vector<renderpack::PipelineData>& pipeline_create_infos,
-                                                      const std::vector<renderpack::MaterialData>& materials) {
+                                                      const std::vector<renderpack::MaterialData>& materials,
+                                                      filesystem::FolderAccessorBase* renderpack_folder) {
         ZoneScoped;
         for(const renderpack::PipelineData& rp_pipeline_state : pipeline_create_infos) {
             ZoneScoped;
-            const auto pipeline_state = to_pipeline_state_create_info(rp_pipeline_state, *rendergraph);
-            if(!pipeline_state) {
-                logger->error("Could not create pipeline %s", rp_pipeline_state.name);
+            auto pipeline = create_pipeline(rp_pipeline_state, renderpack_folder, 0);
+            if(!pipeline) {
                 continue;
             }
 
-            // TODO: A way for renderpack pipelines to say if they're global or surface pipelines
-            Pipeline pipeline;
-            pipeline.pipeline = device->create_surface_pipeline(*pipeline_state);
+            create_materials_for_pipeline(*pipeline, materials, rp_pipeline_state.name);
+
+            pipelines.emplace(rp_pipeline_state.name, std::move(*pipeline));
+        }
+    }
+
+    std::optional<Pipeline> NovaRenderer::create_pipeline(const renderpack::PipelineData& rp_pipeline_state,
+                                                          filesystem::FolderAccessorBase* renderpack_folder,
+                                                          const uint32_t generation) {
+        ZoneScoped;
+        const auto pipeline_state = to_pipeline_state_create_info(rp_pipeline_state, *rendergraph);
+        if(!pipeline_state) {
+            logger->error("Could not create pipeline {}", rp_pipeline_state.name);
+            return std::nullopt;
+        }
 
-            create_materials_for_pipeline(pipeline, materials, rp_pipeline_state.name);
+        auto pipeline_create_info = *pipeline_state;
+        if(pipeline_create_info.mesh_shader && !device->info.supports_mesh_shaders) {
+            logger->debug("Pipeline {} has a mesh shader but the device doesn't support mesh shaders, falling back to the vertex shader",
+                          rp_pipeline_state.name);
+            pipeline_create_info.mesh_shader.reset();
+            pipeline_create_info.task_shader.reset();
+        }
+
+        // TODO: A way for renderpack pipelines to say if they're global or surface pipelines
+        Pipeline pipeline;
+        pipeline.uses_mesh_shaders = pipeline_create_info.mesh_shader.has_value();
+        pipeline.uses_task_shader = pipeline_create_info.task_shader.has_value();
+        pipeline.pipeline = device->create_surface_pipeline(pipeline_create_info);
+
+        if(!rp_pipeline_state.keywords.empty()) {
+            const auto* renderpass = rendergraph->get_renderpass(rp_pipeline_state.pass);
+            if(renderpass != nullptr && renderpass->renderpass != nullptr) {
+                pipeline.variants = std::make_shared<PipelineVariants>(rp_pipeline_state,
+                                                                       pipeline_create_info,
+                                                                       *pipeline.pipeline,
+                                                                       *renderpass->renderpass,
+                                                                       *device,
+                                                                       *worker_pool,
+                                                                       renderpack_folder,
+                                                                       generation);
+            }
+        }
 
-            pipelines.emplace(rp_pipeline_state.name, std::move(pipeline));
+        return pipeline;
+    }
 
+    void NovaRenderer::swap_in_reloaded_pipelines() {
+        ZoneScoped;
+        if(!shader_reloader) {
             return;
         }
+
+        shader_reloader->update();
+
+        // The replaced pipelines' initial compile jobs may still be queued, and those only hold pointers to the pipelines
+        const auto are_compile_jobs_done = num_pipelines_finished == num_pipelines_to_compile;
+        std::erase_if(replaced_pipelines, [&](const ReplacedPipeline& replaced_pipeline) {
+            return are_compile_jobs_done && replaced_pipeline.frame_replaced + settings->max_in_flight_frames <= frame_count;
+        });
+
+        for(auto& [name, pipeline, recompiled_pipeline] : shader_reloader->take_reloaded_pipelines()) {
+            if(const auto itr = pipelines.find(name); itr != pipelines.end()) {
+                // Install the PSO and swap the pipeline together, so that command lists always see the two agree
+                device->install_recompiled_pipeline(*recompiled_pipeline);
+
+                replaced_pipelines.push_back({std::move(itr->second), frame_count});
+                itr->second = std::move(pipeline);
+            }
+        }
+    }
+
+    void NovaRenderer::compile_pipelines_for_renderpasses(const std::vector<renderpack::PipelineData>& pipeline_create_infos) {
+        ZoneScoped;
+        auto jobs = std::make_shared<std::vector<PipelineCompileJob>>();
+
+        // A pipeline gets a job for each renderpass it renders in, and only derives from its parent's job in the same renderpass
+        using JobKey = std::pair<std::string, const rhi::RhiRenderpass*>;
+        std::map<JobKey, size_t> job_idx_by_key;
+        for(const auto& renderpass_name : rendergraph->calculate_renderpass_execution_order()) {
+            const auto* renderpass = rendergraph->get_renderpass(renderpass_name);
+            if(renderpass == nullptr || renderpass->renderpass == nullptr) {
+                continue;
+            }
+
+            for(const auto& pipeline_name : renderpass->pipeline_names) {
+                if(const auto itr = pipelines.find(pipeline_name); itr != pipelines.end() && itr->second.pipeline) {
+                    if(job_idx_by_key.emplace(JobKey{pipeline_name, renderpass->renderpass}, jobs->size()).second) {
+                        jobs->push_back({itr->second.pipeline.get(), renderpass->renderpass, {}});
+                    }
+                }
+            }
+        }
+
+        std::unordered_map<std::string, std::string> parent_names;
+        for(const auto& pipeline_data : pipeline_create_infos) {
+            if(pipeline_data.parent_name && !pipeline_data.parent_name->empty()) {
+                parent_names.emplace(pipeline_data.name, *pipeline_data.parent_name);
+            }
+        }
+
+        // Finds the job for a pipeline's parent, if the parent compiles in the same renderpass
+        const auto get_parent_job = [&](const std::string& pipeline_name, const size_t job_idx) -> std::optional<size_t> {
+            const auto parent_itr = parent_names.find(pipeline_name);
+            if(parent_itr == parent_names.end()) {
+                return std::nullopt;
+            }
+
+            const auto parent_job_itr = job_idx_by_key.find(JobKey{parent_itr->second, (*jobs)[job_idx].renderpass});
+            if(parent_job_itr == job_idx_by_key.end()) {
+                return std::nullopt;
+            }
+
+            return parent_job_itr->second;
+        };
+
+        std::vector<bool> waits_for_parent(jobs->size(), false);
+        for(const auto& [job_key, job_idx] : job_idx_by_key) {
+            const auto& pipeline_name = job_key.first;
+            const auto parent_job_idx = get_parent_job(pipeline_name, job_idx);
+            if(!parent_job_idx) {
+                continue;
+            }
+
+            // Only wait if following the parents gets to a pipeline without one, otherwise a cycle of parents would never compile
+            auto ancestor_name = (*jobs)[*parent_job_idx].pipeline->name;
+            auto ancestor_job_idx = get_parent_job(ancestor_name, *parent_job_idx);
+            size_t num_steps = 0;
+            while(ancestor_job_idx && num_steps < jobs->size()) {
+                ancestor_name = (*jobs)[*ancestor_job_idx].pipeline->name;
+                ancestor_job_idx = get_parent_job(ancestor_name, *ancestor_job_idx);
+                num_steps++;
+            }
+
+            if(!ancestor_job_idx) {
+                (*jobs)[*parent_job_idx].children.push_back(job_idx);
+                waits_for_parent[job_idx] = true;
+
+            } else {
+                logger->warn("Pipeline {}'s parents form a cycle, compiling it without deriving it from its parent", pipeline_name);
+            }
+        }
+
+        num_pipelines_compiled = 0;
+        num_pipelines_failed = 0;
+        num_pipelines_finished = 0;
+        num_pipelines_to_compile = static_cast<uint32_t>(jobs->size());
+
+        logger->info("Compiling {} pipelines on {} threads", num_pipelines_to_compile, worker_pool->get_num_threads());
+
+        // Mark every pipeline before submitting any jobs, including the children that wait for their parents, so that command lists draw
+        // with fallbacks instead of compiling the pipelines on the render thread while the jobs are queued
+        for(const auto& job : *jobs) {
+            device->mark_pipeline_pending(*job.pipeline, *job.renderpass);
+        }
+
+        for(size_t job_idx = 0; job_idx < jobs->size(); job_idx++) {
+            if(!waits_for_parent[job_idx]) {
+                submit_pipeline_compile(jobs, job_idx);
+            }
+        }
+    }
+
+    void NovaRenderer::submit_pipeline_compile(std::shared_ptr<std::vector<PipelineCompileJob>> jobs, const size_t job_idx) {
+        // Pipelines block rendering, so compile them before any texture loading work
+        worker_pool->submit(
+            [this, jobs = std::move(jobs), job_idx] {
+                const auto& job = (*jobs)[job_idx];
+                if(device->compile_pipeline_for_renderpass(*job.pipeline, *job.renderpass)) {
+                    num_pipelines_compiled++;
+
+                } else {
+                    num_pipelines_failed++;
+                }
+
+                if(++num_pipelines_finished == num_pipelines_to_compile) {
+                    logger->info("Finished compiling pipelines. {} failed", num_pipelines_failed.load());
+                }
+
+                // Children compile from scratch if their parent failed, so start them either way
+                for(const auto child_idx : job.children) {
+                    submit_pipeline_compile(jobs, child_idx);
+                }
+            },
+            1.0f);
     }
 
     void NovaRenderer::create_materials_for_pipeline(const Pipeline& pipeline,
@@ -465,11 +952,28 @@ namespace nova::renderer {
                     ZoneScoped;
                     MaterialPass pass = {};
                     pass.pipeline_interface = pipeline.pipeline_interface;
+                    pass.uses_mesh_shaders = pipeline.uses_mesh_shaders;
+                    pass.uses_task_shader = pipeline.uses_task_shader;
+
+                    if(pipeline.variants) {
+                        pass.variant_key = pipeline.variants->get_variant_key(pass_data.keywords);
+
+                    } else if(!pass_data.keywords.empty()) {
+                        logger->warn("Material pass {}.{} turns on keywords, but pipeline {} has no keywords",
+                                     material_data.name,
+                                     pass_data.name,
+                                     pipeline_name);
+                    }
 
                     const FullMaterialPassName full_pass_name{pass_data.material_name, pass_data.name};
 
                     pass.name = full_pass_name;
 
+                    pass.bound_resource_names.reserve(pass_data.bindings.size());
+                    for(const auto& [descriptor_name, resource_name] : pass_data.bindings) {
+                        pass.bound_resource_names.push_back(resource_name);
+                    }
+
                     MaterialPassMetadata pass_metadata{};
                     pass_metadata.data = pass_data;
                     material_metadatas.emplace(full_pass_name, pass_metadata);
@@ -489,53 +993,111 @@ namespace nova::renderer {
 
     void NovaRenderer::update_camera_matrix_buffer(const uint32_t frame_idx) {
         ZoneScoped;
-        for(const Camera& cam : cameras) {
-            if(cam.is_active) {
-                auto& data = camera_data->at(cam.index);
-                data.previous_view = data.view;
-                data.previous_projection = data.projection;
+        const auto framebuffer_size = device->get_swapchain()->get_size();
+
+        for(Camera& cam : cameras) {
+            if(!cam.is_active) {
+                continue;
+            }
 
-                data.view = translate({}, cam.position);
-                data.view = rotate(data.view, cam.rotation.x, {1, 0, 0});
-                data.view = rotate(data.view, cam.rotation.y, {0, 1, 0});
-                data.view = rotate(data.view, cam.rotation.z, {0, 0, 1});
+            const Camera::MatrixInputs inputs{cam.position,
+                                              cam.rotation,
+                                              cam.field_of_view,
+                                              cam.aspect_ratio,
+                                              cam.near_plane,
+                                              cam.far_plane,
+                                              framebuffer_size};
+            const auto has_camera_changed = cam.last_matrix_inputs != inputs;
+
+            // Cameras that haven't moved and already have up-to-date previous matrices don't need their UBO touched at all, which also
+            // keeps them from being uploaded
+            if(!has_camera_changed && !cam.has_stale_previous_matrices) {
+                continue;
+            }
 
-                if(cam.field_of_view > 0) {
-                    data.projection = glm::perspective(cam.field_of_view, cam.aspect_ratio, cam.near_plane, cam.far_plane);
+            auto& data = camera_data->at(cam.index);
+            data.previous_view = data.view;
+            data.previous_projection = data.projection;
 
-                } else {
-                    const auto framebuffer_size = device->get_swapchain()->get_size();
-                    glm::mat4 ui_matrix{
-                        {2.0f, 0.0f, 0.0f, -1.0f},
-                        {0.0f, 2.0f, 0.0f, -1.0f},
-                        {0.0f, 0.0f, -1.0f, 0.0f},
-                        {0.0f, 0.0f, 0.0f, 1.0f},
-                    };
-                    ui_matrix[0][0] /= framebuffer_size.x;
-                    ui_matrix[1][1] /= framebuffer_size.y;
-                    data.projection = ui_matrix;
-                }
+            if(!has_camera_changed) {
+                cam.has_stale_previous_matrices = false;
+                continue;
+            }
+
+            data.view = translate({}, cam.position);
+            data.view = rotate(data.view, cam.rotation.x, {1, 0, 0});
+            data.view = rotate(data.view, cam.rotation.y, {0, 1, 0});
+            data.view = rotate(data.view, cam.rotation.z, {0, 0, 1});
+
+            if(cam.field_of_view > 0) {
+                data.projection = glm::perspective(cam.field_of_view, cam.aspect_ratio, cam.near_plane, cam.far_plane);
+
+            } else {
+                glm::mat4 ui_matrix{
+                    {2.0f, 0.0f, 0.0f, -1.0f},
+                    {0.0f, 2.0f, 0.0f, -1.0f},
+                    {0.0f, 0.0f, -1.0f, 0.0f},
+                    {0.0f, 0.0f, 0.0f, 1.0f},
+                };
+                ui_matrix[0][0] /= framebuffer_size.x;
+                ui_matrix[1][1] /= framebuffer_size.y;
+                data.projection = ui_matrix;
             }
+
+            cam.last_matrix_inputs = inputs;
+            cam.has_stale_previous_matrices = true;
         }
 
         camera_data->upload_to_device(frame_idx);
     }
 
-    std::vector<rhi::RhiImage*> NovaRenderer::get_all_images() {
-        std::vector<rhi::RhiImage*> images{};
+    void NovaRenderer::resize_material_device_buffer(const uint32_t frame_idx) {
+        ZoneScoped;
+        const auto required_size = mem::Bytes{material_buffer->size()};
+        if(material_device_buffers[frame_idx]->size >= required_size) {
+            return;
+        }
+
+        const auto buffer_name = fmt::format("{}_{}", MATERIAL_DATA_BUFFER_NAME, frame_idx);
+        device_resources->destroy_uniform_buffer(buffer_name);
+
+        if(auto buffer = device_resources->create_uniform_buffer(buffer_name, required_size); buffer) {
+            material_device_buffers[frame_idx] = *buffer;
+
+            // The new buffer has none of the material data, so it all needs to be uploaded
+            material_buffer->mark_all_dirty(frame_idx);
+
+        } else {
+            logger->error("Could not grow material buffer {} to {} bytes", buffer_name, required_size.b_count());
+        }
+    }
 
-        const auto& textures = device_resources->get_all_textures();
-        images.reserve(textures.size());
+    void NovaRenderer::upload_material_buffer(const uint32_t frame_idx) {
+        ZoneScoped;
+        const auto& device_buffer = material_device_buffers[frame_idx];
+        const auto device_buffer_size = device_buffer->size.b_count();
+
+        for(const MaterialDataRange& range : material_buffer->get_dirty_ranges(frame_idx, &frame_arenas[frame_idx])) {
+            // Materials created during this frame may have grown the CPU buffer past the end of the device buffer. They'll be uploaded
+            // the next time this frame's device buffer is resized
+            if(range.offset >= device_buffer_size) {
+                break;
+            }
 
-        for(const TextureResource& texture : textures) {
-            images.emplace_back(texture.image);
+            const auto num_bytes = std::min(range.size, device_buffer_size - range.offset);
+            device->write_data_to_buffer(material_buffer->data() + range.offset,
+                                         mem::Bytes{num_bytes},
+                                         mem::Bytes{range.offset},
+                                         device_buffer->buffer);
         }
 
-        return images;
+        material_buffer->clear_dirty_ranges(frame_idx);
     }
 
     void NovaRenderer::destroy_dynamic_resources() {
         ZoneScoped;
+        destroy_renderpack_samplers();
+
         if(loaded_renderpack) {
             for(const renderpack::TextureCreateInfo& tex_data : loaded_renderpack->resources.render_targets) {
                 device_resources->destroy_render_target(tex_data.name);
@@ -554,6 +1116,14 @@ namespace nova::renderer {
 
     rhi::RhiSampler* NovaRenderer::get_point_sampler() const { return point_sampler; }
 
+    rhi::RhiSampler* NovaRenderer::get_renderpack_sampler(const std::string& name) const {
+        if(const auto itr = renderpack_samplers.find(name); itr != renderpack_samplers.end()) {
+            return itr->second;
+        }
+
+        return nullptr;
+    }
+
     Pipeline* NovaRenderer::find_pipeline(const std::string& pipeline_name) {
         if(const auto pipeline_itr = pipelines.find(pipeline_name); pipeline_itr != pipelines.end()) {
             return &pipeline_itr->second;
@@ -618,6 +1188,12 @@ namespace nova::renderer {
                     batch.num_indices = mesh.num_indices;
                     batch.vertex_buffer = mesh.vertex_buffer;
                     batch.index_buffer = mesh.index_buffer;
+                    batch.meshlet_buffer = mesh.meshlet_buffer;
+                    batch.meshlet_vertex_buffer = mesh.meshlet_vertex_buffer;
+                    batch.meshlet_primitive_buffer = mesh.meshlet_primitive_buffer;
+                    batch.num_meshlets = mesh.num_meshlets;
+                    batch.bounding_center = mesh.bounding_center;
+                    batch.bounding_radius = mesh.bounding_radius;
                     batch.commands.emplace_back(command);
 
                     key.batch_idx = static_cast<uint32_t>(material.static_mesh_draws.size());
@@ -725,6 +1301,18 @@ namespace nova::renderer {
 
     DeviceResources& NovaRenderer::get_resource_manager() const { return *device_resources; }
 
+    TextureStreamer& NovaRenderer::get_texture_streamer() const { return *texture_streamer; }
+
+    VirtualTextureSystem& NovaRenderer::get_virtual_texture_system() const { return *virtual_texture_system; }
+
+    WorkerPool& NovaRenderer::get_worker_pool() const { return *worker_pool; }
+
+    PipelineCompileProgress NovaRenderer::get_pipeline_compile_progress() const {
+        return {num_pipelines_compiled, num_pipelines_failed, num_pipelines_to_compile};
+    }
+
+    MemoryBudgetTracker& NovaRenderer::get_memory_budget_tracker() const { return *memory_budget_tracker; }
+
     void NovaRenderer::initialize_virtual_filesystem() {
         // The host application MUST register its data directory before initializing Nova
 
@@ -744,7 +1332,21 @@ namespace nova::renderer {
         }
     }
 
-    void NovaRenderer::create_resource_storage() { device_resources = std::make_unique<DeviceResources>(*this); }
+    void NovaRenderer::create_resource_storage() {
+        // Device resources compress textures on the worker pool, even the default ones
+        worker_pool = std::make_unique<WorkerPool>(settings->num_worker_threads);
+        device_resources = std::make_unique<DeviceResources>(*this);
+        texture_streamer = std::make_unique<TextureStreamer>(*this,
+                                                             *worker_pool,
+                                                             settings->texture_streaming,
+                                                             settings->max_in_flight_frames);
+        device_resources->set_texture_streamer(texture_streamer.get());
+        virtual_texture_system = std::make_unique<VirtualTextureSystem>(*this,
+                                                                        *worker_pool,
+                                                                        settings->virtual_textures,
+                                                                        settings->max_in_flight_frames);
+        memory_budget_tracker = std::make_unique<MemoryBudgetTracker>(*this, settings->memory_budget);
+    }
 
     void NovaRenderer::create_builtin_render_targets() {
         const auto& swapchain_size = device->get_swapchain()->get_size();
@@ -795,7 +1397,7 @@ namespace nova::renderer {
     }
 
     void NovaRenderer::create_builtin_uniform_buffers() {
-        material_buffer = std::make_unique<MaterialDataBuffer>();
+        material_buffer = std::make_unique<MaterialDataBuffer>(MATERIAL_BUFFER_SIZE.b_count(), settings->max_in_flight_frames);
         for(uint32_t i = 0; i < settings->max_in_flight_frames; i++) {
             const auto buffer_name = fmt::format("{}_{}", MATERIAL_DATA_BUFFER_NAME, i);
             if(auto buffer = device_resources->create_uniform_buffer(buffer_name, MATERIAL_BUFFER_SIZE); buffer) {
@@ -843,7 +1445,6 @@ namespace nova::renderer {
         const auto& ui_output = *device_resources->get_render_target(UI_OUTPUT_RT_NAME);
         const auto& scene_output = *device_resources->get_render_target(SCENE_OUTPUT_RT_NAME);
 
-        backbuffer_output_pipeline_create_info.viewport_size = device->get_swapchain()->get_size();
         auto backbuffer_pipeline = device->create_global_pipeline(*backbuffer_output_pipeline_create_info);
         if(rendergraph->create_renderpass<BackbufferOutputRenderpass>(*device_resources,
                                                                       ui_output->image,
@@ -0,0 +1,116 @@
+#include "procedural_geometry_ring.hpp"
+
+#include <array>
+
+#include <Tracy.hpp>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+#include "nova_renderer/rhi/command_list.hpp"
+#include "nova_renderer/rhi/render_device.hpp"
+
+#include "../util/memory_utils.hpp"
+
+using namespace nova::mem;
+
+namespace nova::renderer {
+    static auto logger = spdlog::stdout_color_mt("ProceduralGeometryRing");
+
+    using namespace rhi;
+
+    ProceduralGeometryRing::ProceduralGeometryRing(const Bytes size_per_frame, const uint32_t num_in_flight_frames, RenderDevice& device)
+        : device{device}, size_per_frame{size_per_frame}, num_in_flight_frames{num_in_flight_frames} {
+        const auto total_size = size_per_frame * num_in_flight_frames;
+
+        staging_buffer = device.create_buffer({"ProceduralGeometryStagingRing", total_size, BufferUsage::StagingBuffer});
+        geometry_buffer = device.create_buffer({"ProceduralGeometryRing", total_size, BufferUsage::GeometryBuffer});
+
+        if(staging_buffer == nullptr || geometry_buffer == nullptr) {
+            logger->error("Could not create the procedural geometry ring, procedural meshes will not be rendered");
+        }
+    }
+
+    ProceduralGeometryRing::~ProceduralGeometryRing() {
+        if(staging_buffer != nullptr) {
+            device.destroy_buffer(staging_buffer);
+        }
+
+        if(geometry_buffer != nullptr) {
+            device.destroy_buffer(geometry_buffer);
+        }
+    }
+
+    bool ProceduralGeometryRing::reserve(const Bytes num_bytes) {
+        if(num_reserved_bytes + num_bytes > size_per_frame) {
+            return false;
+        }
+
+        num_reserved_bytes += num_bytes;
+        return true;
+    }
+
+    void ProceduralGeometryRing::release(const Bytes num_bytes) { num_reserved_bytes -= num_bytes; }
+
+    void ProceduralGeometryRing::begin_frame(const uint32_t frame_idx) {
+        frame_start = size_per_frame * frame_idx;
+        frame_head = 0;
+    }
+
+    std::optional<ProceduralGeometryRing::Allocation> ProceduralGeometryRing::write(const void* data,
+                                                                                    const Bytes num_bytes,
+                                                                                    const Bytes alignment) {
+        ZoneScoped;
+        if(staging_buffer == nullptr) {
+            return std::nullopt;
+        }
+
+        const auto aligned_head = align(frame_head, alignment);
+        if(aligned_head + num_bytes > size_per_frame) {
+            logger->error("Procedural geometry ring ran out of space: {} bytes are in use, {} more were requested, but there's only {} "
+                          "bytes per frame. Did a procedural mesh write more data than it reserved?",
+                          aligned_head.b_count(),
+                          num_bytes.b_count(),
+                          size_per_frame.b_count());
+            return std::nullopt;
+        }
+
+        const auto offset = frame_start + aligned_head;
+        device.write_data_to_buffer(data, num_bytes, offset, staging_buffer);
+
+        frame_head = aligned_head + num_bytes;
+
+        return Allocation{offset, num_bytes};
+    }
+
+    void ProceduralGeometryRing::record_upload(RhiRenderCommandList& cmds) const {
+        ZoneScoped;
+        if(frame_head == Bytes{0} || geometry_buffer == nullptr) {
+            return;
+        }
+
+        // We waited on this frame's fence before we started writing to its region, so the GPU is done reading the region's old data.
+        // Thus we only need barriers after the copy
+        cmds.copy_buffer(geometry_buffer, frame_start, staging_buffer, frame_start, frame_head);
+
+        RhiResourceBarrier vertex_barrier = {};
+        vertex_barrier.resource_to_barrier = geometry_buffer;
+        vertex_barrier.access_before_barrier = ResourceAccess::CopyWrite;
+        vertex_barrier.access_after_barrier = ResourceAccess::VertexAttributeRead;
+        vertex_barrier.old_state = ResourceState::CopyDestination;
+        vertex_barrier.new_state = ResourceState::VertexBuffer;
+        vertex_barrier.source_queue = QueueType::Graphics;
+        vertex_barrier.destination_queue = QueueType::Graphics;
+        vertex_barrier.buffer_memory_barrier.offset = frame_start;
+        vertex_barrier.buffer_memory_barrier.size = frame_head;
+
+        auto index_barrier = vertex_barrier;
+        index_barrier.access_after_barrier = ResourceAccess::IndexRead;
+        index_barrier.new_state = ResourceState::IndexBuffer;
+
+        cmds.resource_barriers(PipelineStage::Transfer, PipelineStage::VertexInput, std::array{vertex_barrier, index_barrier});
+    }
+
+    RhiBuffer* ProceduralGeometryRing::get_buffer() const { return geometry_buffer; }
+
+    uint32_t ProceduralGeometryRing::get_num_in_flight_frames() const { return num_in_flight_frames; }
+} // namespace nova::renderer
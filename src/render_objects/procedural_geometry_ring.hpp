@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+#include "nova_renderer/rhi/forward_decls.hpp"
+#include "nova_renderer/util/bytes.hpp"
+
+namespace nova::renderer {
+    /*!
+     * \brief Linear ring buffer that every procedural mesh streams its geometry through
+     *
+     * The ring has one region for each in-flight frame. Procedural meshes copy their data into the current frame's region of a
+     * persistently mapped staging buffer, then the ring records a single copy of everything written that frame into a device-local buffer
+     * that's used for both vertices and indices. When a frame comes around again its whole region is reclaimed at once, since the
+     * frame's fence tells us that the GPU is done with it
+     *
+     * Procedural meshes reserve their maximum size when they're created, so writing to the ring during a frame can't run out of space as
+     * long as every mesh stays within the size it asked for
+     */
+    class ProceduralGeometryRing {
+    public:
+        /*!
+         * \brief Where some data ended up in the ring's device buffer
+         */
+        struct Allocation {
+            mem::Bytes offset = 0;
+            mem::Bytes size = 0;
+        };
+
+        /*!
+         * \param size_per_frame Size of each frame's region of the ring
+         * \param num_in_flight_frames Number of in-flight frames, aka the number of regions in the ring
+         * \param device The device to create the ring's buffers with
+         */
+        ProceduralGeometryRing(mem::Bytes size_per_frame, uint32_t num_in_flight_frames, rhi::RenderDevice& device);
+
+        ProceduralGeometryRing(const ProceduralGeometryRing& other) = delete;
+        ProceduralGeometryRing& operator=(const ProceduralGeometryRing& other) = delete;
+
+        ProceduralGeometryRing(ProceduralGeometryRing&& old) noexcept = delete;
+        ProceduralGeometryRing& operator=(ProceduralGeometryRing&& old) noexcept = delete;
+
+        ~ProceduralGeometryRing();
+
+        /*!
+         * \brief Reserves space in every frame's region
+         *
+         * \return True if there's enough space left in the ring, false if there isn't
+         */
+        [[nodiscard]] bool reserve(mem::Bytes num_bytes);
+
+        /*!
+         * \brief Gives back space that was previously reserved
+         */
+        void release(mem::Bytes num_bytes);
+
+        /*!
+         * \brief Starts writing to the given frame's region, throwing away everything that was written to it last time
+         *
+         * Only call this after waiting for the frame's fence
+         */
+        void begin_frame(uint32_t frame_idx);
+
+        /*!
+         * \brief Copies some data into the current frame's region
+         *
+         * \param data The data to write
+         * \param num_bytes The number of bytes to write
+         * \param alignment The alignment of the data's offset in the ring
+         *
+         * \return Where in the ring's device buffer the data will be after the frame's upload, or nullopt if there's no space for it
+         */
+        [[nodiscard]] std::optional<Allocation> write(const void* data, mem::Bytes num_bytes, mem::Bytes alignment);
+
+        /*!
+         * \brief Records the commands to copy everything written this frame to the device buffer
+         *
+         * Must be recorded before any draws which use data from this frame's region, and outside of a renderpass
+         */
+        void record_upload(rhi::RhiRenderCommandList& cmds) const;
+
+        /*!
+         * \brief The buffer that holds the procedural meshes' vertices and indices. Bind this with the offsets from `write`
+         */
+        [[nodiscard]] rhi::RhiBuffer* get_buffer() const;
+
+        [[nodiscard]] uint32_t get_num_in_flight_frames() const;
+
+    private:
+        rhi::RenderDevice& device;
+
+        mem::Bytes size_per_frame;
+        uint32_t num_in_flight_frames;
+
+        rhi::RhiBuffer* staging_buffer = nullptr;
+        rhi::RhiBuffer* geometry_buffer = nullptr;
+
+        mem::Bytes num_reserved_bytes = 0;
+
+        /*!
+         * \brief Start of the current frame's region
+         */
+        mem::Bytes frame_start = 0;
+
+        /*!
+         * \brief Next free byte in the current frame's region, relative to `frame_start`
+         */
+        mem::Bytes frame_head = 0;
+    };
+} // namespace nova::renderer
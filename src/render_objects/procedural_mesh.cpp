@@ -1,233 +1,134 @@
 #include "nova_renderer/procedural_mesh.hpp"
 
-#include <rx/core/log.h>
+#include <algorithm>
+#include <cstring>
 
-#include "nova_renderer/rhi/render_device.hpp"
+#include <Tracy.hpp>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
 
 #include "../util/memory_utils.hpp"
+#include "procedural_geometry_ring.hpp"
+
 using namespace nova::mem;
 
 namespace nova::renderer {
-    RX_LOG("ProceduralMesh", logger);
+    static auto logger = spdlog::stdout_color_mt("ProceduralMesh");
 
     using namespace rhi;
 
+    /*!
+     * \brief Alignment of the vertex and index data in the procedural geometry ring
+     *
+     * Everything in the ring is aligned the same way, so a mesh can reserve exactly as much space as it'll ever use
+     */
+    constexpr Bytes PROCEDURAL_MESH_DATA_ALIGNMENT = 256;
+
     ProceduralMesh::ProceduralMesh(const uint64_t vertex_buffer_size,
                                    const uint64_t index_buffer_size,
-                                   const uint32_t num_in_flight_frames,
-                                   RenderDevice* device,
+                                   ProceduralGeometryRing& ring,
                                    const std::string& name)
-        : device(device),
-          name(name)
-#ifdef NOVA_DEBUG
-          ,
-          vertex_buffer_size(vertex_buffer_size),
-          index_buffer_size(index_buffer_size)
-#endif
-    {
-        const auto aligned_vertex_buffer_size = align(vertex_buffer_size, 256);
-        const auto aligned_index_buffer_size = align(index_buffer_size, 256);
-        const auto host_memory_size = aligned_vertex_buffer_size + aligned_index_buffer_size;
-        const auto device_memory_size = host_memory_size * 3;
-
-        allocator = &rx::memory::g_system_allocator;
-
-        vertex_buffers.resize(num_in_flight_frames);
-        index_buffers.resize(num_in_flight_frames);
-        for(uint32_t i = 0; i < num_in_flight_frames; i++) {
-            vertex_buffers[i] = device->create_buffer({std::string::format("%sVertices%d", name, i),
-                                                       vertex_buffer_size,
-                                                       BufferUsage::VertexBuffer},
-                                                      *allocator);
-            index_buffers[i] = device->create_buffer({std::string::format("%sIndices%d", name, i),
-                                                      index_buffer_size,
-                                                      BufferUsage::IndexBuffer},
-                                                     *allocator);
-        }
+        : name(name), vertex_buffer_size(vertex_buffer_size), index_buffer_size(index_buffer_size) {
+        vertex_data.reserve(vertex_buffer_size);
+        index_data.reserve(index_buffer_size);
 
-        cached_vertex_buffer = device->create_buffer({std::string::format("%sStagingVertices", name),
-                                                      vertex_buffer_size,
-                                                      BufferUsage::StagingBuffer},
-                                                     *allocator);
-        cached_index_buffer = device->create_buffer({std::string::format("%sStagingIndices", name),
-                                                     index_buffer_size,
-                                                     BufferUsage::StagingBuffer},
-                                                    *allocator);
+        buffers_per_frame.resize(ring.get_num_in_flight_frames(), Buffers{nullptr, nullptr});
+
+        const auto bytes_to_reserve = align(vertex_buffer_size, PROCEDURAL_MESH_DATA_ALIGNMENT) +
+                                      align(index_buffer_size, PROCEDURAL_MESH_DATA_ALIGNMENT);
+        if(ring.reserve(bytes_to_reserve)) {
+            this->ring = &ring;
+            num_reserved_bytes = bytes_to_reserve;
+
+        } else {
+            logger->error("Not enough space in the procedural geometry ring for procedural mesh {}, which needs {} bytes. It will not be "
+                          "rendered",
+                          name,
+                          bytes_to_reserve.b_count());
+        }
     }
 
     ProceduralMesh::ProceduralMesh(ProceduralMesh&& old) noexcept
-        : device{old.device},
-          vertex_buffers{std::move(old.vertex_buffers)},
-          index_buffers{std::move(old.index_buffers)},
-          cached_vertex_buffer{old.cached_vertex_buffer},
-          cached_index_buffer{old.cached_index_buffer},
-          num_vertex_bytes_to_upload{old.num_vertex_bytes_to_upload},
-          num_index_bytes_to_upload{old.num_index_bytes_to_upload},
-          allocator {
-        old.allocator
+        : ring{old.ring},
+          name{std::move(old.name)},
+          vertex_data{std::move(old.vertex_data)},
+          index_data{std::move(old.index_data)},
+          vertex_buffer_size{old.vertex_buffer_size},
+          index_buffer_size{old.index_buffer_size},
+          buffers_per_frame{std::move(old.buffers_per_frame)},
+          num_reserved_bytes{old.num_reserved_bytes} {
+        old.ring = nullptr;
     }
-#if NOVA_DEBUG
-    , vertex_buffer_size{old.vertex_buffer_size}, index_buffer_size { old.index_buffer_size }
-#endif
-    { old.device = nullptr; }
 
     ProceduralMesh& ProceduralMesh::operator=(ProceduralMesh&& old) noexcept {
-        device = old.device;
-        vertex_buffers = std::move(old.vertex_buffers);
-        index_buffers = std::move(old.index_buffers);
-        cached_vertex_buffer = old.cached_vertex_buffer;
-        cached_index_buffer = old.cached_index_buffer;
-        num_vertex_bytes_to_upload = old.num_vertex_bytes_to_upload;
-        num_index_bytes_to_upload = old.num_index_bytes_to_upload;
-        allocator = old.allocator;
-
-#if NOVA_DEBUG
+        if(ring != nullptr) {
+            ring->release(num_reserved_bytes);
+        }
+
+        ring = old.ring;
+        name = std::move(old.name);
+        vertex_data = std::move(old.vertex_data);
+        index_data = std::move(old.index_data);
         vertex_buffer_size = old.vertex_buffer_size;
         index_buffer_size = old.index_buffer_size;
-#endif
+        buffers_per_frame = std::move(old.buffers_per_frame);
+        num_reserved_bytes = old.num_reserved_bytes;
 
-        old.device = nullptr;
+        old.ring = nullptr;
 
         return *this;
     }
 
+    ProceduralMesh::~ProceduralMesh() {
+        if(ring != nullptr) {
+            ring->release(num_reserved_bytes);
+        }
+    }
+
     void ProceduralMesh::set_vertex_data(const void* data, const uint64_t size) {
-#ifdef NOVA_DEBUG
+        // The mesh only reserved enough space in the ring for vertex_buffer_size bytes, so we can't let it have any more
         if(size > vertex_buffer_size) {
-            logger->error(
-                "Cannot upload vertex data. There's only space for %uz bytes, you tried to upload %uz. Truncating vertex data to fit",
-                vertex_buffer_size,
-                size);
-
-            device->write_data_to_buffer(data, vertex_buffer_size, cached_vertex_buffer);
-            num_vertex_bytes_to_upload = vertex_buffer_size;
-
-        } else {
-#endif
-
-            device->write_data_to_buffer(data, size, cached_vertex_buffer);
-            num_vertex_bytes_to_upload = size;
-
-#ifdef NOVA_DEBUG
+            logger->error("Cannot upload vertex data. There's only space for {} bytes, you tried to upload {}. Truncating vertex data to fit",
+                          vertex_buffer_size,
+                          size);
         }
-#endif
+
+        const auto num_bytes = std::min(size, vertex_buffer_size);
+        vertex_data.resize(num_bytes);
+        std::memcpy(vertex_data.data(), data, num_bytes);
     }
 
     void ProceduralMesh::set_index_data(const void* data, const uint64_t size) {
-#ifdef NOVA_DEBUG
         if(size > index_buffer_size) {
-            logger->error(
-                "Cannot upload index data. There's only space for %uz bytes, you tried to upload %uz. Truncating vertex data to fit",
-                index_buffer_size,
-                size);
-
-            device->write_data_to_buffer(data, index_buffer_size, cached_index_buffer);
-            num_index_bytes_to_upload = index_buffer_size;
-
-        } else {
-#endif
-            device->write_data_to_buffer(data, size, cached_index_buffer);
-            num_index_bytes_to_upload = size;
-
-#ifdef NOVA_DEBUG
+            logger->error("Cannot upload index data. There's only space for {} bytes, you tried to upload {}. Truncating index data to fit",
+                          index_buffer_size,
+                          size);
         }
-#endif
-    }
-
-    void ProceduralMesh::record_commands_to_upload_data(RhiRenderCommandList* cmds, const uint8_t frame_idx) const {
-        const bool should_upload_vertex_buffer = num_vertex_bytes_to_upload > 0;
-        const bool should_upload_index_buffer = num_index_bytes_to_upload > 0;
-
-        auto* cur_vertex_buffer = vertex_buffers[frame_idx];
-        auto* cur_index_buffer = index_buffers[frame_idx];
-
-        std::vector<RhiResourceBarrier> barriers_before_upload;
 
-        if(should_upload_vertex_buffer) {
-            RhiResourceBarrier barrier_before_vertex_upload = {};
-            barrier_before_vertex_upload.resource_to_barrier = cur_vertex_buffer;
-            barrier_before_vertex_upload.access_before_barrier = ResourceAccess::VertexAttributeRead;
-            barrier_before_vertex_upload.access_after_barrier = ResourceAccess::MemoryWrite;
-            barrier_before_vertex_upload.old_state = ResourceState::VertexBuffer;
-            barrier_before_vertex_upload.new_state = ResourceState::CopyDestination;
-            barrier_before_vertex_upload.source_queue = QueueType::Graphics;
-            barrier_before_vertex_upload.destination_queue = QueueType::Graphics;
-            barrier_before_vertex_upload.buffer_memory_barrier.offset = 0;
-            barrier_before_vertex_upload.buffer_memory_barrier.size = num_vertex_bytes_to_upload;
+        const auto num_bytes = std::min(size, index_buffer_size);
+        index_data.resize(num_bytes);
+        std::memcpy(index_data.data(), data, num_bytes);
+    }
 
-            barriers_before_upload.push_back(barrier_before_vertex_upload);
-        }
+    void ProceduralMesh::write_to_ring(const uint32_t frame_idx) {
+        ZoneScoped;
+        auto& buffers = buffers_per_frame[frame_idx];
+        buffers = {nullptr, nullptr};
 
-        if(should_upload_index_buffer) {
-            RhiResourceBarrier barrier_before_index_upload = {};
-            barrier_before_index_upload.resource_to_barrier = cur_index_buffer;
-            barrier_before_index_upload.access_before_barrier = ResourceAccess::IndexRead;
-            barrier_before_index_upload.access_after_barrier = ResourceAccess::MemoryWrite;
-            barrier_before_index_upload.old_state = ResourceState::IndexBuffer;
-            barrier_before_index_upload.new_state = ResourceState::CopyDestination;
-            barrier_before_index_upload.source_queue = QueueType::Graphics;
-            barrier_before_index_upload.destination_queue = QueueType::Graphics;
-            barrier_before_index_upload.buffer_memory_barrier.offset = 0;
-            barrier_before_index_upload.buffer_memory_barrier.size = num_index_bytes_to_upload;
-
-            barriers_before_upload.push_back(barrier_before_index_upload);
-        }
-
-        if(barriers_before_upload.is_empty()) {
+        if(ring == nullptr || vertex_data.empty() || index_data.empty()) {
             return;
         }
 
-        cmds->resource_barriers(PipelineStage::VertexInput, PipelineStage::Transfer, barriers_before_upload);
-
-        if(should_upload_vertex_buffer) {
-            cmds->copy_buffer(cur_vertex_buffer, 0, cached_vertex_buffer, 0, num_vertex_bytes_to_upload);
-        }
-
-        if(should_upload_index_buffer) {
-            cmds->copy_buffer(cur_index_buffer, 0, cached_index_buffer, 0, num_index_bytes_to_upload);
-        }
-
-        std::vector<RhiResourceBarrier> barriers_after_upload;
-
-        if(should_upload_vertex_buffer) {
-            RhiResourceBarrier barrier_after_vertex_upload = {};
-            barrier_after_vertex_upload.resource_to_barrier = cur_vertex_buffer;
-            barrier_after_vertex_upload.access_before_barrier = ResourceAccess::MemoryWrite;
-            barrier_after_vertex_upload.access_after_barrier = ResourceAccess::VertexAttributeRead;
-            barrier_after_vertex_upload.old_state = ResourceState::CopyDestination;
-            barrier_after_vertex_upload.new_state = ResourceState::VertexBuffer;
-            barrier_after_vertex_upload.source_queue = QueueType::Graphics;
-            barrier_after_vertex_upload.destination_queue = QueueType::Graphics;
-            barrier_after_vertex_upload.buffer_memory_barrier.offset = 0;
-            barrier_after_vertex_upload.buffer_memory_barrier.size = num_vertex_bytes_to_upload;
-            barriers_after_upload.push_back(barrier_after_vertex_upload);
-        }
-
-        if(should_upload_index_buffer) {
-            RhiResourceBarrier barrier_after_index_upload = {};
-            barrier_after_index_upload.resource_to_barrier = cur_index_buffer;
-            barrier_after_index_upload.access_before_barrier = ResourceAccess::MemoryWrite;
-            barrier_after_index_upload.access_after_barrier = ResourceAccess::IndexRead;
-            barrier_after_index_upload.old_state = ResourceState::CopyDestination;
-            barrier_after_index_upload.new_state = ResourceState::IndexBuffer;
-            barrier_after_index_upload.source_queue = QueueType::Graphics;
-            barrier_after_index_upload.destination_queue = QueueType::Graphics;
-            barrier_after_index_upload.buffer_memory_barrier.offset = 0;
-            barrier_after_index_upload.buffer_memory_barrier.size = num_index_bytes_to_upload;
-            barriers_after_upload.push_back(barrier_after_index_upload);
-        }
-
-        if(barriers_after_upload.is_empty()) {
+        const auto vertex_allocation = ring->write(vertex_data.data(), vertex_data.size(), PROCEDURAL_MESH_DATA_ALIGNMENT);
+        const auto index_allocation = ring->write(index_data.data(), index_data.size(), PROCEDURAL_MESH_DATA_ALIGNMENT);
+        if(!vertex_allocation || !index_allocation) {
+            logger->error("Could not write procedural mesh {} to the procedural geometry ring", name);
             return;
         }
 
-        cmds->resource_barriers(PipelineStage::Transfer, PipelineStage::VertexInput, barriers_after_upload);
+        auto* ring_buffer = ring->get_buffer();
+        buffers = {ring_buffer, ring_buffer, vertex_allocation->offset, index_allocation->offset};
     }
 
-    ProceduralMesh::Buffers ProceduralMesh::get_buffers_for_frame(const uint8_t frame_idx) const {
-        auto* vertex_buffer = vertex_buffers[frame_idx];
-        auto* index_buffer = index_buffers[frame_idx];
-
-        return {vertex_buffer, index_buffer};
-    }
+    ProceduralMesh::Buffers ProceduralMesh::get_buffers_for_frame(const uint8_t frame_idx) const { return buffers_per_frame[frame_idx]; }
 } // namespace nova::renderer
@@ -32,7 +32,7 @@ namespace nova::renderer {
                                                            MeshId mesh,
                                                            rhi::RenderDevice& device)
         : GlobalRenderpass(BACKBUFFER_OUTPUT_RENDER_PASS_NAME, std::move(pipeline), mesh, true) {
-        resource_binder = device.create_resource_binder_for_pipeline(*(this->pipeline), device.get_allocator());
+        resource_binder = device.create_resource_binder_for_pipeline(*(this->pipeline));
 
         resource_binder->bind_image("ui_output", ui_output);
         resource_binder->bind_image("scene_output", scene_output);
@@ -1,9 +1,124 @@
 #include "material_data_buffer.hpp"
 
-#include <rx/core/utility/move.h>
+#include <algorithm>
+
+#include <Tracy.hpp>
 
 namespace nova::renderer {
-    MaterialDataBuffer::MaterialDataBuffer(size_t num_bytes) : buffer(std::move(buffer)) {}
+    constexpr uint32_t PAGES_PER_WORD = 64;
+
+    size_t get_num_dirty_words(const size_t num_bytes) {
+        const auto num_pages = (num_bytes + MATERIAL_DIRTY_PAGE_SIZE - 1) / MATERIAL_DIRTY_PAGE_SIZE;
+        return (num_pages + PAGES_PER_WORD - 1) / PAGES_PER_WORD;
+    }
+
+    MaterialDataBuffer::MaterialDataBuffer(const size_t num_bytes, const uint32_t num_frames)
+        : buffer(num_bytes), dirty_pages_per_frame(num_frames, std::vector<uint64_t>(get_num_dirty_words(num_bytes))) {}
+
+    uint8_t* MaterialDataBuffer::data() { return buffer.data(); }
+
+    const uint8_t* MaterialDataBuffer::data() const { return buffer.data(); }
+
+    size_t MaterialDataBuffer::size() const { return buffer.size(); }
+
+    mem::FrameVector<MaterialDataRange> MaterialDataBuffer::get_dirty_ranges(const uint32_t frame_idx, mem::FrameArena* arena) const {
+        ZoneScoped;
+        mem::FrameVector<MaterialDataRange> ranges{arena};
+
+        const auto& dirty_pages = dirty_pages_per_frame[frame_idx];
+        const auto num_pages = (buffer.size() + MATERIAL_DIRTY_PAGE_SIZE - 1) / MATERIAL_DIRTY_PAGE_SIZE;
+
+        size_t page_idx = 0;
+        while(page_idx < num_pages) {
+            // Skip clean words quickly, since most of the buffer is clean most of the time
+            if(dirty_pages[page_idx / PAGES_PER_WORD] == 0) {
+                page_idx = (page_idx / PAGES_PER_WORD + 1) * PAGES_PER_WORD;
+                continue;
+            }
+
+            if((dirty_pages[page_idx / PAGES_PER_WORD] & (1ull << (page_idx % PAGES_PER_WORD))) == 0) {
+                page_idx++;
+                continue;
+            }
+
+            const auto first_dirty_page = page_idx;
+            while(page_idx < num_pages && (dirty_pages[page_idx / PAGES_PER_WORD] & (1ull << (page_idx % PAGES_PER_WORD))) != 0) {
+                page_idx++;
+            }
+
+            const auto offset = first_dirty_page * MATERIAL_DIRTY_PAGE_SIZE;
+            const auto end = std::min(page_idx * MATERIAL_DIRTY_PAGE_SIZE, buffer.size());
+            ranges.push_back({offset, end - offset});
+        }
+
+        return ranges;
+    }
+
+    void MaterialDataBuffer::clear_dirty_ranges(const uint32_t frame_idx) {
+        auto& dirty_pages = dirty_pages_per_frame[frame_idx];
+        std::fill(dirty_pages.begin(), dirty_pages.end(), 0);
+    }
+
+    void MaterialDataBuffer::mark_all_dirty(const uint32_t frame_idx) {
+        auto& dirty_pages = dirty_pages_per_frame[frame_idx];
+        std::fill(dirty_pages.begin(), dirty_pages.end(), ~0ull);
+    }
+
+    size_t MaterialDataBuffer::allocate_slot(const uint32_t slot_size) {
+        ZoneScoped;
+        if(auto free_slots = free_slots_by_size.find(slot_size); free_slots != free_slots_by_size.end() && !free_slots->second.empty()) {
+            const auto offset = free_slots->second.back();
+            free_slots->second.pop_back();
+
+            mark_dirty(offset, slot_size);
+            return offset;
+        }
+
+        auto& chunk = chunks_by_size[slot_size];
+        if(chunk.num_remaining_slots == 0) {
+            // Reserve a new chunk for this size class. The chunk must start at a multiple of the slot size, or the slot's index won't be
+            // an integer
+            const auto chunk_start = ((num_allocated_bytes + slot_size - 1) / slot_size) * slot_size;
+            const auto chunk_size = static_cast<size_t>(slot_size) * MATERIAL_SLOTS_PER_CHUNK;
+
+            num_allocated_bytes = chunk_start + chunk_size;
+            if(num_allocated_bytes > buffer.size()) {
+                grow(num_allocated_bytes);
+            }
+
+            chunk.next_offset = chunk_start;
+            chunk.num_remaining_slots = MATERIAL_SLOTS_PER_CHUNK;
+        }
+
+        const auto offset = chunk.next_offset;
+        chunk.next_offset += slot_size;
+        chunk.num_remaining_slots--;
+
+        mark_dirty(offset, slot_size);
+        return offset;
+    }
+
+    void MaterialDataBuffer::free_slot(const uint32_t slot_size, const size_t offset) { free_slots_by_size[slot_size].push_back(offset); }
+
+    void MaterialDataBuffer::mark_dirty(const size_t offset, const size_t num_bytes) {
+        const auto first_page = offset / MATERIAL_DIRTY_PAGE_SIZE;
+        const auto last_page = (offset + num_bytes - 1) / MATERIAL_DIRTY_PAGE_SIZE;
+
+        for(auto& dirty_pages : dirty_pages_per_frame) {
+            for(auto page = first_page; page <= last_page; page++) {
+                dirty_pages[page / PAGES_PER_WORD] |= 1ull << (page % PAGES_PER_WORD);
+            }
+        }
+    }
+
+    void MaterialDataBuffer::grow(const size_t min_size) {
+        ZoneScoped;
+        const auto new_size = std::max(buffer.size() * 2, min_size);
+        buffer.resize(new_size);
 
-    uint8_t* MaterialDataBuffer::data() const { return buffer.data; }
+        const auto num_words = get_num_dirty_words(new_size);
+        for(auto& dirty_pages : dirty_pages_per_frame) {
+            dirty_pages.resize(num_words);
+        }
+    }
 } // namespace nova::renderer
@@ -1,17 +1,50 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <unordered_map>
 #include <vector>
 
+#include "nova_renderer/util/frame_arena.hpp"
+
 namespace nova::renderer {
+    /*!
+     * \brief Granularity of the material buffer's dirty tracking, in bytes
+     */
+    constexpr uint32_t MATERIAL_DIRTY_PAGE_SIZE = 256;
+
+    /*!
+     * \brief How many slots of a given size class the material buffer reserves at once
+     */
+    constexpr uint32_t MATERIAL_SLOTS_PER_CHUNK = 64;
+
+    /*!
+     * \brief A range of bytes in the material buffer
+     */
+    struct MaterialDataRange {
+        size_t offset = 0;
+        size_t size = 0;
+    };
+
     /*!
      * \brief Array that can hold data of multiple types of multiple sizes
      *
-     * This array uses a linear allocator internally
+     * Each material struct size gets its own size class, with its own free list. Size classes reserve space in chunks of
+     * MATERIAL_SLOTS_PER_CHUNK slots, so we only waste space for alignment once per chunk instead of once per material
+     *
+     * The buffer keeps track of which bytes have changed since each frame's device buffer was last updated, so Nova only has to upload the
+     * materials that actually changed
+     *
+     * The buffer grows when it runs out of space. This invalidates any pointers to materials in the buffer, so don't hold on to them -
+     * hold on to the material's index
      */
     class MaterialDataBuffer {
     public:
-        explicit MaterialDataBuffer(size_t num_bytes);
+        /*!
+         * \param num_bytes Initial size of the buffer
+         * \param num_frames Number of frames in flight, aka the number of device buffers that this buffer tracks dirty ranges for
+         */
+        MaterialDataBuffer(size_t num_bytes, uint32_t num_frames);
 
         MaterialDataBuffer(const MaterialDataBuffer& other) = delete;
         MaterialDataBuffer& operator=(const MaterialDataBuffer& other) = delete;
@@ -26,6 +59,8 @@ namespace nova::renderer {
          *
          * This operator performs no checks that the requested element is of the requested type. I recommend that you only use indices you
          * get from `get_next_free_index` with the same type as what you're requesting
+         *
+         * Since you get a mutable reference, this method marks the element as dirty
          */
         template <typename MaterialDataStruct>
         [[nodiscard]] MaterialDataStruct& at(uint32_t idx);
@@ -39,50 +74,124 @@ namespace nova::renderer {
         template <typename MaterialDataStruct>
         [[nodiscard]] const MaterialDataStruct& at(uint32_t idx) const;
 
+        /*!
+         * \brief Copies data into an element of this array, and marks the element as dirty
+         *
+         * Prefer this to `at` when you're replacing a whole element, since it doesn't leave a reference lying around that could dangle
+         * when the buffer grows
+         */
+        template <typename MaterialDataStruct>
+        void write(uint32_t idx, const MaterialDataStruct& data);
+
         /*!
          * \brief Gets the index of the next free element of the requested type
+         *
+         * The index is in units of the requested type, so shaders can use it to index into an array of that type
          */
         template <typename MaterialDataStruct>
         [[nodiscard]] uint32_t get_next_free_index();
 
-        [[nodiscard]] uint8_t* data() const;
+        /*!
+         * \brief Returns an element to the buffer, so that a later call to `get_next_free_index` with a type of the same size may reuse it
+         */
+        template <typename MaterialDataStruct>
+        void free_index(uint32_t idx);
+
+        [[nodiscard]] uint8_t* data();
+
+        [[nodiscard]] const uint8_t* data() const;
+
+        /*!
+         * \brief Current size of the buffer, in bytes. Device buffers must be at least this large
+         */
+        [[nodiscard]] size_t size() const;
+
+        /*!
+         * \brief Gets all the ranges of the buffer that changed since the last time `clear_dirty_ranges` was called for the given frame
+         *
+         * Adjacent dirty pages are merged into a single range
+         *
+         * \param frame_idx The frame to get the dirty ranges of
+         * \param arena Arena to allocate the ranges from. May be nullptr
+         */
+        [[nodiscard]] mem::FrameVector<MaterialDataRange> get_dirty_ranges(uint32_t frame_idx, mem::FrameArena* arena) const;
+
+        /*!
+         * \brief Lets the buffer know that the given frame's device buffer is up-to-date
+         */
+        void clear_dirty_ranges(uint32_t frame_idx);
+
+        /*!
+         * \brief Marks the whole buffer as dirty for the given frame, e.g. because that frame's device buffer was recreated
+         */
+        void mark_all_dirty(uint32_t frame_idx);
 
     private:
+        /*!
+         * \brief The chunk that a size class is currently handing out slots from
+         */
+        struct SizeClassChunk {
+            size_t next_offset = 0;
+            uint32_t num_remaining_slots = 0;
+        };
+
         std::vector<uint8_t> buffer;
 
-        uint32_t num_allocated_bytes = 0;
+        size_t num_allocated_bytes = 0;
+
+        /*!
+         * \brief Byte offsets of freed slots, by slot size
+         */
+        std::unordered_map<uint32_t, std::vector<size_t>> free_slots_by_size;
+
+        std::unordered_map<uint32_t, SizeClassChunk> chunks_by_size;
+
+        /*!
+         * \brief One bit per MATERIAL_DIRTY_PAGE_SIZE bytes of the buffer, for each frame in flight
+         */
+        std::vector<std::vector<uint64_t>> dirty_pages_per_frame;
+
+        [[nodiscard]] size_t allocate_slot(uint32_t slot_size);
+
+        void free_slot(uint32_t slot_size, size_t offset);
+
+        void mark_dirty(size_t offset, size_t num_bytes);
+
+        void grow(size_t min_size);
     };
-    
+
     template <typename MaterialDataStruct>
-    MaterialDataStruct& MaterialDataBuffer::at(uint32_t idx) {
-        return reinterpret_cast<MaterialDataStruct*>(buffer.data)[idx];
+    MaterialDataStruct& MaterialDataBuffer::at(const uint32_t idx) {
+        mark_dirty(static_cast<size_t>(idx) * sizeof(MaterialDataStruct), sizeof(MaterialDataStruct));
+        return reinterpret_cast<MaterialDataStruct*>(buffer.data())[idx];
     }
 
     template <typename MaterialDataStruct>
-    const MaterialDataStruct& MaterialDataBuffer::at(uint32_t idx) const {
-        return reinterpret_cast<MaterialDataStruct*>(buffer.data)[idx];
+    const MaterialDataStruct& MaterialDataBuffer::at(const uint32_t idx) const {
+        return reinterpret_cast<const MaterialDataStruct*>(buffer.data())[idx];
+    }
+
+    template <typename MaterialDataStruct>
+    void MaterialDataBuffer::write(const uint32_t idx, const MaterialDataStruct& data) {
+        at<MaterialDataStruct>(idx) = data;
     }
 
     template <typename MaterialDataStruct>
     uint32_t MaterialDataBuffer::get_next_free_index() {
         constexpr uint32_t struct_size = sizeof(MaterialDataStruct);
 
-        // Here's a Al Gore rhythm for your soul
-
-        // This class is a party. The idea is that it's an array of any type you want. You reinterpret the buffer pointer to the type you
-        // want at runtime
-        //
-        // So like if you want to store five floats, one float3, and a float4x4 all in the same buffer... you can do that, and they each get
-        // an index. They get an index as if the buffer was an array of their type? So when we find a place to put them in the buffer - aka
-        // in this method - we have to align the number of already-allocated bytes to the size of the struct of the new material, rounding
-        // up. This means that we end up with a lot of empty bytes here any there. Ideally we can find a way to force alignment on material
-        // structs and avoid wasting _too_ much data, but who knows
+        // The buffer is an array of any type you want. You reinterpret the buffer pointer to the type you want at runtime, and each
+        // material's index is its index as if the whole buffer was an array of its type. allocate_slot makes sure that every slot's offset
+        // is a multiple of its size, so the division is exact
+        const auto offset = allocate_slot(struct_size);
 
-        // Intentionally using integer division
-        const auto new_idx = (num_allocated_bytes / struct_size) + 1;
+        return static_cast<uint32_t>(offset / struct_size);
+    }
 
-        num_allocated_bytes = struct_size * new_idx;
+    template <typename MaterialDataStruct>
+    void MaterialDataBuffer::free_index(const uint32_t idx) {
+        constexpr uint32_t struct_size = sizeof(MaterialDataStruct);
 
-        return new_idx;
+        free_slot(struct_size, static_cast<size_t>(idx) * struct_size);
     }
 } // namespace nova::renderer
@@ -0,0 +1,134 @@
+#include "memory_budget_tracker.hpp"
+
+#include <algorithm>
+#include <span>
+
+#include <Tracy.hpp>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+#include "nova_renderer/nova_renderer.hpp"
+#include "nova_renderer/resource_loader.hpp"
+#include "nova_renderer/rhi/render_device.hpp"
+
+#include "texture_streamer.hpp"
+
+namespace nova::renderer {
+    static auto logger = spdlog::stdout_color_mt("MemoryBudgetTracker");
+
+    constexpr size_t BYTES_PER_MB = 1024 * 1024;
+
+    const char* to_string(const MemoryPressure pressure) {
+        switch(pressure) {
+            case MemoryPressure::Normal:
+                return "Normal";
+
+            case MemoryPressure::Elevated:
+                return "Elevated";
+
+            case MemoryPressure::Critical:
+                return "Critical";
+
+            default:
+                return "Unknown";
+        }
+    }
+
+    MemoryBudgetTracker::MemoryBudgetTracker(NovaRenderer& renderer, const NovaSettings::MemoryBudgetOptions& options)
+        : device{renderer.get_device()},
+          device_resources{renderer.get_resource_manager()},
+          texture_streamer{renderer.get_texture_streamer()},
+          options{options},
+          full_texture_budget{texture_streamer.get_vram_budget()} {}
+
+    void MemoryBudgetTracker::update(const uint64_t frame_count) {
+        ZoneScoped;
+        stats = device.get_memory_stats();
+
+        device_local_usage_ratio = 0;
+        for(const auto& heap : std::span{stats.heaps}.first(stats.num_heaps)) {
+            if(heap.is_device_local && heap.budget.b_count() > 0) {
+                const auto ratio = static_cast<float>(heap.usage.b_count()) / static_cast<float>(heap.budget.b_count());
+                device_local_usage_ratio = std::max(device_local_usage_ratio, ratio);
+            }
+        }
+
+        TracyPlot("VRAM usage ratio", device_local_usage_ratio);
+
+        const auto new_pressure = calculate_pressure();
+        const auto did_pressure_change = new_pressure != pressure;
+        if(did_pressure_change) {
+            logger->info("Memory pressure went from {} to {} on frame {} ({:.0f}% of the VRAM budget used)",
+                         to_string(pressure),
+                         to_string(new_pressure),
+                         frame_count,
+                         device_local_usage_ratio * 100.0f);
+
+            if(new_pressure != MemoryPressure::Normal) {
+                for(size_t category = 0; category < rhi::NUM_MEMORY_CATEGORIES; category++) {
+                    logger->info("{}: {} MB",
+                                 rhi::to_string(static_cast<rhi::MemoryCategory>(category)),
+                                 stats.usage_per_category[category] / BYTES_PER_MB);
+                }
+            }
+
+            pressure = new_pressure;
+        }
+
+        switch(pressure) {
+            case MemoryPressure::Normal: {
+                texture_streamer.set_vram_budget(full_texture_budget);
+            } break;
+
+            case MemoryPressure::Elevated: {
+                // The measured usage only falls once the streamer has dropped mips down to its budget and the frames that used them have
+                // retired. If we shrank the budget every frame, it would collapse long before the usage caught up, so we shrink once when
+                // pressure goes up and then wait for things to settle before shrinking again
+                const auto has_settled = texture_streamer.get_resident_size() <= texture_streamer.get_vram_budget() &&
+                                         frame_count >= last_budget_shrink_frame + options.frames_between_budget_shrinks;
+                if(did_pressure_change || has_settled) {
+                    // Shrink relative to what's actually resident, so the streamer drops mips right away instead of just lowering a
+                    // budget that it isn't using anyways
+                    const auto cur_budget = std::min(texture_streamer.get_vram_budget(), texture_streamer.get_resident_size());
+                    const auto shrunk_budget = static_cast<size_t>(static_cast<float>(cur_budget) *
+                                                                   (1.0f - options.texture_budget_shrink_rate));
+                    texture_streamer.set_vram_budget(shrunk_budget);
+                    last_budget_shrink_frame = frame_count;
+
+                    device_resources.release_staging_buffers();
+                }
+            } break;
+
+            case MemoryPressure::Critical: {
+                // The streamer never drops the smallest mips, so this leaves every texture with something to sample
+                texture_streamer.set_vram_budget(0);
+
+                device_resources.release_staging_buffers();
+            } break;
+        }
+    }
+
+    const rhi::RhiMemoryStats& MemoryBudgetTracker::get_stats() const { return stats; }
+
+    MemoryPressure MemoryBudgetTracker::get_pressure() const { return pressure; }
+
+    float MemoryBudgetTracker::get_device_local_usage_ratio() const { return device_local_usage_ratio; }
+
+    MemoryPressure MemoryBudgetTracker::calculate_pressure() const {
+        if(device_local_usage_ratio >= options.critical_pressure) {
+            return MemoryPressure::Critical;
+        }
+
+        if(device_local_usage_ratio >= options.elevated_pressure) {
+            return MemoryPressure::Elevated;
+        }
+
+        // Stay where we are until pressure falls well below the elevated threshold, so that giving memory back doesn't immediately let
+        // textures take it again
+        if(pressure != MemoryPressure::Normal && device_local_usage_ratio >= options.relieved_pressure) {
+            return MemoryPressure::Elevated;
+        }
+
+        return MemoryPressure::Normal;
+    }
+} // namespace nova::renderer
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+
+#include "nova_renderer/nova_settings.hpp"
+#include "nova_renderer/rhi/rhi_types.hpp"
+
+namespace nova::renderer {
+    class NovaRenderer;
+    class DeviceResources;
+    class TextureStreamer;
+
+    namespace rhi {
+        class RenderDevice;
+    }
+
+    enum class MemoryPressure {
+        /*!
+         * \brief Plenty of VRAM left
+         */
+        Normal,
+
+        /*!
+         * \brief VRAM is getting tight, so we're slowly giving some back
+         */
+        Elevated,
+
+        /*!
+         * \brief We're about to run out of VRAM, so we're giving back everything we can
+         */
+        Critical,
+    };
+
+    [[nodiscard]] const char* to_string(MemoryPressure pressure);
+
+    /*!
+     * \brief Watches how much GPU memory Nova uses, and gives memory back before allocations start failing
+     *
+     * Every frame we ask the device for its heap budgets. When the device has VK_EXT_memory_budget, they account for every other program
+     * that's using the GPU, otherwise they only count our own allocations. When the fullest device-local heap gets close to its budget,
+     * we shrink the texture streamer's budget a bit so textures drop their finest mips, and release the staging buffers that
+     * `DeviceResources` keeps around. While pressure stays elevated we shrink the budget again every so often, but only once the streamer
+     * has gotten down to the last budget and the GPU has let go of the dropped mips. If we get really close, we drop streamed textures to
+     * their smallest mips all at once. Once pressure falls, textures get their full budget back
+     *
+     * Texture allocations are made within the heap budget, so they fail rather than push us over it. Textures are the only thing we can
+     * shrink on the fly, so they're the only thing that gives way
+     */
+    class MemoryBudgetTracker {
+    public:
+        MemoryBudgetTracker(NovaRenderer& renderer, const NovaSettings::MemoryBudgetOptions& options);
+
+        /*!
+         * \brief Reads the latest memory stats and reacts to memory pressure
+         *
+         * Call this once a frame from the render thread, after `RenderDevice::begin_frame` and before `TextureStreamer::update`
+         */
+        void update(uint64_t frame_count);
+
+        /*!
+         * \brief Memory stats as of the last `update`
+         */
+        [[nodiscard]] const rhi::RhiMemoryStats& get_stats() const;
+
+        [[nodiscard]] MemoryPressure get_pressure() const;
+
+        /*!
+         * \brief Usage of the fullest device-local heap, as a fraction of its budget. May be greater than 1
+         */
+        [[nodiscard]] float get_device_local_usage_ratio() const;
+
+    private:
+        rhi::RenderDevice& device;
+
+        DeviceResources& device_resources;
+
+        TextureStreamer& texture_streamer;
+
+        NovaSettings::MemoryBudgetOptions options;
+
+        /*!
+         * \brief The texture streamer's budget from the settings, which we go back to when there's no pressure
+         */
+        size_t full_texture_budget;
+
+        rhi::RhiMemoryStats stats;
+
+        MemoryPressure pressure = MemoryPressure::Normal;
+
+        /*!
+         * \brief The frame when we last shrank the texture budget because of elevated pressure
+         */
+        uint64_t last_budget_shrink_frame = 0;
+
+        float device_local_usage_ratio = 0;
+
+        [[nodiscard]] MemoryPressure calculate_pressure() const;
+    };
+} // namespace nova::renderer
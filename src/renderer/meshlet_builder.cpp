@@ -0,0 +1,199 @@
+#include "meshlet_builder.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+#include <Tracy.hpp>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+namespace nova::renderer {
+    static auto logger = spdlog::stdout_color_mt("MeshletBuilder");
+
+    constexpr uint32_t INVALID_LOCAL_INDEX = std::numeric_limits<uint32_t>::max();
+
+    /*!
+     * \brief If a meshlet's triangles are spread over more than this (cosine of the) angle from the average normal, the normal cone is
+     * so wide that it would basically never cull anything, so we don't bother
+     */
+    constexpr float MIN_CONE_DOT = 0.1f;
+
+    glm::vec3 get_triangle_normal(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2) {
+        const auto normal = glm::cross(p1 - p0, p2 - p0);
+        const auto length = glm::length(normal);
+        if(length == 0) {
+            return {};
+        }
+
+        return normal / length;
+    }
+
+    void calculate_meshlet_bounds(Meshlet& meshlet, const MeshletData& data, const FullVertex* vertices) {
+        // Bounding sphere. Centered on the AABB so that the result only depends on the set of vertices and not on their order
+        glm::vec3 min_pos{std::numeric_limits<float>::max()};
+        glm::vec3 max_pos{std::numeric_limits<float>::lowest()};
+        for(uint32_t i = 0; i < meshlet.vertex_count; i++) {
+            const auto& position = vertices[data.vertex_indices[meshlet.vertex_offset + i]].position;
+            min_pos = glm::min(min_pos, position);
+            max_pos = glm::max(max_pos, position);
+        }
+
+        const auto center = (min_pos + max_pos) * 0.5f;
+        float radius = 0;
+        for(uint32_t i = 0; i < meshlet.vertex_count; i++) {
+            const auto& position = vertices[data.vertex_indices[meshlet.vertex_offset + i]].position;
+            radius = std::max(radius, glm::length(position - center));
+        }
+
+        meshlet.bounding_sphere = glm::vec4{center, radius};
+
+        // Normal cone. The axis is the average of all the triangle normals, and the cone has to be wide enough to contain every one of them
+        const auto get_position = [&](const uint32_t packed_triangle, const uint32_t corner) {
+            const auto local_idx = (packed_triangle >> (corner * 8)) & 0xFF;
+            return vertices[data.vertex_indices[meshlet.vertex_offset + local_idx]].position;
+        };
+
+        glm::vec3 normal_sum{};
+        for(uint32_t i = 0; i < meshlet.primitive_count; i++) {
+            const auto triangle = data.primitives[meshlet.primitive_offset + i];
+            normal_sum += get_triangle_normal(get_position(triangle, 0), get_position(triangle, 1), get_position(triangle, 2));
+        }
+
+        meshlet.cone_apex = glm::vec4{center, 0};
+        meshlet.cone_axis_cutoff = glm::vec4{0, 0, 0, 1};
+
+        const auto normal_sum_length = glm::length(normal_sum);
+        if(normal_sum_length == 0) {
+            return;
+        }
+
+        const auto axis = normal_sum / normal_sum_length;
+
+        float min_dot = 1;
+        for(uint32_t i = 0; i < meshlet.primitive_count; i++) {
+            const auto triangle = data.primitives[meshlet.primitive_offset + i];
+            const auto normal = get_triangle_normal(get_position(triangle, 0), get_position(triangle, 1), get_position(triangle, 2));
+            if(normal != glm::vec3{}) {
+                min_dot = std::min(min_dot, glm::dot(axis, normal));
+            }
+        }
+
+        if(min_dot <= MIN_CONE_DOT) {
+            // Cone is too wide to be useful. Leave the cutoff at 1 so the meshlet is never cone culled
+            meshlet.cone_axis_cutoff = glm::vec4{axis, 1};
+            return;
+        }
+
+        // Slide the apex back along the axis until every triangle's plane is in front of it, so the cone test is conservative
+        float max_t = 0;
+        for(uint32_t i = 0; i < meshlet.primitive_count; i++) {
+            const auto triangle = data.primitives[meshlet.primitive_offset + i];
+            const auto p0 = get_position(triangle, 0);
+            const auto normal = get_triangle_normal(p0, get_position(triangle, 1), get_position(triangle, 2));
+            const auto dn = glm::dot(axis, normal);
+            if(dn > 0) {
+                max_t = std::max(max_t, glm::dot(center - p0, normal) / dn);
+            }
+        }
+
+        meshlet.cone_apex = glm::vec4{center - axis * max_t, 0};
+        meshlet.cone_axis_cutoff = glm::vec4{axis, std::sqrt(1 - min_dot * min_dot)};
+    }
+
+    MeshletData build_meshlets(const MeshData& mesh_data, const uint32_t max_vertices, const uint32_t max_primitives) {
+        ZoneScoped;
+        MeshletData data;
+
+        if(max_vertices < 3 || max_vertices > MAX_MESHLET_LOCAL_INDICES || max_primitives == 0 ||
+           max_primitives > MAX_MESHLET_LOCAL_INDICES) {
+            logger->error("Invalid meshlet limits: {} vertices and {} primitives. Vertices must be in [3, {}], primitives in [1, {}]",
+                          max_vertices,
+                          max_primitives,
+                          MAX_MESHLET_LOCAL_INDICES,
+                          MAX_MESHLET_LOCAL_INDICES);
+            return data;
+        }
+
+        const auto* vertices = static_cast<const FullVertex*>(mesh_data.vertex_data_ptr);
+        const auto num_vertices = static_cast<uint32_t>(mesh_data.vertex_data_size / sizeof(FullVertex));
+
+        const auto* indices = static_cast<const uint32_t*>(mesh_data.index_data_ptr);
+        const auto num_triangles = static_cast<uint32_t>(mesh_data.index_data_size / sizeof(uint32_t)) / 3;
+
+        if(vertices == nullptr || indices == nullptr || num_triangles == 0) {
+            return data;
+        }
+
+        // Worst case is one meshlet every max_primitives triangles, and 3 unique vertices per triangle
+        data.meshlets.reserve(num_triangles / max_primitives + 1);
+        data.vertex_indices.reserve(static_cast<size_t>(num_triangles) * 3);
+        data.primitives.reserve(num_triangles);
+
+        // Meshlet-local index of every vertex in the mesh, or INVALID_LOCAL_INDEX if the vertex isn't in the current meshlet
+        std::vector<uint32_t> local_indices(num_vertices, INVALID_LOCAL_INDEX);
+
+        Meshlet cur_meshlet{};
+
+        const auto finish_meshlet = [&] {
+            if(cur_meshlet.primitive_count == 0) {
+                return;
+            }
+
+            calculate_meshlet_bounds(cur_meshlet, data, vertices);
+
+            // Only reset the vertices we touched, so building meshlets stays linear in the number of triangles
+            for(uint32_t i = 0; i < cur_meshlet.vertex_count; i++) {
+                local_indices[data.vertex_indices[cur_meshlet.vertex_offset + i]] = INVALID_LOCAL_INDEX;
+            }
+
+            data.meshlets.push_back(cur_meshlet);
+
+            cur_meshlet = {};
+            cur_meshlet.vertex_offset = static_cast<uint32_t>(data.vertex_indices.size());
+            cur_meshlet.primitive_offset = static_cast<uint32_t>(data.primitives.size());
+        };
+
+        for(uint32_t triangle_idx = 0; triangle_idx < num_triangles; triangle_idx++) {
+            const std::array<uint32_t, 3> triangle{indices[triangle_idx * 3], indices[triangle_idx * 3 + 1], indices[triangle_idx * 3 + 2]};
+
+            if(triangle[0] >= num_vertices || triangle[1] >= num_vertices || triangle[2] >= num_vertices) {
+                logger->error("Triangle {} references a vertex past the end of the vertex buffer, skipping it", triangle_idx);
+                continue;
+            }
+
+            uint32_t num_new_vertices = 0;
+            for(uint32_t corner = 0; corner < 3; corner++) {
+                const auto is_duplicate_corner = std::find(triangle.begin(), triangle.begin() + corner, triangle[corner]) !=
+                                                 triangle.begin() + corner;
+                if(local_indices[triangle[corner]] == INVALID_LOCAL_INDEX && !is_duplicate_corner) {
+                    num_new_vertices++;
+                }
+            }
+
+            if(cur_meshlet.vertex_count + num_new_vertices > max_vertices || cur_meshlet.primitive_count + 1 > max_primitives) {
+                finish_meshlet();
+            }
+
+            uint32_t packed_triangle = 0;
+            for(uint32_t corner = 0; corner < 3; corner++) {
+                auto& local_idx = local_indices[triangle[corner]];
+                if(local_idx == INVALID_LOCAL_INDEX) {
+                    local_idx = cur_meshlet.vertex_count;
+                    data.vertex_indices.push_back(triangle[corner]);
+                    cur_meshlet.vertex_count++;
+                }
+
+                packed_triangle |= local_idx << (corner * 8);
+            }
+
+            data.primitives.push_back(packed_triangle);
+            cur_meshlet.primitive_count++;
+        }
+
+        finish_meshlet();
+
+        return data;
+    }
+} // namespace nova::renderer
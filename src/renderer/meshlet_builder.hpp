@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "nova_renderer/renderables.hpp"
+
+namespace nova::renderer {
+    /*!
+     * \brief Maximum number of unique vertices in a single meshlet
+     *
+     * 64 vertices and 124 primitives is what Nvidia recommends for Turing. 124 instead of 126 so that the primitive indices for a full
+     * meshlet fit nicely into 4-byte chunks
+     */
+    constexpr uint32_t MAX_MESHLET_VERTICES = 64;
+
+    /*!
+     * \brief Maximum number of triangles in a single meshlet
+     */
+    constexpr uint32_t MAX_MESHLET_PRIMITIVES = 124;
+
+    /*!
+     * \brief Largest vertex or primitive limit that `build_meshlets` accepts
+     *
+     * Meshlet-local vertex indices are packed into one byte each, so a meshlet can't reference more than 256 vertices. Primitives are held
+     * to the same width so that a meshlet-local triangle index fits in a byte as well, which is also the smallest maximum output primitive
+     * count that mesh shader implementations must support
+     */
+    constexpr uint32_t MAX_MESHLET_LOCAL_INDICES = 256;
+
+    /*!
+     * \brief Number of meshlets that a single task shader workgroup looks at
+     *
+     * Task shaders that Nova expects renderpacks to use have a workgroup size of 32, with one thread per meshlet
+     */
+    constexpr uint32_t MESHLETS_PER_TASK_WORKGROUP = 32;
+
+    /*!
+     * \brief A small cluster of a mesh's triangles
+     *
+     * This struct is laid out to match the `Meshlet` struct in `nova/meshlets.hlsl`, so don't rearrange the members unless you also change
+     * the shader side
+     */
+    struct Meshlet {
+        /*!
+         * \brief Index of this meshlet's first vertex index in the mesh's meshlet vertex buffer
+         */
+        uint32_t vertex_offset = 0;
+
+        /*!
+         * \brief Number of unique vertices that this meshlet uses
+         */
+        uint32_t vertex_count = 0;
+
+        /*!
+         * \brief Index of this meshlet's first triangle in the mesh's meshlet primitive buffer
+         */
+        uint32_t primitive_offset = 0;
+
+        /*!
+         * \brief Number of triangles in this meshlet
+         */
+        uint32_t primitive_count = 0;
+
+        /*!
+         * \brief Bounding sphere of the meshlet, in model space. xyz is the center and w is the radius
+         */
+        glm::vec4 bounding_sphere{};
+
+        /*!
+         * \brief Apex of the meshlet's normal cone, in model space. w is unused
+         */
+        glm::vec4 cone_apex{};
+
+        /*!
+         * \brief Axis of the meshlet's normal cone in xyz, and the cone's cutoff in w
+         *
+         * A meshlet is entirely backfacing when `dot(normalize(cone_apex - camera_position), axis) >= cutoff`. Meshlets which can't be
+         * culled this way, e.g. because they have triangles facing in opposite directions, have a cutoff of 1 so that the test always fails
+         */
+        glm::vec4 cone_axis_cutoff{0, 0, 0, 1};
+    };
+
+    static_assert(sizeof(Meshlet) % 16 == 0, "Meshlet struct is not aligned to 16 bytes!");
+
+    /*!
+     * \brief All the meshlets for a single mesh, ready to be uploaded to the GPU
+     */
+    struct MeshletData {
+        std::vector<Meshlet> meshlets;
+
+        /*!
+         * \brief Indices into the mesh's vertex buffer. Each meshlet references a contiguous range of this array
+         */
+        std::vector<uint32_t> vertex_indices;
+
+        /*!
+         * \brief Triangles of all the meshlets
+         *
+         * Each triangle is packed into a single uint32_t, with one byte for each of the triangle's three meshlet-local vertex indices. The
+         * highest byte is unused
+         */
+        std::vector<uint32_t> primitives;
+    };
+
+    /*!
+     * \brief Splits a mesh into meshlets
+     *
+     * The mesh must use `FullVertex` and 32-bit indices, like everything else in Nova does. Triangles are added to meshlets greedily, in
+     * the order they appear in the index buffer. Meshes with a good vertex cache order will therefore get meshlets with good spatial
+     * locality
+     *
+     * This function is deterministic: the same mesh data will always produce the same meshlets, byte for byte
+     *
+     * \param mesh_data The mesh to build meshlets for
+     * \param max_vertices Maximum number of unique vertices in a meshlet. Must be in [3, MAX_MESHLET_LOCAL_INDICES], so that a meshlet can
+     * hold at least one triangle
+     * \param max_primitives Maximum number of triangles in a meshlet. Must be in [1, MAX_MESHLET_LOCAL_INDICES]
+     *
+     * \return The meshlets for the mesh. Will be empty if the mesh has no triangles or if the limits are invalid
+     */
+    [[nodiscard]] MeshletData build_meshlets(const MeshData& mesh_data,
+                                             uint32_t max_vertices = MAX_MESHLET_VERTICES,
+                                             uint32_t max_primitives = MAX_MESHLET_PRIMITIVES);
+} // namespace nova::renderer
@@ -1,7 +1,10 @@
 #include "pipeline_reflection.hpp"
 
+#include <algorithm>
+
 #include <rx/core/log.h>
-#include <spirv_cross.hpp>
+
+#include "shader_reflection.hpp"
 
 namespace nova::renderer {
     using namespace rhi;
@@ -19,60 +22,127 @@ namespace nova::renderer {
         if(pipeline_state.pixel_shader) {
             get_shader_module_descriptors(pipeline_state.pixel_shader->source, ShaderStage::Pixel, bindings);
         }
+        if(pipeline_state.task_shader) {
+            get_shader_module_descriptors(pipeline_state.task_shader->source, ShaderStage::Task, bindings);
+        }
+        if(pipeline_state.mesh_shader) {
+            get_shader_module_descriptors(pipeline_state.mesh_shader->source, ShaderStage::Mesh, bindings);
+        }
 
         return bindings;
     }
 
-    void get_shader_module_descriptors(const std::vector<uint32_t>& spirv,
-                                       const ShaderStage shader_stage,
-                                       std::unordered_map<std::string, RhiResourceBindingDescription>& bindings) {
-        const spirv_cross::Compiler shader_compiler{spirv.data(), spirv.size()};
-        const spirv_cross::ShaderResources& resources = shader_compiler.get_shader_resources();
+    std::vector<PipelinePushConstantRange> get_push_constant_ranges(const RhiGraphicsPipelineState& pipeline_state) {
+        std::vector<PipelinePushConstantRange> ranges;
+
+        const auto add_shader_range = [&](const std::vector<uint32_t>& spirv, const ShaderStage shader_stage) {
+            const auto& reflection = get_shader_reflection_database().get_reflection(spirv);
+            if(!reflection.push_constants || reflection.push_constants->size == 0) {
+                return;
+            }
+
+            // Vulkan wants push constant offsets and sizes to be multiples of four
+            const auto begin = reflection.push_constants->offset & ~3u;
+            const auto end = (reflection.push_constants->offset + reflection.push_constants->size + 3u) & ~3u;
 
-        for(const auto& resource : resources.separate_images) {
-            add_resource_to_bindings(bindings, shader_stage, shader_compiler, resource, DescriptorType::Texture);
+            const auto itr = std::find_if(ranges.begin(), ranges.end(), [&](const PipelinePushConstantRange& range) {
+                return range.offset == begin && range.size == end - begin;
+            });
+            if(itr != ranges.end()) {
+                itr->stages |= static_cast<uint32_t>(shader_stage);
+
+            } else {
+                ranges.push_back({begin, end - begin, static_cast<uint32_t>(shader_stage)});
+            }
+        };
+
+        add_shader_range(pipeline_state.vertex_shader.source, ShaderStage::Vertex);
+
+        if(pipeline_state.geometry_shader) {
+            add_shader_range(pipeline_state.geometry_shader->source, ShaderStage::Geometry);
+        }
+        if(pipeline_state.pixel_shader) {
+            add_shader_range(pipeline_state.pixel_shader->source, ShaderStage::Pixel);
+        }
+        if(pipeline_state.task_shader) {
+            add_shader_range(pipeline_state.task_shader->source, ShaderStage::Task);
         }
+        if(pipeline_state.mesh_shader) {
+            add_shader_range(pipeline_state.mesh_shader->source, ShaderStage::Mesh);
+        }
+
+        std::sort(ranges.begin(), ranges.end(), [](const PipelinePushConstantRange& lhs, const PipelinePushConstantRange& rhs) {
+            return lhs.offset < rhs.offset || (lhs.offset == rhs.offset && lhs.size < rhs.size);
+        });
 
-        for(const auto& resource : resources.separate_samplers) {
-            add_resource_to_bindings(bindings, shader_stage, shader_compiler, resource, DescriptorType::Sampler);
+        return ranges;
+    }
+
+    std::vector<PipelinePushConstantRange> get_push_constant_intervals(const std::vector<PipelinePushConstantRange>& ranges) {
+        // Every range starts and ends on one of these, so the stages can only change at them
+        std::vector<uint32_t> boundaries;
+        boundaries.reserve(ranges.size() * 2);
+        for(const auto& range : ranges) {
+            boundaries.push_back(range.offset);
+            boundaries.push_back(range.offset + range.size);
         }
+        std::sort(boundaries.begin(), boundaries.end());
+        boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
+
+        std::vector<PipelinePushConstantRange> intervals;
+        for(size_t i = 0; i + 1 < boundaries.size(); i++) {
+            const auto begin = boundaries[i];
+            const auto end = boundaries[i + 1];
+
+            uint32_t stages = 0;
+            for(const auto& range : ranges) {
+                if(range.offset <= begin && range.offset + range.size >= end) {
+                    stages |= range.stages;
+                }
+            }
 
-        for(const auto& resource : resources.uniform_buffers) {
-            add_resource_to_bindings(bindings, shader_stage, shader_compiler, resource, DescriptorType::UniformBuffer);
+            if(stages == 0) {
+                // No range covers this gap
+                continue;
+            }
+
+            if(!intervals.empty() && intervals.back().stages == stages && intervals.back().offset + intervals.back().size == begin) {
+                intervals.back().size += end - begin;
+
+            } else {
+                intervals.push_back({begin, end - begin, stages});
+            }
         }
 
-        for(const auto& resource : resources.storage_buffers) {
-            add_resource_to_bindings(bindings, shader_stage, shader_compiler, resource, DescriptorType::StorageBuffer);
+        return intervals;
+    }
+
+    void get_shader_module_descriptors(const std::vector<uint32_t>& spirv,
+                                       const ShaderStage shader_stage,
+                                       std::unordered_map<std::string, RhiResourceBindingDescription>& bindings) {
+        const auto& reflection = get_shader_reflection_database().get_reflection(spirv);
+
+        for(const auto& binding : reflection.bindings) {
+            add_resource_to_bindings(bindings, shader_stage, binding);
         }
     }
 
     void add_resource_to_bindings(std::unordered_map<std::string, RhiResourceBindingDescription>& bindings,
                                   const ShaderStage shader_stage,
-                                  const spirv_cross::Compiler& shader_compiler,
-                                  const spirv_cross::Resource& resource,
-                                  const DescriptorType type) {
-        const uint32_t set_idx = shader_compiler.get_decoration(resource.id, spv::DecorationDescriptorSet);
-        const uint32_t binding_idx = shader_compiler.get_decoration(resource.id, spv::DecorationBinding);
-
+                                  const ShaderResourceBinding& resource) {
         RhiResourceBindingDescription new_binding = {};
-        new_binding.set = set_idx;
-        new_binding.binding = binding_idx;
-        new_binding.type = type;
-        new_binding.count = 1;
+        new_binding.set = resource.set;
+        new_binding.binding = resource.binding;
+        new_binding.type = resource.type;
+        new_binding.count = resource.count;
+        new_binding.is_unbounded = resource.is_unbounded;
         new_binding.stages = shader_stage;
 
         logger->debug("Pipeline reflection found resource %s of type %s in binding %u.%u",
                         resource.name.c_str(),
-                        descriptor_type_to_string(type),
-                        set_idx,
-                        binding_idx);
-
-        const spirv_cross::SPIRType& type_information = shader_compiler.get_type(resource.type_id);
-        if(!type_information.array.empty()) {
-            new_binding.count = type_information.array[0];
-            // All arrays are unbounded until I figure out how to use SPIRV-Cross to detect unbounded arrays
-            new_binding.is_unbounded = true;
-        }
+                        descriptor_type_to_string(resource.type),
+                        resource.set,
+                        resource.binding);
 
         const std::string& resource_name = resource.name.c_str();
 
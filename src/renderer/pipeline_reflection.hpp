@@ -1,26 +1,56 @@
 #pragma once
 #include <unordered_map>
 #include <string>
+#include <vector>
 
 #include "nova_renderer/rhi/pipeline_create_info.hpp"
 #include "nova_renderer/rhi/rhi_enums.hpp"
 #include "nova_renderer/rhi/rhi_types.hpp"
 
-namespace spirv_cross {
-    struct Resource;
-    class Compiler;
-} // namespace spirv_cross
-
 namespace nova::renderer {
+    struct ShaderResourceBinding;
+
+    /*!
+     * \brief A range of push constants, and every stage which reads it
+     */
+    struct PipelinePushConstantRange {
+        uint32_t offset;
+
+        uint32_t size;
+
+        /*!
+         * \brief Mask of the `rhi::ShaderStage`s which read this range
+         */
+        uint32_t stages;
+    };
+
     std::unordered_map<std::string, rhi::RhiResourceBindingDescription> get_all_descriptors(const RhiGraphicsPipelineState& pipeline_state);
 
+    /*!
+     * \brief Merges the push constants that each of a pipeline's shaders reads
+     *
+     * Each shader reads one range of push constants, and stages which read the same range share an entry, so every stage is in at most
+     * one entry like Vulkan requires. Ranges are widened to multiples of four bytes
+     *
+     * \return The ranges, sorted by offset. Empty if no shader reads any push constants
+     */
+    std::vector<PipelinePushConstantRange> get_push_constant_ranges(const RhiGraphicsPipelineState& pipeline_state);
+
+    /*!
+     * \brief Splits push constant ranges which overlap into disjoint intervals, each with every stage of the ranges that cover it
+     *
+     * Vulkan wants each push to name exactly the stages of every range that the pushed bytes overlap. Pushing each interval once with
+     * its stages does that, without writing any byte twice
+     *
+     * \return The intervals, sorted by offset. Neighboring intervals with the same stages are merged
+     */
+    std::vector<PipelinePushConstantRange> get_push_constant_intervals(const std::vector<PipelinePushConstantRange>& ranges);
+
     void get_shader_module_descriptors(const std::vector<uint32_t>& spirv,
                                        rhi::ShaderStage shader_stage,
                                        std::unordered_map<std::string, rhi::RhiResourceBindingDescription>& bindings);
 
     void add_resource_to_bindings(std::unordered_map<std::string, rhi::RhiResourceBindingDescription>& bindings,
                                   rhi::ShaderStage shader_stage,
-                                  const spirv_cross::Compiler& shader_compiler,
-                                  const spirv_cross::Resource& resource,
-                                  rhi::DescriptorType type);
+                                  const ShaderResourceBinding& resource);
 } // namespace nova::renderer
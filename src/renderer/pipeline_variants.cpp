@@ -0,0 +1,200 @@
+#include "pipeline_variants.hpp"
+
+#include <algorithm>
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+#include <Tracy.hpp>
+
+#include "nova_renderer/loading/renderpack_loading.hpp"
+#include "nova_renderer/renderpack_data_conversions.hpp"
+#include "nova_renderer/util/worker_pool.hpp"
+
+#include "../loading/renderpack/spirv_optimizer.hpp"
+
+namespace nova::renderer {
+    static auto logger = spdlog::stdout_color_mt("PipelineVariants");
+
+    template <typename ValueType>
+    static ValueType* get_if_present(std::optional<ValueType>& value) {
+        return value ? &*value : nullptr;
+    }
+
+    template <typename ValueType>
+    static const ValueType* get_if_present(const std::optional<ValueType>& value) {
+        return value ? &*value : nullptr;
+    }
+
+    PipelineVariants::PipelineVariants(renderpack::PipelineData pipeline_data,
+                                       RhiGraphicsPipelineState base_state,
+                                       const rhi::RhiPipeline& base_pipeline,
+                                       rhi::RhiRenderpass& renderpass,
+                                       rhi::RenderDevice& device,
+                                       WorkerPool& worker_pool,
+                                       filesystem::FolderAccessorBase* folder_access,
+                                       const uint32_t generation)
+        : pipeline_data{std::move(pipeline_data)},
+          base_state{std::move(base_state)},
+          base_pipeline{base_pipeline},
+          renderpass{renderpass},
+          device{device},
+          worker_pool{worker_pool},
+          folder_access{folder_access},
+          generation{generation} {
+        // Variants that don't change any shaders are the base variant
+        pipelines_by_spirv.emplace(hash_spirv(this->base_state), &base_pipeline);
+    }
+
+    PipelineVariantKey PipelineVariants::get_variant_key(const std::vector<std::string>& keywords) const {
+        PipelineVariantKey key = 0;
+
+        for(const auto& keyword : keywords) {
+            const auto itr = std::find(pipeline_data.keywords.begin(), pipeline_data.keywords.end(), keyword);
+            if(itr == pipeline_data.keywords.end()) {
+                logger->warn("Pipeline {} has no keyword {}, ignoring it", pipeline_data.name, keyword);
+                continue;
+            }
+
+            key |= PipelineVariantKey{1} << static_cast<uint32_t>(itr - pipeline_data.keywords.begin());
+        }
+
+        return key;
+    }
+
+    const rhi::RhiPipeline& PipelineVariants::get_pipeline(const PipelineVariantKey key) {
+        if(key == 0) {
+            return base_pipeline;
+        }
+
+        std::lock_guard lock{mutex};
+        const auto [itr, is_new_variant] = variants.try_emplace(key);
+        if(itr->second.status == VariantStatus::Ready) {
+            return *itr->second.pipeline;
+        }
+
+        if(is_new_variant) {
+            // Rendering waits for the renderpack's own pipelines, but not for variants, so those come first
+            // Hold a reference, since reloading the pipeline's shaders may replace us while the variant compiles
+            worker_pool.submit([self = shared_from_this(), key] { self->compile_variant(key); }, 0.5f);
+        }
+
+        return base_pipeline;
+    }
+
+    void PipelineVariants::compile_variant(const PipelineVariantKey key) {
+        ZoneScoped;
+        auto defines = pipeline_data.defines;
+        for(uint32_t i = 0; i < pipeline_data.keywords.size(); i++) {
+            if((key & (PipelineVariantKey{1} << i)) != 0) {
+                defines.push_back(pipeline_data.keywords[i]);
+            }
+        }
+
+        auto state = base_state;
+        state.name = generation == 0 ? fmt::format("{}#{:x}", base_state.name, key) :
+                                       fmt::format("{}#{:x}.{}", base_state.name, key, generation);
+        state.fallback = base_state.name;
+        // Variants only differ from the base variant in their shaders, so they're cheap to derive from it
+        state.parent = base_state.name;
+
+        const auto compile_stage = [&](const renderpack::RenderpackShaderSource* rp_source, const rhi::ShaderStage stage, ShaderSource* shader) {
+            // Precompiled SPIR-V can't have keywords, so the base variant's SPIR-V is already right
+            if(shader == nullptr || rp_source == nullptr || rp_source->source_text.empty()) {
+                return true;
+            }
+
+            const auto language = rp_source->filename.ends_with(".hlsl") ? rhi::ShaderLanguage::Hlsl : rhi::ShaderLanguage::Glsl;
+            shader->source = renderpack::compile_shader(rp_source->source_text, stage, language, folder_access, defines);
+            if(shader->source.empty()) {
+                return false;
+            }
+
+            std::string error_message;
+            shader->source = renderpack::get_spirv_optimizer().specialize(shader->source,
+                                                                          pipeline_data.specialization_constants,
+                                                                          error_message);
+            if(shader->source.empty()) {
+                logger->error("Could not specialize {} for variant {:x}: {}", rp_source->filename, key, error_message);
+                return false;
+            }
+
+            return true;
+        };
+
+        const auto compiled_all_shaders = compile_stage(&pipeline_data.vertex_shader, rhi::ShaderStage::Vertex, &state.vertex_shader) &&
+                                          compile_stage(get_if_present(pipeline_data.geometry_shader),
+                                                        rhi::ShaderStage::Geometry,
+                                                        get_if_present(state.geometry_shader)) &&
+                                          compile_stage(get_if_present(pipeline_data.fragment_shader),
+                                                        rhi::ShaderStage::Pixel,
+                                                        get_if_present(state.pixel_shader)) &&
+                                          compile_stage(get_if_present(pipeline_data.task_shader),
+                                                        rhi::ShaderStage::Task,
+                                                        get_if_present(state.task_shader)) &&
+                                          compile_stage(get_if_present(pipeline_data.mesh_shader),
+                                                        rhi::ShaderStage::Mesh,
+                                                        get_if_present(state.mesh_shader));
+
+        const auto fail = [&] {
+            logger->error("Could not compile variant {:x} of pipeline {}, drawing with the base variant instead", key, base_state.name);
+
+            std::lock_guard lock{mutex};
+            variants[key].status = VariantStatus::Failed;
+        };
+
+        if(!compiled_all_shaders) {
+            fail();
+            return;
+        }
+
+        const auto spirv_hash = hash_spirv(state);
+        {
+            std::lock_guard lock{mutex};
+            if(const auto itr = pipelines_by_spirv.find(spirv_hash); itr != pipelines_by_spirv.end()) {
+                logger->debug("Variant {:x} of pipeline {} has the same shaders as another variant", key, base_state.name);
+                variants[key] = {VariantStatus::Ready, itr->second};
+                return;
+            }
+        }
+
+        state.vertex_fields = renderpack::get_vertex_fields(state.vertex_shader);
+
+        auto pipeline = device.create_surface_pipeline(state);
+        if(!pipeline || !device.compile_pipeline_for_renderpass(*pipeline, renderpass)) {
+            fail();
+            return;
+        }
+
+        std::lock_guard lock{mutex};
+        // Another worker may have made a pipeline with the same shaders while we were compiling, in which case we use theirs
+        const auto [itr, is_new_pipeline] = pipelines_by_spirv.try_emplace(spirv_hash, pipeline.get());
+        if(is_new_pipeline) {
+            variant_pipelines.push_back(std::move(pipeline));
+        }
+
+        variants[key] = {VariantStatus::Ready, itr->second};
+
+        logger->debug("Compiled variant {:x} of pipeline {}", key, base_state.name);
+    }
+
+    Sha256Digest PipelineVariants::hash_spirv(const RhiGraphicsPipelineState& state) {
+        Sha256 hasher;
+
+        const auto hash_shader = [&](const ShaderSource* shader) {
+            // Hash the size even when there's no shader, so that moving code between stages changes the hash
+            const auto num_words = shader != nullptr ? shader->source.size() : 0;
+            hasher.update_value(static_cast<uint64_t>(num_words));
+            if(num_words > 0) {
+                hasher.update(std::span{reinterpret_cast<const uint8_t*>(shader->source.data()), num_words * sizeof(uint32_t)});
+            }
+        };
+
+        hash_shader(&state.vertex_shader);
+        hash_shader(get_if_present(state.geometry_shader));
+        hash_shader(get_if_present(state.pixel_shader));
+        hash_shader(get_if_present(state.task_shader));
+        hash_shader(get_if_present(state.mesh_shader));
+
+        return hasher.finish();
+    }
+} // namespace nova::renderer
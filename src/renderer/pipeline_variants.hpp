@@ -0,0 +1,109 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "nova_renderer/rendergraph.hpp"
+
+#include "../util/sha256.hpp"
+
+namespace nova::filesystem {
+    class FolderAccessorBase;
+}
+
+namespace nova::renderer {
+    class WorkerPool;
+
+    /*!
+     * \brief Compiles the variants of a pipeline with keywords as they're needed
+     *
+     * The base variant, with every keyword turned off, is compiled with the rest of the renderpack. Other variants are compiled on the
+     * worker pool the first time something asks for them, and whoever asked gets the base variant until they're ready. Variants whose
+     * shaders compile to the same SPIR-V share a pipeline, since keywords that a shader doesn't use don't change it
+     */
+    class PipelineVariants : public std::enable_shared_from_this<PipelineVariants> {
+    public:
+        /*!
+         * \param pipeline_data The renderpack's description of the pipeline, with the source of its shaders
+         * \param base_state The state of the base variant
+         * \param base_pipeline The base variant
+         * \param renderpass The renderpass to compile the variants for
+         * \param device The device to create the variants with
+         * \param worker_pool The worker pool to compile the variants on
+         * \param folder_access The renderpack's folder, so that shaders can include files from it
+         * \param generation How many times the pipeline's shaders have been reloaded. Devices cache pipelines by name, so this keeps
+         * variants of reloaded shaders from getting the old shaders' pipelines
+         */
+        PipelineVariants(renderpack::PipelineData pipeline_data,
+                         RhiGraphicsPipelineState base_state,
+                         const rhi::RhiPipeline& base_pipeline,
+                         rhi::RhiRenderpass& renderpass,
+                         rhi::RenderDevice& device,
+                         WorkerPool& worker_pool,
+                         filesystem::FolderAccessorBase* folder_access,
+                         uint32_t generation = 0);
+
+        /*!
+         * \brief Works out which variant turns on the given keywords. Keywords that the pipeline doesn't have are ignored
+         */
+        [[nodiscard]] PipelineVariantKey get_variant_key(const std::vector<std::string>& keywords) const;
+
+        /*!
+         * \brief Gets the pipeline for a variant, and starts compiling the variant if nobody's asked for it before
+         *
+         * \return The variant, or the base variant if the variant isn't ready or couldn't be compiled
+         */
+        [[nodiscard]] const rhi::RhiPipeline& get_pipeline(PipelineVariantKey key);
+
+    private:
+        enum class VariantStatus {
+            Compiling,
+            Ready,
+            Failed,
+        };
+
+        struct Variant {
+            VariantStatus status = VariantStatus::Compiling;
+
+            const rhi::RhiPipeline* pipeline = nullptr;
+        };
+
+        renderpack::PipelineData pipeline_data;
+
+        RhiGraphicsPipelineState base_state;
+
+        const rhi::RhiPipeline& base_pipeline;
+
+        rhi::RhiRenderpass& renderpass;
+
+        rhi::RenderDevice& device;
+
+        WorkerPool& worker_pool;
+
+        filesystem::FolderAccessorBase* folder_access;
+
+        uint32_t generation;
+
+        std::mutex mutex;
+
+        std::unordered_map<PipelineVariantKey, Variant> variants;
+
+        /*!
+         * \brief Every pipeline we've made, keyed by a hash of its shaders' SPIR-V
+         */
+        std::map<Sha256Digest, const rhi::RhiPipeline*> pipelines_by_spirv;
+
+        std::vector<std::unique_ptr<rhi::RhiPipeline>> variant_pipelines;
+
+        /*!
+         * \brief Compiles a variant and makes it available. Runs on the worker pool
+         */
+        void compile_variant(PipelineVariantKey key);
+
+        [[nodiscard]] static Sha256Digest hash_spirv(const RhiGraphicsPipelineState& state);
+    };
+} // namespace nova::renderer
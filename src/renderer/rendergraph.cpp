@@ -1,5 +1,7 @@
 #include "nova_renderer/rendergraph.hpp"
 
+#include <algorithm>
+#include <array>
 #include <utility>
 
 #include <Tracy.hpp>
@@ -8,7 +10,9 @@
 #include "nova_renderer/rhi/command_list.hpp"
 
 #include "../loading/renderpack/render_graph_builder.hpp"
+#include "meshlet_builder.hpp"
 #include "pipeline_reflection.hpp"
+#include "pipeline_variants.hpp"
 
 namespace nova::renderer {
     using namespace renderpack;
@@ -64,8 +68,7 @@ namespace nova::renderer {
 
             // TODO: Use shader reflection to figure our the stage that the pipelines in this renderpass need access to this resource
             // instead of using a robust default
-            std::vector<rhi::RhiResourceBarrier> barriers{&rx::memory::g_system_allocator};
-            barriers.push_back(backbuffer_barrier);
+            const auto barriers = std::array{backbuffer_barrier};
             cmds.resource_barriers(rhi::PipelineStage::TopOfPipe, rhi::PipelineStage::ColorAttachmentOutput, barriers);
         }
     }
@@ -92,8 +95,7 @@ namespace nova::renderer {
             backbuffer_barrier.destination_queue = rhi::QueueType::Graphics;
             backbuffer_barrier.image_memory_barrier.aspect = rhi::ImageAspect::Color;
 
-            std::vector<rhi::RhiResourceBarrier> barriers{&rx::memory::g_system_allocator};
-            barriers.push_back(backbuffer_barrier);
+            const auto barriers = std::array{backbuffer_barrier};
             cmds.resource_barriers(rhi::PipelineStage::ColorAttachmentOutput, rhi::PipelineStage::BottomOfPipe, barriers);
         }
     }
@@ -106,7 +108,7 @@ namespace nova::renderer {
     void GlobalRenderpass::record_renderpass_contents(rhi::RhiRenderCommandList& cmds, FrameContext& ctx) {
         cmds.set_pipeline(*pipeline);
 
-        cmds.bind_resources(*resource_binder);
+        cmds.bind_resources(*resource_binder, static_cast<uint32_t>(ctx.frame_idx));
 
         const auto mesh_data = ctx.nova->get_mesh(mesh);
         cmds.bind_index_buffer(mesh_data->index_buffer, rhi::IndexType::Uint32);
@@ -187,15 +189,57 @@ namespace nova::renderer {
 
     void renderer::MaterialPass::record(rhi::RhiRenderCommandList& cmds, FrameContext& ctx) const {
         ZoneScoped;
+        if(!bound_resource_names.empty()) {
+            report_texture_screen_sizes(ctx);
+        }
+
         cmds.bind_descriptor_sets(descriptor_sets, pipeline_interface);
 
-        static_mesh_draws.each_fwd(
-            [&](const MeshBatch<StaticMeshRenderCommand>& batch) { record_rendering_static_mesh_batch(batch, cmds, ctx); });
+        static_mesh_draws.each_fwd([&](const MeshBatch<StaticMeshRenderCommand>& batch) {
+            if(uses_mesh_shaders && batch.num_meshlets > 0) {
+                record_rendering_static_meshlet_batch(batch, cmds, ctx);
+
+            } else {
+                record_rendering_static_mesh_batch(batch, cmds, ctx);
+            }
+        });
 
         static_procedural_mesh_draws.each_fwd(
             [&](const ProceduralMeshBatch<StaticMeshRenderCommand>& batch) { record_rendering_static_mesh_batch(batch, cmds, ctx); });
     }
 
+    void renderer::MaterialPass::report_texture_screen_sizes(FrameContext& ctx) const {
+        ZoneScoped;
+        float max_screen_size = 0;
+
+        for(const auto& batch : static_mesh_draws) {
+            for(const StaticMeshRenderCommand& command : batch.commands) {
+                if(!command.is_visible) {
+                    continue;
+                }
+
+                const auto& model_matrix = command.model_matrix;
+                const auto center = glm::vec3{model_matrix * glm::vec4{batch.bounding_center, 1}};
+
+                // Non-uniform scales stretch the sphere into an ellipsoid, so use the largest scale to keep the sphere around the mesh
+                const auto scale = std::max({glm::length(glm::vec3{model_matrix[0]}),
+                                             glm::length(glm::vec3{model_matrix[1]}),
+                                             glm::length(glm::vec3{model_matrix[2]})});
+                const auto radius = batch.bounding_radius * scale;
+
+                for(const Camera& camera : ctx.cameras) {
+                    if(camera.is_active) {
+                        max_screen_size = std::max(max_screen_size, projected_screen_size(camera, center, radius, ctx.viewport_height));
+                    }
+                }
+            }
+        }
+
+        if(max_screen_size > 0) {
+            ctx.nova->get_texture_streamer().report_texture_screen_size(bound_resource_names, max_screen_size);
+        }
+    }
+
     void renderer::MaterialPass::record_rendering_static_mesh_batch(const MeshBatch<StaticMeshRenderCommand>& batch,
                                                                     rhi::RhiRenderCommandList& cmds,
                                                                     FrameContext& ctx) {
@@ -215,7 +259,7 @@ namespace nova::renderer {
 
         if(start_index != ctx.cur_model_matrix_index) {
             // TODO: There's probably a better way to do this
-            std::vector<rhi::RhiBuffer*> vertex_buffers{ctx.allocator};
+            mem::FrameVector<rhi::RhiBuffer*> vertex_buffers(ctx.allocator);
             vertex_buffers.reserve(batch.num_vertex_attributes);
             for(uint32_t i = 0; i < batch.num_vertex_attributes; i++) {
                 vertex_buffers.push_back(batch.vertex_buffer);
@@ -227,6 +271,38 @@ namespace nova::renderer {
         }
     }
 
+    void renderer::MaterialPass::record_rendering_static_meshlet_batch(const MeshBatch<StaticMeshRenderCommand>& batch,
+                                                                       rhi::RhiRenderCommandList& cmds,
+                                                                       FrameContext& ctx) const {
+        ZoneScoped;
+        bool are_buffers_bound = false;
+
+        // Each task shader workgroup culls a group of meshlets and launches mesh shaders for the survivors
+        const auto num_tasks = uses_task_shader ? (batch.num_meshlets + MESHLETS_PER_TASK_WORKGROUP - 1) / MESHLETS_PER_TASK_WORKGROUP :
+                                                  batch.num_meshlets;
+
+        // Mesh shader draws don't have instances, so each visible instance gets its own draw with its model matrix index in the push
+        // constants
+        for(const StaticMeshRenderCommand& command : batch.commands) {
+            if(!command.is_visible) {
+                continue;
+            }
+
+            if(!are_buffers_bound) {
+                cmds.bind_meshlet_buffers(batch.vertex_buffer,
+                                          batch.meshlet_buffer,
+                                          batch.meshlet_vertex_buffer,
+                                          batch.meshlet_primitive_buffer);
+                are_buffers_bound = true;
+            }
+
+            cmds.set_model_matrix_index(static_cast<uint32_t>(ctx.cur_model_matrix_index));
+            cmds.draw_mesh_tasks(num_tasks);
+
+            ctx.cur_model_matrix_index++;
+        }
+    }
+
     void renderer::MaterialPass::record_rendering_static_mesh_batch(const ProceduralMeshBatch<StaticMeshRenderCommand>& batch,
                                                                     rhi::RhiRenderCommandList& cmds,
                                                                     FrameContext& ctx) {
@@ -245,23 +321,48 @@ namespace nova::renderer {
         });
 
         if(start_index != ctx.cur_model_matrix_index) {
-            const auto& [vertex_buffer, index_buffer] = batch.mesh->get_buffers_for_frame(ctx.frame_idx);
+            const auto& [vertex_buffer, index_buffer, vertex_offset, index_offset] = batch.mesh->get_buffers_for_frame(ctx.frame_idx);
+            if(vertex_buffer == nullptr || index_buffer == nullptr) {
+                // The mesh's data didn't make it into the procedural geometry ring this frame
+                return;
+            }
+
             // TODO: There's probably a better way to do this
-            std::vector<rhi::RhiBuffer*> vertex_buffers;
+            mem::FrameVector<rhi::RhiBuffer*> vertex_buffers(ctx.allocator);
+            mem::FrameVector<mem::Bytes> vertex_offsets(ctx.allocator);
             vertex_buffers.reserve(7);
+            vertex_offsets.reserve(7);
             for(uint32_t i = 0; i < 7; i++) {
                 vertex_buffers.push_back(vertex_buffer);
+                vertex_offsets.push_back(vertex_offset);
             }
-            cmds.bind_vertex_buffers(vertex_buffers);
-            cmds.bind_index_buffer(index_buffer, rhi::IndexType::Uint32);
+            cmds.bind_vertex_buffers(vertex_buffers, vertex_offsets);
+            cmds.bind_index_buffer(index_buffer, rhi::IndexType::Uint32, index_offset);
         }
     }
 
-    void Pipeline::record(rhi::RhiRenderCommandList& cmds, FrameContext& ctx) const {
-        ZoneScoped;        cmds.set_pipeline(*pipeline);
+    const rhi::RhiPipeline& Pipeline::get_pipeline_for_variant(const PipelineVariantKey key) const {
+        if(key == 0 || !variants) {
+            return *pipeline;
+        }
+
+        return variants->get_pipeline(key);
+    }
 
+    void Pipeline::record(rhi::RhiRenderCommandList& cmds, FrameContext& ctx) const {
+        ZoneScoped;
         const auto& passes = ctx.nova->get_material_passes_for_pipeline(pipeline->name);
 
-        passes.each_fwd([&](const renderer::MaterialPass& pass) { pass.record(cmds, ctx); });
+        // Passes which use the same variant share a pipeline, so only bind a pipeline when it changes
+        const rhi::RhiPipeline* bound_pipeline = nullptr;
+        passes.each_fwd([&](const renderer::MaterialPass& pass) {
+            const auto& pass_pipeline = get_pipeline_for_variant(pass.variant_key);
+            if(&pass_pipeline != bound_pipeline) {
+                cmds.set_pipeline(pass_pipeline);
+                bound_pipeline = &pass_pipeline;
+            }
+
+            pass.record(cmds, ctx);
+        });
     }
 } // namespace nova::renderer
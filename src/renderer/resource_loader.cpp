@@ -1,7 +1,17 @@
 #include "nova_renderer/resource_loader.hpp"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+
 #include "nova_renderer/nova_renderer.hpp"
 
+#include "../loading/textures/mip_generator.hpp"
+#include "../loading/textures/texture_compressor.hpp"
+#include "../loading/textures/texture_file.hpp"
+
 using namespace nova::mem;
 
 namespace nova::renderer {
@@ -16,18 +26,20 @@ namespace nova::renderer {
     constexpr size_t UNIFORM_BUFFER_ALIGNMENT = 64;           // TODO: Get a real value
     constexpr size_t UNIFORM_BUFFER_TOTAL_MEMORY_SIZE = 8096; // TODO: Get a real value
 
-    size_t size_in_bytes(PixelFormat pixel_format);
-
     DeviceResources::DeviceResources(NovaRenderer& renderer)
         : renderer{renderer},
           device{renderer.get_device()},
           internal_allocator{renderer.get_global_allocator()},
           textures{&internal_allocator},
           staging_buffers{&internal_allocator},
-          uniform_buffers{&internal_allocator} {
+          uniform_buffers{&internal_allocator},
+          texture_compressor{std::make_unique<TextureCompressor>(renderer.get_worker_pool(),
+                                                                 renderer.get_settings()->texture_loading.compressed_texture_cache_directory)} {
         create_default_textures();
     }
 
+    DeviceResources::~DeviceResources() = default;
+
     std::optional<BufferResourceAccessor> DeviceResources::create_uniform_buffer(const std::string& name, const Bytes size) {
         const auto event_name = std::string::format("create_uniform_buffer(%s)", name);
         ZoneScoped;        BufferResource resource = {};
@@ -56,7 +68,7 @@ namespace nova::renderer {
 
     void DeviceResources::destroy_uniform_buffer(const std::string& name) {
         if(const BufferResource* res = uniform_buffers.find(name)) {
-            // TODO device.destroy_buffer(res->buffer);
+            device.destroy_buffer(res->buffer, internal_allocator);
         }
         uniform_buffers.erase(name);
     }
@@ -67,16 +79,280 @@ namespace nova::renderer {
                                                                           const PixelFormat pixel_format,
                                                                           const void* data,
                                                                           rx::memory::allocator& allocator) {
+        std::vector<const void*> mip_data;
+        if(data == nullptr || (pixel_format != PixelFormat::Rgba8 && pixel_format != PixelFormat::Rgba8Srgb)) {
+            if(data != nullptr) {
+                mip_data.push_back(data);
+            }
+
+            return create_texture_with_mips(name, width, height, pixel_format, 1, mip_data, allocator);
+        }
+
+        const auto& options = renderer.get_settings()->texture_loading;
+        const auto* pixels = static_cast<const uint8_t*>(data);
+        const auto is_srgb = pixel_format == PixelFormat::Rgba8Srgb;
+        const auto pixel_width = static_cast<uint32_t>(width);
+        const auto pixel_height = static_cast<uint32_t>(height);
+
+        // The compressor needs every mip on the CPU, so the GPU can only make mips for uncompressed textures
+        if(options.generate_mips && options.generate_mips_on_gpu && !options.compress_textures) {
+            mip_data.push_back(data);
+            const auto num_mips = get_num_mips_for_size(pixel_width, pixel_height);
+            auto* image = create_texture_image(name, width, height, pixel_format, num_mips, mip_data, allocator, true);
+
+            return add_texture_to_table(name, width, height, pixel_format, image, allocator);
+        }
+
+        std::vector<std::vector<uint8_t>> generated_mips;
+        if(options.generate_mips) {
+            generated_mips = generate_mip_chain(pixels, pixel_width, pixel_height, is_srgb);
+        }
+
+        std::vector<const uint8_t*> mip_pixels;
+        mip_pixels.reserve(generated_mips.size() + 1);
+        mip_pixels.push_back(pixels);
+        for(const auto& mip : generated_mips) {
+            mip_pixels.push_back(mip.data());
+        }
+
+        if(options.compress_textures) {
+            const auto compressed_format = TextureCompressor::choose_compressed_format(pixels, pixel_width, pixel_height, is_srgb);
+            if(auto compressed_mips = texture_compressor->compress(mip_pixels, pixel_width, pixel_height, compressed_format)) {
+                return create_texture_from_mip_chain(name, width, height, compressed_format, std::move(*compressed_mips), allocator);
+            }
+        }
+
+        // The streamer loads mips whenever it wants them, so it needs its own copy of the first mip
+        const auto first_mip_size = get_image_size_in_bytes(pixel_format, pixel_width, pixel_height);
+        generated_mips.emplace(generated_mips.begin(), pixels, pixels + first_mip_size);
+
+        return create_texture_from_mip_chain(name, width, height, pixel_format, std::move(generated_mips), allocator);
+    }
+
+    std::optional<TextureResourceAccessor> DeviceResources::create_texture_from_file(const std::string& name,
+                                                                                    const std::span<const uint8_t> file_data) {
+        ZoneScoped;
+        const auto max_dimension = static_cast<uint32_t>(device.info.max_texture_size.b_count());
+        const auto texture_file = parse_texture_file(file_data, max_dimension);
+        if(!texture_file) {
+            logger->error("Could not read texture file for texture %s", name);
+            return rx::nullopt;
+        }
+
+        const auto is_rgba8 = texture_file->format == PixelFormat::Rgba8 || texture_file->format == PixelFormat::Rgba8Srgb;
+        if(is_rgba8 && texture_file->mips.size() == 1) {
+            return create_texture(name,
+                                  texture_file->width,
+                                  texture_file->height,
+                                  texture_file->format,
+                                  texture_file->mips[0].data(),
+                                  internal_allocator);
+        }
+
+        std::vector<std::vector<uint8_t>> mips;
+        mips.reserve(texture_file->mips.size());
+        for(const auto& mip : texture_file->mips) {
+            mips.emplace_back(mip.begin(), mip.end());
+        }
+
+        return create_texture_from_mip_chain(name,
+                                             texture_file->width,
+                                             texture_file->height,
+                                             texture_file->format,
+                                             std::move(mips),
+                                             internal_allocator);
+    }
+
+    /*!
+     * \brief A file with every mip of a streamed texture, one after another. Deleted once the last loader that reads it is gone
+     */
+    struct SpilledMipFile {
+        std::filesystem::path path;
+
+        /*!
+         * \brief Where each mip starts in the file, plus the size of the file at the end
+         */
+        std::vector<size_t> mip_offsets;
+
+        SpilledMipFile() = default;
+
+        SpilledMipFile(const SpilledMipFile& other) = delete;
+        SpilledMipFile& operator=(const SpilledMipFile& other) = delete;
+
+        SpilledMipFile(SpilledMipFile&& old) noexcept = delete;
+        SpilledMipFile& operator=(SpilledMipFile&& old) noexcept = delete;
+
+        ~SpilledMipFile() {
+            std::error_code error;
+            std::filesystem::remove(path, error);
+        }
+    };
+
+    static std::atomic<uint64_t> next_spilled_mip_file_id = 0;
+
+    static MipLoader make_spilled_mip_loader(const std::filesystem::path& directory,
+                                             const std::string& name,
+                                             std::vector<std::vector<uint8_t>> mips) {
+        ZoneScoped;
+        // The streamer may want any mip again whenever a texture grows on screen. Keeping every mip of every streamed texture in RAM
+        // would cost as much as the textures themselves, so write them to disk and read back the ones the streamer asks for
+        auto file = std::make_shared<SpilledMipFile>();
+        file->path = directory / (std::to_string(next_spilled_mip_file_id++) + ".mips");
+
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+
+        auto is_written = false;
+        if(!error) {
+            std::ofstream output{file->path, std::ios::binary | std::ios::trunc};
+
+            size_t offset = 0;
+            for(const auto& mip : mips) {
+                file->mip_offsets.push_back(offset);
+                output.write(reinterpret_cast<const char*>(mip.data()), static_cast<std::streamsize>(mip.size()));
+                offset += mip.size();
+            }
+            file->mip_offsets.push_back(offset);
+
+            output.close();
+            is_written = static_cast<bool>(output);
+        }
+
+        if(!is_written) {
+            logger->warn("Could not write the mips of texture %s to %s, keeping them in memory", name, file->path.string());
+
+            auto shared_mips = std::make_shared<const std::vector<std::vector<uint8_t>>>(std::move(mips));
+            return [shared_mips](const uint32_t mip_level) {
+                return mip_level < shared_mips->size() ? (*shared_mips)[mip_level] : std::vector<uint8_t>{};
+            };
+        }
+
+        return [file](const uint32_t mip_level) {
+            if(mip_level + 1 >= file->mip_offsets.size()) {
+                return std::vector<uint8_t>{};
+            }
+
+            const auto offset = file->mip_offsets[mip_level];
+            std::vector<uint8_t> pixels(file->mip_offsets[mip_level + 1] - offset);
+
+            // Every call opens its own stream, so the worker threads can load mips of the same texture at once
+            std::ifstream input{file->path, std::ios::binary};
+            input.seekg(static_cast<std::streamoff>(offset));
+            if(!input.read(reinterpret_cast<char*>(pixels.data()), static_cast<std::streamsize>(pixels.size()))) {
+                return std::vector<uint8_t>{};
+            }
+
+            return pixels;
+        };
+    }
+
+    std::optional<TextureResourceAccessor> DeviceResources::create_texture_from_mip_chain(const std::string& name,
+                                                                                         const size_t width,
+                                                                                         const size_t height,
+                                                                                         const PixelFormat pixel_format,
+                                                                                         std::vector<std::vector<uint8_t>> mips,
+                                                                                         rx::memory::allocator& allocator) {
+        if(texture_streamer == nullptr) {
+            std::vector<const void*> mip_data;
+            mip_data.reserve(mips.size());
+            for(const auto& mip : mips) {
+                mip_data.push_back(mip.data());
+            }
+
+            return create_texture_with_mips(name, width, height, pixel_format, static_cast<uint32_t>(mip_data.size()), mip_data, allocator);
+        }
+
+        const auto num_mips = static_cast<uint32_t>(mips.size());
+
+        StreamedTextureCreateInfo create_info = {};
+        create_info.name = name;
+        create_info.width = static_cast<uint32_t>(width);
+        create_info.height = static_cast<uint32_t>(height);
+        create_info.num_mips = num_mips;
+        create_info.format = pixel_format;
+        create_info.load_mip = make_spilled_mip_loader(renderer.get_settings()->texture_streaming.spilled_mip_directory,
+                                                       name,
+                                                       std::move(mips));
+
+        const auto slot = texture_streamer->add_texture(std::move(create_info));
+        if(!slot) {
+            return rx::nullopt;
+        }
+
+        return TextureResourceAccessor{&textures, *slot};
+    }
+
+    void DeviceResources::set_texture_streamer(TextureStreamer* streamer) { texture_streamer = streamer; }
+
+    std::optional<TextureResourceAccessor> DeviceResources::create_texture_with_mips(const std::string& name,
+                                                                                    const size_t width,
+                                                                                    const size_t height,
+                                                                                    const PixelFormat pixel_format,
+                                                                                    const uint32_t num_mips,
+                                                                                    const std::span<const void* const> mip_data,
+                                                                                    rx::memory::allocator& allocator) {
         const auto event_name = std::string::format("create_texture(%s)", name);
         ZoneScoped;
-        TextureResource resource = {};
+        auto* image = create_texture_image(name, width, height, pixel_format, num_mips, mip_data, allocator);
+
+        return add_texture_to_table(name, width, height, pixel_format, image, allocator);
+    }
 
+    std::optional<TextureResourceAccessor> DeviceResources::add_texture_to_table(const std::string& name,
+                                                                                const size_t width,
+                                                                                const size_t height,
+                                                                                const PixelFormat pixel_format,
+                                                                                RhiImage* image,
+                                                                                rx::memory::allocator& allocator) {
+        if(image == nullptr) {
+            logger->error("Could not create image for texture %s", name);
+            return rx::nullopt;
+        }
+
+        TextureResource resource = {};
         resource.name = name;
         resource.width = width;
         resource.height = height;
         resource.format = pixel_format;
+        resource.image = image;
+
+        // A texture's index in the textures array is also its slot in the bindless texture table, so reuse the slots of destroyed
+        // textures before growing the array
+        size_t idx;
+        if(!free_texture_slots.empty()) {
+            idx = free_texture_slots.back();
+            free_texture_slots.pop_back();
+            textures[idx] = resource;
+
+        } else if(textures.size() < device.info.max_num_textures) {
+            idx = textures.size();
+            textures.push_back(resource);
+
+        } else {
+            logger->error("Can not add texture %s to the texture table, it already has the maximum of %u textures",
+                          name,
+                          device.info.max_num_textures);
+            device.destroy_texture(resource.image, allocator);
+            return rx::nullopt;
+        }
+
+        texture_name_to_idx.insert(name, static_cast<uint32_t>(idx));
+        device.set_texture_table_slot(static_cast<uint32_t>(idx), resource.image);
+
+        logger->debug("Added texture %s to slot %u of the texture table", name, idx);
+
+        return TextureResourceAccessor{&textures, idx};
+    }
 
-        const size_t pixel_size = size_in_bytes(pixel_format);
+    RhiImage* DeviceResources::create_texture_image(const std::string& name,
+                                                    const size_t width,
+                                                    const size_t height,
+                                                    const PixelFormat pixel_format,
+                                                    const uint32_t num_mips,
+                                                    const std::span<const void* const> mip_data,
+                                                    rx::memory::allocator& allocator,
+                                                    const bool generate_remaining_mips) {
+        ZoneScoped;
 
         renderpack::TextureCreateInfo info = {};
         info.name = name;
@@ -85,70 +361,116 @@ namespace nova::renderer {
         info.format.dimension_type = TextureDimensionType::Absolute;
         info.format.width = static_cast<float>(width);
         info.format.height = static_cast<float>(height);
+        info.num_mips = num_mips;
 
-        resource.image = device.create_image(info, allocator);
-        resource.image->is_dynamic = false;
+        auto* image = device.create_image(info, allocator);
+        if(image == nullptr) {
+            return nullptr;
+        }
+        image->is_dynamic = false;
 
-        if(data != nullptr) {
-            ZoneScoped;            RhiBuffer* staging_buffer = get_staging_buffer_with_size(width * height * pixel_size);
+        if(!mip_data.empty()) {
+            ZoneScoped;
+            // Blits need the graphics queue
+            const auto queue = generate_remaining_mips ? QueueType::Graphics : QueueType::Transfer;
 
-            RhiRenderCommandList* cmds = device.create_command_list(0,
-                                                                    QueueType::Transfer,
-                                                                    RhiRenderCommandList::Level::Primary,
-                                                                    allocator);
+            RhiRenderCommandList* cmds = device.create_command_list(0, queue, RhiRenderCommandList::Level::Primary, allocator);
             cmds->set_debug_name(std::string::format("UploadTo%s", name));
 
-            RhiResourceBarrier initial_texture_barrier = {};
-            initial_texture_barrier.resource_to_barrier = resource.image;
-            initial_texture_barrier.access_before_barrier = ResourceAccess::CopyRead;
-            initial_texture_barrier.access_after_barrier = ResourceAccess::CopyWrite;
-            initial_texture_barrier.old_state = ResourceState::Undefined;
-            initial_texture_barrier.new_state = ResourceState::CopyDestination;
-            initial_texture_barrier.source_queue = QueueType::Transfer;
-            initial_texture_barrier.destination_queue = QueueType::Transfer;
-            initial_texture_barrier.image_memory_barrier.aspect = ImageAspect::Color;
-
-            std::vector<RhiResourceBarrier> initial_barriers{&allocator};
-            initial_barriers.push_back(initial_texture_barrier);
-            cmds->resource_barriers(PipelineStage::Transfer, PipelineStage::Transfer, initial_barriers);
-            cmds->upload_data_to_image(resource.image, width, height, pixel_size, staging_buffer, data);
-
-            RhiResourceBarrier final_texture_barrier = {};
-            final_texture_barrier.resource_to_barrier = resource.image;
-            final_texture_barrier.access_before_barrier = ResourceAccess::CopyWrite;
-            final_texture_barrier.access_after_barrier = ResourceAccess::ShaderRead;
-            final_texture_barrier.old_state = ResourceState::CopyDestination;
-            final_texture_barrier.new_state = ResourceState::ShaderRead;
-            final_texture_barrier.source_queue = QueueType::Transfer;
-            final_texture_barrier.destination_queue = QueueType::Graphics;
-            final_texture_barrier.image_memory_barrier.aspect = ImageAspect::Color;
-
-            std::vector<RhiResourceBarrier> final_barriers{&allocator};
-            final_barriers.push_back(final_texture_barrier);
-            cmds->resource_barriers(PipelineStage::Transfer, PipelineStage::VertexShader, final_barriers);
+            std::vector<RhiBuffer*> mip_staging_buffers;
+            record_texture_image_upload(image,
+                                        width,
+                                        height,
+                                        pixel_format,
+                                        mip_data,
+                                        *cmds,
+                                        queue,
+                                        mip_staging_buffers,
+                                        generate_remaining_mips);
 
             RhiFence* upload_done_fence = device.create_fence(false, allocator);
-            device.submit_command_list(cmds, QueueType::Transfer, upload_done_fence);
+            device.submit_command_list(cmds, queue, upload_done_fence);
 
-            // Be sure that the data copy is complete, so that this method doesn't return before the GPU is done with the staging buffer
+            // Be sure that the data copy is complete, so that this method doesn't return before the GPU is done with the staging buffers
             std::vector<RhiFence*> upload_done_fences{&allocator};
             upload_done_fences.push_back(upload_done_fence);
             device.wait_for_fences(upload_done_fences);
             device.destroy_fences(upload_done_fences, allocator);
 
-            return_staging_buffer(staging_buffer);
+            for(auto* staging_buffer : mip_staging_buffers) {
+                return_staging_buffer(staging_buffer);
+            }
 
-            logger->debug("Uploaded texture data to texture %s", name);
+            logger->debug("Uploaded %u mips of texture data to texture %s", mip_data.size(), name);
         }
 
-        auto idx = textures.size();
+        return image;
+    }
 
-        textures.push_back(resource);
-        texture_name_to_idx.insert(name, static_cast<uint32_t>(idx));
+    void DeviceResources::record_texture_image_upload(RhiImage* image,
+                                                      const size_t width,
+                                                      const size_t height,
+                                                      const PixelFormat pixel_format,
+                                                      const std::span<const void* const> mip_data,
+                                                      RhiRenderCommandList& cmds,
+                                                      const QueueType queue,
+                                                      std::vector<RhiBuffer*>& staging_buffers_out,
+                                                      const bool generate_remaining_mips) {
+        ZoneScoped;
+        RhiResourceBarrier initial_texture_barrier = {};
+        initial_texture_barrier.resource_to_barrier = image;
+        initial_texture_barrier.access_before_barrier = ResourceAccess::CopyRead;
+        initial_texture_barrier.access_after_barrier = ResourceAccess::CopyWrite;
+        initial_texture_barrier.old_state = ResourceState::Undefined;
+        initial_texture_barrier.new_state = ResourceState::CopyDestination;
+        initial_texture_barrier.source_queue = queue;
+        initial_texture_barrier.destination_queue = queue;
+        initial_texture_barrier.image_memory_barrier.aspect = ImageAspect::Color;
 
-        logger->debug("Added texture %s to the textures array, there's now %u textures total", name, textures.size());
+        cmds.resource_barriers(PipelineStage::Transfer, PipelineStage::Transfer, std::array{initial_texture_barrier});
 
-        return TextureResourceAccessor{&textures, idx};
+        // Each mip gets its own staging buffer, since the upload copies the mip's data to the start of the buffer
+        for(uint32_t mip = 0; mip < mip_data.size(); mip++) {
+            const auto mip_width = std::max<size_t>(width >> mip, 1);
+            const auto mip_height = std::max<size_t>(height >> mip, 1);
+
+            const auto mip_size = get_image_size_in_bytes(pixel_format, static_cast<uint32_t>(mip_width), static_cast<uint32_t>(mip_height));
+
+            RhiBuffer* staging_buffer = get_staging_buffer_with_size(mip_size);
+            cmds.upload_data_to_image(image, mip_width, mip_height, mip_size, staging_buffer, mip_data[mip], mip);
+
+            staging_buffers_out.push_back(staging_buffer);
+        }
+
+        if(generate_remaining_mips) {
+            // Leaves the whole image ready for shaders to read
+            cmds.generate_mips(image);
+
+        } else {
+            RhiResourceBarrier final_texture_barrier = {};
+            final_texture_barrier.resource_to_barrier = image;
+            final_texture_barrier.access_before_barrier = ResourceAccess::CopyWrite;
+            final_texture_barrier.access_after_barrier = ResourceAccess::ShaderRead;
+            final_texture_barrier.old_state = ResourceState::CopyDestination;
+            final_texture_barrier.new_state = ResourceState::ShaderRead;
+            final_texture_barrier.source_queue = queue;
+            final_texture_barrier.destination_queue = QueueType::Graphics;
+            final_texture_barrier.image_memory_barrier.aspect = ImageAspect::Color;
+
+            cmds.resource_barriers(PipelineStage::Transfer, PipelineStage::VertexShader, std::array{final_texture_barrier});
+        }
+    }
+
+    RhiImage* DeviceResources::replace_texture_image(const uint32_t idx, RhiImage* image, const size_t width, const size_t height) {
+        auto& texture = textures[idx];
+        auto* old_image = texture.image;
+
+        texture.image = image;
+        texture.width = width;
+        texture.height = height;
+        device.set_texture_table_slot(idx, image);
+
+        return old_image;
     }
 
     std::optional<uint32_t> DeviceResources::get_texture_idx_for_name(const std::string& name) const {
@@ -271,16 +593,35 @@ namespace nova::renderer {
     }
 
     void DeviceResources::destroy_render_target(const std::string& texture_name, rx::memory::allocator& allocator) {
-        if(const auto idx = get_texture_idx_for_name(texture_name); idx) {
-            const auto texture = textures[*idx];
-            device.destroy_texture(texture.image, allocator);
-            textures.erase(*idx, *idx);
+        if(auto* image = remove_texture_from_table(texture_name); image != nullptr) {
+            device.destroy_texture(image, allocator);
+        }
+    }
+
+    RhiImage* DeviceResources::remove_texture_from_table(const std::string& texture_name) {
+        // Don't use get_texture_idx_for_name, it returns the white texture for unknown names and we don't want to remove that
+        if(const auto* idx = texture_name_to_idx.find(texture_name); idx != nullptr) {
+            const auto slot = *idx;
+            auto& texture = textures[slot];
+            auto* image = texture.image;
+            texture.image = nullptr;
+
+            // Erasing the texture would shift every texture after it into a different slot. Instead, point the slot at the white texture
+            // so that stale material data samples something valid, and let the next texture reuse it
+            device.set_texture_table_slot(slot, textures[0].image);
+            free_texture_slots.push_back(slot);
+
+            texture_name_to_idx.erase(texture_name);
+
+            return image;
         }
 #if NOVA_DEBUG
         else {
             logger->error("Could not delete texture %s, are you sure you spelled it correctly?", texture_name);
         }
 #endif
+
+        return nullptr;
     }
 
     RhiBuffer* DeviceResources::get_staging_buffer_with_size(const Bytes size) {
@@ -316,6 +657,17 @@ namespace nova::renderer {
         buffers->push_back(buffer);
     }
 
+    void DeviceResources::release_staging_buffers() {
+        ZoneScoped;
+        for(auto& [size, buffers] : staging_buffers) {
+            for(auto* buffer : buffers) {
+                device.destroy_buffer(buffer, internal_allocator);
+            }
+        }
+
+        staging_buffers.clear();
+    }
+
     const std::vector<TextureResource>& DeviceResources::get_all_textures() const { return textures; }
 
     void DeviceResources::create_default_textures() {
@@ -338,6 +690,8 @@ namespace nova::renderer {
     size_t size_in_bytes(const PixelFormat pixel_format) {
         switch(pixel_format) {
             case PixelFormat::Rgba8:
+                [[fallthrough]];
+            case PixelFormat::Rgba8Srgb:
                 return 4;
 
             case PixelFormat::Rgba16F:
@@ -0,0 +1,364 @@
+#include "shader_reflection.hpp"
+
+#include <algorithm>
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+#include <spirv_cross.hpp>
+#include <Tracy.hpp>
+
+#include "nova_renderer/constants.hpp"
+
+#include "../loading/renderpack/shader_cache.hpp"
+#include "../util/binary_io.hpp"
+
+namespace nova::renderer {
+    using namespace spirv_cross;
+
+    /*!
+     * \brief Reflection may happen while Nova compiles its builtin pipelines during static initialization, before a static logger would be
+     * initialized
+     */
+    static spdlog::logger& get_logger() {
+        static auto logger = spdlog::stdout_color_mt("ShaderReflection");
+        return *logger;
+    }
+
+    constexpr uint32_t SHADER_REFLECTION_MAGIC = 0x46524E56; // "VNRF"
+
+    /*!
+     * \brief Version of the reflection format. Increment this whenever the format or what we reflect changes
+     */
+    constexpr uint32_t SHADER_REFLECTION_VERSION = 1;
+
+    constexpr const char* SHADER_REFLECTION_EXTENSION = ".refl";
+
+    static rhi::VertexFieldFormat to_rhi_vertex_format(const SPIRType& spirv_type) {
+        switch(spirv_type.basetype) {
+            case SPIRType::UInt:
+                return rhi::VertexFieldFormat::Uint;
+
+            case SPIRType::Float: {
+                switch(spirv_type.vecsize) {
+                    case 2:
+                        return rhi::VertexFieldFormat::Float2;
+
+                    case 3:
+                        return rhi::VertexFieldFormat::Float3;
+
+                    case 4:
+                        return rhi::VertexFieldFormat::Float4;
+
+                    default:
+                        get_logger().error("Nova does not support float fields with {} vector elements", spirv_type.vecsize);
+                        return rhi::VertexFieldFormat::Invalid;
+                }
+            };
+
+            case SPIRType::Unknown:
+                [[fallthrough]];
+            case SPIRType::Void:
+                [[fallthrough]];
+            case SPIRType::Boolean:
+                [[fallthrough]];
+            case SPIRType::SByte:
+                [[fallthrough]];
+            case SPIRType::UByte:
+                [[fallthrough]];
+            case SPIRType::Short:
+                [[fallthrough]];
+            case SPIRType::UShort:
+                [[fallthrough]];
+            case SPIRType::Int:
+                [[fallthrough]];
+            case SPIRType::Int64:
+                [[fallthrough]];
+            case SPIRType::UInt64:
+                [[fallthrough]];
+            case SPIRType::AtomicCounter:
+                [[fallthrough]];
+            case SPIRType::Half:
+                [[fallthrough]];
+            case SPIRType::Double:
+                [[fallthrough]];
+            case SPIRType::Struct:
+                [[fallthrough]];
+            case SPIRType::Image:
+                [[fallthrough]];
+            case SPIRType::SampledImage:
+                [[fallthrough]];
+            case SPIRType::Sampler:
+                [[fallthrough]];
+            case SPIRType::AccelerationStructureNV:
+                [[fallthrough]];
+            case SPIRType::ControlPointArray:
+                [[fallthrough]];
+            case SPIRType::Char:
+                [[fallthrough]];
+            default:
+                get_logger().error("Nova does not support vertex fields of type {}", static_cast<uint32_t>(spirv_type.basetype));
+        }
+
+        return {};
+    }
+
+    /*!
+     * \brief Works out how many descriptors are in a binding, and whether the binding is an unbounded array
+     */
+    static std::pair<uint32_t, bool> get_descriptor_count(const Compiler& compiler, const SPIRType& type) {
+        uint32_t count = 1;
+        bool is_unbounded = false;
+
+        // Vulkan flattens arrays of arrays of descriptors, so we multiply all the dimensions together
+        for(size_t i = 0; i < type.array.size(); i++) {
+            uint32_t dimension = type.array[i];
+            if(!type.array_size_literal[i]) {
+                // Sized by a specialization constant, which we only know the default value of
+                dimension = compiler.get_constant(dimension).scalar();
+
+            } else if(dimension == 0) {
+                is_unbounded = true;
+                dimension = MAX_NUM_TEXTURES;
+            }
+
+            count *= dimension;
+        }
+
+        return {count, is_unbounded};
+    }
+
+    static ShaderReflection reflect_spirv(const std::vector<uint32_t>& spirv) {
+        ZoneScoped;
+        const Compiler compiler{spirv.data(), spirv.size()};
+        const auto resources = compiler.get_shader_resources();
+
+        ShaderReflection reflection = {};
+
+        if(compiler.get_execution_model() == spv::ExecutionModelVertex) {
+            reflection.stage_inputs.reserve(resources.stage_inputs.size());
+            for(const auto& input : resources.stage_inputs) {
+                reflection.stage_inputs.emplace_back(ShaderStageInput{input.name,
+                                                                      compiler.get_decoration(input.id, spv::DecorationLocation),
+                                                                      to_rhi_vertex_format(compiler.get_type(input.base_type_id))});
+            }
+        }
+
+        const auto add_bindings = [&](const auto& shader_resources, const rhi::DescriptorType type) {
+            for(const auto& resource : shader_resources) {
+                const auto [count, is_unbounded] = get_descriptor_count(compiler, compiler.get_type(resource.type_id));
+
+                reflection.bindings.emplace_back(ShaderResourceBinding{resource.name,
+                                                                       compiler.get_decoration(resource.id, spv::DecorationDescriptorSet),
+                                                                       compiler.get_decoration(resource.id, spv::DecorationBinding),
+                                                                       type,
+                                                                       count,
+                                                                       is_unbounded});
+            }
+        };
+
+        add_bindings(resources.sampled_images, rhi::DescriptorType::CombinedImageSampler);
+        add_bindings(resources.separate_images, rhi::DescriptorType::Texture);
+        add_bindings(resources.separate_samplers, rhi::DescriptorType::Sampler);
+        add_bindings(resources.uniform_buffers, rhi::DescriptorType::UniformBuffer);
+        add_bindings(resources.storage_buffers, rhi::DescriptorType::StorageBuffer);
+
+        // SPIR-V only allows one push constant block per entry point
+        if(!resources.push_constant_buffers.empty()) {
+            const auto ranges = compiler.get_active_buffer_ranges(resources.push_constant_buffers[0].id);
+            if(!ranges.empty()) {
+                size_t begin = ranges[0].offset;
+                size_t end = ranges[0].offset + ranges[0].range;
+                for(const auto& range : ranges) {
+                    begin = std::min(begin, range.offset);
+                    end = std::max(end, range.offset + range.range);
+                }
+
+                reflection.push_constants = ShaderPushConstantRange{static_cast<uint32_t>(begin), static_cast<uint32_t>(end - begin)};
+            }
+        }
+
+        for(const auto& constant : compiler.get_specialization_constants()) {
+            reflection.specialization_constants.emplace_back(ShaderSpecializationConstant{compiler.get_name(constant.id), constant.constant_id});
+        }
+
+        return reflection;
+    }
+
+    static void write_string(std::vector<uint8_t>& data, const std::string& string) {
+        write_value(data, static_cast<uint32_t>(string.size()));
+        data.insert(data.end(), string.begin(), string.end());
+    }
+
+    static std::optional<std::string> read_string(BinaryReader& reader) {
+        const auto length = reader.read<uint32_t>();
+        if(!length || *length > reader.get_num_remaining_bytes()) {
+            return std::nullopt;
+        }
+
+        std::string string(*length, '\0');
+        if(!reader.read_bytes(string.data(), string.size())) {
+            return std::nullopt;
+        }
+
+        return string;
+    }
+
+    static std::vector<uint8_t> serialize_reflection(const ShaderReflection& reflection) {
+        std::vector<uint8_t> data;
+        write_value(data, SHADER_REFLECTION_MAGIC);
+        write_value(data, SHADER_REFLECTION_VERSION);
+
+        write_value(data, static_cast<uint32_t>(reflection.stage_inputs.size()));
+        for(const auto& input : reflection.stage_inputs) {
+            write_string(data, input.name);
+            write_value(data, input.location);
+            write_value(data, static_cast<uint32_t>(input.format));
+        }
+
+        write_value(data, static_cast<uint32_t>(reflection.bindings.size()));
+        for(const auto& binding : reflection.bindings) {
+            write_string(data, binding.name);
+            write_value(data, binding.set);
+            write_value(data, binding.binding);
+            write_value(data, static_cast<uint32_t>(binding.type));
+            write_value(data, binding.count);
+            write_value(data, static_cast<uint8_t>(binding.is_unbounded));
+        }
+
+        write_value(data, static_cast<uint8_t>(reflection.push_constants.has_value()));
+        if(reflection.push_constants) {
+            write_value(data, reflection.push_constants->offset);
+            write_value(data, reflection.push_constants->size);
+        }
+
+        write_value(data, static_cast<uint32_t>(reflection.specialization_constants.size()));
+        for(const auto& constant : reflection.specialization_constants) {
+            write_string(data, constant.name);
+            write_value(data, constant.constant_id);
+        }
+
+        return data;
+    }
+
+    static std::optional<ShaderReflection> deserialize_reflection(const std::vector<uint8_t>& data) {
+        BinaryReader reader{data};
+        if(reader.read<uint32_t>() != SHADER_REFLECTION_MAGIC || reader.read<uint32_t>() != SHADER_REFLECTION_VERSION) {
+            return std::nullopt;
+        }
+
+        ShaderReflection reflection = {};
+
+        const auto num_inputs = reader.read<uint32_t>();
+        if(!num_inputs) {
+            return std::nullopt;
+        }
+        for(uint32_t i = 0; i < *num_inputs; i++) {
+            auto name = read_string(reader);
+            const auto location = reader.read<uint32_t>();
+            const auto format = reader.read<uint32_t>();
+            if(!name || !location || !format || *format > static_cast<uint32_t>(rhi::VertexFieldFormat::Invalid)) {
+                return std::nullopt;
+            }
+
+            reflection.stage_inputs.emplace_back(
+                ShaderStageInput{std::move(*name), *location, static_cast<rhi::VertexFieldFormat>(*format)});
+        }
+
+        const auto num_bindings = reader.read<uint32_t>();
+        if(!num_bindings) {
+            return std::nullopt;
+        }
+        for(uint32_t i = 0; i < *num_bindings; i++) {
+            auto name = read_string(reader);
+            const auto set = reader.read<uint32_t>();
+            const auto binding = reader.read<uint32_t>();
+            const auto type = reader.read<uint32_t>();
+            const auto count = reader.read<uint32_t>();
+            const auto is_unbounded = reader.read<uint8_t>();
+            if(!name || !set || !binding || !type || !count || !is_unbounded ||
+               *type > static_cast<uint32_t>(rhi::DescriptorType::Sampler)) {
+                return std::nullopt;
+            }
+
+            reflection.bindings.emplace_back(ShaderResourceBinding{std::move(*name),
+                                                                   *set,
+                                                                   *binding,
+                                                                   static_cast<rhi::DescriptorType>(*type),
+                                                                   *count,
+                                                                   *is_unbounded != 0});
+        }
+
+        const auto has_push_constants = reader.read<uint8_t>();
+        if(!has_push_constants) {
+            return std::nullopt;
+        }
+        if(*has_push_constants != 0) {
+            const auto offset = reader.read<uint32_t>();
+            const auto size = reader.read<uint32_t>();
+            if(!offset || !size) {
+                return std::nullopt;
+            }
+
+            reflection.push_constants = ShaderPushConstantRange{*offset, *size};
+        }
+
+        const auto num_constants = reader.read<uint32_t>();
+        if(!num_constants) {
+            return std::nullopt;
+        }
+        for(uint32_t i = 0; i < *num_constants; i++) {
+            auto name = read_string(reader);
+            const auto constant_id = reader.read<uint32_t>();
+            if(!name || !constant_id) {
+                return std::nullopt;
+            }
+
+            reflection.specialization_constants.emplace_back(ShaderSpecializationConstant{std::move(*name), *constant_id});
+        }
+
+        return reflection;
+    }
+
+    const ShaderReflection& ShaderReflectionDatabase::get_reflection(const std::vector<uint32_t>& spirv) {
+        ZoneScoped;
+        Sha256 hasher;
+        hasher.update_value(SHADER_REFLECTION_VERSION);
+        hasher.update(std::span{reinterpret_cast<const uint8_t*>(spirv.data()), spirv.size() * sizeof(uint32_t)});
+        const auto key = hasher.finish();
+
+        {
+            std::lock_guard lock{mutex};
+            if(const auto itr = reflections.find(key); itr != reflections.end()) {
+                return *itr->second;
+            }
+        }
+
+        // Reflect without holding the lock, so that other threads can reflect on other modules. If two threads reflect on the same module
+        // at once, the first one to finish wins
+        auto& shader_cache = renderpack::get_shader_cache();
+
+        std::optional<ShaderReflection> reflection;
+        if(const auto data = shader_cache.find_data(key, SHADER_REFLECTION_EXTENSION)) {
+            reflection = deserialize_reflection(*data);
+        }
+
+        if(!reflection) {
+            reflection = reflect_spirv(spirv);
+            shader_cache.add_data(key, SHADER_REFLECTION_EXTENSION, serialize_reflection(*reflection));
+        }
+
+        std::lock_guard lock{mutex};
+        const auto [itr, was_inserted] = reflections.try_emplace(key, std::make_unique<ShaderReflection>(std::move(*reflection)));
+        return *itr->second;
+    }
+
+    void ShaderReflectionDatabase::clear() {
+        std::lock_guard lock{mutex};
+        reflections.clear();
+    }
+
+    ShaderReflectionDatabase& get_shader_reflection_database() {
+        static ShaderReflectionDatabase database;
+        return database;
+    }
+} // namespace nova::renderer
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "nova_renderer/rhi/rhi_enums.hpp"
+
+#include "../util/sha256.hpp"
+
+namespace nova::renderer {
+    /*!
+     * \brief An input to a vertex shader
+     */
+    struct ShaderStageInput {
+        std::string name;
+
+        uint32_t location;
+
+        rhi::VertexFieldFormat format;
+    };
+
+    /*!
+     * \brief A descriptor that a shader uses
+     */
+    struct ShaderResourceBinding {
+        std::string name;
+
+        uint32_t set;
+
+        uint32_t binding;
+
+        rhi::DescriptorType type;
+
+        /*!
+         * \brief Number of descriptors in the binding. Unbounded arrays are `MAX_NUM_TEXTURES` long, devices may shrink them to fit
+         */
+        uint32_t count;
+
+        /*!
+         * \brief True if the binding is a runtime-sized array, like `Texture2D textures[]`
+         */
+        bool is_unbounded;
+    };
+
+    /*!
+     * \brief The part of a shader's push constant block that the shader actually reads
+     */
+    struct ShaderPushConstantRange {
+        uint32_t offset;
+
+        uint32_t size;
+    };
+
+    struct ShaderSpecializationConstant {
+        std::string name;
+
+        uint32_t constant_id;
+    };
+
+    /*!
+     * \brief Everything Nova wants to know about a shader's interface, so that it doesn't have to parse the SPIR-V again
+     */
+    struct ShaderReflection {
+        /*!
+         * \brief Inputs to the shader, in the order that SPIR-V declares them. Only vertex shaders have these
+         */
+        std::vector<ShaderStageInput> stage_inputs;
+
+        std::vector<ShaderResourceBinding> bindings;
+
+        /*!
+         * \brief The push constants that the shader reads, or an empty optional if it reads none
+         */
+        std::optional<ShaderPushConstantRange> push_constants;
+
+        std::vector<ShaderSpecializationConstant> specialization_constants;
+    };
+
+    /*!
+     * \brief Reflects on each shader module once, no matter how many pipelines use it
+     *
+     * Reflections are keyed by a SHA-256 of the module's SPIR-V. The first time we see a module we look for its reflection in the shader
+     * cache, and if it's not there we parse the SPIR-V with SPIRV-Cross and save what we found to the shader cache. Either way, we keep
+     * the reflection in memory until the renderpack is unloaded
+     *
+     * Thread-safe
+     */
+    class ShaderReflectionDatabase {
+    public:
+        /*!
+         * \brief Gets the reflection for a shader module
+         *
+         * The reference stays valid until `clear` is called
+         */
+        [[nodiscard]] const ShaderReflection& get_reflection(const std::vector<uint32_t>& spirv);
+
+        /*!
+         * \brief Forgets every reflection, for instance because the renderpack that used them was unloaded
+         *
+         * Nothing may hold on to a reflection from this database while this runs
+         */
+        void clear();
+
+    private:
+        std::mutex mutex;
+
+        std::map<Sha256Digest, std::unique_ptr<ShaderReflection>> reflections;
+    };
+
+    /*!
+     * \brief The reflection database that pipeline creation uses
+     */
+    [[nodiscard]] ShaderReflectionDatabase& get_shader_reflection_database();
+} // namespace nova::renderer
@@ -0,0 +1,269 @@
+#include "shader_reloader.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <utility>
+
+#include <Tracy.hpp>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+#include "nova_renderer/filesystem/folder_accessor.hpp"
+#include "nova_renderer/loading/renderpack_loading.hpp"
+#include "nova_renderer/rhi/render_device.hpp"
+#include "nova_renderer/util/worker_pool.hpp"
+
+#include "../loading/renderpack/spirv_optimizer.hpp"
+
+namespace nova::renderer {
+    static auto logger = spdlog::stdout_color_mt("ShaderReloader");
+
+    /*!
+     * \brief Calls a function with every shader in a pipeline, and the stage it's for
+     */
+    template <typename PipelineDataType, typename FuncType>
+    static void for_each_shader(PipelineDataType& data, FuncType&& func) {
+        func(data.vertex_shader, rhi::ShaderStage::Vertex);
+
+        const auto visit_optional = [&](auto& shader, const rhi::ShaderStage stage) {
+            if(shader) {
+                func(*shader, stage);
+            }
+        };
+
+        visit_optional(data.geometry_shader, rhi::ShaderStage::Geometry);
+        visit_optional(data.tessellation_control_shader, rhi::ShaderStage::TessellationControl);
+        visit_optional(data.tessellation_evaluation_shader, rhi::ShaderStage::TessellationEvaluation);
+        visit_optional(data.fragment_shader, rhi::ShaderStage::Pixel);
+        visit_optional(data.task_shader, rhi::ShaderStage::Task);
+        visit_optional(data.mesh_shader, rhi::ShaderStage::Mesh);
+    }
+
+    ShaderReloader::ShaderReloader(const std::vector<renderpack::PipelineData>& pipelines,
+                                   filesystem::FolderAccessorBase& renderpack_folder,
+                                   const Rendergraph& rendergraph,
+                                   rhi::RenderDevice& device,
+                                   WorkerPool& worker_pool,
+                                   PipelineFactory create_pipeline)
+        : renderpack_folder{renderpack_folder},
+          rendergraph{rendergraph},
+          device{device},
+          worker_pool{worker_pool},
+          create_pipeline{std::move(create_pipeline)},
+          watcher{renderpack_folder.get_root()},
+          root_prefix{std::filesystem::path{renderpack_folder.get_root()}.lexically_normal().generic_string()} {
+        if(!root_prefix.empty() && !root_prefix.ends_with('/')) {
+            root_prefix += '/';
+        }
+
+        std::lock_guard lock{mutex};
+        this->pipelines.reserve(pipelines.size());
+        for(const auto& pipeline_data : pipelines) {
+            const auto pipeline_idx = this->pipelines.size();
+            auto& state = this->pipelines.emplace_back();
+            state.data = pipeline_data;
+
+            for_each_shader(state.data, [&](const renderpack::RenderpackShaderSource& shader, const rhi::ShaderStage stage) {
+                add_stage_dependencies({pipeline_idx, stage}, shader);
+            });
+        }
+
+        logger->info("Watching {} files in {} for changes", stages_by_file.size(), renderpack_folder.get_root());
+    }
+
+    void ShaderReloader::update() {
+        ZoneScoped;
+        const auto changed_files = watcher.get_changed_files();
+        if(changed_files.empty()) {
+            return;
+        }
+
+        std::lock_guard lock{mutex};
+        for(const auto& file : changed_files) {
+            const auto itr = stages_by_file.find(file);
+            if(itr == stages_by_file.end()) {
+                continue;
+            }
+
+            logger->debug("{} changed, reloading {} shaders", file, itr->second.size());
+            for(const auto& stage_id : itr->second) {
+                pipelines[stage_id.pipeline_idx].dirty_stages |= static_cast<uint32_t>(stage_id.stage);
+            }
+        }
+
+        for(size_t pipeline_idx = 0; pipeline_idx < pipelines.size(); pipeline_idx++) {
+            auto& state = pipelines[pipeline_idx];
+            // Pipelines which are already reloading pick up their new changes the next time we're called after they finish
+            if(state.dirty_stages == 0 || state.is_reloading) {
+                continue;
+            }
+
+            state.is_reloading = true;
+            const auto stages = state.dirty_stages;
+            state.dirty_stages = 0;
+
+            // Someone's waiting to see their change, so get in front of texture loading
+            worker_pool.submit([this, pipeline_idx, stages] { reload_pipeline(pipeline_idx, stages); }, 1.0f);
+        }
+    }
+
+    std::vector<ReloadedPipeline> ShaderReloader::take_reloaded_pipelines() {
+        std::lock_guard lock{mutex};
+        return std::exchange(reloaded_pipelines, {});
+    }
+
+    void ShaderReloader::reload_pipeline(const size_t pipeline_idx, const uint32_t stages) {
+        ZoneScoped;
+        renderpack::PipelineData data;
+        uint32_t generation;
+        {
+            std::lock_guard lock{mutex};
+            data = pipelines[pipeline_idx].data;
+            generation = ++pipelines[pipeline_idx].generation;
+        }
+
+        bool all_stages_compiled = true;
+        for_each_shader(data, [&](renderpack::RenderpackShaderSource& shader, const rhi::ShaderStage stage) {
+            if((stages & static_cast<uint32_t>(stage)) == 0) {
+                return;
+            }
+
+            std::vector<std::string> included_files;
+            std::vector<uint32_t> spirv;
+            std::string source_text;
+            if(shader.filename.ends_with(".spirv")) {
+                spirv = renderpack::load_shader_file(shader.filename, &renderpack_folder, stage);
+
+            } else {
+                source_text = renderpack_folder.read_text_file(shader.filename);
+                const auto language = shader.filename.ends_with(".hlsl") ? rhi::ShaderLanguage::Hlsl : rhi::ShaderLanguage::Glsl;
+                spirv = renderpack::compile_shader(source_text, stage, language, &renderpack_folder, data.defines, &included_files);
+            }
+
+            // Depend on whatever the shader includes now, even if it doesn't compile, so that fixing an included file reloads it
+            shader.included_files = std::move(included_files);
+
+            if(spirv.empty()) {
+                logger->error("Could not reload shader {} for pipeline {}, keeping the old one", shader.filename, data.name);
+                all_stages_compiled = false;
+                return;
+            }
+
+            std::string error_message;
+            spirv = renderpack::get_spirv_optimizer().specialize(spirv, data.specialization_constants, error_message);
+            if(spirv.empty()) {
+                logger->error("Could not specialize shader {} for pipeline {}, keeping the old one:\n{}",
+                              shader.filename,
+                              data.name,
+                              error_message);
+                all_stages_compiled = false;
+                return;
+            }
+
+            shader.source = std::move(spirv);
+            shader.source_text = std::move(source_text);
+        });
+
+        std::optional<Pipeline> pipeline;
+        std::unique_ptr<rhi::RhiRecompiledPipeline> recompiled_pipeline;
+        if(all_stages_compiled) {
+            pipeline = create_pipeline(data, generation);
+
+            const auto* renderpass = rendergraph.get_renderpass(data.pass);
+            if(pipeline && pipeline->pipeline && renderpass != nullptr && renderpass->renderpass != nullptr) {
+                recompiled_pipeline = device.recompile_pipeline_for_renderpass(*pipeline->pipeline, *renderpass->renderpass);
+                if(!recompiled_pipeline) {
+                    logger->error("Could not recompile pipeline {}, keeping the old one", data.name);
+                    pipeline.reset();
+                }
+
+            } else {
+                logger->error("Could not recreate pipeline {}, keeping the old one", data.name);
+                pipeline.reset();
+            }
+        }
+
+        std::lock_guard lock{mutex};
+        auto& state = pipelines[pipeline_idx];
+        for_each_shader(state.data, [&](const renderpack::RenderpackShaderSource& shader, const rhi::ShaderStage stage) {
+            remove_stage_dependencies({pipeline_idx, stage}, shader);
+        });
+
+        if(pipeline) {
+            state.data = std::move(data);
+
+        } else {
+            // Keep the shaders that work, but watch the files that the broken ones include now
+            for_each_shader(state.data, [&](renderpack::RenderpackShaderSource& shader, const rhi::ShaderStage stage) {
+                for_each_shader(data, [&](renderpack::RenderpackShaderSource& new_shader, const rhi::ShaderStage new_stage) {
+                    if(stage == new_stage) {
+                        shader.included_files = std::move(new_shader.included_files);
+                    }
+                });
+            });
+        }
+
+        for_each_shader(state.data, [&](const renderpack::RenderpackShaderSource& shader, const rhi::ShaderStage stage) {
+            add_stage_dependencies({pipeline_idx, stage}, shader);
+        });
+
+        state.is_reloading = false;
+
+        if(pipeline) {
+            logger->info("Reloaded pipeline {}", state.data.name);
+            reloaded_pipelines.push_back({state.data.name, std::move(*pipeline), std::move(recompiled_pipeline)});
+        }
+    }
+
+    void ShaderReloader::add_stage_dependencies(const StageId stage_id, const renderpack::RenderpackShaderSource& shader) {
+        const auto add_file = [&](const std::string& file) {
+            auto& stages = stages_by_file[normalize_path(file)];
+            const auto already_added = std::any_of(stages.begin(), stages.end(), [&](const StageId& other) {
+                return other.pipeline_idx == stage_id.pipeline_idx && other.stage == stage_id.stage;
+            });
+            if(!already_added) {
+                stages.push_back(stage_id);
+            }
+        };
+
+        add_file(shader.filename);
+        for(const auto& file : shader.included_files) {
+            add_file(file);
+        }
+    }
+
+    void ShaderReloader::remove_stage_dependencies(const StageId stage_id, const renderpack::RenderpackShaderSource& shader) {
+        const auto remove_file = [&](const std::string& file) {
+            const auto itr = stages_by_file.find(normalize_path(file));
+            if(itr == stages_by_file.end()) {
+                return;
+            }
+
+            auto& stages = itr->second;
+            stages.erase(std::remove_if(stages.begin(),
+                                        stages.end(),
+                                        [&](const StageId& other) {
+                                            return other.pipeline_idx == stage_id.pipeline_idx && other.stage == stage_id.stage;
+                                        }),
+                         stages.end());
+            if(stages.empty()) {
+                stages_by_file.erase(itr);
+            }
+        };
+
+        remove_file(shader.filename);
+        for(const auto& file : shader.included_files) {
+            remove_file(file);
+        }
+    }
+
+    std::string ShaderReloader::normalize_path(const std::string& path) const {
+        // DXC gives us includes like `./nova/file.hlsl`, and the file watcher gives us `nova/file.hlsl`
+        auto normalized = std::filesystem::path{path}.lexically_normal().generic_string();
+        if(!root_prefix.empty() && normalized.starts_with(root_prefix)) {
+            normalized.erase(0, root_prefix.size());
+        }
+
+        return normalized;
+    }
+} // namespace nova::renderer
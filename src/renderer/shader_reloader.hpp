@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "nova_renderer/renderpack_data.hpp"
+#include "nova_renderer/rendergraph.hpp"
+
+#include "../filesystem/file_watcher.hpp"
+
+namespace nova::filesystem {
+    class FolderAccessorBase;
+}
+
+namespace nova::renderer {
+    class WorkerPool;
+
+    namespace rhi {
+        class RenderDevice;
+    }
+
+    /*!
+     * \brief A pipeline whose shaders were recompiled, ready to replace the old one between frames
+     */
+    struct ReloadedPipeline {
+        std::string name;
+
+        Pipeline pipeline;
+
+        /*!
+         * \brief The pipeline's new PSO. Install it with `RenderDevice::install_recompiled_pipeline` at the same time as you swap in
+         * `pipeline`, so that command lists never use the new PSO with the old pipeline or the other way around
+         */
+        std::unique_ptr<rhi::RhiRecompiledPipeline> recompiled_pipeline;
+    };
+
+    /*!
+     * \brief Creates a pipeline from the renderpack's description of it. Called on the worker pool
+     *
+     * The second parameter is how many times the pipeline has been reloaded
+     */
+    using PipelineFactory = std::function<std::optional<Pipeline>(const renderpack::PipelineData&, uint32_t)>;
+
+    /*!
+     * \brief Recompiles the pipelines whose shaders changed on disk, so that renderpack authors see their changes without reloading the
+     * whole renderpack
+     *
+     * Every shader remembers which files it included the last time it was compiled. We keep a graph from each of those files, and each
+     * shader's own file, to the pipeline stages which use them. When a file changes we recompile only the stages that use it, on the
+     * worker pool, then recompile their pipelines. The new pipelines come back through `take_reloaded_pipelines`, so that `NovaRenderer`
+     * can swap them in between frames. A pipeline whose shaders don't compile keeps its old shaders
+     *
+     * Only works for renderpacks in regular folders, since we need to watch the files
+     */
+    class ShaderReloader {
+    public:
+        /*!
+         * \param pipelines The renderpack's pipelines, with the files that their shaders included
+         * \param renderpack_folder The renderpack's folder. Must be a regular folder
+         * \param rendergraph The rendergraph that the pipelines render in
+         * \param device The device to compile pipelines with
+         * \param worker_pool The worker pool to compile shaders on. Wait for it to be idle before destroying the reloader
+         * \param create_pipeline Creates pipelines from their reloaded descriptions
+         */
+        ShaderReloader(const std::vector<renderpack::PipelineData>& pipelines,
+                       filesystem::FolderAccessorBase& renderpack_folder,
+                       const Rendergraph& rendergraph,
+                       rhi::RenderDevice& device,
+                       WorkerPool& worker_pool,
+                       PipelineFactory create_pipeline);
+
+        /*!
+         * \brief Checks for changed files and starts reloading the pipelines that use them. Call this once a frame
+         */
+        void update();
+
+        /*!
+         * \brief Takes the pipelines which finished reloading since the last time you called this
+         */
+        [[nodiscard]] std::vector<ReloadedPipeline> take_reloaded_pipelines();
+
+    private:
+        struct StageId {
+            size_t pipeline_idx;
+
+            rhi::ShaderStage stage;
+        };
+
+        struct PipelineReloadState {
+            /*!
+             * \brief The pipeline's description, with the shaders that it currently uses
+             */
+            renderpack::PipelineData data;
+
+            /*!
+             * \brief How many times we've tried to reload the pipeline
+             */
+            uint32_t generation = 0;
+
+            bool is_reloading = false;
+
+            /*!
+             * \brief Stages which changed and haven't been reloaded yet, as a mask of `rhi::ShaderStage` bits
+             */
+            uint32_t dirty_stages = 0;
+        };
+
+        filesystem::FolderAccessorBase& renderpack_folder;
+
+        const Rendergraph& rendergraph;
+
+        rhi::RenderDevice& device;
+
+        WorkerPool& worker_pool;
+
+        PipelineFactory create_pipeline;
+
+        filesystem::FileWatcher watcher;
+
+        /*!
+         * \brief Renderpack root, normalized so that we can strip it from shader file names which include it
+         */
+        std::string root_prefix;
+
+        std::mutex mutex;
+
+        std::vector<PipelineReloadState> pipelines;
+
+        /*!
+         * \brief The stages that use each file, by the file's normalized path relative to the renderpack
+         */
+        std::unordered_map<std::string, std::vector<StageId>> stages_by_file;
+
+        std::vector<ReloadedPipeline> reloaded_pipelines;
+
+        /*!
+         * \brief Recompiles some stages of a pipeline, then the pipeline itself. Runs on the worker pool
+         *
+         * \param pipeline_idx The pipeline to reload
+         * \param stages Mask of the stages to recompile
+         */
+        void reload_pipeline(size_t pipeline_idx, uint32_t stages);
+
+        /*!
+         * \brief Records that a stage uses its shader's file and everything that the shader included. Must be called with the mutex held
+         */
+        void add_stage_dependencies(StageId stage_id, const renderpack::RenderpackShaderSource& shader);
+
+        /*!
+         * \brief Forgets which files a stage used. Must be called with the mutex held
+         */
+        void remove_stage_dependencies(StageId stage_id, const renderpack::RenderpackShaderSource& shader);
+
+        [[nodiscard]] std::string normalize_path(const std::string& path) const;
+    };
+} // namespace nova::renderer
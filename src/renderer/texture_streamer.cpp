@@ -0,0 +1,404 @@
+#include "texture_streamer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <Tracy.hpp>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+#include "nova_renderer/camera.hpp"
+#include "nova_renderer/nova_renderer.hpp"
+#include "nova_renderer/resource_loader.hpp"
+#include "nova_renderer/rhi/render_device.hpp"
+#include "nova_renderer/util/frame_arena.hpp"
+#include "nova_renderer/util/worker_pool.hpp"
+
+namespace nova::renderer {
+    static auto logger = spdlog::stdout_color_mt("TextureStreamer");
+
+    constexpr size_t BYTES_PER_MB = 1024 * 1024;
+
+    float projected_screen_size(const Camera& camera, const glm::vec3& center, const float radius, const float viewport_height) {
+        const auto distance = glm::length(center - camera.position);
+        if(distance <= radius) {
+            // The camera is inside the sphere, so it covers the whole screen
+            return viewport_height;
+        }
+
+        const auto projected_radius = radius / (distance * std::tan(camera.field_of_view * 0.5f));
+        return std::min(projected_radius * viewport_height, viewport_height);
+    }
+
+    TextureStreamer::TextureStreamer(NovaRenderer& renderer,
+                                     WorkerPool& worker_pool,
+                                     const NovaSettings::TextureStreamingOptions& options,
+                                     const uint32_t num_in_flight_frames)
+        : renderer{renderer},
+          device{renderer.get_device()},
+          device_resources{renderer.get_resource_manager()},
+          worker_pool{worker_pool},
+          options{options},
+          num_in_flight_frames{num_in_flight_frames},
+          vram_budget{static_cast<size_t>(options.vram_budget_mb) * BYTES_PER_MB},
+          staging_buffers_per_frame(num_in_flight_frames) {}
+
+    TextureStreamer::~TextureStreamer() {
+        // We only get destroyed when the renderer's shutting down, so there's no frames in flight
+        for(const auto& retired_image : retired_images) {
+            device.destroy_texture(retired_image.image);
+        }
+
+        for(const auto& staging_buffers : staging_buffers_per_frame) {
+            for(auto* staging_buffer : staging_buffers) {
+                device_resources.return_staging_buffer(staging_buffer);
+            }
+        }
+    }
+
+    std::optional<uint32_t> TextureStreamer::add_texture(StreamedTextureCreateInfo create_info) {
+        ZoneScoped;
+        if(create_info.num_mips == 0 || !create_info.load_mip) {
+            logger->error("Streamed texture {} must have at least one mip and a mip loader", create_info.name);
+            return std::nullopt;
+        }
+
+        StreamedTexture texture = {};
+        texture.info = std::move(create_info);
+
+        // The tail of the mip chain is always resident, so that the texture always has something to sample
+        texture.min_first_mip = texture.info.num_mips - 1;
+        for(uint32_t mip = 0; mip < texture.info.num_mips; mip++) {
+            const auto mip_size = std::max(texture.info.width, texture.info.height) >> mip;
+            if(mip_size <= options.min_resident_mip_size) {
+                texture.min_first_mip = mip;
+                break;
+            }
+        }
+        texture.resident_first_mip = texture.min_first_mip;
+
+        std::vector<std::vector<uint8_t>> tail_mips;
+        std::vector<const void*> tail_mip_data;
+        for(uint32_t mip = texture.min_first_mip; mip < texture.info.num_mips; mip++) {
+            tail_mips.push_back(texture.info.load_mip(mip));
+            if(tail_mips.back().empty()) {
+                logger->error("Could not load mip {} of texture {}", mip, texture.info.name);
+                return std::nullopt;
+            }
+
+            tail_mip_data.push_back(tail_mips.back().data());
+        }
+
+        const auto resource = device_resources.create_texture_with_mips(texture.info.name,
+                                                                        std::max(texture.info.width >> texture.min_first_mip, 1u),
+                                                                        std::max(texture.info.height >> texture.min_first_mip, 1u),
+                                                                        texture.info.format,
+                                                                        texture.info.num_mips - texture.min_first_mip,
+                                                                        tail_mip_data,
+                                                                        renderer.get_global_allocator());
+        if(!resource) {
+            return std::nullopt;
+        }
+
+        const auto slot = static_cast<uint32_t>(resource->get_idx());
+
+        std::lock_guard lock{textures_mutex};
+        texture.last_used_frame = cur_frame;
+        slots_by_name[texture.info.name] = slot;
+        textures.emplace(slot, std::move(texture));
+
+        return slot;
+    }
+
+    void TextureStreamer::remove_texture(const uint32_t slot) {
+        std::lock_guard lock{textures_mutex};
+
+        const auto itr = textures.find(slot);
+        if(itr == textures.end()) {
+            logger->error("Texture slot {} isn't being streamed", slot);
+            return;
+        }
+
+        // Any load that's in flight for this texture will finish, but nothing will be able to find the texture, so we'll drop it. The
+        // in-flight frames may still sample the texture's image, so it has to outlive them
+        if(auto* image = device_resources.remove_texture_from_table(itr->second.info.name); image != nullptr) {
+            retired_images.emplace_back(RetiredImage{image, cur_frame + num_in_flight_frames});
+        }
+        slots_by_name.erase(itr->second.info.name);
+        textures.erase(itr);
+    }
+
+    void TextureStreamer::report_texture_screen_size(const uint32_t slot, const float size_in_pixels) {
+        std::lock_guard lock{textures_mutex};
+
+        if(const auto itr = textures.find(slot); itr != textures.end()) {
+            auto& texture = itr->second;
+            texture.screen_size = std::max(texture.screen_size, size_in_pixels);
+            texture.last_used_frame = cur_frame;
+            texture.was_reported = true;
+        }
+    }
+
+    void TextureStreamer::report_texture_screen_size(const std::span<const std::string> names, const float size_in_pixels) {
+        std::lock_guard lock{textures_mutex};
+
+        for(const auto& name : names) {
+            const auto slot_itr = slots_by_name.find(name);
+            if(slot_itr == slots_by_name.end()) {
+                continue;
+            }
+
+            auto& texture = textures.at(slot_itr->second);
+            texture.screen_size = std::max(texture.screen_size, size_in_pixels);
+            texture.last_used_frame = cur_frame;
+            texture.was_reported = true;
+        }
+    }
+
+    void TextureStreamer::update(const uint64_t frame_count, mem::FrameArena* arena) {
+        ZoneScoped;
+        std::lock_guard lock{textures_mutex};
+
+        cur_frame = frame_count;
+
+        destroy_retired_images(frame_count);
+        request_mips(frame_count, arena);
+    }
+
+    void TextureStreamer::record_uploads(rhi::RhiRenderCommandList& cmds, const uint32_t frame_idx) {
+        ZoneScoped;
+        // This frame's fence has signaled, so the GPU is done with the uploads it did the last time around
+        auto& staging_buffers = staging_buffers_per_frame[frame_idx];
+        for(auto* staging_buffer : staging_buffers) {
+            device_resources.return_staging_buffer(staging_buffer);
+        }
+        staging_buffers.clear();
+
+        std::lock_guard lock{textures_mutex};
+        upload_loaded_mips(cmds, frame_idx);
+    }
+
+    void TextureStreamer::load_mips(const LoadRequest& request) {
+        ZoneScoped;
+        LoadedMips loaded = {};
+        loaded.slot = request.slot;
+        loaded.request_id = request.request_id;
+        loaded.first_mip = request.first_mip;
+        loaded.mips.reserve(request.num_mips - request.first_mip);
+
+        for(uint32_t mip = request.first_mip; mip < request.num_mips; mip++) {
+            auto pixels = request.load_mip(mip);
+            if(pixels.empty()) {
+                logger->error("Could not load mip {} of the texture in slot {}", mip, request.slot);
+                loaded.mips.clear();
+                break;
+            }
+
+            loaded.mips.push_back(std::move(pixels));
+        }
+
+        std::lock_guard lock{loaded_mutex};
+        loaded_mips.push_back(std::move(loaded));
+    }
+
+    void TextureStreamer::destroy_retired_images(const uint64_t frame_count) {
+        std::erase_if(retired_images, [&](const RetiredImage& retired_image) {
+            if(retired_image.destroy_frame <= frame_count) {
+                device.destroy_texture(retired_image.image);
+                return true;
+            }
+
+            return false;
+        });
+    }
+
+    void TextureStreamer::upload_loaded_mips(rhi::RhiRenderCommandList& cmds, const uint32_t frame_idx) {
+        ZoneScoped;
+        {
+            std::lock_guard lock{loaded_mutex};
+            std::swap(loads_to_upload, loaded_mips);
+        }
+
+        const auto upload_budget = static_cast<size_t>(options.max_upload_mb_per_frame) * BYTES_PER_MB;
+        size_t bytes_uploaded = 0;
+
+        for(auto& loaded : loads_to_upload) {
+            const auto itr = textures.find(loaded.slot);
+            if(itr == textures.end() || itr->second.pending_request != loaded.request_id) {
+                // The texture was removed or asked for different mips while we were loading these
+                continue;
+            }
+
+            auto& texture = itr->second;
+            if(loaded.mips.empty()) {
+                // Don't keep asking for mips that failed to load. We'll try again when the texture wants different mips
+                texture.is_load_in_flight = false;
+                texture.failed_first_mip = loaded.first_mip;
+                continue;
+            }
+
+            const auto size = mip_chain_size(texture, loaded.first_mip);
+            if(bytes_uploaded > 0 && bytes_uploaded + size > upload_budget) {
+                // Out of upload budget for this frame. Try again next frame
+                std::lock_guard lock{loaded_mutex};
+                loaded_mips.push_back(std::move(loaded));
+                continue;
+            }
+
+            mem::FrameVector<const void*> mip_data{cmds.get_frame_arena()};
+            mip_data.reserve(loaded.mips.size());
+            for(const auto& mip : loaded.mips) {
+                mip_data.push_back(mip.data());
+            }
+
+            const auto width = std::max(texture.info.width >> loaded.first_mip, 1u);
+            const auto height = std::max(texture.info.height >> loaded.first_mip, 1u);
+            // Create the image without any data, so that the upload goes into this frame's commands rather than its own submission
+            auto* image = device_resources.create_texture_image(texture.info.name,
+                                                                width,
+                                                                height,
+                                                                texture.info.format,
+                                                                texture.info.num_mips - loaded.first_mip,
+                                                                {},
+                                                                renderer.get_global_allocator());
+            texture.is_load_in_flight = false;
+            if(image == nullptr) {
+                logger->error("Could not create image for mips {}+ of texture {}", loaded.first_mip, texture.info.name);
+                continue;
+            }
+
+            device_resources.record_texture_image_upload(image,
+                                                         width,
+                                                         height,
+                                                         texture.info.format,
+                                                         mip_data,
+                                                         cmds,
+                                                         rhi::QueueType::Graphics,
+                                                         staging_buffers_per_frame[frame_idx]);
+
+            auto* old_image = device_resources.replace_texture_image(loaded.slot, image, width, height);
+            retired_images.emplace_back(RetiredImage{old_image, cur_frame + num_in_flight_frames});
+
+            texture.resident_first_mip = loaded.first_mip;
+            bytes_uploaded += size;
+        }
+
+        loads_to_upload.clear();
+    }
+
+    void TextureStreamer::request_mips(const uint64_t frame_count, mem::FrameArena* arena) {
+        ZoneScoped;
+        struct Residency {
+            uint32_t slot;
+            StreamedTexture* texture;
+            uint32_t wanted_first_mip;
+        };
+
+        mem::FrameVector<Residency> residencies{arena};
+        residencies.reserve(textures.size());
+
+        size_t total_size = 0;
+        size_t cur_resident_size = 0;
+
+        for(auto& [slot, texture] : textures) {
+            cur_resident_size += mip_chain_size(texture, texture.resident_first_mip);
+
+            if(texture.screen_size > 0) {
+                texture.last_screen_size = texture.screen_size;
+            }
+            texture.screen_size = 0;
+
+            auto wanted_first_mip = texture.min_first_mip;
+            if(!texture.was_reported) {
+                // Nothing tells us how large this texture is on screen, so give it every mip and let the budget decide
+                wanted_first_mip = 0;
+
+            } else if(frame_count - texture.last_used_frame <= options.frames_until_eviction) {
+                wanted_first_mip = first_mip_for_screen_size(texture, texture.last_screen_size);
+            }
+
+            residencies.emplace_back(Residency{slot, &texture, wanted_first_mip});
+            total_size += mip_chain_size(texture, wanted_first_mip);
+        }
+
+        resident_size = cur_resident_size;
+
+        // Drop the finest mip of the textures that are smallest on screen, one mip from each texture per pass, until everything fits
+        if(total_size > vram_budget) {
+            std::sort(residencies.begin(), residencies.end(), [](const Residency& a, const Residency& b) {
+                return a.texture->last_screen_size < b.texture->last_screen_size;
+            });
+
+            auto dropped_any = true;
+            while(total_size > vram_budget && dropped_any) {
+                dropped_any = false;
+
+                for(auto& residency : residencies) {
+                    if(total_size <= vram_budget) {
+                        break;
+                    }
+
+                    if(residency.wanted_first_mip < residency.texture->min_first_mip) {
+                        total_size -= mip_chain_size(*residency.texture, residency.wanted_first_mip) -
+                                      mip_chain_size(*residency.texture, residency.wanted_first_mip + 1);
+                        residency.wanted_first_mip++;
+                        dropped_any = true;
+                    }
+                }
+            }
+        }
+
+        for(const auto& [slot, texture, wanted_first_mip] : residencies) {
+            if(texture->is_load_in_flight || texture->resident_first_mip == wanted_first_mip ||
+               texture->failed_first_mip == wanted_first_mip) {
+                continue;
+            }
+
+            texture->failed_first_mip = NO_MIP;
+            texture->pending_request = next_request_id++;
+            texture->is_load_in_flight = true;
+
+            // Evictions free up VRAM and only load small mips, so they go first. Otherwise, the textures that are largest on screen go
+            // first, since they're the ones that look the blurriest
+            const auto priority = wanted_first_mip > texture->resident_first_mip ? std::numeric_limits<float>::max() :
+                                                                                   texture->last_screen_size;
+
+            worker_pool.submit([this, request = LoadRequest{slot, texture->pending_request, wanted_first_mip, texture->info.num_mips,
+                                                            texture->info.load_mip}] { load_mips(request); },
+                               priority);
+        }
+    }
+
+    void TextureStreamer::set_vram_budget(const size_t budget_in_bytes) { vram_budget = budget_in_bytes; }
+
+    size_t TextureStreamer::get_vram_budget() const { return vram_budget; }
+
+    size_t TextureStreamer::get_resident_size() const { return resident_size; }
+
+    uint32_t TextureStreamer::first_mip_for_screen_size(const StreamedTexture& texture, const float screen_size) {
+        if(screen_size <= 0) {
+            return texture.min_first_mip;
+        }
+
+        // Each mip halves the resolution, so we can skip one mip for every time the texture's size divides evenly by the screen size
+        const auto max_dimension = static_cast<float>(std::max(texture.info.width, texture.info.height));
+        const auto mips_to_skip = std::floor(std::log2(max_dimension / screen_size));
+        if(mips_to_skip <= 0) {
+            return 0;
+        }
+
+        return std::min(static_cast<uint32_t>(mips_to_skip), texture.min_first_mip);
+    }
+
+    size_t TextureStreamer::mip_chain_size(const StreamedTexture& texture, const uint32_t first_mip) {
+        size_t size = 0;
+        for(uint32_t mip = first_mip; mip < texture.info.num_mips; mip++) {
+            const auto width = std::max(texture.info.width >> mip, 1u);
+            const auto height = std::max(texture.info.height >> mip, 1u);
+            size += rhi::get_image_size_in_bytes(texture.info.format, width, height);
+        }
+
+        return size;
+    }
+} // namespace nova::renderer
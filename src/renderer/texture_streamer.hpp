@@ -0,0 +1,312 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "nova_renderer/nova_settings.hpp"
+#include "nova_renderer/rhi/forward_decls.hpp"
+#include "nova_renderer/rhi/rhi_enums.hpp"
+
+namespace nova::mem {
+    class FrameArena;
+}
+
+namespace nova::renderer {
+    class Camera;
+    class NovaRenderer;
+    class DeviceResources;
+    class WorkerPool;
+
+    namespace rhi {
+        class RenderDevice;
+    }
+
+    /*!
+     * \brief Loads the pixels of one mip of a texture
+     *
+     * Called on the streaming worker threads, so it must be safe to call from any thread. Returns tightly-packed pixels, or an empty vector
+     * if the mip couldn't be loaded
+     */
+    using MipLoader = std::function<std::vector<uint8_t>(uint32_t mip_level)>;
+
+    struct StreamedTextureCreateInfo {
+        std::string name;
+
+        /*!
+         * \brief Width of the texture's first mip, in pixels
+         */
+        uint32_t width;
+
+        /*!
+         * \brief Height of the texture's first mip, in pixels
+         */
+        uint32_t height;
+
+        uint32_t num_mips;
+
+        rhi::PixelFormat format;
+
+        MipLoader load_mip;
+    };
+
+    /*!
+     * \brief Calculates how many pixels tall a sphere is when the camera renders it
+     *
+     * Use this to get the screen size to pass to `TextureStreamer::report_texture_screen_size`
+     */
+    [[nodiscard]] float projected_screen_size(const Camera& camera, const glm::vec3& center, float radius, float viewport_height);
+
+    /*!
+     * \brief Streams texture mips in and out of VRAM
+     *
+     * Every streamed texture always has its smallest mips resident, so there's always something to sample. Each frame, whatever draws
+     * textured things tells the streamer how large the textures were on screen. The streamer works out which mips each texture needs from
+     * that, drops mips from the textures that are smallest on screen until everything fits in the VRAM budget, then loads the mips that
+     * changed on the worker pool. Textures that nothing has reported a size for yet want every mip, so hosts that don't report sizes
+     * still get sharp textures when they fit in the budget. Once the mips are loaded, the streamer uploads them into a new image with exactly the resident mips and
+     * points the texture's slot in the texture table at that image
+     *
+     * Uploads are recorded into the frame's command list in `record_uploads`, and are limited to a few megabytes a frame
+     */
+    class TextureStreamer {
+    public:
+        TextureStreamer(NovaRenderer& renderer,
+                        WorkerPool& worker_pool,
+                        const NovaSettings::TextureStreamingOptions& options,
+                        uint32_t num_in_flight_frames);
+
+        TextureStreamer(const TextureStreamer& other) = delete;
+        TextureStreamer& operator=(const TextureStreamer& other) = delete;
+
+        TextureStreamer(TextureStreamer&& old) noexcept = delete;
+        TextureStreamer& operator=(TextureStreamer&& old) noexcept = delete;
+
+        ~TextureStreamer();
+
+        /*!
+         * \brief Adds a texture to the texture table and starts streaming it
+         *
+         * Loads the texture's smallest mips right away, on the calling thread. Everything else is loaded when the texture gets used
+         *
+         * \return The texture's slot in the texture table, or an empty optional if the texture couldn't be created
+         */
+        [[nodiscard]] std::optional<uint32_t> add_texture(StreamedTextureCreateInfo create_info);
+
+        /*!
+         * \brief Stops streaming the texture in the given slot, and destroys its image once the in-flight frames are done with it
+         */
+        void remove_texture(uint32_t slot);
+
+        /*!
+         * \brief Tells the streamer how large a texture was on screen this frame, in pixels
+         *
+         * May be called any number of times per texture per frame, from any thread. The streamer uses the largest size it was told
+         */
+        void report_texture_screen_size(uint32_t slot, float size_in_pixels);
+
+        /*!
+         * \brief Tells the streamer how large the textures with the given names were on screen this frame, in pixels
+         *
+         * Names of textures that aren't streamed are ignored, so you can pass the names of everything that a material binds
+         */
+        void report_texture_screen_size(std::span<const std::string> names, float size_in_pixels);
+
+        /*!
+         * \brief Destroys images that the GPU is done with, then decides which mips to load next
+         *
+         * Call this once a frame from the render thread, after waiting for the frame's fence
+         *
+         * \param frame_count The index of the current frame
+         * \param arena The current frame's arena, for temporary allocations. May be nullptr
+         */
+        void update(uint64_t frame_count, mem::FrameArena* arena);
+
+        /*!
+         * \brief Records uploads of the mips that the worker pool has loaded into the frame's command list
+         *
+         * Call this once a frame from the render thread, after `update`. The staging buffers are returned when the frame comes around
+         * again
+         */
+        void record_uploads(rhi::RhiRenderCommandList& cmds, uint32_t frame_idx);
+
+        /*!
+         * \brief Changes how much VRAM streamed textures may use
+         *
+         * Takes effect on the next `update`. Textures drop their finest mips until they fit, but they never drop their always-resident
+         * mips, so the textures may still use more than this
+         */
+        void set_vram_budget(size_t budget_in_bytes);
+
+        [[nodiscard]] size_t get_vram_budget() const;
+
+        /*!
+         * \brief Bytes of VRAM that the streamed textures' current images use, as of the last `update`
+         */
+        [[nodiscard]] size_t get_resident_size() const;
+
+    private:
+        static constexpr uint32_t NO_MIP = std::numeric_limits<uint32_t>::max();
+
+        struct StreamedTexture {
+            StreamedTextureCreateInfo info;
+
+            /*!
+             * \brief The first of the mips which are always resident
+             */
+            uint32_t min_first_mip;
+
+            /*!
+             * \brief The first mip of the texture's current image
+             */
+            uint32_t resident_first_mip;
+
+            /*!
+             * \brief Identifies the texture's in-flight load, so we can ignore loads that finish after the texture was removed or re-requested
+             */
+            uint64_t pending_request = 0;
+
+            bool is_load_in_flight = false;
+
+            /*!
+             * \brief The first mip of the last load that failed, or NO_MIP if the last load succeeded
+             */
+            uint32_t failed_first_mip = NO_MIP;
+
+            /*!
+             * \brief Largest size that the texture had on screen during the current frame
+             */
+            float screen_size = 0;
+
+            /*!
+             * \brief Largest size that the texture had on screen during the last frame it was used in
+             */
+            float last_screen_size = 0;
+
+            uint64_t last_used_frame = 0;
+
+            /*!
+             * \brief Whether anything has ever reported the texture's size on screen
+             */
+            bool was_reported = false;
+        };
+
+        struct LoadRequest {
+            uint32_t slot;
+
+            uint64_t request_id;
+
+            uint32_t first_mip;
+
+            uint32_t num_mips;
+
+            MipLoader load_mip;
+        };
+
+        struct LoadedMips {
+            uint32_t slot;
+
+            uint64_t request_id;
+
+            uint32_t first_mip;
+
+            /*!
+             * \brief Pixels for every mip from `first_mip` to the end of the chain. Empty if any of them couldn't be loaded
+             */
+            std::vector<std::vector<uint8_t>> mips;
+        };
+
+        struct RetiredImage {
+            rhi::RhiImage* image;
+
+            /*!
+             * \brief The frame on which the GPU is definitely done with the image
+             */
+            uint64_t destroy_frame;
+        };
+
+        NovaRenderer& renderer;
+
+        rhi::RenderDevice& device;
+
+        DeviceResources& device_resources;
+
+        WorkerPool& worker_pool;
+
+        NovaSettings::TextureStreamingOptions options;
+
+        uint32_t num_in_flight_frames;
+
+        size_t vram_budget;
+
+        size_t resident_size = 0;
+
+        uint64_t cur_frame = 0;
+
+        uint64_t next_request_id = 1;
+
+        /*!
+         * \brief Guards the streamed textures, since they're reported and added from other threads
+         */
+        std::mutex textures_mutex;
+
+        /*!
+         * \brief All streamed textures, by their slot in the texture table
+         */
+        std::unordered_map<uint32_t, StreamedTexture> textures;
+
+        std::unordered_map<std::string, uint32_t> slots_by_name;
+
+        std::vector<RetiredImage> retired_images;
+
+        /*!
+         * \brief Staging buffers that each in-flight frame's uploads read from
+         */
+        std::vector<std::vector<rhi::RhiBuffer*>> staging_buffers_per_frame;
+
+        std::mutex loaded_mutex;
+
+        std::vector<LoadedMips> loaded_mips;
+
+        /*!
+         * \brief The loads that `upload_loaded_mips` is working through. Swapped with `loaded_mips` so that neither vector gives up its
+         * capacity
+         */
+        std::vector<LoadedMips> loads_to_upload;
+
+        /*!
+         * \brief Loads the requested mips. Runs on the worker pool
+         */
+        void load_mips(const LoadRequest& request);
+
+        void destroy_retired_images(uint64_t frame_count);
+
+        /*!
+         * \brief Replaces textures' images with the mips that the worker pool has loaded, until we hit the upload budget for this frame
+         */
+        void upload_loaded_mips(rhi::RhiRenderCommandList& cmds, uint32_t frame_idx);
+
+        /*!
+         * \brief Decides which mips every texture should have, and starts loading the mips of the textures which don't have them
+         */
+        void request_mips(uint64_t frame_count, mem::FrameArena* arena);
+
+        /*!
+         * \brief The first mip which has enough texels for the texture to look sharp at the given size on screen
+         */
+        [[nodiscard]] static uint32_t first_mip_for_screen_size(const StreamedTexture& texture, float screen_size);
+
+        /*!
+         * \brief Bytes of VRAM that a texture uses when every mip from `first_mip` to the end of the chain is resident
+         */
+        [[nodiscard]] static size_t mip_chain_size(const StreamedTexture& texture, uint32_t first_mip);
+    };
+} // namespace nova::renderer
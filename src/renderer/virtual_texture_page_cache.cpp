@@ -0,0 +1,220 @@
+#include "virtual_texture_page_cache.hpp"
+
+#include <algorithm>
+
+#include <Tracy.hpp>
+
+namespace nova::renderer {
+    constexpr uint32_t PAGE_COORD_MASK = MAX_VIRTUAL_TEXTURE_SIZE_IN_PAGES - 1;
+    constexpr uint32_t MIP_MASK = MAX_VIRTUAL_TEXTURE_MIPS - 1;
+    constexpr uint32_t TEXTURE_MASK = MAX_NUM_VIRTUAL_TEXTURES - 1;
+
+    constexpr uint32_t Y_SHIFT = 0;
+    constexpr uint32_t X_SHIFT = VIRTUAL_TEXTURE_PAGE_COORD_BITS;
+    constexpr uint32_t MIP_SHIFT = X_SHIFT + VIRTUAL_TEXTURE_PAGE_COORD_BITS;
+    constexpr uint32_t TEXTURE_SHIFT = MIP_SHIFT + VIRTUAL_TEXTURE_MIP_BITS;
+
+    static_assert(TEXTURE_SHIFT + VIRTUAL_TEXTURE_ID_BITS == 32, "Virtual page IDs must fill a uint32_t exactly");
+
+    uint32_t VirtualPageId::pack() const {
+        return ((texture & TEXTURE_MASK) << TEXTURE_SHIFT) | ((mip & MIP_MASK) << MIP_SHIFT) | ((x & PAGE_COORD_MASK) << X_SHIFT) |
+               ((y & PAGE_COORD_MASK) << Y_SHIFT);
+    }
+
+    VirtualPageId VirtualPageId::unpack(const uint32_t packed) {
+        return {(packed >> TEXTURE_SHIFT) & TEXTURE_MASK,
+                (packed >> MIP_SHIFT) & MIP_MASK,
+                (packed >> X_SHIFT) & PAGE_COORD_MASK,
+                (packed >> Y_SHIFT) & PAGE_COORD_MASK};
+    }
+
+    VirtualPageId VirtualPageId::parent() const { return {texture, mip + 1, x / 2, y / 2}; }
+
+    VirtualTexturePageCache::VirtualTexturePageCache(const uint32_t width_in_pages,
+                                                     const uint32_t height_in_pages,
+                                                     const uint32_t eviction_delay_frames)
+        : eviction_delay_frames{eviction_delay_frames} {
+        free_pages.reserve(static_cast<size_t>(width_in_pages) * height_in_pages);
+
+        // Hand out pages in row-major order, which makes the cache easy to read in a graphics debugger
+        for(uint32_t y = height_in_pages; y > 0; y--) {
+            for(uint32_t x = width_in_pages; x > 0; x--) {
+                free_pages.emplace_back(PhysicalPage{x - 1, y - 1});
+            }
+        }
+    }
+
+    void VirtualTexturePageCache::add_texture(const uint32_t texture, const uint32_t num_mips) {
+        num_mips_per_texture[texture] = std::min(num_mips, MAX_VIRTUAL_TEXTURE_MIPS);
+    }
+
+    void VirtualTexturePageCache::remove_texture(const uint32_t texture) {
+        num_mips_per_texture.erase(texture);
+
+        const auto is_from_texture = [&](const uint32_t packed) { return VirtualPageId::unpack(packed).texture == texture; };
+
+        std::erase_if(resident_pages, [&](const auto& pair) {
+            if(!is_from_texture(pair.first)) {
+                return false;
+            }
+
+            const auto& page = pair.second;
+            if(!page.is_pinned) {
+                lru.erase(page.lru_position);
+            }
+            free_pages.push_back(page.physical_page);
+
+            return true;
+        });
+
+        std::erase_if(requests, [&](const auto& pair) { return is_from_texture(pair.first); });
+        std::erase_if(pending_pages, is_from_texture);
+    }
+
+    void VirtualTexturePageCache::process_feedback(const std::span<const uint32_t> feedback, const uint64_t frame) {
+        ZoneScoped;
+        requests.clear();
+
+        // Lots of pixels want the same page, so only look at each page once
+        auto& unique_pages = sorted_feedback;
+        unique_pages.assign(feedback.begin(), feedback.end());
+        std::sort(unique_pages.begin(), unique_pages.end());
+
+        for(size_t i = 0; i < unique_pages.size();) {
+            const auto packed = unique_pages[i];
+
+            uint32_t num_requests = 0;
+            while(i < unique_pages.size() && unique_pages[i] == packed) {
+                num_requests++;
+                i++;
+            }
+
+            auto page = VirtualPageId::unpack(packed);
+            const auto num_mips_itr = num_mips_per_texture.find(page.texture);
+            if(num_mips_itr == num_mips_per_texture.end()) {
+                continue;
+            }
+
+            // Shaders fall back to coarser pages when the page they want isn't resident, so everything up the mip chain is in use too
+            for(; page.mip < num_mips_itr->second; page = page.parent()) {
+                const auto page_packed = page.pack();
+
+                if(const auto resident_itr = resident_pages.find(page_packed); resident_itr != resident_pages.end()) {
+                    touch(resident_itr->second, frame);
+
+                } else if(!pending_pages.contains(page_packed)) {
+                    requests[page_packed] += num_requests;
+                }
+            }
+        }
+    }
+
+    std::vector<VirtualPageId> VirtualTexturePageCache::take_page_requests(const uint32_t max_requests) {
+        ZoneScoped;
+        std::vector<std::pair<VirtualPageId, uint32_t>> sorted_requests;
+        sorted_requests.reserve(requests.size());
+        for(const auto& [packed, num_requests] : requests) {
+            sorted_requests.emplace_back(VirtualPageId::unpack(packed), num_requests);
+        }
+
+        const auto num_to_take = std::min(static_cast<size_t>(max_requests), sorted_requests.size());
+        std::partial_sort(sorted_requests.begin(),
+                          sorted_requests.begin() + num_to_take,
+                          sorted_requests.end(),
+                          [](const auto& a, const auto& b) {
+                              if(a.first.mip != b.first.mip) {
+                                  return a.first.mip > b.first.mip;
+                              }
+
+                              return a.second > b.second;
+                          });
+
+        std::vector<VirtualPageId> pages;
+        pages.reserve(num_to_take);
+        for(size_t i = 0; i < num_to_take; i++) {
+            const auto& page = sorted_requests[i].first;
+            const auto packed = page.pack();
+
+            requests.erase(packed);
+            pending_pages.insert(packed);
+            pages.push_back(page);
+        }
+
+        return pages;
+    }
+
+    std::optional<PageMapping> VirtualTexturePageCache::map_page(const VirtualPageId page, const uint64_t frame, const bool is_pinned) {
+        const auto packed = page.pack();
+
+        if(const auto itr = resident_pages.find(packed); itr != resident_pages.end()) {
+            auto& resident_page = itr->second;
+            pending_pages.erase(packed);
+            touch(resident_page, frame);
+
+            if(is_pinned && !resident_page.is_pinned) {
+                lru.erase(resident_page.lru_position);
+                resident_page.is_pinned = true;
+            }
+
+            return PageMapping{resident_page.physical_page, std::nullopt};
+        }
+
+        PageMapping mapping = {};
+
+        if(!free_pages.empty()) {
+            mapping.physical_page = free_pages.back();
+            free_pages.pop_back();
+
+        } else {
+            if(lru.empty()) {
+                return std::nullopt;
+            }
+
+            // The least recently used page is at the back. If even that one was used too recently, every page was
+            const auto evicted_packed = lru.back();
+            const auto evicted_itr = resident_pages.find(evicted_packed);
+            if(frame - evicted_itr->second.last_used_frame <= eviction_delay_frames) {
+                return std::nullopt;
+            }
+
+            mapping.physical_page = evicted_itr->second.physical_page;
+            mapping.evicted_page = VirtualPageId::unpack(evicted_packed);
+
+            lru.pop_back();
+            resident_pages.erase(evicted_itr);
+        }
+
+        ResidentPage resident_page = {};
+        resident_page.physical_page = mapping.physical_page;
+        resident_page.last_used_frame = frame;
+        resident_page.is_pinned = is_pinned;
+        if(!is_pinned) {
+            lru.push_front(packed);
+            resident_page.lru_position = lru.begin();
+        }
+
+        resident_pages.emplace(packed, resident_page);
+        pending_pages.erase(packed);
+
+        return mapping;
+    }
+
+    void VirtualTexturePageCache::cancel_request(const VirtualPageId page) { pending_pages.erase(page.pack()); }
+
+    std::optional<PhysicalPage> VirtualTexturePageCache::find_page(const VirtualPageId page) const {
+        if(const auto itr = resident_pages.find(page.pack()); itr != resident_pages.end()) {
+            return itr->second.physical_page;
+        }
+
+        return std::nullopt;
+    }
+
+    size_t VirtualTexturePageCache::get_num_free_pages() const { return free_pages.size(); }
+
+    void VirtualTexturePageCache::touch(ResidentPage& page, const uint64_t frame) {
+        page.last_used_frame = frame;
+        if(!page.is_pinned) {
+            lru.splice(lru.begin(), lru, page.lru_position);
+        }
+    }
+} // namespace nova::renderer
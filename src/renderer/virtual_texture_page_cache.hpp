@@ -0,0 +1,190 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace nova::renderer {
+    /*!
+     * \brief Width and height of a virtual texture page, in pixels
+     */
+    constexpr uint32_t VIRTUAL_TEXTURE_PAGE_SIZE = 128;
+
+    /*!
+     * \brief How many bits of a feedback entry hold each part of the page's ID. Must match `unpack_virtual_page` in the standard pipeline
+     * layout HLSL
+     */
+    constexpr uint32_t VIRTUAL_TEXTURE_ID_BITS = 8;
+    constexpr uint32_t VIRTUAL_TEXTURE_MIP_BITS = 4;
+    constexpr uint32_t VIRTUAL_TEXTURE_PAGE_COORD_BITS = 10;
+
+    constexpr uint32_t MAX_NUM_VIRTUAL_TEXTURES = 1u << VIRTUAL_TEXTURE_ID_BITS;
+    constexpr uint32_t MAX_VIRTUAL_TEXTURE_MIPS = 1u << VIRTUAL_TEXTURE_MIP_BITS;
+    constexpr uint32_t MAX_VIRTUAL_TEXTURE_SIZE_IN_PAGES = 1u << VIRTUAL_TEXTURE_PAGE_COORD_BITS;
+
+    /*!
+     * \brief Identifies one page of one mip of a virtual texture
+     */
+    struct VirtualPageId {
+        uint32_t texture = 0;
+        uint32_t mip = 0;
+        uint32_t x = 0;
+        uint32_t y = 0;
+
+        /*!
+         * \brief Packs the ID into the format that shaders write to the feedback buffer
+         */
+        [[nodiscard]] uint32_t pack() const;
+
+        [[nodiscard]] static VirtualPageId unpack(uint32_t packed);
+
+        /*!
+         * \brief The page in the next mip which covers this page
+         */
+        [[nodiscard]] VirtualPageId parent() const;
+
+        bool operator==(const VirtualPageId& other) const = default;
+    };
+
+    /*!
+     * \brief Location of a page in the physical page cache, in pages
+     */
+    struct PhysicalPage {
+        uint32_t x = 0;
+        uint32_t y = 0;
+
+        bool operator==(const PhysicalPage& other) const = default;
+    };
+
+    struct PageMapping {
+        PhysicalPage physical_page;
+
+        /*!
+         * \brief The page which used to live in `physical_page`, if we had to evict one to make room
+         */
+        std::optional<VirtualPageId> evicted_page;
+    };
+
+    /*!
+     * \brief Decides which virtual texture pages live in the physical page cache
+     *
+     * This is all CPU-side bookkeeping, it doesn't touch the GPU at all. Give it the page IDs that shaders wrote to the feedback buffer, ask
+     * it which pages to load next, then tell it when those pages are loaded and it'll tell you where they go in the cache and which page
+     * they replaced
+     *
+     * Requesting a page also requests every coarser page that covers it, so shaders always have something to fall back to. When the cache
+     * is full, the least recently used page is evicted - but only if it wasn't used in the last few frames, since the GPU might still be
+     * reading it. Pinned pages are never evicted
+     *
+     * Not thread-safe. `VirtualTextureSystem` only uses it from one worker job at a time
+     */
+    class VirtualTexturePageCache {
+    public:
+        /*!
+         * \param width_in_pages Width of the physical page cache, in pages
+         * \param height_in_pages Height of the physical page cache, in pages
+         * \param eviction_delay_frames Pages which were used within this many frames will not be evicted
+         */
+        VirtualTexturePageCache(uint32_t width_in_pages, uint32_t height_in_pages, uint32_t eviction_delay_frames);
+
+        /*!
+         * \brief Tells the cache about a virtual texture, so that it knows where the texture's mip chain ends
+         */
+        void add_texture(uint32_t texture, uint32_t num_mips);
+
+        /*!
+         * \brief Forgets a virtual texture, freeing all its pages
+         */
+        void remove_texture(uint32_t texture);
+
+        /*!
+         * \brief Records which pages shaders wanted during a frame
+         *
+         * Entries may be in any order and may repeat. Entries for textures that the cache doesn't know about are ignored. Replaces the
+         * requests from any earlier feedback, since pages which are still needed will show up in the new feedback again
+         *
+         * \param feedback Packed page IDs, see `VirtualPageId::pack`
+         * \param frame The frame that the feedback came from
+         */
+        void process_feedback(std::span<const uint32_t> feedback, uint64_t frame);
+
+        /*!
+         * \brief Takes the most important requested pages, so that you can load them
+         *
+         * Coarse pages come first, since finer pages need them as a fallback. Pages which were requested more often come next. The cache
+         * won't hand out these pages again until you map them or cancel them
+         */
+        [[nodiscard]] std::vector<VirtualPageId> take_page_requests(uint32_t max_requests);
+
+        /*!
+         * \brief Finds a place in the cache for a page which has been loaded
+         *
+         * \param page The page to map
+         * \param frame The current frame
+         * \param is_pinned If true, the page is never evicted. Pins the page if it's already in the cache
+         *
+         * \return Where the page lives, or an empty optional if every page in the cache was used too recently to evict
+         */
+        [[nodiscard]] std::optional<PageMapping> map_page(VirtualPageId page, uint64_t frame, bool is_pinned = false);
+
+        /*!
+         * \brief Gives up on a page from `take_page_requests`, for instance because it couldn't be loaded
+         */
+        void cancel_request(VirtualPageId page);
+
+        [[nodiscard]] std::optional<PhysicalPage> find_page(VirtualPageId page) const;
+
+        [[nodiscard]] size_t get_num_free_pages() const;
+
+    private:
+        struct ResidentPage {
+            PhysicalPage physical_page;
+
+            uint64_t last_used_frame;
+
+            bool is_pinned;
+
+            /*!
+             * \brief Position in the LRU list. Only valid for unpinned pages
+             */
+            std::list<uint32_t>::iterator lru_position;
+        };
+
+        uint32_t eviction_delay_frames;
+
+        std::unordered_map<uint32_t, uint32_t> num_mips_per_texture;
+
+        std::vector<PhysicalPage> free_pages;
+
+        /*!
+         * \brief Every page in the cache, by packed page ID
+         */
+        std::unordered_map<uint32_t, ResidentPage> resident_pages;
+
+        /*!
+         * \brief Packed IDs of every unpinned page in the cache, most recently used at the front
+         */
+        std::list<uint32_t> lru;
+
+        /*!
+         * \brief How many times each page that isn't in the cache was requested in the latest feedback
+         */
+        std::unordered_map<uint32_t, uint32_t> requests;
+
+        /*!
+         * \brief Pages which were handed out by `take_page_requests` and haven't been mapped or cancelled yet
+         */
+        std::unordered_set<uint32_t> pending_pages;
+
+        /*!
+         * \brief Scratch space for `process_feedback`, kept around so that processing feedback doesn't allocate every frame
+         */
+        std::vector<uint32_t> sorted_feedback;
+
+        void touch(ResidentPage& page, uint64_t frame);
+    };
+} // namespace nova::renderer
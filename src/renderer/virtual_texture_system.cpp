@@ -0,0 +1,559 @@
+#include "virtual_texture_system.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+
+#include <Tracy.hpp>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+#include "nova_renderer/nova_renderer.hpp"
+#include "nova_renderer/resource_loader.hpp"
+#include "nova_renderer/rhi/command_list.hpp"
+#include "nova_renderer/rhi/render_device.hpp"
+#include "nova_renderer/util/frame_arena.hpp"
+#include "nova_renderer/util/worker_pool.hpp"
+
+namespace nova::renderer {
+    static auto logger = spdlog::stdout_color_mt("VirtualTextureSystem");
+
+    constexpr const char* PHYSICAL_CACHE_NAME = "NovaVirtualTexturePageCache";
+
+    constexpr size_t PAGE_SIZE_IN_BYTES = VIRTUAL_TEXTURE_PAGE_SIZE * VIRTUAL_TEXTURE_PAGE_SIZE * 4;
+
+    /*!
+     * \brief Page table entries are RGBA8 texels, and every physical page coordinate must fit in one channel
+     */
+    constexpr uint32_t MAX_CACHE_SIZE_IN_PAGES = 256;
+
+    constexpr uint32_t PAGE_TABLE_ENTRY_VALID = 0xFFu << 24;
+
+    static uint32_t pack_page_table_entry(const PhysicalPage physical_page, const uint32_t mip) {
+        return physical_page.x | (physical_page.y << 8) | (mip << 16) | PAGE_TABLE_ENTRY_VALID;
+    }
+
+    static bool is_page_table_entry_valid(const uint32_t entry) { return (entry & PAGE_TABLE_ENTRY_VALID) != 0; }
+
+    static uint32_t get_page_table_entry_mip(const uint32_t entry) { return (entry >> 16) & 0xFF; }
+
+    uint32_t VirtualTextureSystem::VirtualTexture::get_width_in_pages(const uint32_t mip) const {
+        return (info.width / VIRTUAL_TEXTURE_PAGE_SIZE) >> mip;
+    }
+
+    uint32_t VirtualTextureSystem::VirtualTexture::get_height_in_pages(const uint32_t mip) const {
+        return (info.height / VIRTUAL_TEXTURE_PAGE_SIZE) >> mip;
+    }
+
+    VirtualTextureSystem::VirtualTextureSystem(NovaRenderer& renderer,
+                                               WorkerPool& worker_pool,
+                                               const NovaSettings::VirtualTextureOptions& options,
+                                               const uint32_t num_in_flight_frames)
+        : device{renderer.get_device()},
+          device_resources{renderer.get_resource_manager()},
+          renderer{renderer},
+          worker_pool{worker_pool},
+          options{options},
+          num_in_flight_frames{num_in_flight_frames},
+          cache_size_in_pages{std::clamp(options.cache_size_in_pages, 1u, MAX_CACHE_SIZE_IN_PAGES)},
+          virtual_texture_infos{MAX_NUM_VIRTUAL_TEXTURES, num_in_flight_frames, device},
+          // Feedback is a few frames old by the time we read it, so pages need to go unused for longer than that before we evict them
+          page_cache{cache_size_in_pages, cache_size_in_pages, num_in_flight_frames * 2},
+          staging_buffers_per_frame(num_in_flight_frames) {
+        ZoneScoped;
+        if(cache_size_in_pages != options.cache_size_in_pages) {
+            logger->warn("Virtual texture cache size of {} pages is out of range, using {} pages instead",
+                         options.cache_size_in_pages,
+                         cache_size_in_pages);
+        }
+
+        // The physical cache has no initial data, we transition it from the Undefined state the first time we copy a page into it
+        const auto cache_size = cache_size_in_pages * VIRTUAL_TEXTURE_PAGE_SIZE;
+        const auto physical_cache = device_resources.create_texture_with_mips(PHYSICAL_CACHE_NAME,
+                                                                              cache_size,
+                                                                              cache_size,
+                                                                              rhi::PixelFormat::Rgba8,
+                                                                              1,
+                                                                              {},
+                                                                              renderer.get_global_allocator());
+        if(physical_cache) {
+            physical_cache_slot = static_cast<uint32_t>(physical_cache->get_idx());
+            physical_cache_image = (*physical_cache)->image;
+
+        } else {
+            logger->error("Could not create the virtual texture page cache. Virtual textures will not work");
+        }
+
+        rhi::RhiBufferCreateInfo feedback_buffer_create_info = {};
+        feedback_buffer_create_info.size = (options.max_feedback_entries + 1) * sizeof(uint32_t);
+        feedback_buffer_create_info.buffer_usage = rhi::BufferUsage::ReadbackBuffer;
+
+        const uint32_t zero = 0;
+
+        feedback_buffers.reserve(num_in_flight_frames);
+        for(uint32_t i = 0; i < num_in_flight_frames; i++) {
+            feedback_buffer_create_info.name = fmt::format("VirtualTextureFeedback{}", i);
+
+            auto* feedback_buffer = device.create_buffer(feedback_buffer_create_info);
+
+            // The first element is the number of entries that shaders wrote
+            device.write_data_to_buffer(&zero, sizeof(uint32_t), feedback_buffer);
+
+            feedback_buffers.push_back(feedback_buffer);
+        }
+    }
+
+    VirtualTextureSystem::~VirtualTextureSystem() {
+        // We only get destroyed when the renderer's shutting down, so there's no frames in flight
+        for(auto* feedback_buffer : feedback_buffers) {
+            device.destroy_buffer(feedback_buffer);
+        }
+
+        for(const auto& staging_buffers : staging_buffers_per_frame) {
+            for(auto* staging_buffer : staging_buffers) {
+                device_resources.return_staging_buffer(staging_buffer);
+            }
+        }
+    }
+
+    std::optional<uint32_t> VirtualTextureSystem::add_virtual_texture(VirtualTextureCreateInfo create_info) {
+        ZoneScoped;
+        if(!create_info.load_page) {
+            logger->error("Virtual texture {} must have a page loader", create_info.name);
+            return std::nullopt;
+        }
+
+        if(!std::has_single_bit(create_info.width) || !std::has_single_bit(create_info.height) ||
+           create_info.width < VIRTUAL_TEXTURE_PAGE_SIZE || create_info.height < VIRTUAL_TEXTURE_PAGE_SIZE) {
+            logger->error("Virtual texture {} is {}x{}, but virtual textures must be powers of two at least {} pixels on a side",
+                          create_info.name,
+                          create_info.width,
+                          create_info.height,
+                          VIRTUAL_TEXTURE_PAGE_SIZE);
+            return std::nullopt;
+        }
+
+        if(create_info.width / VIRTUAL_TEXTURE_PAGE_SIZE > MAX_VIRTUAL_TEXTURE_SIZE_IN_PAGES ||
+           create_info.height / VIRTUAL_TEXTURE_PAGE_SIZE > MAX_VIRTUAL_TEXTURE_SIZE_IN_PAGES) {
+            logger->error("Virtual texture {} is {}x{}, but virtual textures may be at most {} pixels on a side",
+                          create_info.name,
+                          create_info.width,
+                          create_info.height,
+                          MAX_VIRTUAL_TEXTURE_SIZE_IN_PAGES * VIRTUAL_TEXTURE_PAGE_SIZE);
+            return std::nullopt;
+        }
+
+        VirtualTexture texture = {};
+        texture.info = std::move(create_info);
+
+        // Mips stop when the shorter side is one page, so that every page is a full page
+        const auto min_size_in_pages = std::min(texture.info.width, texture.info.height) / VIRTUAL_TEXTURE_PAGE_SIZE;
+        texture.num_mips = static_cast<uint32_t>(std::countr_zero(min_size_in_pages)) + 1;
+
+        // Every entry starts out pointing at nothing. Shaders sample transparent black until the coarsest pages load
+        texture.page_table.resize(texture.num_mips);
+        texture.dirty_mips.resize(texture.num_mips, false);
+
+        std::vector<const void*> page_table_data;
+        page_table_data.reserve(texture.num_mips);
+        for(uint32_t mip = 0; mip < texture.num_mips; mip++) {
+            texture.page_table[mip].resize(static_cast<size_t>(texture.get_width_in_pages(mip)) * texture.get_height_in_pages(mip), 0);
+            page_table_data.push_back(texture.page_table[mip].data());
+        }
+
+        texture.page_table_name = fmt::format("{}PageTable", texture.info.name);
+        const auto page_table = device_resources.create_texture_with_mips(texture.page_table_name,
+                                                                          texture.get_width_in_pages(0),
+                                                                          texture.get_height_in_pages(0),
+                                                                          rhi::PixelFormat::Rgba8,
+                                                                          texture.num_mips,
+                                                                          page_table_data,
+                                                                          renderer.get_global_allocator());
+        if(!page_table) {
+            logger->error("Could not create the page table for virtual texture {}", texture.info.name);
+            return std::nullopt;
+        }
+        texture.page_table_image = (*page_table)->image;
+
+        std::lock_guard textures_lock{textures_mutex};
+
+        if(textures.size() >= MAX_NUM_VIRTUAL_TEXTURES) {
+            logger->error("Can not add virtual texture {}, Nova only supports {} virtual textures",
+                          texture.info.name,
+                          MAX_NUM_VIRTUAL_TEXTURES);
+            device_resources.destroy_render_target(texture.page_table_name, renderer.get_global_allocator());
+            return std::nullopt;
+        }
+
+        const auto id = virtual_texture_infos.get_next_free_slot();
+
+        auto& info = virtual_texture_infos[id];
+        info.page_table_texture = static_cast<uint32_t>(page_table->get_idx());
+        info.width = texture.info.width;
+        info.height = texture.info.height;
+        info.num_mips = texture.num_mips;
+        info.physical_cache_texture = physical_cache_slot;
+        info.cache_size_in_pages = cache_size_in_pages;
+
+        {
+            std::lock_guard cache_lock{page_cache_mutex};
+            page_cache.add_texture(id, texture.num_mips);
+        }
+
+        // The coarsest mip is what shaders fall back to when nothing else is resident, so its pages are always resident
+        const auto coarsest_mip = texture.num_mips - 1;
+        for(uint32_t y = 0; y < texture.get_height_in_pages(coarsest_mip); y++) {
+            for(uint32_t x = 0; x < texture.get_width_in_pages(coarsest_mip); x++) {
+                num_pending_loads++;
+                worker_pool.submit([this, page = VirtualPageId{id, coarsest_mip, x, y}, loader = texture.info.load_page] {
+                    load_page(page, loader, true);
+                },
+                                   std::numeric_limits<float>::max());
+            }
+        }
+
+        textures.emplace(id, std::move(texture));
+
+        return id;
+    }
+
+    void VirtualTextureSystem::remove_virtual_texture(const uint32_t id) {
+        std::lock_guard textures_lock{textures_mutex};
+
+        const auto itr = textures.find(id);
+        if(itr == textures.end()) {
+            logger->error("There's no virtual texture with ID {}", id);
+            return;
+        }
+
+        {
+            std::lock_guard cache_lock{page_cache_mutex};
+            page_cache.remove_texture(id);
+            std::erase_if(failed_pages, [&](const uint32_t packed) { return VirtualPageId::unpack(packed).texture == id; });
+        }
+
+        // Pages of this texture that are still loading will find that the texture is gone, and be dropped
+        device_resources.destroy_render_target(itr->second.page_table_name, renderer.get_global_allocator());
+        virtual_texture_infos.free_slot(id);
+        textures.erase(itr);
+    }
+
+    void VirtualTextureSystem::begin_frame(const uint32_t frame_idx, const uint64_t frame_count) {
+        ZoneScoped;
+        cur_frame = frame_count;
+
+        // This frame's fence has signaled, so the GPU is done with the staging buffers from the last time we used this frame
+        auto& staging_buffers = staging_buffers_per_frame[frame_idx];
+        for(auto* staging_buffer : staging_buffers) {
+            device_resources.return_staging_buffer(staging_buffer);
+        }
+        staging_buffers.clear();
+
+        {
+            std::lock_guard textures_lock{textures_mutex};
+            virtual_texture_infos.upload_to_device(frame_idx);
+        }
+
+        auto* feedback_buffer = feedback_buffers[frame_idx];
+
+        uint32_t num_entries = 0;
+        device.read_data_from_buffer(&num_entries, sizeof(uint32_t), 0, feedback_buffer);
+        if(num_entries == 0) {
+            return;
+        }
+
+        // Shaders keep counting after the buffer is full, but they stop writing
+        num_entries = std::min(num_entries, options.max_feedback_entries);
+
+        // If the workers are still busy with older feedback, skip this feedback. The pages it wants will show up in later feedback anyways
+        if(!is_processing_feedback.exchange(true)) {
+            feedback_entries.resize(num_entries);
+            device.read_data_from_buffer(feedback_entries.data(), num_entries * sizeof(uint32_t), sizeof(uint32_t), feedback_buffer);
+
+            // The feedback was written the last time we rendered this frame
+            const auto feedback_frame = frame_count > num_in_flight_frames ? frame_count - num_in_flight_frames : 0;
+
+            worker_pool.submit([this, feedback_frame] { process_feedback(feedback_entries, feedback_frame); });
+        }
+
+        const uint32_t zero = 0;
+        device.write_data_to_buffer(&zero, sizeof(uint32_t), feedback_buffer);
+    }
+
+    void VirtualTextureSystem::record_uploads(rhi::RhiRenderCommandList& cmds, const uint32_t frame_idx) {
+        ZoneScoped;
+        mem::FrameVector<LoadedPage> pages{cmds.get_frame_arena()};
+
+        {
+            std::lock_guard loaded_lock{loaded_mutex};
+            const auto num_pages = std::min(loaded_pages.size(), static_cast<size_t>(options.max_page_uploads_per_frame));
+            pages.insert(pages.end(),
+                         std::make_move_iterator(loaded_pages.begin()),
+                         std::make_move_iterator(loaded_pages.begin() + static_cast<ptrdiff_t>(num_pages)));
+            loaded_pages.erase(loaded_pages.begin(), loaded_pages.begin() + static_cast<ptrdiff_t>(num_pages));
+        }
+
+        if(pages.empty() || physical_cache_image == nullptr) {
+            num_pending_loads -= static_cast<uint32_t>(pages.size());
+            return;
+        }
+
+        std::lock_guard textures_lock{textures_mutex};
+
+        struct PageCopy {
+            const LoadedPage* page;
+
+            PhysicalPage physical_page;
+        };
+
+        mem::FrameVector<PageCopy> copies{cmds.get_frame_arena()};
+        copies.reserve(pages.size());
+
+        {
+            std::lock_guard cache_lock{page_cache_mutex};
+
+            for(const auto& loaded_page : pages) {
+                num_pending_loads--;
+
+                const auto texture_itr = textures.find(loaded_page.page.texture);
+                if(texture_itr == textures.end()) {
+                    // The texture was removed while we were loading it
+                    continue;
+                }
+
+                if(loaded_page.pixels.empty()) {
+                    failed_pages.insert(loaded_page.page.pack());
+                    page_cache.cancel_request(loaded_page.page);
+                    continue;
+                }
+
+                const auto mapping = page_cache.map_page(loaded_page.page, cur_frame, loaded_page.is_pinned);
+                if(!mapping) {
+                    // Every page in the cache is in use. If the page is still needed, it'll be requested again
+                    page_cache.cancel_request(loaded_page.page);
+                    continue;
+                }
+
+                if(mapping->evicted_page) {
+                    if(const auto evicted_itr = textures.find(mapping->evicted_page->texture); evicted_itr != textures.end()) {
+                        unmap_page_table_entries(evicted_itr->second, *mapping->evicted_page);
+                    }
+                }
+
+                map_page_table_entries(texture_itr->second, loaded_page.page, mapping->physical_page);
+
+                copies.emplace_back(PageCopy{&loaded_page, mapping->physical_page});
+            }
+        }
+
+        if(copies.empty()) {
+            return;
+        }
+
+        auto& staging_buffers = staging_buffers_per_frame[frame_idx];
+
+        mem::FrameVector<VirtualTexture*> dirty_textures{cmds.get_frame_arena()};
+        for(auto& [id, texture] : textures) {
+            if(std::find(texture.dirty_mips.begin(), texture.dirty_mips.end(), true) != texture.dirty_mips.end()) {
+                dirty_textures.push_back(&texture);
+            }
+        }
+
+        mem::FrameVector<rhi::RhiResourceBarrier> barriers{cmds.get_frame_arena()};
+        barriers.reserve(dirty_textures.size() + 1);
+
+        rhi::RhiResourceBarrier to_copy_barrier = {};
+        to_copy_barrier.access_before_barrier = rhi::ResourceAccess::ShaderRead;
+        to_copy_barrier.access_after_barrier = rhi::ResourceAccess::CopyWrite;
+        to_copy_barrier.old_state = rhi::ResourceState::ShaderRead;
+        to_copy_barrier.new_state = rhi::ResourceState::CopyDestination;
+        to_copy_barrier.source_queue = rhi::QueueType::Graphics;
+        to_copy_barrier.destination_queue = rhi::QueueType::Graphics;
+        to_copy_barrier.image_memory_barrier.aspect = rhi::ImageAspect::Color;
+
+        to_copy_barrier.resource_to_barrier = physical_cache_image;
+        if(!is_physical_cache_initialized) {
+            to_copy_barrier.old_state = rhi::ResourceState::Undefined;
+            is_physical_cache_initialized = true;
+        }
+        barriers.push_back(to_copy_barrier);
+
+        to_copy_barrier.old_state = rhi::ResourceState::ShaderRead;
+        for(auto* texture : dirty_textures) {
+            to_copy_barrier.resource_to_barrier = texture->page_table_image;
+            barriers.push_back(to_copy_barrier);
+        }
+
+        cmds.resource_barriers(rhi::PipelineStage::FragmentShader, rhi::PipelineStage::Transfer, barriers);
+
+        // All the pages go in one staging buffer, one after another
+        auto* page_staging_buffer = device_resources.get_staging_buffer_with_size(copies.size() * PAGE_SIZE_IN_BYTES);
+        staging_buffers.push_back(page_staging_buffer);
+
+        for(size_t i = 0; i < copies.size(); i++) {
+            const auto& [page, physical_page] = copies[i];
+            const auto offset = i * PAGE_SIZE_IN_BYTES;
+            device.write_data_to_buffer(page->pixels.data(), PAGE_SIZE_IN_BYTES, offset, page_staging_buffer);
+
+            rhi::RhiImageRegion region = {};
+            region.x = physical_page.x * VIRTUAL_TEXTURE_PAGE_SIZE;
+            region.y = physical_page.y * VIRTUAL_TEXTURE_PAGE_SIZE;
+            region.width = VIRTUAL_TEXTURE_PAGE_SIZE;
+            region.height = VIRTUAL_TEXTURE_PAGE_SIZE;
+            cmds.copy_buffer_to_image(physical_cache_image, region, page_staging_buffer, offset);
+        }
+
+        for(auto* texture : dirty_textures) {
+            record_page_table_uploads(cmds, staging_buffers, *texture);
+        }
+
+        for(auto& barrier : barriers) {
+            barrier.access_before_barrier = rhi::ResourceAccess::CopyWrite;
+            barrier.access_after_barrier = rhi::ResourceAccess::ShaderRead;
+            barrier.old_state = rhi::ResourceState::CopyDestination;
+            barrier.new_state = rhi::ResourceState::ShaderRead;
+        }
+
+        cmds.resource_barriers(rhi::PipelineStage::Transfer, rhi::PipelineStage::VertexShader, barriers);
+    }
+
+    rhi::RhiBuffer* VirtualTextureSystem::get_info_buffer_for_frame(const uint32_t frame_idx) const {
+        return virtual_texture_infos.get_buffer_for_frame(frame_idx);
+    }
+
+    rhi::RhiBuffer* VirtualTextureSystem::get_feedback_buffer_for_frame(const uint32_t frame_idx) const {
+        return feedback_buffers[frame_idx];
+    }
+
+    void VirtualTextureSystem::process_feedback(const std::span<const uint32_t> feedback, const uint64_t frame) {
+        ZoneScoped;
+        struct PageLoad {
+            VirtualPageId page;
+
+            PageLoader loader;
+        };
+
+        std::vector<PageLoad> loads;
+
+        {
+            std::lock_guard textures_lock{textures_mutex};
+            std::lock_guard cache_lock{page_cache_mutex};
+
+            page_cache.process_feedback(feedback, frame);
+
+            // Don't load pages faster than we can upload them
+            const auto num_loading = num_pending_loads.load();
+            const auto max_new_loads = options.max_page_uploads_per_frame > num_loading ? options.max_page_uploads_per_frame - num_loading :
+                                                                                          0;
+
+            for(const auto& page : page_cache.take_page_requests(max_new_loads)) {
+                const auto texture_itr = textures.find(page.texture);
+                if(texture_itr == textures.end() || failed_pages.contains(page.pack())) {
+                    page_cache.cancel_request(page);
+                    continue;
+                }
+
+                loads.emplace_back(PageLoad{page, texture_itr->second.info.load_page});
+            }
+        }
+
+        num_pending_loads += static_cast<uint32_t>(loads.size());
+
+        for(auto& load : loads) {
+            // Coarse pages are the fallback for finer pages, so they load first
+            const auto priority = static_cast<float>(load.page.mip);
+            worker_pool.submit([this, load = std::move(load)] { load_page(load.page, load.loader, false); }, priority);
+        }
+
+        is_processing_feedback = false;
+    }
+
+    void VirtualTextureSystem::load_page(const VirtualPageId page, const PageLoader& loader, const bool is_pinned) {
+        ZoneScoped;
+        auto pixels = loader(page.mip, page.x, page.y);
+        if(pixels.size() != PAGE_SIZE_IN_BYTES) {
+            logger->error("Could not load page ({}, {}) of mip {} of virtual texture {}. Got {} bytes, expected {}",
+                          page.x,
+                          page.y,
+                          page.mip,
+                          page.texture,
+                          pixels.size(),
+                          PAGE_SIZE_IN_BYTES);
+            pixels.clear();
+        }
+
+        std::lock_guard lock{loaded_mutex};
+        loaded_pages.emplace_back(LoadedPage{page, std::move(pixels), is_pinned});
+    }
+
+    void VirtualTextureSystem::map_page_table_entries(VirtualTexture& texture, const VirtualPageId page, const PhysicalPage physical_page) {
+        const auto new_entry = pack_page_table_entry(physical_page, page.mip);
+
+        // Entries that point at a coarser page, or nothing, get the new page. Entries that point at a finer page keep it
+        replace_page_table_entries(texture, page, new_entry, [&](const uint32_t entry) {
+            return !is_page_table_entry_valid(entry) || get_page_table_entry_mip(entry) > page.mip;
+        });
+    }
+
+    void VirtualTextureSystem::unmap_page_table_entries(VirtualTexture& texture, const VirtualPageId page) {
+        // The parent's entry already points at the closest resident page to the parent, which is the closest resident ancestor of this
+        // page
+        uint32_t new_entry = 0;
+        if(page.mip + 1 < texture.num_mips) {
+            const auto parent = page.parent();
+            new_entry = texture.page_table[parent.mip][parent.y * texture.get_width_in_pages(parent.mip) + parent.x];
+        }
+
+        // The only page from this mip that covers this region is the page we're unmapping, so every entry from this mip points at it
+        replace_page_table_entries(texture, page, new_entry, [&](const uint32_t entry) {
+            return is_page_table_entry_valid(entry) && get_page_table_entry_mip(entry) == page.mip;
+        });
+    }
+
+    void VirtualTextureSystem::replace_page_table_entries(VirtualTexture& texture,
+                                                          const VirtualPageId page,
+                                                          const uint32_t new_entry,
+                                                          const std::function<bool(uint32_t)>& should_replace) {
+        // The page covers one entry in its own mip, 2x2 entries in the next finer mip, 4x4 in the mip after that, etc
+        for(uint32_t mip = page.mip; mip < page.mip + 1; mip--) {
+            const auto scale = 1u << (page.mip - mip);
+            const auto width_in_pages = texture.get_width_in_pages(mip);
+            auto& entries = texture.page_table[mip];
+
+            for(uint32_t y = page.y * scale; y < (page.y + 1) * scale; y++) {
+                for(uint32_t x = page.x * scale; x < (page.x + 1) * scale; x++) {
+                    auto& entry = entries[y * width_in_pages + x];
+                    if(entry != new_entry && should_replace(entry)) {
+                        entry = new_entry;
+                        texture.dirty_mips[mip] = true;
+                    }
+                }
+            }
+        }
+    }
+
+    void VirtualTextureSystem::record_page_table_uploads(rhi::RhiRenderCommandList& cmds,
+                                                         std::vector<rhi::RhiBuffer*>& staging_buffers,
+                                                         VirtualTexture& texture) {
+        for(uint32_t mip = 0; mip < texture.num_mips; mip++) {
+            if(!texture.dirty_mips[mip]) {
+                continue;
+            }
+
+            const auto& entries = texture.page_table[mip];
+            const auto size = entries.size() * sizeof(uint32_t);
+
+            auto* staging_buffer = device_resources.get_staging_buffer_with_size(size);
+            staging_buffers.push_back(staging_buffer);
+            device.write_data_to_buffer(entries.data(), size, staging_buffer);
+
+            rhi::RhiImageRegion region = {};
+            region.mip_level = mip;
+            region.width = texture.get_width_in_pages(mip);
+            region.height = texture.get_height_in_pages(mip);
+            cmds.copy_buffer_to_image(texture.page_table_image, region, staging_buffer, 0);
+
+            texture.dirty_mips[mip] = false;
+        }
+    }
+} // namespace nova::renderer
@@ -0,0 +1,283 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "nova_renderer/nova_settings.hpp"
+#include "nova_renderer/per_frame_device_array.hpp"
+#include "nova_renderer/rhi/forward_decls.hpp"
+
+#include "virtual_texture_page_cache.hpp"
+
+namespace nova::renderer {
+    class NovaRenderer;
+    class DeviceResources;
+    class WorkerPool;
+
+    namespace rhi {
+        class RenderDevice;
+        class RhiRenderCommandList;
+    } // namespace rhi
+
+    /*!
+     * \brief Loads the pixels of one page of a virtual texture
+     *
+     * Called on the worker pool, so it must be safe to call from any thread. Returns `VIRTUAL_TEXTURE_PAGE_SIZE` by
+     * `VIRTUAL_TEXTURE_PAGE_SIZE` tightly-packed RGBA8 pixels, or an empty vector if the page couldn't be loaded
+     */
+    using PageLoader = std::function<std::vector<uint8_t>(uint32_t mip_level, uint32_t page_x, uint32_t page_y)>;
+
+    struct VirtualTextureCreateInfo {
+        std::string name;
+
+        /*!
+         * \brief Width of the texture's first mip, in pixels. Must be a power of two, and at least `VIRTUAL_TEXTURE_PAGE_SIZE`
+         */
+        uint32_t width;
+
+        /*!
+         * \brief Height of the texture's first mip, in pixels. Must be a power of two, and at least `VIRTUAL_TEXTURE_PAGE_SIZE`
+         */
+        uint32_t height;
+
+        PageLoader load_page;
+    };
+
+    /*!
+     * \brief Everything a shader needs to sample a virtual texture
+     *
+     * Must match `VirtualTextureInfo` in the standard pipeline layout HLSL
+     */
+    struct VirtualTextureInfo {
+        /*!
+         * \brief Slot of the texture's page table in the texture table
+         */
+        uint32_t page_table_texture;
+
+        uint32_t width;
+
+        uint32_t height;
+
+        /*!
+         * \brief Number of mips that have pages. The last of these mips is always resident
+         */
+        uint32_t num_mips;
+
+        /*!
+         * \brief Slot of the physical page cache in the texture table
+         */
+        uint32_t physical_cache_texture;
+
+        uint32_t cache_size_in_pages;
+
+        uint32_t padding[2];
+    };
+
+    /*!
+     * \brief Streams pages of huge textures into a page cache, based on which pages shaders actually sampled
+     *
+     * Meshes pick a virtual texture with `FullVertex::virtual_texture_id`. Shaders sample it with `sample_virtual_texture`, which looks
+     * up the page in the texture's page table and reads the page from the physical page cache. If the page isn't resident, the page table
+     * points at the closest coarser page that is, and the shader writes the page it wanted to the frame's feedback buffer
+     *
+     * Each frame, once the frame's fence has signaled, we read back its feedback and hand it to the worker pool. The workers work out which
+     * pages are missing, with `VirtualTexturePageCache`, and load them. The render thread copies loaded pages into the page cache and
+     * updates the page tables, a limited number of pages per frame
+     *
+     * Every page table is an RGBA8 texture with one texel per page, and a mip for every mip of the virtual texture. A texel holds the
+     * position of its page in the physical cache, the mip that the page actually came from, and 255 in alpha if it points at anything
+     */
+    class VirtualTextureSystem {
+    public:
+        VirtualTextureSystem(NovaRenderer& renderer,
+                             WorkerPool& worker_pool,
+                             const NovaSettings::VirtualTextureOptions& options,
+                             uint32_t num_in_flight_frames);
+
+        VirtualTextureSystem(const VirtualTextureSystem& other) = delete;
+        VirtualTextureSystem& operator=(const VirtualTextureSystem& other) = delete;
+
+        VirtualTextureSystem(VirtualTextureSystem&& old) noexcept = delete;
+        VirtualTextureSystem& operator=(VirtualTextureSystem&& old) noexcept = delete;
+
+        ~VirtualTextureSystem();
+
+        /*!
+         * \brief Creates a virtual texture and starts loading its coarsest mip
+         *
+         * \return The texture's ID, which is what meshes put in `FullVertex::virtual_texture_id`, or an empty optional if the texture
+         * couldn't be created
+         */
+        [[nodiscard]] std::optional<uint32_t> add_virtual_texture(VirtualTextureCreateInfo create_info);
+
+        /*!
+         * \brief Destroys a virtual texture and frees its pages
+         */
+        void remove_virtual_texture(uint32_t id);
+
+        /*!
+         * \brief Reads back the pages that the GPU wanted the last time it rendered this frame, and starts loading the missing ones
+         *
+         * Call this once a frame from the render thread, after waiting for the frame's fence
+         */
+        void begin_frame(uint32_t frame_idx, uint64_t frame_count);
+
+        /*!
+         * \brief Records commands to copy loaded pages into the page cache and update the page tables
+         *
+         * Call this before recording anything that samples virtual textures
+         */
+        void record_uploads(rhi::RhiRenderCommandList& cmds, uint32_t frame_idx);
+
+        [[nodiscard]] rhi::RhiBuffer* get_info_buffer_for_frame(uint32_t frame_idx) const;
+
+        [[nodiscard]] rhi::RhiBuffer* get_feedback_buffer_for_frame(uint32_t frame_idx) const;
+
+    private:
+        struct VirtualTexture {
+            VirtualTextureCreateInfo info;
+
+            uint32_t num_mips;
+
+            std::string page_table_name;
+
+            rhi::RhiImage* page_table_image;
+
+            /*!
+             * \brief CPU copy of each mip of the page table. Each entry is one RGBA8 texel
+             */
+            std::vector<std::vector<uint32_t>> page_table;
+
+            /*!
+             * \brief Which mips of the page table changed since they were last uploaded
+             */
+            std::vector<bool> dirty_mips;
+
+            [[nodiscard]] uint32_t get_width_in_pages(uint32_t mip) const;
+
+            [[nodiscard]] uint32_t get_height_in_pages(uint32_t mip) const;
+        };
+
+        struct LoadedPage {
+            VirtualPageId page;
+
+            /*!
+             * \brief The page's pixels. Empty if it couldn't be loaded
+             */
+            std::vector<uint8_t> pixels;
+
+            bool is_pinned;
+        };
+
+        rhi::RenderDevice& device;
+
+        DeviceResources& device_resources;
+
+        NovaRenderer& renderer;
+
+        WorkerPool& worker_pool;
+
+        NovaSettings::VirtualTextureOptions options;
+
+        uint32_t num_in_flight_frames;
+
+        uint32_t cache_size_in_pages;
+
+        uint32_t physical_cache_slot = 0;
+
+        rhi::RhiImage* physical_cache_image = nullptr;
+
+        /*!
+         * \brief False until we've copied to the physical cache for the first time, since until then its contents are undefined
+         */
+        bool is_physical_cache_initialized = false;
+
+        uint64_t cur_frame = 0;
+
+        /*!
+         * \brief Guards the virtual textures and their infos. Lock this before `page_cache_mutex` if you need both
+         */
+        std::mutex textures_mutex;
+
+        std::unordered_map<uint32_t, VirtualTexture> textures;
+
+        PerFrameDeviceArray<VirtualTextureInfo> virtual_texture_infos;
+
+        std::mutex page_cache_mutex;
+
+        VirtualTexturePageCache page_cache;
+
+        /*!
+         * \brief Packed IDs of pages that failed to load, so that we don't keep trying to load them every frame
+         */
+        std::unordered_set<uint32_t> failed_pages;
+
+        std::mutex loaded_mutex;
+
+        std::vector<LoadedPage> loaded_pages;
+
+        /*!
+         * \brief Number of pages which are being loaded or are waiting to be uploaded
+         */
+        std::atomic<uint32_t> num_pending_loads = 0;
+
+        /*!
+         * \brief True while the worker pool is processing feedback. We skip feedback that arrives in the meantime, rather than let it pile
+         * up
+         */
+        std::atomic<bool> is_processing_feedback = false;
+
+        /*!
+         * \brief The feedback that the worker pool is processing. Only touched by the render thread while `is_processing_feedback` is
+         * false, and only by the worker pool while it's true. Reused every frame so reading feedback doesn't allocate
+         */
+        std::vector<uint32_t> feedback_entries;
+
+        std::vector<rhi::RhiBuffer*> feedback_buffers;
+
+        /*!
+         * \brief Staging buffers that each frame's uploads used, which we can reuse once the frame's fence has signaled
+         */
+        std::vector<std::vector<rhi::RhiBuffer*>> staging_buffers_per_frame;
+
+        /*!
+         * \brief Works out which pages the feedback wants and starts loading them. Runs on the worker pool
+         */
+        void process_feedback(std::span<const uint32_t> feedback, uint64_t frame);
+
+        /*!
+         * \brief Loads a page and queues it for upload. Runs on the worker pool
+         */
+        void load_page(VirtualPageId page, const PageLoader& loader, bool is_pinned);
+
+        /*!
+         * \brief Points every page table entry that covers `page`, and doesn't already point at a finer page, at the page's new location
+         */
+        static void map_page_table_entries(VirtualTexture& texture, VirtualPageId page, PhysicalPage physical_page);
+
+        /*!
+         * \brief Points every page table entry that pointed at `page` back at the page's closest resident ancestor
+         */
+        static void unmap_page_table_entries(VirtualTexture& texture, VirtualPageId page);
+
+        /*!
+         * \brief Sets every entry in the page table region that `page` covers, for which `should_replace` returns true, to `new_entry`
+         */
+        static void replace_page_table_entries(VirtualTexture& texture,
+                                               VirtualPageId page,
+                                               uint32_t new_entry,
+                                               const std::function<bool(uint32_t)>& should_replace);
+
+        void record_page_table_uploads(rhi::RhiRenderCommandList& cmds,
+                                       std::vector<rhi::RhiBuffer*>& staging_buffers,
+                                       VirtualTexture& texture);
+    };
+} // namespace nova::renderer
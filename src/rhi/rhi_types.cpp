@@ -28,6 +28,8 @@ namespace nova::renderer::rhi {
         switch(format) {
             case PixelFormat::Rgba8:
                 [[fallthrough]];
+            case PixelFormat::Rgba8Srgb:
+                [[fallthrough]];
             case PixelFormat::Rgba16F:
                 [[fallthrough]];
             case PixelFormat::Rgba32F:
@@ -43,6 +45,89 @@ namespace nova::renderer::rhi {
         }
     }
 
+    bool is_block_compressed_format(const PixelFormat format) {
+        switch(format) {
+            case PixelFormat::Bc1Rgba:
+                [[fallthrough]];
+            case PixelFormat::Bc1RgbaSrgb:
+                [[fallthrough]];
+            case PixelFormat::Bc2Rgba:
+                [[fallthrough]];
+            case PixelFormat::Bc2RgbaSrgb:
+                [[fallthrough]];
+            case PixelFormat::Bc3Rgba:
+                [[fallthrough]];
+            case PixelFormat::Bc3RgbaSrgb:
+                [[fallthrough]];
+            case PixelFormat::Bc4R:
+                [[fallthrough]];
+            case PixelFormat::Bc5Rg:
+                [[fallthrough]];
+            case PixelFormat::Bc6hRgbUfloat:
+                [[fallthrough]];
+            case PixelFormat::Bc6hRgbSfloat:
+                [[fallthrough]];
+            case PixelFormat::Bc7Rgba:
+                [[fallthrough]];
+            case PixelFormat::Bc7RgbaSrgb:
+                return true;
+
+            default:
+                return false;
+        }
+    }
+
+    size_t get_image_size_in_bytes(const PixelFormat format, const uint32_t width, const uint32_t height) {
+        const auto num_blocks = static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4);
+        const auto num_pixels = static_cast<size_t>(width) * height;
+
+        switch(format) {
+            case PixelFormat::Rgba8:
+                [[fallthrough]];
+            case PixelFormat::Rgba8Srgb:
+                [[fallthrough]];
+            case PixelFormat::Depth32:
+                [[fallthrough]];
+            case PixelFormat::Depth24Stencil8:
+                return num_pixels * 4;
+
+            case PixelFormat::Rgba16F:
+                return num_pixels * 8;
+
+            case PixelFormat::Rgba32F:
+                return num_pixels * 16;
+
+            case PixelFormat::Bc1Rgba:
+                [[fallthrough]];
+            case PixelFormat::Bc1RgbaSrgb:
+                [[fallthrough]];
+            case PixelFormat::Bc4R:
+                return num_blocks * 8;
+
+            case PixelFormat::Bc2Rgba:
+                [[fallthrough]];
+            case PixelFormat::Bc2RgbaSrgb:
+                [[fallthrough]];
+            case PixelFormat::Bc3Rgba:
+                [[fallthrough]];
+            case PixelFormat::Bc3RgbaSrgb:
+                [[fallthrough]];
+            case PixelFormat::Bc5Rg:
+                [[fallthrough]];
+            case PixelFormat::Bc6hRgbUfloat:
+                [[fallthrough]];
+            case PixelFormat::Bc6hRgbSfloat:
+                [[fallthrough]];
+            case PixelFormat::Bc7Rgba:
+                [[fallthrough]];
+            case PixelFormat::Bc7RgbaSrgb:
+                return num_blocks * 16;
+
+            default:
+                return num_pixels * 4;
+        }
+    }
+
     uint32_t get_byte_size(const VertexFieldFormat format) {
         switch(format) {
             case VertexFieldFormat::Uint:
@@ -83,4 +168,49 @@ namespace nova::renderer::rhi {
                 return "Unknown";
         }
     }
+
+    const char* to_string(const MemoryCategory category) {
+        switch(category) {
+            case MemoryCategory::Geometry:
+                return "Geometry";
+
+            case MemoryCategory::Textures:
+                return "Textures";
+
+            case MemoryCategory::RenderTargets:
+                return "RenderTargets";
+
+            case MemoryCategory::Staging:
+                return "Staging";
+
+            case MemoryCategory::Other:
+                return "Other";
+
+            default:
+                return "Unknown";
+        }
+    }
+
+    MemoryCategory get_memory_category(const BufferUsage usage) {
+        switch(usage) {
+            case BufferUsage::IndexBuffer:
+                [[fallthrough]];
+            case BufferUsage::VertexBuffer:
+                [[fallthrough]];
+            case BufferUsage::GeometryBuffer:
+                return MemoryCategory::Geometry;
+
+            case BufferUsage::StagingBuffer:
+                [[fallthrough]];
+            case BufferUsage::ReadbackBuffer:
+                return MemoryCategory::Staging;
+
+            case BufferUsage::UniformBuffer:
+                [[fallthrough]];
+            case BufferUsage::StorageBuffer:
+                [[fallthrough]];
+            default:
+                return MemoryCategory::Other;
+        }
+    }
 } // namespace nova::renderer::rhi
@@ -4,12 +4,18 @@
 
 #pragma once
 
+#include <map>
+#include <mutex>
+#include <unordered_set>
+
 #include <vk_mem_alloc.h>
 #include <vulkan/vulkan.hpp>
 
 #include "nova_renderer/rhi/pipeline_create_info.hpp"
 #include "nova_renderer/rhi/rhi_types.hpp"
 
+#include "../../util/sha256.hpp"
+
 namespace nova::renderer::rhi {
     struct VulkanDeviceMemory : RhiDeviceMemory {
         vk::DeviceMemory memory;
@@ -21,14 +27,45 @@ namespace nova::renderer::rhi {
 
     struct VulkanImage : RhiImage {
         vk::Image image = VK_NULL_HANDLE;
+
+        /*!
+         * \brief View of the whole image
+         */
         vk::ImageView image_view = VK_NULL_HANDLE;
+
         VmaAllocation allocation{};
+
+        vk::Format format = vk::Format::eUndefined;
+        vk::ImageAspectFlags aspect = vk::ImageAspectFlagBits::eColor;
+
+        uint32_t width = 0;
+        uint32_t height = 0;
+
+        MemoryCategory memory_category = MemoryCategory::Textures;
+        VkDeviceSize allocation_size = 0;
+
+        uint32_t num_mip_levels = 1;
+        uint32_t num_array_layers = 1;
+
+        struct RangeView {
+            RhiImageRange range;
+            vk::Format format;
+            vk::ImageView view;
+        };
+
+        /*!
+         * \brief Views of parts of the image, or of the image in other formats, created the first time something asks for them
+         *
+         * Images only ever have a few of these, so a linear search is fine
+         */
+        std::vector<RangeView> range_views;
     };
 
     struct VulkanBuffer : RhiBuffer {
         vk::Buffer buffer = VK_NULL_HANDLE;
         VmaAllocation allocation{};
         VmaAllocationInfo allocation_info{};
+        MemoryCategory memory_category = MemoryCategory::Other;
     };
 
     struct VulkanMaterialResources : RhiMaterialResources {
@@ -43,6 +80,19 @@ namespace nova::renderer::rhi {
         vk::PipelineLayout layout;
 
         std::vector<uint32_t> variable_descriptor_set_counts;
+
+        /*!
+         * \brief The push constant ranges in `layout`
+         */
+        std::vector<vk::PushConstantRange> push_constant_ranges;
+
+        /*!
+         * \brief `push_constant_ranges` split into disjoint intervals, each with the stages of every range that covers it
+         *
+         * Command lists push each interval once with its stages, since Vulkan wants the stages in a push to exactly match the ranges it
+         * touches
+         */
+        std::vector<vk::PushConstantRange> push_constant_intervals;
     };
 
     /*!
@@ -69,6 +119,54 @@ namespace nova::renderer::rhi {
          * already used a pipeline state with this renderpass we just get the caches PSO, otherwise we have to create it
          */
         std::unordered_map<std::string, vk::Pipeline> cached_pipelines;
+
+        /*!
+         * \brief Names of the pipelines which a worker thread is compiling for this renderpass right now
+         */
+        std::unordered_set<std::string> pipelines_being_compiled;
+
+        /*!
+         * \brief Names of the pipelines which are waiting on the worker pool to be compiled for this renderpass
+         */
+        std::unordered_set<std::string> pending_pipelines;
+
+        /*!
+         * \brief Names of the pipelines which failed to compile for this renderpass
+         *
+         * Compiling them again would fail the same way, so we draw with their fallback or skip their draws instead of trying every time
+         * they're bound. A successful recompile removes the pipeline from this set
+         */
+        std::unordered_set<std::string> failed_pipelines;
+
+        /*!
+         * \brief PSOs which were recompiled but haven't been installed yet. They count as in use, so that nothing destroys them while they
+         * wait. A PSO appears once for every recompiled pipeline that holds it
+         */
+        std::vector<vk::Pipeline> uninstalled_pipelines;
+
+        /*!
+         * \brief Every PSO in this renderpass, keyed by a hash of the state that was baked into it
+         *
+         * Renderpacks often have many pipelines with the same state under different names. They all share one PSO
+         */
+        std::map<Sha256Digest, vk::Pipeline> pipelines_by_state;
+
+        /*!
+         * \brief Guards `cached_pipelines`, `pipelines_being_compiled`, `pending_pipelines`, `failed_pipelines`, `uninstalled_pipelines`,
+         * and `pipelines_by_state`, since pipelines are compiled on the worker pool
+         */
+        std::mutex pipelines_mutex;
+    };
+
+    struct VulkanRecompiledPipeline : RhiRecompiledPipeline {
+        VulkanRenderpass* renderpass = nullptr;
+
+        /*!
+         * \brief Name of the pipeline that this is a new version of
+         */
+        std::string name;
+
+        vk::Pipeline pso = VK_NULL_HANDLE;
     };
 
     struct VulkanFramebuffer : RhiFramebuffer {
@@ -1,5 +1,9 @@
 #include "vulkan_command_list.hpp"
 
+#include <algorithm>
+#include <array>
+#include <optional>
+
 #include <Tracy.hpp>
 #include <rx/core/log.h>
 #include <string.h>
@@ -8,6 +12,7 @@
 #include "nova_renderer/camera.hpp"
 #include "nova_renderer/constants.hpp"
 #include "nova_renderer/rhi/pipeline_create_info.hpp"
+#include "nova_renderer/util/frame_arena.hpp"
 
 #include "vk_structs.hpp"
 #include "vulkan_render_device.hpp"
@@ -31,7 +36,7 @@ namespace nova::renderer::rhi {
     VulkanRenderCommandList::VulkanRenderCommandList(vk::CommandBuffer cmds,
                                                      VulkanRenderDevice& render_device,
                                                      rx::memory::allocator& allocator)
-        : cmds(cmds), device(render_device), allocator(allocator), descriptor_sets{&allocator} {
+        : cmds(cmds), device(render_device), allocator(allocator) {
         ZoneScoped;        // TODO: Put this begin info in the constructor parameters
         vk::CommandBufferBeginInfo begin_info = {};
         begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -55,108 +60,44 @@ namespace nova::renderer::rhi {
                                                           RhiSampler* point_sampler,
                                                           RhiSampler* bilinear_sampler,
                                                           RhiSampler* trilinear_sampler,
-                                                          const std::vector<RhiImage*>& textures,
-                                                          rx::memory::allocator& allocator) {
-        const auto set = device.get_next_standard_descriptor_set();
-
+                                                          RhiBuffer* virtual_texture_info_buffer,
+                                                          RhiBuffer* virtual_texture_feedback_buffer,
+                                                          const uint32_t frame_idx) {
+        ZoneScoped;
         const auto* vk_camera_buffer = static_cast<VulkanBuffer*>(camera_buffer);
-        const auto camera_buffer_write = vk::DescriptorBufferInfo()
-                                             .setOffset(0)
-                                             .setRange(vk_camera_buffer->size.b_count())
-                                             .setBuffer(vk_camera_buffer->buffer);
-        const auto camera_buffer_descriptor_type = vk_camera_buffer->size < device.gpu.props.limits.maxUniformBufferRange ?
-                                                       vk::DescriptorType::eUniformBuffer :
-                                                       vk::DescriptorType::eStorageBuffer;
-
         const auto* vk_material_buffer = static_cast<VulkanBuffer*>(material_buffer);
-        const auto material_buffer_write = vk::DescriptorBufferInfo()
-                                               .setOffset(0)
-                                               .setRange(material_buffer->size.b_count())
-                                               .setBuffer(vk_material_buffer->buffer);
-        const auto material_buffer_descriptor_type = material_buffer->size < device.gpu.props.limits.maxUniformBufferRange ?
-                                                         vk::DescriptorType::eUniformBuffer :
-                                                         vk::DescriptorType::eStorageBuffer;
-
-        const auto* vk_point_sampler = static_cast<VulkanSampler*>(point_sampler);
-        const auto point_sampler_write = vk::DescriptorImageInfo().setSampler(vk_point_sampler->sampler);
-
-        const auto* vk_bilinear_sampler = static_cast<VulkanSampler*>(bilinear_sampler);
-        const auto bilinear_sampler_write = vk::DescriptorImageInfo().setSampler(vk_bilinear_sampler->sampler);
-
-        const auto* vk_trilinear_sampler = static_cast<VulkanSampler*>(trilinear_sampler);
-        const auto trilinear_sampler_write = vk::DescriptorImageInfo().setSampler(vk_trilinear_sampler->sampler);
-
-        std::vector<vk::DescriptorImageInfo> vk_textures{&allocator};
-        vk_textures.reserve(textures.size());
-
-        textures.each_fwd([&](const RhiImage* image) {
-            const auto* vk_image = static_cast<const VulkanImage*>(image);
-            vk_textures.emplace_back(
-                vk::DescriptorImageInfo().setImageView(vk_image->image_view).setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal));
-        });
-
-        const auto writes = std::array{
-            vk::WriteDescriptorSet()
-                .setDstSet(set)
-                .setDstBinding(0)
-                .setDstArrayElement(0)
-                .setDescriptorCount(1)
-                .setDescriptorType(camera_buffer_descriptor_type)
-                .setPBufferInfo(&camera_buffer_write),
-            vk::WriteDescriptorSet()
-                .setDstSet(set)
-                .setDstBinding(1)
-                .setDstArrayElement(0)
-                .setDescriptorCount(1)
-                .setDescriptorType(material_buffer_descriptor_type)
-                .setPBufferInfo(&material_buffer_write),
-            vk::WriteDescriptorSet()
-                .setDstSet(set)
-                .setDstBinding(2)
-                .setDstArrayElement(0)
-                .setDescriptorCount(1)
-                .setDescriptorType(vk::DescriptorType::eSampler)
-                .setPImageInfo(&point_sampler_write),
-            vk::WriteDescriptorSet()
-                .setDstSet(set)
-                .setDstBinding(3)
-                .setDstArrayElement(0)
-                .setDescriptorCount(1)
-                .setDescriptorType(vk::DescriptorType::eSampler)
-                .setPImageInfo(&bilinear_sampler_write),
-            vk::WriteDescriptorSet()
-                .setDstSet(set)
-                .setDstBinding(4)
-                .setDstArrayElement(0)
-                .setDescriptorCount(1)
-                .setDescriptorType(vk::DescriptorType::eSampler)
-                .setPImageInfo(&trilinear_sampler_write),
-            vk::WriteDescriptorSet()
-                .setDstSet(set)
-                .setDstBinding(5)
-                .setDstArrayElement(0)
-                .setDescriptorCount(static_cast<uint32_t>(vk_textures.size()))
-                .setDescriptorType(vk::DescriptorType::eSampledImage)
-                .setPImageInfo(vk_textures.data()),
-        };
-
-        device.device.updateDescriptorSets(static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+        const auto* vk_virtual_texture_info_buffer = static_cast<VulkanBuffer*>(virtual_texture_info_buffer);
+        const auto* vk_virtual_texture_feedback_buffer = static_cast<VulkanBuffer*>(virtual_texture_feedback_buffer);
+
+        StandardSetBindings bindings = {};
+        bindings.camera_buffer = vk_camera_buffer->buffer;
+        bindings.camera_buffer_size = vk_camera_buffer->size.b_count();
+        bindings.material_buffer = vk_material_buffer->buffer;
+        bindings.material_buffer_size = vk_material_buffer->size.b_count();
+        bindings.point_sampler = static_cast<VulkanSampler*>(point_sampler)->sampler;
+        bindings.bilinear_sampler = static_cast<VulkanSampler*>(bilinear_sampler)->sampler;
+        bindings.trilinear_sampler = static_cast<VulkanSampler*>(trilinear_sampler)->sampler;
+        bindings.virtual_texture_info_buffer = vk_virtual_texture_info_buffer->buffer;
+        bindings.virtual_texture_info_buffer_size = vk_virtual_texture_info_buffer->size.b_count();
+        bindings.virtual_texture_feedback_buffer = vk_virtual_texture_feedback_buffer->buffer;
+        bindings.virtual_texture_feedback_buffer_size = vk_virtual_texture_feedback_buffer->size.b_count();
+
+        const auto set = device.update_standard_descriptor_set(frame_idx, bindings, frame_arena);
 
         vkCmdBindDescriptorSets(cmds,
                                 VK_PIPELINE_BIND_POINT_GRAPHICS,
                                 device.standard_pipeline_layout,
                                 0,
                                 1,
-                                reinterpret_cast<const vk::DescriptorSet*>(&set),
+                                reinterpret_cast<const VkDescriptorSet*>(&set),
                                 0,
                                 nullptr);
-
-        descriptor_sets.emplace_back(set);
     }
 
-    void VulkanRenderCommandList::bind_resources(RhiResourceBinder& binder) {
+    void VulkanRenderCommandList::bind_resources(RhiResourceBinder& binder, const uint32_t frame_idx) {
+        ZoneScoped;
         auto& vk_binder = static_cast<VulkanResourceBinder&>(binder);
-        const auto& sets = vk_binder.get_sets();
+        const auto& sets = vk_binder.get_sets(frame_idx);
         const auto& layout = vk_binder.get_layout();
 
         vkCmdBindDescriptorSets(cmds,
@@ -171,14 +112,14 @@ namespace nova::renderer::rhi {
 
     void VulkanRenderCommandList::resource_barriers(const PipelineStage stages_before_barrier,
                                                     const PipelineStage stages_after_barrier,
-                                                    const std::vector<RhiResourceBarrier>& barriers) {
-        ZoneScoped;        std::vector<vk::BufferMemoryBarrier> buffer_barriers{&allocator};
+                                                    const std::span<const RhiResourceBarrier> barriers) {
+        ZoneScoped;        mem::FrameVector<vk::BufferMemoryBarrier> buffer_barriers(frame_arena);
         buffer_barriers.reserve(barriers.size());
 
-        std::vector<vk::ImageMemoryBarrier> image_barriers{&allocator};
+        mem::FrameVector<vk::ImageMemoryBarrier> image_barriers(frame_arena);
         image_barriers.reserve(barriers.size());
 
-        barriers.each_fwd([&](const RhiResourceBarrier& barrier) {
+        for(const RhiResourceBarrier& barrier : barriers) {
             switch(barrier.resource_to_barrier->type) {
                 case ResourceType::Image: {
                     const auto* image = static_cast<VulkanImage*>(barrier.resource_to_barrier);
@@ -193,10 +134,10 @@ namespace nova::renderer::rhi {
                     image_barrier.dstQueueFamilyIndex = device.get_queue_family_index(barrier.destination_queue);
                     image_barrier.image = image->image;
                     image_barrier.subresourceRange.aspectMask = static_cast<vk::ImageAspectFlags>(barrier.image_memory_barrier.aspect);
-                    image_barrier.subresourceRange.baseMipLevel = 0; // TODO: Something smarter with mips
-                    image_barrier.subresourceRange.levelCount = 1;
+                    image_barrier.subresourceRange.baseMipLevel = 0;
+                    image_barrier.subresourceRange.levelCount = image->num_mip_levels;
                     image_barrier.subresourceRange.baseArrayLayer = 0;
-                    image_barrier.subresourceRange.layerCount = 1;
+                    image_barrier.subresourceRange.layerCount = image->num_array_layers;
 
                     image_barriers.push_back(image_barrier);
                 } break;
@@ -217,7 +158,7 @@ namespace nova::renderer::rhi {
                     buffer_barriers.push_back(buffer_barrier);
                 } break;
             }
-        });
+        }
 
         vkCmdPipelineBarrier(cmds,
                              static_cast<vk::PipelineStageFlags>(stages_before_barrier),
@@ -261,8 +202,7 @@ namespace nova::renderer::rhi {
 
     void VulkanRenderCommandList::set_camera(const Camera& camera) {
         ZoneScoped;        camera_index = camera.index;
-
-        vkCmdPushConstants(cmds, device.standard_pipeline_layout, VK_SHADER_STAGE_ALL, 0, sizeof(uint32_t), &camera_index);
+        are_push_constants_dirty = true;
     }
 
     void VulkanRenderCommandList::begin_renderpass(RhiRenderpass* renderpass, RhiFramebuffer* framebuffer) {
@@ -282,6 +222,21 @@ namespace nova::renderer::rhi {
         begin_info.pClearValues = clear_values.data();
 
         vkCmdBeginRenderPass(cmds, &begin_info, VK_SUBPASS_CONTENTS_INLINE);
+
+        // Every pipeline has a dynamic viewport and scissor rect, so that they don't depend on the framebuffer's size
+        current_render_area = begin_info.renderArea;
+
+        vk::Viewport viewport;
+        viewport.x = 0;
+        viewport.y = 0;
+        viewport.width = static_cast<float>(current_render_area.extent.width);
+        viewport.height = static_cast<float>(current_render_area.extent.height);
+        viewport.minDepth = 0.0F;
+        viewport.maxDepth = 1.0F;
+        vkCmdSetViewport(cmds, 0, 1, &viewport);
+
+        vkCmdSetScissor(cmds, 0, 1, &current_render_area);
+        is_scissor_rect_custom = false;
     }
 
     void VulkanRenderCommandList::end_renderpass() {
@@ -291,35 +246,124 @@ namespace nova::renderer::rhi {
     }
 
     void VulkanRenderCommandList::set_material_index(uint32_t index) {
-        vkCmdPushConstants(cmds, device.standard_pipeline_layout, VK_SHADER_STAGE_ALL, sizeof(uint32_t), sizeof(uint32_t), &index);
+        material_index = index;
+        are_push_constants_dirty = true;
+    }
+
+    void VulkanRenderCommandList::set_model_matrix_index(const uint32_t index) {
+        model_matrix_index = index;
+        are_push_constants_dirty = true;
     }
 
     void VulkanRenderCommandList::set_pipeline(const RhiPipeline& state) {
         ZoneScoped;
         const auto& vk_pipeline = static_cast<const VulkanPipeline&>(state);
 
-        if(current_render_pass != nullptr) {
-            auto* pipeline = current_render_pass->cached_pipelines.find(vk_pipeline.state.name);
-            if(pipeline == nullptr) {
-                const auto pipeline_result = device.compile_pipeline_state(vk_pipeline, *current_render_pass, allocator);
-                if(pipeline_result) {
-                    pipeline = current_render_pass->cached_pipelines.insert(vk_pipeline.state.name, *pipeline_result);
+        is_pipeline_bound = false;
+
+        if(current_render_pass == nullptr) {
+            logger->error("Cannot use a pipeline state when not in a renderpass");
+            return;
+        }
+
+        const auto& name = vk_pipeline.state.name;
+        std::optional<vk::Pipeline> pipeline;
+        bool is_compiling;
+        bool has_failed;
+
+        {
+            std::lock_guard lock{current_render_pass->pipelines_mutex};
+            if(const auto itr = current_render_pass->cached_pipelines.find(name); itr != current_render_pass->cached_pipelines.end()) {
+                pipeline = itr->second;
+            }
 
-                } else {
-                    logger->error("Could not compile pipeline %s", vk_pipeline.state.name);
-                    return;
+            is_compiling = current_render_pass->pipelines_being_compiled.contains(name) ||
+                           current_render_pass->pending_pipelines.contains(name);
+            has_failed = current_render_pass->failed_pipelines.contains(name);
+            if(!pipeline && (is_compiling || has_failed) && vk_pipeline.state.fallback) {
+                // Don't wait for the worker pool, draw with the fallback until the real pipeline is ready. Pipelines which failed to
+                // compile draw with their fallback until they're fixed and reloaded
+                if(const auto itr = current_render_pass->cached_pipelines.find(*vk_pipeline.state.fallback);
+                   itr != current_render_pass->cached_pipelines.end()) {
+                    pipeline = itr->second;
                 }
             }
+        }
 
-            if(pipeline != nullptr) {
-                vkCmdBindPipeline(cmds, VK_PIPELINE_BIND_POINT_GRAPHICS, static_cast<vk::Pipeline>(*pipeline));
+        if(!pipeline && !is_compiling && !has_failed) {
+            // Nobody compiled this pipeline ahead of time, so we have to compile it now
+            if(!device.compile_pipeline_for_renderpass(vk_pipeline, *current_render_pass)) {
+                return;
             }
 
-        } else {
-            logger->error("Cannot use a pipeline state when not in a renderpass");
+            std::lock_guard lock{current_render_pass->pipelines_mutex};
+            if(const auto itr = current_render_pass->cached_pipelines.find(name); itr != current_render_pass->cached_pipelines.end()) {
+                pipeline = itr->second;
+            }
+        }
+
+        if(pipeline) {
+            vkCmdBindPipeline(cmds, VK_PIPELINE_BIND_POINT_GRAPHICS, *pipeline);
+            is_pipeline_bound = true;
+
+            set_dynamic_state(vk_pipeline.state);
+
+            if(vk_pipeline.layout.layout != current_layout) {
+                // Push constants only stay valid between pipelines with compatible layouts, so push them again to be safe
+                current_layout = vk_pipeline.layout.layout;
+                current_push_constant_intervals = vk_pipeline.layout.push_constant_intervals;
+                are_push_constants_dirty = true;
+            }
+        }
+    }
+
+    void VulkanRenderCommandList::set_dynamic_state(const RhiGraphicsPipelineState& state) {
+        if(!state.enable_scissor_test && is_scissor_rect_custom) {
+            // A pipeline before this one scissored part of the framebuffer away, but this one draws to all of it
+            vkCmdSetScissor(cmds, 0, 1, &current_render_area);
+            is_scissor_rect_custom = false;
+        }
+
+        if(state.rasterizer_state.uses_depth_bias()) {
+            vkCmdSetDepthBias(cmds,
+                              state.rasterizer_state.depth_bias,
+                              state.rasterizer_state.maximum_depth_bias,
+                              state.rasterizer_state.slope_scaled_depth_bias);
+        }
+
+        if(state.stencil_state) {
+            vkCmdSetStencilReference(cmds, VK_STENCIL_FACE_FRONT_BIT, state.stencil_state->front_face_op.reference_value);
+            vkCmdSetStencilReference(cmds, VK_STENCIL_FACE_BACK_BIT, state.stencil_state->back_face_op.reference_value);
         }
     }
 
+    void VulkanRenderCommandList::flush_push_constants() {
+        if(!are_push_constants_dirty) {
+            return;
+        }
+
+        // Must match StandardPushConstants in the shader includer
+        const auto push_constants = std::array{camera_index, material_index, model_matrix_index};
+        const auto push_constants_size = static_cast<uint32_t>(sizeof(push_constants));
+
+        for(const auto& interval : current_push_constant_intervals) {
+            // Shaders only read the members they use, so the intervals might not cover all of them
+            if(interval.offset >= push_constants_size) {
+                continue;
+            }
+
+            const auto size = std::min(interval.size, push_constants_size - interval.offset);
+            vkCmdPushConstants(cmds,
+                               current_layout,
+                               static_cast<VkShaderStageFlags>(interval.stageFlags),
+                               interval.offset,
+                               size,
+                               reinterpret_cast<const uint8_t*>(push_constants.data()) + interval.offset);
+        }
+
+        are_push_constants_dirty = false;
+    }
+
     void VulkanRenderCommandList::bind_descriptor_sets(const std::vector<RhiDescriptorSet*>& descriptor_sets,
                                                        const RhiPipelineInterface* pipeline_interface) {
         ZoneScoped;        const auto* vk_interface = static_cast<const VulkanPipelineInterface*>(pipeline_interface);
@@ -338,11 +382,11 @@ namespace nova::renderer::rhi {
         }
     }
 
-    void VulkanRenderCommandList::bind_vertex_buffers(const std::vector<RhiBuffer*>& buffers) {
-        ZoneScoped;        std::vector<vk::Buffer> vk_buffers{&allocator};
+    void VulkanRenderCommandList::bind_vertex_buffers(const std::span<RhiBuffer* const> buffers) {
+        ZoneScoped;        mem::FrameVector<vk::Buffer> vk_buffers(frame_arena);
         vk_buffers.reserve(buffers.size());
 
-        std::vector<vk::DeviceSize> offsets{&allocator};
+        mem::FrameVector<vk::DeviceSize> offsets(frame_arena);
         offsets.reserve(buffers.size());
         for(uint32_t i = 0; i < buffers.size(); i++) {
             offsets.push_back(i);
@@ -359,25 +403,98 @@ namespace nova::renderer::rhi {
         vkCmdBindIndexBuffer(cmds, vk_buffer->buffer, 0, to_vk_index_type(index_type));
     }
 
+    void VulkanRenderCommandList::bind_vertex_buffers(const std::span<RhiBuffer* const> buffers, const std::span<const mem::Bytes> offsets) {
+        ZoneScoped;
+        mem::FrameVector<vk::Buffer> vk_buffers(frame_arena);
+        vk_buffers.reserve(buffers.size());
+
+        mem::FrameVector<vk::DeviceSize> vk_offsets(frame_arena);
+        vk_offsets.reserve(offsets.size());
+        for(uint32_t i = 0; i < buffers.size(); i++) {
+            const auto* vk_buffer = static_cast<const VulkanBuffer*>(buffers[i]);
+            vk_buffers.push_back(vk_buffer->buffer);
+            vk_offsets.push_back(offsets[i].b_count());
+        }
+
+        vkCmdBindVertexBuffers(cmds, 0, static_cast<uint32_t>(vk_buffers.size()), vk_buffers.data(), vk_offsets.data());
+    }
+
+    void VulkanRenderCommandList::bind_index_buffer(const RhiBuffer* buffer, const IndexType index_type, const mem::Bytes offset) {
+        ZoneScoped;
+        const auto* vk_buffer = static_cast<const VulkanBuffer*>(buffer);
+
+        vkCmdBindIndexBuffer(cmds, vk_buffer->buffer, offset.b_count(), to_vk_index_type(index_type));
+    }
+
     void VulkanRenderCommandList::draw_indexed_mesh(const uint32_t num_indices, const uint32_t offset, const uint32_t num_instances) {
-        ZoneScoped;        vkCmdDrawIndexed(cmds, num_indices, num_instances, offset, 0, 0);
+        ZoneScoped;
+        if(!is_pipeline_bound) {
+            return;
+        }
+
+        flush_push_constants();
+
+        vkCmdDrawIndexed(cmds, num_indices, num_instances, offset, 0, 0);
     }
 
     void VulkanRenderCommandList::set_scissor_rect(const uint32_t x, const uint32_t y, const uint32_t width, const uint32_t height) {
         ZoneScoped;        vk::Rect2D scissor_rect = {{static_cast<int32_t>(x), static_cast<int32_t>(y)}, {width, height}};
         vkCmdSetScissor(cmds, 0, 1, &scissor_rect);
+        is_scissor_rect_custom = true;
+    }
+
+    void VulkanRenderCommandList::bind_meshlet_buffers(RhiBuffer* vertex_buffer,
+                                                       RhiBuffer* meshlet_buffer,
+                                                       RhiBuffer* meshlet_vertex_buffer,
+                                                       RhiBuffer* meshlet_primitive_buffer) {
+        ZoneScoped;
+        const auto buffer_infos = std::array{
+            vk::DescriptorBufferInfo{static_cast<VulkanBuffer*>(vertex_buffer)->buffer, 0, VK_WHOLE_SIZE},
+            vk::DescriptorBufferInfo{static_cast<VulkanBuffer*>(meshlet_buffer)->buffer, 0, VK_WHOLE_SIZE},
+            vk::DescriptorBufferInfo{static_cast<VulkanBuffer*>(meshlet_vertex_buffer)->buffer, 0, VK_WHOLE_SIZE},
+            vk::DescriptorBufferInfo{static_cast<VulkanBuffer*>(meshlet_primitive_buffer)->buffer, 0, VK_WHOLE_SIZE},
+        };
+
+        std::array<vk::WriteDescriptorSet, buffer_infos.size()> writes;
+        for(uint32_t i = 0; i < buffer_infos.size(); i++) {
+            writes[i] = vk::WriteDescriptorSet()
+                            .setDstBinding(i)
+                            .setDescriptorCount(1)
+                            .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                            .setPBufferInfo(&buffer_infos[i]);
+        }
+
+        // The meshlet set is a push descriptor set, so we don't have to allocate and update a new descriptor set for every mesh
+        device.vkCmdPushDescriptorSetKHR(cmds,
+                                         VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                         device.standard_pipeline_layout,
+                                         MESHLET_DESCRIPTOR_SET_INDEX,
+                                         static_cast<uint32_t>(writes.size()),
+                                         reinterpret_cast<const VkWriteDescriptorSet*>(writes.data()));
+    }
+
+    void VulkanRenderCommandList::draw_mesh_tasks(const uint32_t num_tasks, const uint32_t first_task) {
+        ZoneScoped;
+        if(!is_pipeline_bound) {
+            return;
+        }
+
+        flush_push_constants();
+
+        device.vkCmdDrawMeshTasksNV(cmds, num_tasks, first_task);
     }
 
     void VulkanRenderCommandList::upload_data_to_image(RhiImage* image,
                                                        const size_t width,
                                                        const size_t height,
-                                                       const size_t bytes_per_pixel,
+                                                       const mem::Bytes num_bytes,
                                                        RhiBuffer* staging_buffer,
-                                                       const void* data) {
+                                                       const void* data,
+                                                       const uint32_t mip_level) {
         ZoneScoped;        auto* vk_image = static_cast<VulkanImage*>(image);
         auto* vk_buffer = static_cast<VulkanBuffer*>(staging_buffer);
 
-        memcpy(vk_buffer->allocation_info.pMappedData, data, width * height * bytes_per_pixel);
+        memcpy(vk_buffer->allocation_info.pMappedData, data, num_bytes.b_count());
 
         vk::BufferImageCopy image_copy{};
         if(!vk_image->is_depth_tex) {
@@ -385,16 +502,114 @@ namespace nova::renderer::rhi {
         } else {
             logger->error("Can not upload data to depth images");
         }
+        image_copy.imageSubresource.mipLevel = mip_level;
         image_copy.imageSubresource.layerCount = 1;
         image_copy.imageExtent = {static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1};
 
         vkCmdCopyBufferToImage(cmds, vk_buffer->buffer, vk_image->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &image_copy);
     }
 
-    void VulkanRenderCommandList::cleanup_resources() {
+    void VulkanRenderCommandList::copy_buffer_to_image(RhiImage* image,
+                                                       const RhiImageRegion& region,
+                                                       RhiBuffer* source_buffer,
+                                                       const mem::Bytes source_offset) {
         ZoneScoped;
-        device.return_standard_descriptor_sets(descriptor_sets);
+        auto* vk_image = static_cast<VulkanImage*>(image);
+        auto* vk_buffer = static_cast<VulkanBuffer*>(source_buffer);
+
+        vk::BufferImageCopy image_copy{};
+        image_copy.bufferOffset = source_offset.b_count();
+        image_copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        image_copy.imageSubresource.mipLevel = region.mip_level;
+        image_copy.imageSubresource.layerCount = 1;
+        image_copy.imageOffset = {static_cast<int32_t>(region.x), static_cast<int32_t>(region.y), 0};
+        image_copy.imageExtent = {region.width, region.height, 1};
 
-        descriptor_sets.clear();
+        vkCmdCopyBufferToImage(cmds, vk_buffer->buffer, vk_image->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &image_copy);
+    }
+
+    void VulkanRenderCommandList::generate_mips(RhiImage* image) {
+        ZoneScoped;
+        auto* vk_image = static_cast<VulkanImage*>(image);
+
+        VkImageMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = vk_image->image;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.levelCount = 1;
+        barrier.subresourceRange.layerCount = vk_image->num_array_layers;
+
+        auto mip_width = static_cast<int32_t>(vk_image->width);
+        auto mip_height = static_cast<int32_t>(vk_image->height);
+
+        for(uint32_t mip = 1; mip < vk_image->num_mip_levels; mip++) {
+            // The previous mip was just written, by the upload or by the last blit. Make it the source of this blit
+            barrier.subresourceRange.baseMipLevel = mip - 1;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            vkCmdPipelineBarrier(cmds, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+            const auto next_width = std::max(mip_width / 2, 1);
+            const auto next_height = std::max(mip_height / 2, 1);
+
+            VkImageBlit blit = {};
+            blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.srcSubresource.mipLevel = mip - 1;
+            blit.srcSubresource.layerCount = vk_image->num_array_layers;
+            blit.srcOffsets[1] = {mip_width, mip_height, 1};
+            blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.dstSubresource.mipLevel = mip;
+            blit.dstSubresource.layerCount = vk_image->num_array_layers;
+            blit.dstOffsets[1] = {next_width, next_height, 1};
+
+            vkCmdBlitImage(cmds,
+                           vk_image->image,
+                           VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           vk_image->image,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           1,
+                           &blit,
+                           VK_FILTER_LINEAR);
+
+            // Nothing reads the previous mip after this, so it can go straight to its final layout
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            vkCmdPipelineBarrier(cmds,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                 0,
+                                 0,
+                                 nullptr,
+                                 0,
+                                 nullptr,
+                                 1,
+                                 &barrier);
+
+            mip_width = next_width;
+            mip_height = next_height;
+        }
+
+        // The last mip was only ever written
+        barrier.subresourceRange.baseMipLevel = vk_image->num_mip_levels - 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(cmds,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                             0,
+                             0,
+                             nullptr,
+                             0,
+                             nullptr,
+                             1,
+                             &barrier);
     }
 } // namespace nova::renderer::rhi
@@ -28,14 +28,15 @@ namespace nova::renderer::rhi {
                                      RhiSampler* point_sampler,
                                      RhiSampler* bilinear_sampler,
                                      RhiSampler* trilinear_sampler,
-                                     const std::vector<RhiImage*>& textures,
-                                     rx::memory::allocator& allocator) override;
+                                     RhiBuffer* virtual_texture_info_buffer,
+                                     RhiBuffer* virtual_texture_feedback_buffer,
+                                     uint32_t frame_idx) override;
 
-        void bind_resources(RhiResourceBinder& binder) override;
+        void bind_resources(RhiResourceBinder& binder, uint32_t frame_idx) override;
 
         void resource_barriers(PipelineStage stages_before_barrier,
                                PipelineStage stages_after_barrier,
-                               const std::vector<RhiResourceBarrier>& barriers) override;
+                               std::span<const RhiResourceBarrier> barriers) override;
 
         void copy_buffer(RhiBuffer* destination_buffer,
                          mem::Bytes destination_offset,
@@ -53,29 +54,47 @@ namespace nova::renderer::rhi {
 
         void set_material_index(uint32_t index) override;
 
+        void set_model_matrix_index(uint32_t index) override;
+
         void set_pipeline(const RhiPipeline& state) override;
 
         void bind_descriptor_sets(const std::vector<RhiDescriptorSet*>& descriptor_sets,
                                   const RhiPipelineInterface* pipeline_interface) override;
 
-        void bind_vertex_buffers(const std::vector<RhiBuffer*>& buffers) override;
+        void bind_vertex_buffers(std::span<RhiBuffer* const> buffers) override;
+
+        void bind_vertex_buffers(std::span<RhiBuffer* const> buffers, std::span<const mem::Bytes> offsets) override;
 
         void bind_index_buffer(const RhiBuffer* buffer, IndexType index_type) override;
 
+        void bind_index_buffer(const RhiBuffer* buffer, IndexType index_type, mem::Bytes offset) override;
+
         void draw_indexed_mesh(uint32_t num_indices, uint32_t offset, uint32_t num_instances) override;
 
         void set_scissor_rect(uint32_t x, uint32_t y, uint32_t width, uint32_t height) override;
 
-        void upload_data_to_image(
-            RhiImage* image, size_t width, size_t height, size_t bytes_per_pixel, RhiBuffer* staging_buffer, const void* data) override;
+        void bind_meshlet_buffers(RhiBuffer* vertex_buffer,
+                                  RhiBuffer* meshlet_buffer,
+                                  RhiBuffer* meshlet_vertex_buffer,
+                                  RhiBuffer* meshlet_primitive_buffer) override;
+
+        void draw_mesh_tasks(uint32_t num_tasks, uint32_t first_task) override;
+
+        void upload_data_to_image(RhiImage* image,
+                                  size_t width,
+                                  size_t height,
+                                  mem::Bytes num_bytes,
+                                  RhiBuffer* staging_buffer,
+                                  const void* data,
+                                  uint32_t mip_level) override;
+
+        void copy_buffer_to_image(RhiImage* image,
+                                  const RhiImageRegion& region,
+                                  RhiBuffer* source_buffer,
+                                  mem::Bytes source_offset) override;
+
+        void generate_mips(RhiImage* image) override;
 
-    public:
-        /*!
-         * \brief Called by VulkanRenderDevice when this command list has finished execution on the GPU
-         *
-         * This method should free any transient resources that the command lists uses
-         */
-        void cleanup_resources();
     private:
         VulkanRenderDevice& device;
 
@@ -83,10 +102,51 @@ namespace nova::renderer::rhi {
 
         uint32_t camera_index = 0;
 
+        uint32_t material_index = 0;
+
+        uint32_t model_matrix_index = 0;
+
         VulkanRenderpass* current_render_pass = nullptr;
 
+        /*!
+         * \brief False if the last pipeline we tried to bind wasn't ready and had no fallback, in which case we skip draws until the next
+         * pipeline
+         */
+        bool is_pipeline_bound = false;
+
         vk::PipelineLayout current_layout = VK_NULL_HANDLE;
 
-        std::vector<vk::DescriptorSet> descriptor_sets;
+        /*!
+         * \brief Disjoint push constant intervals in `current_layout`. See `VulkanPipelineLayoutInfo::push_constant_intervals`
+         */
+        std::vector<vk::PushConstantRange> current_push_constant_intervals;
+
+        /*!
+         * \brief True if the camera or material index changed, or we bound a pipeline with a different layout, since we last pushed
+         * constants
+         */
+        bool are_push_constants_dirty = true;
+
+        /*!
+         * \brief Area of the framebuffer that the current renderpass renders to
+         */
+        vk::Rect2D current_render_area{};
+
+        /*!
+         * \brief True if someone set a scissor rect which doesn't cover the whole render area
+         */
+        bool is_scissor_rect_custom = false;
+
+        /*!
+         * \brief Sets the dynamic state that a pipeline needs, right after binding it
+         */
+        void set_dynamic_state(const RhiGraphicsPipelineState& state);
+
+        /*!
+         * \brief Pushes the camera and material index, if they changed, right before a draw
+         *
+         * Both indices go in one push for each of the current layout's ranges, rather than one push every time either index changes
+         */
+        void flush_push_constants();
     };
 } // namespace nova::renderer::rhi
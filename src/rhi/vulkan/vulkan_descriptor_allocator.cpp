@@ -0,0 +1,381 @@
+#include "vulkan_descriptor_allocator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+#include <Tracy.hpp>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+#include "nova_renderer/util/utils.hpp"
+
+namespace nova::renderer::rhi {
+    static auto logger = spdlog::stdout_color_mt("VulkanDescriptorAllocator");
+
+    /*!
+     * \brief Number of sets that the first pool in each chain can hold. Each pool after that is twice as large as the one before it, up
+     * to MAX_SETS_PER_POOL
+     */
+    constexpr uint32_t INITIAL_SETS_PER_POOL = 64;
+
+    constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+    /*!
+     * \brief How many descriptors of each type we expect the average set to have
+     *
+     * Sets with more descriptors than this get their own pool, see `fits_in_shared_pool`
+     */
+    constexpr auto DESCRIPTORS_PER_SET = std::array{std::pair{vk::DescriptorType::eUniformBuffer, 4u},
+                                                    std::pair{vk::DescriptorType::eStorageBuffer, 4u},
+                                                    std::pair{vk::DescriptorType::eSampledImage, 16u},
+                                                    std::pair{vk::DescriptorType::eSampler, 4u},
+                                                    std::pair{vk::DescriptorType::eCombinedImageSampler, 4u}};
+
+    VulkanDescriptorAllocator::VulkanDescriptorAllocator(const vk::Device device,
+                                                         const vk::AllocationCallbacks& allocation_callbacks,
+                                                         const uint32_t num_in_flight_frames,
+                                                         const uint32_t num_threads)
+        : device{device}, allocation_callbacks{allocation_callbacks}, num_threads{num_threads} {
+        persistent_pools.can_free_sets = true;
+        freed_sets_per_frame.resize(num_in_flight_frames);
+        transient_pools.resize(num_in_flight_frames * num_threads);
+    }
+
+    VulkanDescriptorAllocator::~VulkanDescriptorAllocator() {
+        const auto destroy_chain = [&](const PoolChain& chain) {
+            for(const auto pool : chain.pools) {
+                device.destroyDescriptorPool(pool, &allocation_callbacks);
+            }
+        };
+
+        destroy_chain(persistent_pools);
+
+        for(const auto& chain : transient_pools) {
+            destroy_chain(chain);
+        }
+
+        for(const auto& [pool, num_live_sets] : dedicated_pools) {
+            device.destroyDescriptorPool(vk::DescriptorPool{pool}, &allocation_callbacks);
+        }
+    }
+
+    std::vector<vk::DescriptorSet> VulkanDescriptorAllocator::allocate_persistent(
+        const std::vector<vk::DescriptorSetLayout>& layouts,
+        const std::vector<uint32_t>& variable_descriptor_counts,
+        const std::span<const vk::DescriptorPoolSize> descriptor_counts) {
+        ZoneScoped;
+        if(layouts.size() != variable_descriptor_counts.size()) {
+            throw std::runtime_error("Descriptor set layouts and variable descriptor counts must be the same size");
+        }
+
+        const auto variable_count_info = vk::DescriptorSetVariableDescriptorCountAllocateInfo()
+                                             .setDescriptorSetCount(static_cast<uint32_t>(variable_descriptor_counts.size()))
+                                             .setPDescriptorCounts(variable_descriptor_counts.data());
+
+        const auto allocate_info = vk::DescriptorSetAllocateInfo()
+                                       .setDescriptorSetCount(static_cast<uint32_t>(layouts.size()))
+                                       .setPSetLayouts(layouts.data())
+                                       .setPNext(&variable_count_info);
+
+        std::vector<vk::DescriptorSet> sets(layouts.size());
+
+        const auto has_variable_descriptors = std::any_of(variable_descriptor_counts.begin(),
+                                                          variable_descriptor_counts.end(),
+                                                          [](const uint32_t count) { return count > 0; });
+
+        std::lock_guard lock{persistent_mutex};
+
+        const auto pool = !has_variable_descriptors && fits_in_shared_pool(layouts.size(), descriptor_counts) ?
+                              allocate_from_chain(persistent_pools, allocate_info, sets.data()) :
+                              allocate_from_dedicated_pool(allocate_info, descriptor_counts, sets.data());
+        if(!pool) {
+            throw std::runtime_error(fmt::format("Could not allocate {} descriptor sets", layouts.size()));
+        }
+
+        for(const auto set : sets) {
+            pool_by_set.emplace(static_cast<VkDescriptorSet>(set), pool);
+        }
+
+        return sets;
+    }
+
+    void VulkanDescriptorAllocator::free_persistent(const std::span<const vk::DescriptorSet> sets) {
+        std::lock_guard lock{persistent_mutex};
+
+        auto& freed_sets = freed_sets_per_frame[cur_frame_idx];
+        freed_sets.insert(freed_sets.end(), sets.begin(), sets.end());
+    }
+
+    vk::DescriptorSet VulkanDescriptorAllocator::allocate_transient(const uint32_t frame_idx,
+                                                                    const uint32_t thread_idx,
+                                                                    const vk::DescriptorSetLayout layout,
+                                                                    const uint32_t variable_descriptor_count) {
+        const auto variable_count_info = vk::DescriptorSetVariableDescriptorCountAllocateInfo()
+                                             .setDescriptorSetCount(1)
+                                             .setPDescriptorCounts(&variable_descriptor_count);
+
+        const auto allocate_info = vk::DescriptorSetAllocateInfo().setDescriptorSetCount(1).setPSetLayouts(&layout).setPNext(
+            &variable_count_info);
+
+        // No locking needed, each thread only touches its own chain
+        auto& chain = transient_pools[frame_idx * num_threads + thread_idx];
+
+        vk::DescriptorSet set;
+        if(!allocate_from_chain(chain, allocate_info, &set)) {
+            return {};
+        }
+
+        return set;
+    }
+
+    void VulkanDescriptorAllocator::reset_frame(const uint32_t frame_idx) {
+        ZoneScoped;
+        for(uint32_t thread_idx = 0; thread_idx < num_threads; thread_idx++) {
+            auto& chain = transient_pools[frame_idx * num_threads + thread_idx];
+
+            // Keep the pools around, so we don't have to grow the chain again next frame
+            for(const auto pool : chain.pools) {
+                device.resetDescriptorPool(pool, {});
+            }
+
+            chain.current_pool = 0;
+        }
+
+        std::lock_guard lock{persistent_mutex};
+
+        cur_frame_idx = frame_idx;
+
+        // Every frame which might have used these sets has finished by now
+        auto& freed_sets = freed_sets_per_frame[frame_idx];
+        for(const auto set : freed_sets) {
+            free_persistent_now(set);
+        }
+        freed_sets.clear();
+    }
+
+    size_t VulkanDescriptorAllocator::ImmutableSetKeyHasher::operator()(const std::vector<uint64_t>& key) const {
+        size_t hash = 0;
+        for(const auto value : key) {
+            hash_combine(hash, value);
+        }
+
+        return hash;
+    }
+
+    vk::DescriptorSet VulkanDescriptorAllocator::get_immutable_set(const vk::DescriptorSetLayout layout,
+                                                                   const std::span<const vk::WriteDescriptorSet> writes) {
+        ZoneScoped;
+        // The key is everything that affects the set's contents, and the handles are the resources that it refers to
+        std::vector<uint64_t> key;
+        std::vector<uint64_t> handles;
+
+        key.push_back(reinterpret_cast<uint64_t>(static_cast<VkDescriptorSetLayout>(layout)));
+
+        for(const auto& write : writes) {
+            key.push_back(write.dstBinding);
+            key.push_back(write.dstArrayElement);
+            key.push_back(write.descriptorCount);
+            key.push_back(static_cast<uint64_t>(write.descriptorType));
+
+            for(uint32_t i = 0; i < write.descriptorCount; i++) {
+                if(write.pBufferInfo != nullptr) {
+                    const auto& info = write.pBufferInfo[i];
+                    handles.push_back(reinterpret_cast<uint64_t>(static_cast<VkBuffer>(info.buffer)));
+                    key.push_back(handles.back());
+                    key.push_back(info.offset);
+                    key.push_back(info.range);
+
+                } else if(write.pImageInfo != nullptr) {
+                    const auto& info = write.pImageInfo[i];
+                    handles.push_back(reinterpret_cast<uint64_t>(static_cast<VkImageView>(info.imageView)));
+                    key.push_back(handles.back());
+                    handles.push_back(reinterpret_cast<uint64_t>(static_cast<VkSampler>(info.sampler)));
+                    key.push_back(handles.back());
+                    key.push_back(static_cast<uint64_t>(info.imageLayout));
+                }
+            }
+        }
+
+        std::lock_guard lock{persistent_mutex};
+
+        if(const auto itr = immutable_sets.find(key); itr != immutable_sets.end()) {
+            return itr->second.set;
+        }
+
+        const uint32_t no_variable_descriptors = 0;
+        const auto variable_count_info = vk::DescriptorSetVariableDescriptorCountAllocateInfo()
+                                             .setDescriptorSetCount(1)
+                                             .setPDescriptorCounts(&no_variable_descriptors);
+        const auto allocate_info = vk::DescriptorSetAllocateInfo().setDescriptorSetCount(1).setPSetLayouts(&layout).setPNext(
+            &variable_count_info);
+
+        vk::DescriptorSet set;
+        const auto pool = allocate_from_chain(persistent_pools, allocate_info, &set);
+        if(!pool) {
+            return {};
+        }
+
+        pool_by_set.emplace(static_cast<VkDescriptorSet>(set), pool);
+
+        std::vector<vk::WriteDescriptorSet> writes_to_set{writes.begin(), writes.end()};
+        for(auto& write : writes_to_set) {
+            write.dstSet = set;
+        }
+        device.updateDescriptorSets(static_cast<uint32_t>(writes_to_set.size()), writes_to_set.data(), 0, nullptr);
+
+        immutable_sets.emplace(std::move(key), ImmutableSet{set, std::move(handles)});
+
+        return set;
+    }
+
+    void VulkanDescriptorAllocator::forget_sets_using(const uint64_t handle) {
+        std::lock_guard lock{persistent_mutex};
+
+        auto& freed_sets = freed_sets_per_frame[cur_frame_idx];
+        std::erase_if(immutable_sets, [&](const auto& pair) {
+            const auto& handles = pair.second.handles;
+            if(std::find(handles.begin(), handles.end(), handle) == handles.end()) {
+                return false;
+            }
+
+            freed_sets.push_back(pair.second.set);
+            return true;
+        });
+    }
+
+    bool VulkanDescriptorAllocator::fits_in_shared_pool(const size_t num_sets,
+                                                        const std::span<const vk::DescriptorPoolSize> descriptor_counts) {
+        if(num_sets > INITIAL_SETS_PER_POOL) {
+            return false;
+        }
+
+        return std::all_of(descriptor_counts.begin(), descriptor_counts.end(), [](const vk::DescriptorPoolSize& pool_size) {
+            const auto itr = std::find_if(DESCRIPTORS_PER_SET.begin(), DESCRIPTORS_PER_SET.end(), [&](const auto& type_and_count) {
+                return type_and_count.first == pool_size.type;
+            });
+
+            return itr != DESCRIPTORS_PER_SET.end() && pool_size.descriptorCount <= itr->second * INITIAL_SETS_PER_POOL;
+        });
+    }
+
+    vk::DescriptorPool VulkanDescriptorAllocator::allocate_from_chain(PoolChain& chain,
+                                                                      const vk::DescriptorSetAllocateInfo& allocate_info,
+                                                                      vk::DescriptorSet* sets) {
+        auto pool_flags = vk::DescriptorPoolCreateFlags{vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind};
+        if(chain.can_free_sets) {
+            pool_flags |= vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet;
+        }
+
+        while(true) {
+            auto is_new_pool = false;
+            if(chain.current_pool == chain.pools.size()) {
+                chain.pools.push_back(create_pool(chain.pools.size(), pool_flags));
+                is_new_pool = true;
+            }
+
+            auto info = allocate_info;
+            info.descriptorPool = chain.pools[chain.current_pool];
+
+            const auto result = device.allocateDescriptorSets(&info, sets);
+            if(result == vk::Result::eSuccess) {
+                return info.descriptorPool;
+            }
+
+            if(result != vk::Result::eErrorOutOfPoolMemory && result != vk::Result::eErrorFragmentedPool) {
+                logger->error("Could not allocate descriptor sets: {}", vk::to_string(result));
+                return {};
+            }
+
+            if(is_new_pool) {
+                // Stay on this pool, since it's still empty and smaller sets can use it
+                logger->error("Could not allocate descriptor sets even from a brand new descriptor pool. Are the sets too large?");
+                return {};
+            }
+
+            chain.current_pool++;
+        }
+    }
+
+    vk::DescriptorPool VulkanDescriptorAllocator::allocate_from_dedicated_pool(
+        const vk::DescriptorSetAllocateInfo& allocate_info,
+        const std::span<const vk::DescriptorPoolSize> descriptor_counts,
+        vk::DescriptorSet* sets) {
+        ZoneScoped;
+        const auto create_info = vk::DescriptorPoolCreateInfo()
+                                     .setFlags(vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind)
+                                     .setMaxSets(allocate_info.descriptorSetCount)
+                                     .setPoolSizeCount(static_cast<uint32_t>(descriptor_counts.size()))
+                                     .setPPoolSizes(descriptor_counts.data());
+
+        vk::DescriptorPool pool;
+        if(const auto result = device.createDescriptorPool(&create_info, &allocation_callbacks, &pool); result != vk::Result::eSuccess) {
+            logger->error("Could not create a descriptor pool for {} sets: {}", allocate_info.descriptorSetCount, vk::to_string(result));
+            return {};
+        }
+
+        auto info = allocate_info;
+        info.descriptorPool = pool;
+
+        if(const auto result = device.allocateDescriptorSets(&info, sets); result != vk::Result::eSuccess) {
+            logger->error("Could not allocate descriptor sets from their own pool: {}", vk::to_string(result));
+            device.destroyDescriptorPool(pool, &allocation_callbacks);
+            return {};
+        }
+
+        dedicated_pools.emplace(static_cast<VkDescriptorPool>(pool), allocate_info.descriptorSetCount);
+
+        return pool;
+    }
+
+    void VulkanDescriptorAllocator::free_persistent_now(const vk::DescriptorSet set) {
+        const auto pool_itr = pool_by_set.find(static_cast<VkDescriptorSet>(set));
+        if(pool_itr == pool_by_set.end()) {
+            logger->error("Tried to free a descriptor set which didn't come from this allocator");
+            return;
+        }
+
+        const auto pool = pool_itr->second;
+        pool_by_set.erase(pool_itr);
+
+        // Dedicated pools can't free individual sets, but we can destroy the whole pool once nothing uses it
+        if(const auto dedicated_itr = dedicated_pools.find(static_cast<VkDescriptorPool>(pool)); dedicated_itr != dedicated_pools.end()) {
+            dedicated_itr->second--;
+            if(dedicated_itr->second == 0) {
+                device.destroyDescriptorPool(pool, &allocation_callbacks);
+                dedicated_pools.erase(dedicated_itr);
+            }
+
+            return;
+        }
+
+        device.freeDescriptorSets(pool, 1, &set);
+
+        // The pool has room again, so start allocating from it
+        const auto pool_idx = static_cast<size_t>(std::find(persistent_pools.pools.begin(), persistent_pools.pools.end(), pool) -
+                                                  persistent_pools.pools.begin());
+        persistent_pools.current_pool = std::min(persistent_pools.current_pool, pool_idx);
+    }
+
+    vk::DescriptorPool VulkanDescriptorAllocator::create_pool(const size_t pool_idx, const vk::DescriptorPoolCreateFlags flags) const {
+        ZoneScoped;
+        const auto num_sets = std::min(INITIAL_SETS_PER_POOL << std::min<size_t>(pool_idx, 16), MAX_SETS_PER_POOL);
+
+        std::array<vk::DescriptorPoolSize, DESCRIPTORS_PER_SET.size()> pool_sizes;
+        for(size_t i = 0; i < DESCRIPTORS_PER_SET.size(); i++) {
+            const auto& [type, count] = DESCRIPTORS_PER_SET[i];
+            pool_sizes[i] = vk::DescriptorPoolSize{type, count * num_sets};
+        }
+
+        const auto create_info = vk::DescriptorPoolCreateInfo()
+                                     .setFlags(flags)
+                                     .setMaxSets(num_sets)
+                                     .setPoolSizeCount(static_cast<uint32_t>(pool_sizes.size()))
+                                     .setPPoolSizes(pool_sizes.data());
+
+        vk::DescriptorPool pool;
+        device.createDescriptorPool(&create_info, &allocation_callbacks, &pool);
+
+        return pool;
+    }
+} // namespace nova::renderer::rhi
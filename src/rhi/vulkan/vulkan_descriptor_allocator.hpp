@@ -0,0 +1,210 @@
+#pragma once
+
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+namespace nova::renderer::rhi {
+    /*!
+     * \brief Allocates descriptor sets from chains of descriptor pools which grow as needed
+     *
+     * There's three kinds of descriptor sets:
+     * - Persistent sets live until they're freed with `free_persistent`. Resource binders use these
+     * - Transient sets live until their frame comes around again. Each in-flight frame has its own pools for each render thread, so threads
+     *   can allocate transient sets without any locking. All of a frame's transient pools are reset at once, after the frame's fence has
+     *   signaled
+     * - Immutable sets are persistent sets which are never written after they're created. They're cached by their contents, so asking for
+     *   a set with the same layout and the same descriptors as an existing set gives you the existing set
+     *
+     * When a pool runs out of space, the allocator chains a new, larger pool onto it rather than failing. Persistent sets with
+     * variable-sized bindings, or with more descriptors than a shared pool has room for, get a pool of their own that's exactly as large as
+     * they need - an unbounded texture array can hold tens of thousands of textures, which would either not fit in a shared pool or waste
+     * most of it
+     */
+    class VulkanDescriptorAllocator {
+    public:
+        /*!
+         * \param device The device to create pools with
+         * \param allocation_callbacks Host memory callbacks for the pools
+         * \param num_in_flight_frames Number of in-flight frames, each of which gets its own transient pools
+         * \param num_threads Number of threads which may allocate transient sets
+         */
+        VulkanDescriptorAllocator(vk::Device device,
+                                  const vk::AllocationCallbacks& allocation_callbacks,
+                                  uint32_t num_in_flight_frames,
+                                  uint32_t num_threads);
+
+        VulkanDescriptorAllocator(const VulkanDescriptorAllocator& other) = delete;
+        VulkanDescriptorAllocator& operator=(const VulkanDescriptorAllocator& other) = delete;
+
+        VulkanDescriptorAllocator(VulkanDescriptorAllocator&& old) noexcept = delete;
+        VulkanDescriptorAllocator& operator=(VulkanDescriptorAllocator&& old) noexcept = delete;
+
+        ~VulkanDescriptorAllocator();
+
+        /*!
+         * \brief Allocates descriptor sets that live until you free them with `free_persistent`
+         *
+         * Throws a `std::runtime_error` if the sets can't be allocated, since nothing can render with half-allocated descriptors
+         *
+         * \param layouts The layout of each set to allocate
+         * \param variable_descriptor_counts The number of descriptors in the variable-sized binding of each set. Must be the same size as
+         * `layouts`
+         * \param descriptor_counts The total number of descriptors of each type in all the sets, including the variable-sized bindings
+         *
+         * \return The new sets, in the same order as `layouts`
+         */
+        [[nodiscard]] std::vector<vk::DescriptorSet> allocate_persistent(const std::vector<vk::DescriptorSetLayout>& layouts,
+                                                                         const std::vector<uint32_t>& variable_descriptor_counts,
+                                                                         std::span<const vk::DescriptorPoolSize> descriptor_counts);
+
+        /*!
+         * \brief Returns persistent sets to their pools
+         *
+         * The in-flight frames may still be reading the sets, so they're actually freed the next time the current frame's transient pools
+         * are reset. A pool which was created for a single allocation is destroyed once all of its sets are freed
+         */
+        void free_persistent(std::span<const vk::DescriptorSet> sets);
+
+        /*!
+         * \brief Allocates a descriptor set that's valid until the next time `reset_frame` is called for the same frame
+         *
+         * Only one thread may use a given thread index at a time. Different threads may allocate at the same time without any locking
+         */
+        [[nodiscard]] vk::DescriptorSet allocate_transient(uint32_t frame_idx,
+                                                           uint32_t thread_idx,
+                                                           vk::DescriptorSetLayout layout,
+                                                           uint32_t variable_descriptor_count = 0);
+
+        /*!
+         * \brief Frees every transient set that was allocated for the given frame, and every persistent set which was freed the last time
+         * this frame was recorded
+         *
+         * Call this after waiting for the frame's fence, and before any thread allocates transient sets for the frame
+         */
+        void reset_frame(uint32_t frame_idx);
+
+        /*!
+         * \brief Gets a descriptor set with the given layout and contents, creating and writing it if it doesn't exist yet
+         *
+         * The `dstSet` of the writes is ignored. You must not write to the set that this method returns
+         *
+         * The cache identifies resources by their handles. When you destroy a resource that might be in an immutable set, call
+         * `forget_sets_using` so that a new resource with a recycled handle doesn't get the old resource's set
+         */
+        [[nodiscard]] vk::DescriptorSet get_immutable_set(vk::DescriptorSetLayout layout, std::span<const vk::WriteDescriptorSet> writes);
+
+        /*!
+         * \brief Removes every immutable set which refers to the given Vulkan handle from the cache, and frees those sets
+         */
+        void forget_sets_using(uint64_t handle);
+
+    private:
+        /*!
+         * \brief A chain of descriptor pools. When one is full we move on to the next, creating it if needed
+         */
+        struct PoolChain {
+            std::vector<vk::DescriptorPool> pools;
+
+            /*!
+             * \brief Index of the pool we're currently allocating from
+             */
+            size_t current_pool = 0;
+
+            /*!
+             * \brief Whether sets from this chain can be freed individually
+             */
+            bool can_free_sets = false;
+        };
+
+        struct ImmutableSet {
+            vk::DescriptorSet set;
+
+            /*!
+             * \brief Every Vulkan handle that the set refers to
+             */
+            std::vector<uint64_t> handles;
+        };
+
+        vk::Device device;
+
+        const vk::AllocationCallbacks& allocation_callbacks;
+
+        uint32_t num_threads;
+
+        /*!
+         * \brief Guards everything which isn't a transient pool
+         */
+        std::mutex persistent_mutex;
+
+        PoolChain persistent_pools;
+
+        /*!
+         * \brief Pools which were created for a single allocation, and how many of their sets haven't been freed yet
+         */
+        std::unordered_map<VkDescriptorPool, uint32_t> dedicated_pools;
+
+        /*!
+         * \brief The pool that each persistent set came from
+         */
+        std::unordered_map<VkDescriptorSet, vk::DescriptorPool> pool_by_set;
+
+        /*!
+         * \brief Index of the frame that was most recently reset
+         */
+        uint32_t cur_frame_idx = 0;
+
+        /*!
+         * \brief Persistent sets which were freed while each frame was being recorded. They're returned to their pools when that frame
+         * comes around again
+         */
+        std::vector<std::vector<vk::DescriptorSet>> freed_sets_per_frame;
+
+        /*!
+         * \brief Transient pools for each frame and each thread. Index with `frame_idx * num_threads + thread_idx`
+         */
+        std::vector<PoolChain> transient_pools;
+
+        struct ImmutableSetKeyHasher {
+            size_t operator()(const std::vector<uint64_t>& key) const;
+        };
+
+        /*!
+         * \brief Immutable sets, keyed by their layout and everything in their descriptors
+         */
+        std::unordered_map<std::vector<uint64_t>, ImmutableSet, ImmutableSetKeyHasher> immutable_sets;
+
+        /*!
+         * \brief Checks if sets with the given number of descriptors will fit in an empty shared pool
+         */
+        [[nodiscard]] static bool fits_in_shared_pool(size_t num_sets, std::span<const vk::DescriptorPoolSize> descriptor_counts);
+
+        /*!
+         * \brief Allocates sets from the chain, growing the chain if the current pool is full
+         *
+         * \return The pool that the sets came from, or a null pool if they couldn't be allocated
+         */
+        [[nodiscard]] vk::DescriptorPool allocate_from_chain(PoolChain& chain,
+                                                             const vk::DescriptorSetAllocateInfo& allocate_info,
+                                                             vk::DescriptorSet* sets);
+
+        /*!
+         * \brief Creates a pool with exactly enough space for the sets, and allocates them from it
+         *
+         * \return The new pool, or a null pool if the sets couldn't be allocated
+         */
+        [[nodiscard]] vk::DescriptorPool allocate_from_dedicated_pool(const vk::DescriptorSetAllocateInfo& allocate_info,
+                                                                      std::span<const vk::DescriptorPoolSize> descriptor_counts,
+                                                                      vk::DescriptorSet* sets);
+
+        /*!
+         * \brief Returns a persistent set to its pool right away. The caller must hold `persistent_mutex`
+         */
+        void free_persistent_now(vk::DescriptorSet set);
+
+        [[nodiscard]] vk::DescriptorPool create_pool(size_t pool_idx, vk::DescriptorPoolCreateFlags flags) const;
+    };
+} // namespace nova::renderer::rhi
@@ -0,0 +1,231 @@
+#include "vulkan_pipeline_cache.hpp"
+
+#include <cstring>
+#include <fstream>
+
+#include <Tracy.hpp>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+namespace nova::renderer::rhi {
+    static auto logger = spdlog::stdout_color_mt("VulkanPipelineCache");
+
+    constexpr uint32_t PIPELINE_CACHE_FILE_MAGIC = 0x4350564E; // "NVPC"
+
+    /*!
+     * \brief Version of our header. Increment this whenever the header changes
+     */
+    constexpr uint32_t PIPELINE_CACHE_FILE_VERSION = 1;
+
+    constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+    constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+    /*!
+     * \brief Goes at the start of the cache file, before the data that the driver gave us
+     */
+    struct PipelineCacheFileHeader {
+        uint32_t magic;
+        uint32_t version;
+
+        uint32_t vendor_id;
+        uint32_t device_id;
+        uint32_t driver_version;
+        uint8_t pipeline_cache_uuid[VK_UUID_SIZE];
+
+        uint64_t data_size;
+
+        /*!
+         * \brief FNV-1a hash of the data, so we can tell if the file got corrupted
+         */
+        uint64_t data_hash;
+    };
+
+    static uint64_t hash_data(const uint8_t* data, const size_t size) {
+        uint64_t hash = FNV_OFFSET_BASIS;
+        for(size_t i = 0; i < size; i++) {
+            hash ^= data[i];
+            hash *= FNV_PRIME;
+        }
+
+        return hash;
+    }
+
+    static PipelineCacheFileHeader make_header(const vk::PhysicalDeviceProperties& gpu_properties) {
+        PipelineCacheFileHeader header = {};
+        header.magic = PIPELINE_CACHE_FILE_MAGIC;
+        header.version = PIPELINE_CACHE_FILE_VERSION;
+        header.vendor_id = gpu_properties.vendorID;
+        header.device_id = gpu_properties.deviceID;
+        header.driver_version = gpu_properties.driverVersion;
+        std::memcpy(header.pipeline_cache_uuid, gpu_properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+        return header;
+    }
+
+    VulkanPipelineCache::VulkanPipelineCache(const vk::Device device,
+                                             const vk::PhysicalDeviceProperties& gpu_properties,
+                                             const vk::AllocationCallbacks& allocation_callbacks,
+                                             std::filesystem::path cache_path)
+        : device{device}, gpu_properties{gpu_properties}, allocation_callbacks{allocation_callbacks}, cache_path{std::move(cache_path)} {
+        ZoneScoped;
+        const auto initial_data = load_cache_data();
+
+        vk::PipelineCacheCreateInfo create_info = {};
+        create_info.initialDataSize = initial_data.size();
+        create_info.pInitialData = initial_data.data();
+
+        auto result = device.createPipelineCache(&create_info, &allocation_callbacks, &cache);
+        if(result != vk::Result::eSuccess && !initial_data.empty()) {
+            // The driver didn't like the data even though it passed our checks. Start over with an empty cache
+            logger->warn("Driver rejected the pipeline cache data in {}, starting with an empty cache", this->cache_path.string());
+
+            create_info.initialDataSize = 0;
+            create_info.pInitialData = nullptr;
+            result = device.createPipelineCache(&create_info, &allocation_callbacks, &cache);
+        }
+
+        if(result != vk::Result::eSuccess) {
+            logger->error("Could not create pipeline cache: {}", vk::to_string(result));
+            cache = vk::PipelineCache{};
+
+        } else if(!initial_data.empty()) {
+            logger->info("Loaded {} bytes of pipeline cache data from {}", initial_data.size(), this->cache_path.string());
+        }
+    }
+
+    VulkanPipelineCache::~VulkanPipelineCache() {
+        if(cache) {
+            save();
+            device.destroyPipelineCache(cache, &allocation_callbacks);
+        }
+    }
+
+    vk::PipelineCache VulkanPipelineCache::get_cache() const { return cache; }
+
+    void VulkanPipelineCache::save() const {
+        ZoneScoped;
+        if(!cache) {
+            return;
+        }
+
+        size_t data_size = 0;
+        if(device.getPipelineCacheData(cache, &data_size, nullptr) != vk::Result::eSuccess) {
+            logger->error("Could not get the size of the pipeline cache data");
+            return;
+        }
+
+        std::vector<uint8_t> data(data_size);
+        if(device.getPipelineCacheData(cache, &data_size, data.data()) != vk::Result::eSuccess) {
+            logger->error("Could not get the pipeline cache data");
+            return;
+        }
+        data.resize(data_size);
+
+        auto header = make_header(gpu_properties);
+        header.data_size = data.size();
+        header.data_hash = hash_data(data.data(), data.size());
+
+        std::error_code error;
+        if(cache_path.has_parent_path()) {
+            std::filesystem::create_directories(cache_path.parent_path(), error);
+            if(error) {
+                logger->error("Could not create pipeline cache directory {}: {}", cache_path.parent_path().string(), error.message());
+                return;
+            }
+        }
+
+        auto temp_path = cache_path;
+        temp_path += ".tmp";
+
+        {
+            std::ofstream file{temp_path, std::ios::binary | std::ios::trunc};
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+            file.flush();
+
+            if(!file) {
+                logger->error("Could not write pipeline cache to {}", temp_path.string());
+                file.close();
+                std::filesystem::remove(temp_path, error);
+                return;
+            }
+        }
+
+        std::filesystem::rename(temp_path, cache_path, error);
+        if(error) {
+            logger->error("Could not move pipeline cache from {} to {}: {}", temp_path.string(), cache_path.string(), error.message());
+            std::filesystem::remove(temp_path, error);
+            return;
+        }
+
+        logger->debug("Saved {} bytes of pipeline cache data to {}", data.size(), cache_path.string());
+    }
+
+    std::vector<uint8_t> VulkanPipelineCache::load_cache_data() const {
+        ZoneScoped;
+        std::ifstream file{cache_path, std::ios::binary | std::ios::ate};
+        if(!file) {
+            return {};
+        }
+
+        const auto file_size = static_cast<size_t>(file.tellg());
+        file.seekg(0);
+
+        PipelineCacheFileHeader header = {};
+        if(file_size < sizeof(header) || !file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+            logger->warn("Pipeline cache file {} is too small to have a header, ignoring it", cache_path.string());
+            return {};
+        }
+
+        const auto expected_header = make_header(gpu_properties);
+        if(header.magic != expected_header.magic || header.version != expected_header.version) {
+            logger->warn("Pipeline cache file {} isn't a Nova pipeline cache, or is from an older version of Nova. Ignoring it",
+                         cache_path.string());
+            return {};
+        }
+
+        if(header.vendor_id != expected_header.vendor_id || header.device_id != expected_header.device_id ||
+           header.driver_version != expected_header.driver_version ||
+           std::memcmp(header.pipeline_cache_uuid, expected_header.pipeline_cache_uuid, VK_UUID_SIZE) != 0) {
+            logger->info("Pipeline cache file {} is from a different GPU or driver, ignoring it", cache_path.string());
+            return {};
+        }
+
+        if(header.data_size != file_size - sizeof(header)) {
+            logger->warn("Pipeline cache file {} is truncated, ignoring it", cache_path.string());
+            return {};
+        }
+
+        std::vector<uint8_t> data(header.data_size);
+        if(!file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size())) ||
+           hash_data(data.data(), data.size()) != header.data_hash) {
+            logger->warn("Pipeline cache file {} is corrupt, ignoring it", cache_path.string());
+            return {};
+        }
+
+        // The driver checks its own header too, but some drivers have crashed on bad data in the past, so check it ourselves as well
+        struct VulkanCacheHeader {
+            uint32_t header_size;
+            uint32_t header_version;
+            uint32_t vendor_id;
+            uint32_t device_id;
+            uint8_t pipeline_cache_uuid[VK_UUID_SIZE];
+        };
+
+        VulkanCacheHeader vk_header = {};
+        if(data.size() < sizeof(vk_header)) {
+            logger->warn("Pipeline cache file {} has no Vulkan header, ignoring it", cache_path.string());
+            return {};
+        }
+        std::memcpy(&vk_header, data.data(), sizeof(vk_header));
+
+        if(vk_header.header_size < sizeof(vk_header) || vk_header.header_version != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+           vk_header.vendor_id != expected_header.vendor_id || vk_header.device_id != expected_header.device_id ||
+           std::memcmp(vk_header.pipeline_cache_uuid, expected_header.pipeline_cache_uuid, VK_UUID_SIZE) != 0) {
+            logger->warn("Pipeline cache file {} has a Vulkan header that doesn't match this device, ignoring it", cache_path.string());
+            return {};
+        }
+
+        return data;
+    }
+} // namespace nova::renderer::rhi
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+namespace nova::renderer::rhi {
+    /*!
+     * \brief A VkPipelineCache which is loaded from disk when it's created, and saved back to disk when asked
+     *
+     * Drivers spend most of the time it takes to create a pipeline compiling its shaders to the GPU's ISA. The pipeline cache holds onto
+     * that ISA, so the second time Nova sees a pipeline the driver can skip the compile
+     *
+     * The cache is only useful to the GPU and driver that made it, so the file records the vendor ID, device ID, driver version, and
+     * pipeline cache UUID of the device that saved it. We throw away files that don't match the current device, or whose data doesn't match
+     * its checksum, and start with an empty cache. Saving writes to a temporary file and renames it over the old one, so a crash while
+     * saving never leaves a half-written cache behind
+     *
+     * Vulkan pipeline caches are internally synchronized, so any thread may create pipelines with the cache
+     */
+    class VulkanPipelineCache {
+    public:
+        VulkanPipelineCache(vk::Device device,
+                            const vk::PhysicalDeviceProperties& gpu_properties,
+                            const vk::AllocationCallbacks& allocation_callbacks,
+                            std::filesystem::path cache_path);
+
+        VulkanPipelineCache(const VulkanPipelineCache& other) = delete;
+        VulkanPipelineCache& operator=(const VulkanPipelineCache& other) = delete;
+
+        VulkanPipelineCache(VulkanPipelineCache&& old) noexcept = delete;
+        VulkanPipelineCache& operator=(VulkanPipelineCache&& old) noexcept = delete;
+
+        /*!
+         * \brief Saves the cache, then destroys it
+         */
+        ~VulkanPipelineCache();
+
+        [[nodiscard]] vk::PipelineCache get_cache() const;
+
+        /*!
+         * \brief Writes the cache's current contents to disk
+         */
+        void save() const;
+
+    private:
+        vk::Device device;
+
+        vk::PhysicalDeviceProperties gpu_properties;
+
+        vk::AllocationCallbacks allocation_callbacks;
+
+        std::filesystem::path cache_path;
+
+        vk::PipelineCache cache;
+
+        /*!
+         * \brief Reads the pipeline cache data from disk
+         *
+         * \return The data to initialize the cache with, or an empty vector if there's no cache file or it doesn't match this device
+         */
+        [[nodiscard]] std::vector<uint8_t> load_cache_data() const;
+    };
+} // namespace nova::renderer::rhi
@@ -2,9 +2,11 @@
 #define VMA_IMPLEMENTATION
 #include "vulkan_render_device.hpp"
 
+#include <algorithm>
 #include <csignal>
 #include <cstring>
 #include <sstream>
+#include <utility>
 
 #include <Tracy.hpp>
 #include <spdlog/sinks/stdout_color_sinks.h>
@@ -15,11 +17,16 @@
 #include "nova_renderer/frame_context.hpp"
 #include "nova_renderer/renderables.hpp"
 #include "nova_renderer/rhi/pipeline_create_info.hpp"
+#include "nova_renderer/util/frame_arena.hpp"
+#include "nova_renderer/util/utils.hpp"
 #include "nova_renderer/window.hpp"
 
+#include "../../loading/renderpack/spirv_optimizer.hpp"
 #include "../../renderer/pipeline_reflection.hpp"
 #include "vk_structs.hpp"
 #include "vulkan_command_list.hpp"
+#include "vulkan_descriptor_allocator.hpp"
+#include "vulkan_pipeline_cache.hpp"
 #include "vulkan_resource_binder.hpp"
 #include "vulkan_utils.hpp"
 
@@ -50,6 +57,23 @@ using namespace nova::mem;
 namespace nova::renderer::rhi {
     static auto logger = spdlog::stdout_color_mt("VulkanRenderDevice");
 
+    /*!
+     * \brief The most fences that `wait_for_fences` and `reset_fences` can take at once
+     */
+    constexpr size_t MAX_FENCES_PER_CALL = 16;
+
+    static uint32_t gather_vk_fences(const std::span<RhiFence* const> fences, std::array<VkFence, MAX_FENCES_PER_CALL>& vk_fences) {
+        if(fences.size() > vk_fences.size()) {
+            throw std::runtime_error("Too many fences to wait for or reset at once");
+        }
+
+        std::transform(fences.begin(), fences.end(), vk_fences.begin(), [](const RhiFence* fence) {
+            return static_cast<VkFence>(static_cast<const VulkanFence*>(fence)->fence);
+        });
+
+        return static_cast<uint32_t>(fences.size());
+    }
+
     void FencedTask::operator()() const { work_to_perform(); }
 
     VulkanRenderDevice::VulkanRenderDevice(NovaSettingsAccessManager& settings, NovaWindow& window) : RenderDevice{settings, window} {
@@ -68,19 +92,40 @@ namespace nova::renderer::rhi {
 
         initialize_vma();
 
+        pipeline_cache = std::make_unique<VulkanPipelineCache>(device,
+                                                               gpu.props,
+                                                               vk_internal_allocator,
+                                                               settings->vulkan.pipeline_cache_path);
+
         if(settings.settings.debug.enabled) {
             // Late init, can only be used when the device has already been created
             vkSetDebugUtilsObjectNameEXT = reinterpret_cast<PFN_vkSetDebugUtilsObjectNameEXT>(
                 vkGetDeviceProcAddr(device, "vkSetDebugUtilsObjectNameEXT"));
         }
 
+        if(info.supports_mesh_shaders) {
+            vkCmdDrawMeshTasksNV = reinterpret_cast<PFN_vkCmdDrawMeshTasksNV>(vkGetDeviceProcAddr(device, "vkCmdDrawMeshTasksNV"));
+            vkCmdPushDescriptorSetKHR = reinterpret_cast<PFN_vkCmdPushDescriptorSetKHR>(
+                vkGetDeviceProcAddr(device, "vkCmdPushDescriptorSetKHR"));
+        }
+
         create_swapchain();
 
         create_per_thread_command_pools();
 
         create_standard_pipeline_layout();
+
+        create_standard_descriptor_sets();
+
+        descriptor_allocator = std::make_unique<VulkanDescriptorAllocator>(device,
+                                                                           vk_internal_allocator,
+                                                                           settings->max_in_flight_frames,
+                                                                           NUM_RENDER_THREADS);
     }
 
+    // Out of line so that the unique_ptrs can see the full types they point to
+    VulkanRenderDevice::~VulkanRenderDevice() = default;
+
     void VulkanRenderDevice::set_num_renderpasses(uint32_t /* num_renderpasses */) {
         // Pretty sure Vulkan doesn't need to do anything here
     }
@@ -301,8 +346,10 @@ namespace nova::renderer::rhi {
         pipeline->name = pipeline_state.name;
         pipeline->layout.layout = standard_pipeline_layout;
         pipeline->layout.descriptor_set_layouts = {&allocator, std::array{standard_set_layout}};
-        pipeline->layout.variable_descriptor_set_counts = {&allocator, std::array{MAX_NUM_TEXTURES}};
+        pipeline->layout.variable_descriptor_set_counts = {&allocator, std::array{info.max_num_textures}};
         pipeline->layout.bindings = standard_layout_bindings;
+        pipeline->layout.push_constant_ranges = standard_push_constants;
+        pipeline->layout.push_constant_intervals = standard_push_constants;
         pipeline->state = pipeline_state;
 
         return pipeline;
@@ -322,20 +369,53 @@ namespace nova::renderer::rhi {
         return pipeline;
     }
 
-    std::unique_ptr<RhiResourceBinder> VulkanRenderDevice::create_resource_binder_for_pipeline(const RhiPipeline& pipeline,
-                                                                                               rx::memory::allocator& allocator) {
+    std::unique_ptr<RhiResourceBinder> VulkanRenderDevice::create_resource_binder_for_pipeline(const RhiPipeline& pipeline) {
+        ZoneScoped;
         const auto& vk_pipeline = static_cast<const VulkanPipeline&>(pipeline);
 
-        auto descriptors = create_descriptors(vk_pipeline.layout.descriptor_set_layouts,
-                                              vk_pipeline.layout.variable_descriptor_set_counts,
-                                              allocator);
+        // Every in-flight frame gets its own sets, so that the binder never writes to a set which the GPU is using. We allocate all the
+        // frames' sets at once so that they can share a pool
+        const auto& layout = vk_pipeline.layout;
+        const auto num_frames = settings->max_in_flight_frames;
+
+        std::vector<vk::DescriptorSetLayout> layouts;
+        std::vector<uint32_t> variable_descriptor_counts;
+        layouts.reserve(layout.descriptor_set_layouts.size() * num_frames);
+        variable_descriptor_counts.reserve(layout.descriptor_set_layouts.size() * num_frames);
+        for(uint32_t i = 0; i < num_frames; i++) {
+            layouts.insert(layouts.end(), layout.descriptor_set_layouts.begin(), layout.descriptor_set_layouts.end());
+            variable_descriptor_counts.insert(variable_descriptor_counts.end(),
+                                              layout.variable_descriptor_set_counts.begin(),
+                                              layout.variable_descriptor_set_counts.end());
+        }
+
+        std::vector<vk::DescriptorPoolSize> descriptor_counts;
+        layout.bindings.each_value([&](const RhiResourceBindingDescription& binding_desc) {
+            const auto type = to_vk_descriptor_type(binding_desc.type);
+            auto itr = std::find_if(descriptor_counts.begin(), descriptor_counts.end(), [&](const vk::DescriptorPoolSize& size) {
+                return size.type == type;
+            });
+            if(itr == descriptor_counts.end()) {
+                itr = descriptor_counts.insert(itr, vk::DescriptorPoolSize{type, 0});
+            }
+
+            itr->descriptorCount += binding_desc.count * num_frames;
+        });
+
+        const auto all_sets = create_descriptors(layouts, variable_descriptor_counts, descriptor_counts);
+
+        std::vector<std::vector<vk::DescriptorSet>> sets_per_frame;
+        sets_per_frame.reserve(num_frames);
+        for(uint32_t i = 0; i < num_frames; i++) {
+            const auto first_set = all_sets.begin() + static_cast<ptrdiff_t>(i * layout.descriptor_set_layouts.size());
+            sets_per_frame.emplace_back(first_set, first_set + static_cast<ptrdiff_t>(layout.descriptor_set_layouts.size()));
+        }
 
-        return std::make_unique<VulkanResourceBinder>(&allocator,
-                                                      *this,
+        return std::make_unique<VulkanResourceBinder>(*this,
                                                       vk_pipeline.layout.bindings,
-                                                      descriptors,
-                                                      vk_pipeline.layout.layout,
-                                                      allocator);
+                                                      vk_pipeline.layout.descriptor_set_layouts,
+                                                      std::move(sets_per_frame),
+                                                      vk_pipeline.layout.layout);
     }
 
     std::optional<vk::DescriptorPool> VulkanRenderDevice::create_descriptor_pool(
@@ -362,67 +442,153 @@ namespace nova::renderer::rhi {
         return pool;
     }
 
-    vk::DescriptorSet VulkanRenderDevice::get_next_standard_descriptor_set() {
-        if(standard_descriptor_sets.is_empty()) {
-            const auto variable_set_counts = std::array{MAX_NUM_TEXTURES};
-            const auto count_allocate_info = vk::DescriptorSetVariableDescriptorCountAllocateInfo()
-                                                 .setPDescriptorCounts(variable_set_counts.data())
-                                                 .setDescriptorSetCount(static_cast<uint32_t>(variable_set_counts.size()));
+    void VulkanRenderDevice::set_texture_table_slot(const uint32_t slot, RhiImage* image) {
+        if(slot >= info.max_num_textures) {
+            logger->error("Can not put an image in texture table slot {}, the device only supports {} textures", slot, info.max_num_textures);
+            return;
+        }
 
-            const auto allocate_info = vk::DescriptorSetAllocateInfo()
-                                           .setDescriptorPool(standard_descriptor_set_pool)
-                                           .setDescriptorSetCount(1)
-                                           .setPSetLayouts(&standard_set_layout)
-                                           .setPNext(&count_allocate_info);
+        const auto* vk_image = static_cast<const VulkanImage*>(image);
 
-            vk::DescriptorSet set;
-            device.allocateDescriptorSets(&allocate_info, &set);
+        std::lock_guard lock{texture_table_mutex};
 
-            if(settings->debug.enabled) {
-                vk::DebugUtilsObjectNameInfoEXT object_name = {};
-                object_name.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT;
-                object_name.objectType = VK_OBJECT_TYPE_DESCRIPTOR_SET;
-                object_name.objectHandle = reinterpret_cast<uint64_t>(static_cast<vk::DescriptorSet>(set));
-                object_name.pObjectName = "Standard descriptor set";
+        if(slot >= texture_table.size()) {
+            texture_table.resize(slot + 1);
+        }
+        texture_table[slot] = vk_image->image_view;
 
-                NOVA_CHECK_RESULT(vkSetDebugUtilsObjectNameEXT(device, &object_name));
-            }
+        // Every frame has its own copy of the table, and each copy gets written when its frame binds it
+        for(auto& dirty_slots : dirty_texture_slots_per_frame) {
+            dirty_slots.push_back(slot);
+        }
+    }
 
-            return set;
+    vk::DescriptorSet VulkanRenderDevice::update_standard_descriptor_set(const uint32_t frame_idx,
+                                                                         const StandardSetBindings& bindings,
+                                                                         FrameArena* arena) {
+        ZoneScoped;
+        const auto set = standard_descriptor_sets[frame_idx];
+        auto& last_bindings = standard_set_bindings_per_frame[frame_idx];
+
+        // The buffer and image infos must stay alive until we call updateDescriptorSets, so they all live out here
+        const auto camera_buffer_info = vk::DescriptorBufferInfo()
+                                            .setBuffer(bindings.camera_buffer)
+                                            .setOffset(0)
+                                            .setRange(bindings.camera_buffer_size);
+        const auto material_buffer_info = vk::DescriptorBufferInfo()
+                                              .setBuffer(bindings.material_buffer)
+                                              .setOffset(0)
+                                              .setRange(bindings.material_buffer_size);
+        const auto point_sampler_info = vk::DescriptorImageInfo().setSampler(bindings.point_sampler);
+        const auto bilinear_sampler_info = vk::DescriptorImageInfo().setSampler(bindings.bilinear_sampler);
+        const auto trilinear_sampler_info = vk::DescriptorImageInfo().setSampler(bindings.trilinear_sampler);
+        const auto virtual_texture_info_buffer_info = vk::DescriptorBufferInfo()
+                                                          .setBuffer(bindings.virtual_texture_info_buffer)
+                                                          .setOffset(0)
+                                                          .setRange(bindings.virtual_texture_info_buffer_size);
+        const auto virtual_texture_feedback_buffer_info = vk::DescriptorBufferInfo()
+                                                              .setBuffer(bindings.virtual_texture_feedback_buffer)
+                                                              .setOffset(0)
+                                                              .setRange(bindings.virtual_texture_feedback_buffer_size);
+
+        FrameVector<vk::WriteDescriptorSet> writes{arena};
+
+        const auto write_binding = [&](const uint32_t binding, const vk::DescriptorType type) {
+            return &writes.emplace_back(
+                vk::WriteDescriptorSet().setDstSet(set).setDstBinding(binding).setDstArrayElement(0).setDescriptorCount(1).setDescriptorType(
+                    type));
+        };
 
-        } else {
-            const auto set = standard_descriptor_sets.last();
-            standard_descriptor_sets.pop_back();
+        if(!last_bindings || last_bindings->camera_buffer != bindings.camera_buffer ||
+           last_bindings->camera_buffer_size != bindings.camera_buffer_size) {
+            const auto camera_buffer_descriptor_type = bindings.camera_buffer_size < gpu.props.limits.maxUniformBufferRange ?
+                                                           vk::DescriptorType::eUniformBuffer :
+                                                           vk::DescriptorType::eStorageBuffer;
+            write_binding(0, camera_buffer_descriptor_type)->setPBufferInfo(&camera_buffer_info);
+        }
 
-            return set;
+        if(!last_bindings || last_bindings->material_buffer != bindings.material_buffer ||
+           last_bindings->material_buffer_size != bindings.material_buffer_size) {
+            // Must match the descriptor type in the standard pipeline layout
+            write_binding(1, vk::DescriptorType::eStorageBuffer)->setPBufferInfo(&material_buffer_info);
+        }
+
+        if(!last_bindings || last_bindings->point_sampler != bindings.point_sampler) {
+            write_binding(2, vk::DescriptorType::eSampler)->setPImageInfo(&point_sampler_info);
+        }
+
+        if(!last_bindings || last_bindings->bilinear_sampler != bindings.bilinear_sampler) {
+            write_binding(3, vk::DescriptorType::eSampler)->setPImageInfo(&bilinear_sampler_info);
         }
-    }
 
-    void VulkanRenderDevice::return_standard_descriptor_sets(const std::vector<vk::DescriptorSet>& sets) {
-        standard_descriptor_sets += sets;
+        if(!last_bindings || last_bindings->trilinear_sampler != bindings.trilinear_sampler) {
+            write_binding(4, vk::DescriptorType::eSampler)->setPImageInfo(&trilinear_sampler_info);
+        }
+
+        if(!last_bindings || last_bindings->virtual_texture_info_buffer != bindings.virtual_texture_info_buffer ||
+           last_bindings->virtual_texture_info_buffer_size != bindings.virtual_texture_info_buffer_size) {
+            write_binding(5, vk::DescriptorType::eStorageBuffer)->setPBufferInfo(&virtual_texture_info_buffer_info);
+        }
+
+        if(!last_bindings || last_bindings->virtual_texture_feedback_buffer != bindings.virtual_texture_feedback_buffer ||
+           last_bindings->virtual_texture_feedback_buffer_size != bindings.virtual_texture_feedback_buffer_size) {
+            write_binding(6, vk::DescriptorType::eStorageBuffer)->setPBufferInfo(&virtual_texture_feedback_buffer_info);
+        }
+
+        last_bindings = bindings;
+
+        FrameVector<vk::DescriptorImageInfo> texture_infos{arena};
+
+        {
+            std::lock_guard lock{texture_table_mutex};
+
+            auto& dirty_slots = dirty_texture_slots_per_frame[frame_idx];
+            std::sort(dirty_slots.begin(), dirty_slots.end());
+            dirty_slots.erase(std::unique(dirty_slots.begin(), dirty_slots.end()), dirty_slots.end());
+
+            // Reserve up front so that the writes can point into the vector
+            texture_infos.reserve(dirty_slots.size());
+
+            // Write each run of consecutive slots with a single write
+            for(size_t i = 0; i < dirty_slots.size(); i++) {
+                const auto first_info_idx = texture_infos.size();
+                texture_infos.emplace_back(vk::DescriptorImageInfo()
+                                               .setImageView(texture_table[dirty_slots[i]])
+                                               .setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal));
+
+                auto* write = write_binding(7, vk::DescriptorType::eSampledImage);
+                write->setDstArrayElement(dirty_slots[i]);
+
+                while(i + 1 < dirty_slots.size() && dirty_slots[i + 1] == dirty_slots[i] + 1) {
+                    i++;
+                    texture_infos.emplace_back(vk::DescriptorImageInfo()
+                                                   .setImageView(texture_table[dirty_slots[i]])
+                                                   .setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal));
+                }
+
+                write->setDescriptorCount(static_cast<uint32_t>(texture_infos.size() - first_info_idx))
+                    .setPImageInfo(&texture_infos[first_info_idx]);
+            }
+
+            dirty_slots.clear();
+        }
+
+        if(!writes.empty()) {
+            device.updateDescriptorSets(static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+        }
+
+        return set;
     }
 
     std::vector<vk::DescriptorSet> VulkanRenderDevice::create_descriptors(
         const std::vector<vk::DescriptorSetLayout>& descriptor_set_layouts,
         const std::vector<uint32_t>& variable_descriptor_max_counts,
-        rx::memory::allocator& allocator) const {
-        RX_ASSERT(descriptor_set_layouts.size() == variable_descriptor_max_counts.size(),
-                  "Descriptor set layous and varaible descriptor counts must be the same size");
-
-        const auto variable_descriptor_counts = vk::DescriptorSetVariableDescriptorCountAllocateInfo()
-                                                    .setDescriptorSetCount(static_cast<uint32_t>(variable_descriptor_max_counts.size()))
-                                                    .setPDescriptorCounts(variable_descriptor_max_counts.data());
-
-        const auto allocate_info = vk::DescriptorSetAllocateInfo()
-                                       .setDescriptorSetCount(static_cast<uint32_t>(descriptor_set_layouts.size()))
-                                       .setPSetLayouts(descriptor_set_layouts.data())
-                                       .setDescriptorPool(standard_descriptor_set_pool)
-                                       .setPNext(&variable_descriptor_counts);
-
-        std::vector<vk::DescriptorSet> sets{&allocator, descriptor_set_layouts.size()};
-        device.allocateDescriptorSets(&allocate_info, sets.data());
+        const std::span<const vk::DescriptorPoolSize> descriptor_counts) const {
+        return descriptor_allocator->allocate_persistent(descriptor_set_layouts, variable_descriptor_max_counts, descriptor_counts);
+    }
 
-        return sets;
+    void VulkanRenderDevice::free_descriptors(const std::span<const vk::DescriptorSet> sets) const {
+        descriptor_allocator->free_persistent(sets);
     }
 
     vk::Fence VulkanRenderDevice::get_next_submission_fence() {
@@ -443,6 +609,7 @@ namespace nova::renderer::rhi {
 
     ntl::Result<vk::Pipeline> VulkanRenderDevice::compile_pipeline_state(const VulkanPipeline& pipeline_state,
                                                                          const VulkanRenderpass& renderpass,
+                                                                         const vk::Pipeline base_pipeline,
                                                                          rx::memory::allocator& allocator) {
         ZoneScoped;
         const auto& state = pipeline_state.state;
@@ -452,15 +619,38 @@ namespace nova::renderer::rhi {
         std::vector<vk::PipelineShaderStageCreateInfo> shader_stages{&internal_allocator};
         std::unordered_map<vk::ShaderStageFlags, vk::ShaderModule> shader_modules{&internal_allocator};
 
-        logger->debug("Compiling vertex module");
-        const auto vertex_module = create_shader_module(state.vertex_shader.source);
-        if(vertex_module) {
-            shader_modules.insert(VK_SHADER_STAGE_VERTEX_BIT, *vertex_module);
+        const auto use_mesh_shaders = state.mesh_shader && info.supports_mesh_shaders;
+
+        if(use_mesh_shaders) {
+            logger->debug("Compiling mesh module");
+            const auto mesh_module = create_shader_module(state.mesh_shader->source);
+            if(mesh_module) {
+                shader_modules.insert(VK_SHADER_STAGE_MESH_BIT_NV, *mesh_module);
+            } else {
+                return ntl::Result<vk::Pipeline>{ntl::NovaError("Could not create mesh module")};
+            }
+
+            if(state.task_shader) {
+                logger->debug("Compiling task module");
+                const auto task_module = create_shader_module(state.task_shader->source);
+                if(task_module) {
+                    shader_modules.insert(VK_SHADER_STAGE_TASK_BIT_NV, *task_module);
+                } else {
+                    return ntl::Result<vk::Pipeline>{ntl::NovaError("Could not create task module")};
+                }
+            }
+
         } else {
-            return ntl::Result<vk::Pipeline>{ntl::NovaError("Could not create vertex module")};
+            logger->debug("Compiling vertex module");
+            const auto vertex_module = create_shader_module(state.vertex_shader.source);
+            if(vertex_module) {
+                shader_modules.insert(VK_SHADER_STAGE_VERTEX_BIT, *vertex_module);
+            } else {
+                return ntl::Result<vk::Pipeline>{ntl::NovaError("Could not create vertex module")};
+            }
         }
 
-        if(state.geometry_shader) {
+        if(state.geometry_shader && !use_mesh_shaders) {
             logger->debug("Compiling geometry module");
             const auto geometry_module = create_shader_module(state.geometry_shader->source);
             if(geometry_module) {
@@ -524,26 +714,15 @@ namespace nova::renderer::rhi {
                 break;
         }
 
-        vk::Viewport viewport;
-        viewport.x = 0;
-        viewport.y = 0;
-        viewport.width = static_cast<float>(renderpass.render_area.extent.width);
-        viewport.height = static_cast<float>(renderpass.render_area.extent.height);
-        viewport.minDepth = 0.0F;
-        viewport.maxDepth = 1.0F;
-
-        vk::Rect2D scissor;
-        scissor.offset = {0, 0};
-        scissor.extent = {static_cast<uint32_t>(state.viewport_size.x), static_cast<uint32_t>(state.viewport_size.y)};
-
+        // The viewport and scissor rect are dynamic, so that resizing framebuffers doesn't mean recompiling pipelines
         vk::PipelineViewportStateCreateInfo viewport_state_create_info;
         viewport_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
         viewport_state_create_info.pNext = nullptr;
         viewport_state_create_info.flags = 0;
         viewport_state_create_info.viewportCount = 1;
-        viewport_state_create_info.pViewports = &viewport;
+        viewport_state_create_info.pViewports = nullptr;
         viewport_state_create_info.scissorCount = 1;
-        viewport_state_create_info.pScissors = &scissor;
+        viewport_state_create_info.pScissors = nullptr;
 
         vk::PipelineRasterizationStateCreateInfo rasterizer_create_info;
         rasterizer_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -556,16 +735,8 @@ namespace nova::renderer::rhi {
         rasterizer_create_info.cullMode = VK_CULL_MODE_BACK_BIT;
         rasterizer_create_info.frontFace = VK_FRONT_FACE_CLOCKWISE;
         rasterizer_create_info.depthClampEnable = VK_FALSE;
-        rasterizer_create_info.depthBiasConstantFactor = state.rasterizer_state.depth_bias;
-        rasterizer_create_info.depthBiasSlopeFactor = state.rasterizer_state.slope_scaled_depth_bias;
-        rasterizer_create_info.depthBiasClamp = state.rasterizer_state.maximum_depth_bias;
-
-        if(rasterizer_create_info.depthBiasConstantFactor != 0 || rasterizer_create_info.depthBiasSlopeFactor != 0) {
-            rasterizer_create_info.depthBiasEnable = VK_TRUE;
-
-        } else {
-            rasterizer_create_info.depthBiasEnable = VK_FALSE;
-        }
+        // The amount of bias is dynamic, command lists set it when they bind the pipeline
+        rasterizer_create_info.depthBiasEnable = state.rasterizer_state.uses_depth_bias() ? VK_TRUE : VK_FALSE;
 
         vk::PipelineMultisampleStateCreateInfo multisample_create_info;
         multisample_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
@@ -668,10 +839,14 @@ namespace nova::renderer::rhi {
             color_blend_create_info.pAttachments = attachment_states.data();
         }
 
-        std::vector<vk::DynamicState> dynamic_states;
+        std::vector<vk::DynamicState> dynamic_states{VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
 
-        if(state.enable_scissor_test) {
-            dynamic_states.emplace_back(VK_DYNAMIC_STATE_SCISSOR);
+        if(state.rasterizer_state.uses_depth_bias()) {
+            dynamic_states.emplace_back(VK_DYNAMIC_STATE_DEPTH_BIAS);
+        }
+
+        if(state.stencil_state) {
+            dynamic_states.emplace_back(VK_DYNAMIC_STATE_STENCIL_REFERENCE);
         }
 
         vk::PipelineDynamicStateCreateInfo dynamic_state_create_info = {};
@@ -682,11 +857,19 @@ namespace nova::renderer::rhi {
         vk::GraphicsPipelineCreateInfo pipeline_create_info = {};
         pipeline_create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
         pipeline_create_info.pNext = nullptr;
-        pipeline_create_info.flags = 0;
+        // Any pipeline may be another pipeline's parent, and we don't know which ones are until their children compile
+        pipeline_create_info.flags = VK_PIPELINE_CREATE_ALLOW_DERIVATIVES_BIT;
+        if(base_pipeline != VK_NULL_HANDLE) {
+            pipeline_create_info.flags |= VK_PIPELINE_CREATE_DERIVATIVE_BIT;
+            pipeline_create_info.basePipelineHandle = base_pipeline;
+        }
         pipeline_create_info.stageCount = static_cast<uint32_t>(shader_stages.size());
         pipeline_create_info.pStages = shader_stages.data();
-        pipeline_create_info.pVertexInputState = &vertex_input_state_create_info;
-        pipeline_create_info.pInputAssemblyState = &input_assembly_create_info;
+        if(!use_mesh_shaders) {
+            // Mesh shader pipelines don't have any fixed-function vertex input
+            pipeline_create_info.pVertexInputState = &vertex_input_state_create_info;
+            pipeline_create_info.pInputAssemblyState = &input_assembly_create_info;
+        }
         pipeline_create_info.pViewportState = &viewport_state_create_info;
         pipeline_create_info.pRasterizationState = &rasterizer_create_info;
         pipeline_create_info.pMultisampleState = &multisample_create_info;
@@ -702,7 +885,7 @@ namespace nova::renderer::rhi {
         const vk::AllocationCallbacks& vk_alloc = wrap_allocator(allocator);
         vk::Pipeline pipeline;
         const auto result = vkCreateGraphicsPipelines(device,
-                                                      nullptr,
+                                                      pipeline_cache->get_cache(),
                                                       1,
                                                       &pipeline_create_info,
                                                       &vk_alloc,
@@ -711,6 +894,10 @@ namespace nova::renderer::rhi {
             return ntl::Result<vk::Pipeline>{MAKE_ERROR("Could not compile pipeline %s", state.name)};
         }
 
+        if(base_pipeline != VK_NULL_HANDLE) {
+            logger->debug("Derived pipeline {} from its parent {}", state.name, *state.parent);
+        }
+
         if(settings.settings.debug.enabled) {
             vk::DebugUtilsObjectNameInfoEXT object_name = {};
             object_name.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT;
@@ -723,6 +910,175 @@ namespace nova::renderer::rhi {
         return ntl::Result{pipeline};
     }
 
+    Sha256Digest VulkanRenderDevice::hash_pipeline_state(const VulkanPipeline& pipeline) const {
+        ZoneScoped;
+        const auto& state = pipeline.state;
+
+        Sha256 hasher;
+
+        const auto hash_shader = [&](const ShaderSource* shader) {
+            // Hash the size even when there's no shader, so that moving code between stages changes the hash
+            const auto num_words = shader != nullptr ? shader->source.size() : 0;
+            hasher.update_value(static_cast<uint64_t>(num_words));
+            if(num_words > 0) {
+                hasher.update(std::span{reinterpret_cast<const uint8_t*>(shader->source.data()), num_words * sizeof(uint32_t)});
+            }
+        };
+
+        const auto hash_optional_shader = [&](const std::optional<ShaderSource>& shader) { hash_shader(shader ? &*shader : nullptr); };
+
+        // Must match how compile_pipeline_state picks its shaders
+        const auto use_mesh_shaders = state.mesh_shader && info.supports_mesh_shaders;
+        hasher.update_value(use_mesh_shaders);
+        if(use_mesh_shaders) {
+            hash_optional_shader(state.mesh_shader);
+            hash_optional_shader(state.task_shader);
+            hash_shader(nullptr);
+
+        } else {
+            hash_shader(&state.vertex_shader);
+            hash_shader(nullptr);
+            hash_optional_shader(state.geometry_shader);
+        }
+        hash_optional_shader(state.pixel_shader);
+
+        hasher.update_value(static_cast<uint64_t>(state.vertex_fields.size()));
+        for(const auto& field : state.vertex_fields) {
+            hasher.update_with_length(field.name);
+            hasher.update_value(field.format);
+        }
+
+        // The viewport, scissor rect, amount of depth bias, and stencil reference values are dynamic, so they don't change the PSO
+        hasher.update_value(state.topology);
+
+        hasher.update_value(state.rasterizer_state.enable_depth_clamping);
+        hasher.update_value(state.rasterizer_state.fill_mode);
+        hasher.update_value(state.rasterizer_state.cull_mode);
+        hasher.update_value(state.rasterizer_state.uses_depth_bias());
+
+        hasher.update_value(state.depth_state.has_value());
+        if(state.depth_state) {
+            hasher.update_value(state.depth_state->enable_depth_write);
+            hasher.update_value(state.depth_state->compare_op);
+
+            const auto& bounds_test_state = state.depth_state->bounds_test_state;
+            hasher.update_value(bounds_test_state.has_value());
+            if(bounds_test_state) {
+                hasher.update_value(bounds_test_state->mode);
+                if(bounds_test_state->mode == DepthBoundsTestMode::Static) {
+                    hasher.update_value(bounds_test_state->static_state.min_bound);
+                    hasher.update_value(bounds_test_state->static_state.max_bound);
+                }
+            }
+        }
+
+        hasher.update_value(state.stencil_state.has_value());
+        if(state.stencil_state) {
+            for(const auto& op_state : {state.stencil_state->front_face_op, state.stencil_state->back_face_op}) {
+                hasher.update_value(op_state.fail_op);
+                hasher.update_value(op_state.pass_op);
+                hasher.update_value(op_state.depth_fail_op);
+                hasher.update_value(op_state.compare_op);
+                hasher.update_value(op_state.compare_mask);
+                hasher.update_value(op_state.write_mask);
+            }
+        }
+
+        hasher.update_value(state.blend_state.has_value());
+        if(state.blend_state) {
+            hasher.update_value(static_cast<uint64_t>(state.blend_state->render_target_states.size()));
+            for(const auto& render_target_blend : state.blend_state->render_target_states) {
+                hasher.update_value(render_target_blend.enable);
+                hasher.update_value(render_target_blend.src_color_factor);
+                hasher.update_value(render_target_blend.dst_color_factor);
+                hasher.update_value(render_target_blend.color_op);
+                hasher.update_value(render_target_blend.src_alpha_factor);
+                hasher.update_value(render_target_blend.dst_alpha_factor);
+                hasher.update_value(render_target_blend.alpha_op);
+            }
+
+            hasher.update_value(state.blend_state->blend_constants.r);
+            hasher.update_value(state.blend_state->blend_constants.g);
+            hasher.update_value(state.blend_state->blend_constants.b);
+            hasher.update_value(state.blend_state->blend_constants.a);
+        }
+
+        hasher.update_value(static_cast<uint64_t>(state.color_attachments.size()));
+
+        hasher.update_value(pipeline.layout.layout);
+
+        return hasher.finish();
+    }
+
+    std::optional<vk::Pipeline> VulkanRenderDevice::get_or_compile_pso(const VulkanPipeline& pipeline,
+                                                                       VulkanRenderpass& renderpass,
+                                                                       const bool derive_from_parent,
+                                                                       const bool is_recompile) {
+        ZoneScoped;
+        const auto& name = pipeline.state.name;
+        const auto state_hash = hash_pipeline_state(pipeline);
+
+        const auto keep_pso = [&](const vk::Pipeline pso) {
+            if(is_recompile) {
+                renderpass.uninstalled_pipelines.push_back(pso);
+                return;
+            }
+
+            const auto [itr, is_new_pipeline] = renderpass.cached_pipelines.emplace(name, pso);
+            if(!is_new_pipeline && itr->second != pso) {
+                const auto old_pso = std::exchange(itr->second, pso);
+                if(!is_pso_in_use(renderpass, old_pso)) {
+                    forget_pso(renderpass, old_pso);
+                    vkDestroyPipeline(device, old_pso, nullptr);
+                }
+            }
+        };
+
+        vk::Pipeline base_pipeline = VK_NULL_HANDLE;
+        {
+            std::lock_guard lock{renderpass.pipelines_mutex};
+            if(const auto itr = renderpass.pipelines_by_state.find(state_hash); itr != renderpass.pipelines_by_state.end()) {
+                logger->debug("Pipeline {} has the same state as a pipeline we've already compiled, sharing its PSO", name);
+                keep_pso(itr->second);
+                return itr->second;
+            }
+
+            if(derive_from_parent && pipeline.state.parent) {
+                if(const auto itr = renderpass.cached_pipelines.find(*pipeline.state.parent); itr != renderpass.cached_pipelines.end()) {
+                    base_pipeline = itr->second;
+                }
+            }
+        }
+
+        // Compile without holding the lock, so command lists can still look up the renderpass's other pipelines
+        const auto pso_result = compile_pipeline_state(pipeline, renderpass, base_pipeline, rx::memory::g_system_allocator);
+        if(!pso_result) {
+            return std::nullopt;
+        }
+
+        std::lock_guard lock{renderpass.pipelines_mutex};
+        const auto [itr, is_new_state] = renderpass.pipelines_by_state.emplace(state_hash, *pso_result);
+        if(!is_new_state) {
+            // Another thread compiled the same state at the same time. Nothing has used our PSO yet, so it can go right away
+            vkDestroyPipeline(device, *pso_result, nullptr);
+        }
+
+        keep_pso(itr->second);
+
+        return itr->second;
+    }
+
+    bool VulkanRenderDevice::is_pso_in_use(const VulkanRenderpass& renderpass, const vk::Pipeline pso) {
+        const auto uses_pso = [&](const auto& name_and_pso) { return name_and_pso.second == pso; };
+        return std::any_of(renderpass.cached_pipelines.begin(), renderpass.cached_pipelines.end(), uses_pso) ||
+               std::find(renderpass.uninstalled_pipelines.begin(), renderpass.uninstalled_pipelines.end(), pso) !=
+                   renderpass.uninstalled_pipelines.end();
+    }
+
+    void VulkanRenderDevice::forget_pso(VulkanRenderpass& renderpass, const vk::Pipeline pso) {
+        std::erase_if(renderpass.pipelines_by_state, [&](const auto& hash_and_pso) { return hash_and_pso.second == pso; });
+    }
+
     RhiBuffer* VulkanRenderDevice::create_buffer(const RhiBufferCreateInfo& info, rx::memory::allocator& allocator) {
         ZoneScoped;
         auto* buffer = allocator.create<VulkanBuffer>();
@@ -736,11 +1092,11 @@ namespace nova::renderer::rhi {
 
         switch(info.buffer_usage) {
             case BufferUsage::UniformBuffer: {
+                // Always allow storage buffer usage, so that buffers which grow past maxUniformBufferRange (like the material buffer) can
+                // keep the same descriptor type
+                vk_create_info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
                 if(info.size < gpu.props.limits.maxUniformBufferRange) {
-                    vk_create_info.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-
-                } else {
-                    vk_create_info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+                    vk_create_info.usage |= VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
                 }
                 vma_alloc.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
                 vma_alloc.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
@@ -752,7 +1108,19 @@ namespace nova::renderer::rhi {
             } break;
 
             case BufferUsage::VertexBuffer: {
-                vk_create_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+                // Mesh shaders read vertex data as a storage buffer
+                vk_create_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+                vma_alloc.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+            } break;
+
+            case BufferUsage::StorageBuffer: {
+                vk_create_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+                vma_alloc.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+            } break;
+
+            case BufferUsage::GeometryBuffer: {
+                vk_create_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
                 vma_alloc.usage = VMA_MEMORY_USAGE_GPU_ONLY;
             } break;
 
@@ -761,6 +1129,12 @@ namespace nova::renderer::rhi {
                 vma_alloc.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
                 vma_alloc.usage = VMA_MEMORY_USAGE_CPU_ONLY;
             } break;
+
+            case BufferUsage::ReadbackBuffer: {
+                vk_create_info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+                vma_alloc.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+                vma_alloc.usage = VMA_MEMORY_USAGE_GPU_TO_CPU;
+            } break;
         }
 
         const auto result = vmaCreateBuffer(vma,
@@ -771,6 +1145,8 @@ namespace nova::renderer::rhi {
                                             &buffer->allocation_info);
         if(result == VK_SUCCESS) {
             buffer->size = info.size;
+            buffer->memory_category = get_memory_category(info.buffer_usage);
+            memory_usage_per_category[static_cast<size_t>(buffer->memory_category)] += buffer->allocation_info.size;
 
             if(settings->debug.enabled) {
                 vk::DebugUtilsObjectNameInfoEXT object_name = {};
@@ -798,9 +1174,53 @@ namespace nova::renderer::rhi {
         memcpy(vulkan_buffer->allocation_info.pMappedData, data, num_bytes.b_count());
     }
 
-    RhiSampler* VulkanRenderDevice::create_sampler(const RhiSamplerCreateInfo& create_info, rx::memory::allocator& allocator) {
+    void VulkanRenderDevice::write_data_to_buffer(const void* data, const Bytes num_bytes, const Bytes offset, const RhiBuffer* buffer) {
+        ZoneScoped;
+        const auto* vulkan_buffer = static_cast<const VulkanBuffer*>(buffer);
+
+        auto* write_ptr = static_cast<uint8_t*>(vulkan_buffer->allocation_info.pMappedData) + offset.b_count();
+        memcpy(write_ptr, data, num_bytes.b_count());
+    }
+
+    void VulkanRenderDevice::read_data_from_buffer(void* data, const Bytes num_bytes, const Bytes offset, const RhiBuffer* buffer) {
         ZoneScoped;
-        auto* sampler = allocator.create<VulkanSampler>();
+        const auto* vulkan_buffer = static_cast<const VulkanBuffer*>(buffer);
+
+        // Readback memory might not be host coherent, in which case the CPU won't see the GPU's writes until we invalidate it
+        vmaInvalidateAllocation(vma, vulkan_buffer->allocation, offset.b_count(), num_bytes.b_count());
+
+        const auto* read_ptr = static_cast<const uint8_t*>(vulkan_buffer->allocation_info.pMappedData) + offset.b_count();
+        memcpy(data, read_ptr, num_bytes.b_count());
+    }
+
+    size_t VulkanRenderDevice::SamplerCreateInfoHasher::operator()(const RhiSamplerCreateInfo& info) const {
+        size_t hash = 0;
+        hash_combine(hash, info.min_filter);
+        hash_combine(hash, info.mag_filter);
+        hash_combine(hash, info.x_wrap_mode);
+        hash_combine(hash, info.y_wrap_mode);
+        hash_combine(hash, info.z_wrap_mode);
+        hash_combine(hash, info.mip_bias);
+        hash_combine(hash, info.enable_anisotropy);
+        hash_combine(hash, info.max_anisotropy);
+        hash_combine(hash, info.min_lod);
+        hash_combine(hash, info.max_lod);
+
+        return hash;
+    }
+
+    RhiSampler* VulkanRenderDevice::create_sampler(const RhiSamplerCreateInfo& create_info, rx::memory::allocator& /* allocator */) {
+        ZoneScoped;
+        std::lock_guard lock{sampler_cache_mutex};
+
+        // Drivers only let us make a few thousand samplers, but most renderpacks only need a handful of unique ones
+        if(const auto itr = sampler_cache.find(create_info); itr != sampler_cache.end()) {
+            itr->second.ref_count++;
+            return itr->second.sampler;
+        }
+
+        // The cache owns samplers, not whichever allocator the first caller had on hand
+        auto* sampler = new VulkanSampler;
 
         vk::SamplerCreateInfo vk_create_info = {};
         vk_create_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -815,12 +1235,41 @@ namespace nova::renderer::rhi {
         vk_create_info.minLod = create_info.min_lod;
         vk_create_info.maxLod = create_info.max_lod;
 
-        const vk::AllocationCallbacks& alloc_calls = wrap_allocator(allocator);
-        vkCreateSampler(device, &vk_create_info, &alloc_calls, &sampler->sampler);
+        vkCreateSampler(device, &vk_create_info, &vk_internal_allocator, &sampler->sampler);
+
+        sampler_cache.emplace(create_info, CachedSampler{sampler, 1});
+        sampler_create_infos.emplace(sampler, create_info);
 
         return sampler;
     }
 
+    void VulkanRenderDevice::destroy_sampler(RhiSampler* sampler) {
+        ZoneScoped;
+        std::lock_guard lock{sampler_cache_mutex};
+
+        auto* vk_sampler = static_cast<VulkanSampler*>(sampler);
+
+        const auto create_info_itr = sampler_create_infos.find(vk_sampler);
+        if(create_info_itr == sampler_create_infos.end()) {
+            logger->error("Tried to destroy a sampler that didn't come from this device");
+            return;
+        }
+
+        auto& cached_sampler = sampler_cache.at(create_info_itr->second);
+        cached_sampler.ref_count--;
+        if(cached_sampler.ref_count > 0) {
+            return;
+        }
+
+        descriptor_allocator->forget_sets_using(reinterpret_cast<uint64_t>(static_cast<VkSampler>(vk_sampler->sampler)));
+        device.destroySampler(vk_sampler->sampler, &vk_internal_allocator);
+
+        sampler_cache.erase(create_info_itr->second);
+        sampler_create_infos.erase(create_info_itr);
+
+        delete vk_sampler;
+    }
+
     RhiImage* VulkanRenderDevice::create_image(const renderpack::TextureCreateInfo& info, rx::memory::allocator& allocator) {
         ZoneScoped;
         auto* image = allocator.create<VulkanImage>();
@@ -843,7 +1292,7 @@ namespace nova::renderer::rhi {
         image_create_info.extent.width = image_pixel_size.x;
         image_create_info.extent.height = image_pixel_size.y;
         image_create_info.extent.depth = 1;
-        image_create_info.mipLevels = 1;
+        image_create_info.mipLevels = std::max(info.num_mips, 1u);
         image_create_info.arrayLayers = 1;
         image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
         image_create_info.usage = VK_IMAGE_USAGE_SAMPLED_BIT;
@@ -853,7 +1302,13 @@ namespace nova::renderer::rhi {
         }
 
         if(info.usage == renderpack::ImageUsage::SampledImage) {
-            image_create_info.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+            // Transfer source so that we can blit mips from each other
+            image_create_info.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
+            // Textures can be streamed at a lower resolution, so fail their allocations instead of pushing us past the heap's budget. Going
+            // over budget means the driver starts paging, or we run out of memory for render targets
+            vma_info.flags = VMA_ALLOCATION_CREATE_WITHIN_BUDGET_BIT;
+            image->memory_category = MemoryCategory::Textures;
 
         } else {
             // If the image isn't a sampled image, it's a render target
@@ -866,14 +1321,19 @@ namespace nova::renderer::rhi {
             }
 
             vma_info.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+            image->memory_category = MemoryCategory::RenderTargets;
         }
 
         image_create_info.queueFamilyIndexCount = 1;
         image_create_info.pQueueFamilyIndices = &graphics_family_index;
         image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 
-        const auto result = vmaCreateImage(vma, &image_create_info, &vma_info, &image->image, &image->allocation, nullptr);
+        VmaAllocationInfo allocation_info = {};
+        const auto result = vmaCreateImage(vma, &image_create_info, &vma_info, &image->image, &image->allocation, &allocation_info);
         if(result == VK_SUCCESS) {
+            image->allocation_size = allocation_info.size;
+            memory_usage_per_category[static_cast<size_t>(image->memory_category)] += allocation_info.size;
+
             if(settings->debug.enabled) {
                 vk::DebugUtilsObjectNameInfoEXT object_name = {};
                 object_name.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT;
@@ -884,23 +1344,16 @@ namespace nova::renderer::rhi {
                 NOVA_CHECK_RESULT(vkSetDebugUtilsObjectNameEXT(device, &object_name));
             }
 
-            vk::ImageViewCreateInfo image_view_create_info = {};
-            image_view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-            image_view_create_info.image = image->image;
-            image_view_create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
-            image_view_create_info.format = image_create_info.format;
-            if(format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT) {
-                image_view_create_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-            } else {
-                image_view_create_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            }
-            image_view_create_info.subresourceRange.baseArrayLayer = 0;
-            image_view_create_info.subresourceRange.layerCount = 1;
-            image_view_create_info.subresourceRange.baseMipLevel = 0;
-            image_view_create_info.subresourceRange.levelCount = 1;
+            image->format = image_create_info.format;
+            image->aspect = image->is_depth_tex ? vk::ImageAspectFlagBits::eDepth : vk::ImageAspectFlagBits::eColor;
+            image->width = image_create_info.extent.width;
+            image->height = image_create_info.extent.height;
+            image->num_mip_levels = image_create_info.mipLevels;
+            image->num_array_layers = image_create_info.arrayLayers;
 
-            const vk::AllocationCallbacks& vk_alloc = wrap_allocator(allocator);
-            vkCreateImageView(device, &image_view_create_info, &vk_alloc, &image->image_view);
+            image->image_view = create_image_view(*image,
+                                                  RhiImageRange{0, image->num_mip_levels, 0, image->num_array_layers},
+                                                  image->format);
 
             return image;
 
@@ -976,17 +1429,14 @@ namespace nova::renderer::rhi {
         return fences;
     }
 
-    void VulkanRenderDevice::wait_for_fences(const std::vector<RhiFence*> fences) {
+    void VulkanRenderDevice::wait_for_fences(const std::span<RhiFence* const> fences) {
         ZoneScoped;
-        std::vector<vk::Fence> vk_fences{&internal_allocator};
-        vk_fences.reserve(fences.size());
-        fences.each_fwd([&](const RhiFence* fence) {
-            const auto* vk_fence = static_cast<const VulkanFence*>(fence);
-            vk_fences.push_back(vk_fence->fence);
-        });
+        // Nova waits on one fence per in-flight frame at most, so this never needs to touch the heap
+        std::array<VkFence, MAX_FENCES_PER_CALL> vk_fences{};
+        const auto num_fences = gather_vk_fences(fences, vk_fences);
 
         const auto result = vkWaitForFences(device,
-                                            static_cast<uint32_t>(vk_fences.size()),
+                                            num_fences,
                                             vk_fences.data(),
                                             VK_TRUE,
                                             std::numeric_limits<uint64_t>::max());
@@ -999,21 +1449,18 @@ namespace nova::renderer::rhi {
         }
     }
 
-    void VulkanRenderDevice::reset_fences(const std::vector<RhiFence*>& fences) {
+    void VulkanRenderDevice::reset_fences(const std::span<RhiFence* const> fences) {
         ZoneScoped;
-        std::vector<vk::Fence> vk_fences{&internal_allocator};
-        vk_fences.reserve(fences.size());
-        fences.each_fwd([&](const RhiFence* fence) {
-            const auto* vk_fence = static_cast<const VulkanFence*>(fence);
-            vk_fences.push_back(vk_fence->fence);
-        });
+        std::array<VkFence, MAX_FENCES_PER_CALL> vk_fences{};
+        const auto num_fences = gather_vk_fences(fences, vk_fences);
 
-        vkResetFences(device, static_cast<uint32_t>(fences.size()), vk_fences.data());
+        vkResetFences(device, num_fences, vk_fences.data());
     }
 
     void VulkanRenderDevice::destroy_renderpass(RhiRenderpass* pass, rx::memory::allocator& allocator) {
         ZoneScoped;
         auto* vk_renderpass = static_cast<VulkanRenderpass*>(pass);
+
         vkDestroyRenderPass(device, vk_renderpass->pass, nullptr);
         allocator.deallocate(reinterpret_cast<uint8_t*>(pass));
     }
@@ -1029,11 +1476,37 @@ namespace nova::renderer::rhi {
     void VulkanRenderDevice::destroy_texture(RhiImage* resource, rx::memory::allocator& allocator) {
         ZoneScoped;
         auto* vk_image = static_cast<VulkanImage*>(resource);
+
+        const auto destroy_view = [&](const vk::ImageView view) {
+            descriptor_allocator->forget_sets_using(reinterpret_cast<uint64_t>(static_cast<VkImageView>(view)));
+            device.destroyImageView(view, &vk_internal_allocator);
+        };
+
+        destroy_view(vk_image->image_view);
+        {
+            // Other threads may be creating range views for the image, see get_image_view
+            std::lock_guard lock{image_view_mutex};
+            for(const auto& range_view : vk_image->range_views) {
+                destroy_view(range_view.view);
+            }
+        }
+
         vmaDestroyImage(vma, vk_image->image, vk_image->allocation);
+        memory_usage_per_category[static_cast<size_t>(vk_image->memory_category)] -= vk_image->allocation_size;
 
         allocator.deallocate(reinterpret_cast<uint8_t*>(resource));
     }
 
+    void VulkanRenderDevice::destroy_buffer(RhiBuffer* buffer, rx::memory::allocator& allocator) {
+        ZoneScoped;
+        auto* vk_buffer = static_cast<VulkanBuffer*>(buffer);
+        descriptor_allocator->forget_sets_using(reinterpret_cast<uint64_t>(static_cast<VkBuffer>(vk_buffer->buffer)));
+        vmaDestroyBuffer(vma, vk_buffer->buffer, vk_buffer->allocation);
+        memory_usage_per_category[static_cast<size_t>(vk_buffer->memory_category)] -= vk_buffer->allocation_info.size;
+
+        allocator.deallocate(reinterpret_cast<uint8_t*>(buffer));
+    }
+
     void VulkanRenderDevice::destroy_semaphores(std::vector<RhiSemaphore*>& semaphores, rx::memory::allocator& allocator) {
         ZoneScoped;
         semaphores.each_fwd([&](RhiSemaphore* semaphore) {
@@ -1138,10 +1611,7 @@ namespace nova::renderer::rhi {
 
         const auto result = vkQueueSubmit(queue_to_submit_to, 1, &submit_info, vk_signal_fence);
 
-        fenced_tasks.emplace_back(vk_signal_fence, [&] {
-            vk_list->cleanup_resources();
-            submission_fences.emplace_back(vk_signal_fence);
-        });
+        fenced_tasks.emplace_back(vk_signal_fence, [&] { submission_fences.emplace_back(vk_signal_fence); });
 
         if(settings->debug.enabled) {
             if(result != VK_SUCCESS) {
@@ -1151,6 +1621,160 @@ namespace nova::renderer::rhi {
         }
     }
 
+    RhiMemoryStats VulkanRenderDevice::get_memory_stats() const {
+        ZoneScoped;
+        const VkPhysicalDeviceMemoryProperties* memory_properties;
+        vmaGetMemoryProperties(vma, &memory_properties);
+
+        std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets = {};
+        vmaGetBudget(vma, budgets.data());
+
+        // Without VK_EXT_memory_budget, VMA reports how much it has allocated from each heap and estimates the budget from the heap's size.
+        // That misses other programs' memory, but it's still enough to notice when we're filling up VRAM ourselves
+        static_assert(MAX_MEMORY_HEAPS == VK_MAX_MEMORY_HEAPS);
+
+        RhiMemoryStats stats = {};
+        stats.num_heaps = memory_properties->memoryHeapCount;
+        for(uint32_t heap = 0; heap < memory_properties->memoryHeapCount; heap++) {
+            auto& heap_budget = stats.heaps[heap];
+            heap_budget.usage = budgets[heap].usage;
+            heap_budget.budget = budgets[heap].budget;
+            heap_budget.is_device_local = (memory_properties->memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+        }
+
+        for(size_t category = 0; category < NUM_MEMORY_CATEGORIES; category++) {
+            stats.usage_per_category[category] = memory_usage_per_category[category];
+        }
+
+        return stats;
+    }
+
+    void VulkanRenderDevice::save_pipeline_cache() { pipeline_cache->save(); }
+
+    bool VulkanRenderDevice::compile_pipeline_for_renderpass(const RhiPipeline& pipeline, RhiRenderpass& renderpass) {
+        ZoneScoped;
+        const auto& vk_pipeline = static_cast<const VulkanPipeline&>(pipeline);
+        auto& vk_renderpass = static_cast<VulkanRenderpass&>(renderpass);
+        const auto& name = vk_pipeline.state.name;
+
+        {
+            std::lock_guard lock{vk_renderpass.pipelines_mutex};
+            // The pipeline's either about to be compiled by us, already compiled, or being compiled by another thread, so it's not pending
+            // anymore
+            vk_renderpass.pending_pipelines.erase(name);
+            if(vk_renderpass.failed_pipelines.contains(name)) {
+                return false;
+            }
+
+            if(vk_renderpass.cached_pipelines.contains(name) || !vk_renderpass.pipelines_being_compiled.emplace(name).second) {
+                return true;
+            }
+        }
+
+        const auto compiled = get_or_compile_pso(vk_pipeline, vk_renderpass, true, false);
+
+        std::lock_guard lock{vk_renderpass.pipelines_mutex};
+        vk_renderpass.pipelines_being_compiled.erase(name);
+
+        if(!compiled) {
+            logger->error("Could not compile pipeline {}", name);
+            vk_renderpass.failed_pipelines.emplace(name);
+            return false;
+        }
+
+        return true;
+    }
+
+    void VulkanRenderDevice::mark_pipeline_pending(const RhiPipeline& pipeline, RhiRenderpass& renderpass) {
+        const auto& vk_pipeline = static_cast<const VulkanPipeline&>(pipeline);
+        auto& vk_renderpass = static_cast<VulkanRenderpass&>(renderpass);
+        const auto& name = vk_pipeline.state.name;
+
+        std::lock_guard lock{vk_renderpass.pipelines_mutex};
+        if(!vk_renderpass.cached_pipelines.contains(name)) {
+            vk_renderpass.pending_pipelines.emplace(name);
+        }
+    }
+
+    std::unique_ptr<RhiRecompiledPipeline> VulkanRenderDevice::recompile_pipeline_for_renderpass(const RhiPipeline& pipeline,
+                                                                                                 RhiRenderpass& renderpass) {
+        ZoneScoped;
+        const auto& vk_pipeline = static_cast<const VulkanPipeline&>(pipeline);
+        auto& vk_renderpass = static_cast<VulkanRenderpass&>(renderpass);
+
+        // The parent may be recompiled too, and its old PSO destroyed while we're still deriving from it
+        const auto pso = get_or_compile_pso(vk_pipeline, vk_renderpass, false, true);
+        if(!pso) {
+            logger->error("Could not recompile pipeline {}", vk_pipeline.state.name);
+            return nullptr;
+        }
+
+        auto recompiled_pipeline = std::make_unique<VulkanRecompiledPipeline>();
+        recompiled_pipeline->renderpass = &vk_renderpass;
+        recompiled_pipeline->name = vk_pipeline.state.name;
+        recompiled_pipeline->pso = *pso;
+
+        return recompiled_pipeline;
+    }
+
+    void VulkanRenderDevice::install_recompiled_pipeline(RhiRecompiledPipeline& pipeline) {
+        ZoneScoped;
+        auto& recompiled_pipeline = static_cast<VulkanRecompiledPipeline&>(pipeline);
+        auto& renderpass = *recompiled_pipeline.renderpass;
+
+        std::lock_guard lock{renderpass.pipelines_mutex};
+        auto& uninstalled_pipelines = renderpass.uninstalled_pipelines;
+        if(const auto itr = std::find(uninstalled_pipelines.begin(), uninstalled_pipelines.end(), recompiled_pipeline.pso);
+           itr != uninstalled_pipelines.end()) {
+            uninstalled_pipelines.erase(itr);
+
+        } else {
+            logger->error("Recompiled pipeline {} was already installed", recompiled_pipeline.name);
+            return;
+        }
+
+        renderpass.failed_pipelines.erase(recompiled_pipeline.name);
+
+        const auto [itr, is_new_pipeline] = renderpass.cached_pipelines.emplace(recompiled_pipeline.name, recompiled_pipeline.pso);
+        if(is_new_pipeline || itr->second == recompiled_pipeline.pso) {
+            return;
+        }
+
+        const auto old_pipeline = std::exchange(itr->second, recompiled_pipeline.pso);
+
+        // Pipelines with the same state share PSOs, so only retire the old one once nothing uses it
+        if(!is_pso_in_use(renderpass, old_pipeline)) {
+            forget_pso(renderpass, old_pipeline);
+            retired_pipelines.push_back({old_pipeline, settings->max_in_flight_frames});
+        }
+    }
+
+    void VulkanRenderDevice::destroy_retired_pipelines() {
+        ZoneScoped;
+        // Every in-flight frame, including the one that's beginning, has to finish before we can destroy the pipelines they might use
+        std::erase_if(retired_pipelines, [&](RetiredPipeline& retired_pipeline) {
+            if(retired_pipeline.frames_until_destroyed > 0) {
+                retired_pipeline.frames_until_destroyed--;
+                return false;
+            }
+
+            vkDestroyPipeline(device, retired_pipeline.pipeline, nullptr);
+            return true;
+        });
+    }
+
+    void VulkanRenderDevice::begin_frame(const uint32_t frame_idx) {
+        ZoneScoped;
+        cur_frame_idx = frame_idx;
+
+        vma_frame_index++;
+        vmaSetCurrentFrameIndex(vma, vma_frame_index);
+
+        descriptor_allocator->reset_frame(frame_idx);
+
+        destroy_retired_pipelines();
+    }
+
     void VulkanRenderDevice::end_frame(FrameContext& /* ctx */) {
         ZoneScoped; // Intentionally copying the vector
         auto cur_tasks = fenced_tasks;
@@ -1187,14 +1811,74 @@ namespace nova::renderer::rhi {
     }
 
     VulkanPipelineLayoutInfo VulkanRenderDevice::create_pipeline_layout(const RhiGraphicsPipelineState& state) {
-        const auto bindings = get_all_descriptors(state);
+        ZoneScoped;
+        auto bindings = get_all_descriptors(state);
+
+        // Reflection doesn't know how many textures this device can bind, so shrink unbounded arrays to fit
+        bindings.each_value([&](RhiResourceBindingDescription& binding_desc) {
+            if(binding_desc.is_unbounded) {
+                binding_desc.count = std::min(binding_desc.count, info.max_num_textures);
+            }
+        });
+
+        const auto to_vk_push_constant_ranges = [](const std::vector<PipelinePushConstantRange>& ranges) {
+            std::vector<vk::PushConstantRange> vk_ranges;
+            vk_ranges.reserve(ranges.size());
+            for(const auto& range : ranges) {
+                vk_ranges.push_back(vk::PushConstantRange()
+                                        .setStageFlags(to_vk_shader_stage_flags(static_cast<ShaderStage>(range.stages)))
+                                        .setOffset(range.offset)
+                                        .setSize(range.size));
+            }
+
+            return vk_ranges;
+        };
+
+        const auto ranges = get_push_constant_ranges(state);
+        const auto push_constant_ranges = to_vk_push_constant_ranges(ranges);
+
+        // Hash the layout without the bindings' names, so that shaders which call the same resources different things share a layout
+        std::vector<const RhiResourceBindingDescription*> sorted_bindings;
+        sorted_bindings.reserve(bindings.size());
+        for(const auto& [name, binding_desc] : bindings) {
+            sorted_bindings.push_back(&binding_desc);
+        }
+        std::sort(sorted_bindings.begin(), sorted_bindings.end(), [](const auto* lhs, const auto* rhs) {
+            return lhs->set < rhs->set || (lhs->set == rhs->set && lhs->binding < rhs->binding);
+        });
+
+        Sha256 hasher;
+        hasher.update_value(static_cast<uint64_t>(sorted_bindings.size()));
+        for(const auto* binding_desc : sorted_bindings) {
+            hasher.update_value(binding_desc->set);
+            hasher.update_value(binding_desc->binding);
+            hasher.update_value(binding_desc->count);
+            hasher.update_value(binding_desc->is_unbounded);
+            hasher.update_value(binding_desc->type);
+            hasher.update_value(binding_desc->stages);
+        }
+        hasher.update_value(static_cast<uint64_t>(push_constant_ranges.size()));
+        for(const auto& range : push_constant_ranges) {
+            hasher.update_value(static_cast<uint32_t>(range.stageFlags));
+            hasher.update_value(range.offset);
+            hasher.update_value(range.size);
+        }
+        const auto layout_hash = hasher.finish();
+
+        std::lock_guard lock{pipeline_layout_cache_mutex};
+        if(const auto itr = pipeline_layout_cache.find(layout_hash); itr != pipeline_layout_cache.end()) {
+            auto layout_info = itr->second;
+            layout_info.bindings = std::move(bindings);
+            return layout_info;
+        }
+
         const auto ds_layouts = create_descriptor_set_layouts(bindings, *this, internal_allocator);
 
         const auto pipeline_layout_create = vk::PipelineLayoutCreateInfo()
                                                 .setSetLayoutCount(static_cast<uint32_t>(ds_layouts.size()))
                                                 .setPSetLayouts(ds_layouts.data())
-                                                .setPushConstantRangeCount(static_cast<uint32_t>(standard_push_constants.size()))
-                                                .setPPushConstantRanges(standard_push_constants.data()); // TODO: Get this from reflection
+                                                .setPushConstantRangeCount(static_cast<uint32_t>(push_constant_ranges.size()))
+                                                .setPPushConstantRanges(push_constant_ranges.data());
 
         vk::PipelineLayout layout;
         device.createPipelineLayout(&pipeline_layout_create, &vk_internal_allocator, &layout);
@@ -1206,7 +1890,15 @@ namespace nova::renderer::rhi {
             }
         });
 
-        return {bindings, ds_layouts, layout, variable_descriptor_counts};
+        VulkanPipelineLayoutInfo layout_info{bindings,
+                                             ds_layouts,
+                                             layout,
+                                             variable_descriptor_counts,
+                                             push_constant_ranges,
+                                             to_vk_push_constant_ranges(get_push_constant_intervals(ranges))};
+        pipeline_layout_cache.emplace(layout_hash, layout_info);
+
+        return layout_info;
     }
 
     void VulkanRenderDevice::create_surface() {
@@ -1344,6 +2036,18 @@ namespace nova::renderer::rhi {
         vk_info.max_uniform_buffer_size = gpu.props.limits.maxUniformBufferRange;
         info.max_texture_size = gpu.props.limits.maxImageDimension2D;
 
+        vk::PhysicalDeviceDescriptorIndexingProperties descriptor_indexing_props = {};
+        vk::PhysicalDeviceProperties2 props2 = {};
+        props2.pNext = &descriptor_indexing_props;
+        gpu.phys_device.getProperties2(&props2);
+
+        // Every texture lives in one update-after-bind binding that all shader stages can see, so both the per-set and the per-stage
+        // limits apply
+        info.max_num_textures = std::min({descriptor_indexing_props.maxDescriptorSetUpdateAfterBindSampledImages,
+                                          descriptor_indexing_props.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                                          MAX_NUM_TEXTURES});
+        logger->info("Bindless texture table has space for {} textures", info.max_num_textures);
+
         // TODO: Something smarter when Intel releases discreet GPUS
         // TODO: Handle integrated AMD GPUs
         info.is_uma = info.architecture == DeviceArchitecture::intel;
@@ -1361,8 +2065,7 @@ namespace nova::renderer::rhi {
         info.supports_raytracing = available_extensions.find_if(extension_name_matcher(VK_NV_RAY_TRACING_EXTENSION_NAME)) !=
                                    std::vector<vk::ExtensionProperties>::k_npos;
 
-        // TODO: Update as more GPUs support mesh shaders
-        info.supports_mesh_shaders = available_extensions.find_if(extension_name_matcher(VK_NV_MESH_SHADER_EXTENSION_NAME));
+        // info.supports_mesh_shaders is set in create_device_and_queues, since that's where we decide whether to enable the extensions
     }
 
     void VulkanRenderDevice::initialize_vma() {
@@ -1370,7 +2073,9 @@ namespace nova::renderer::rhi {
         vk::AllocationCallbacks callbacks = vk_internal_allocator;
 
         VmaAllocatorCreateInfo create_info{};
-        create_info.flags = VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+        if(vk_info.supports_memory_budget) {
+            create_info.flags = VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+        }
         create_info.physicalDevice = gpu.phys_device;
         create_info.device = device;
         create_info.pAllocationCallbacks = &callbacks;
@@ -1387,7 +2092,6 @@ namespace nova::renderer::rhi {
         ZoneScoped;
         std::vector<char*> device_extensions{&internal_allocator};
         device_extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
-        device_extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
 
         uint32_t device_count;
         NOVA_CHECK_RESULT(vkEnumeratePhysicalDevices(instance, &device_count, nullptr));
@@ -1464,6 +2168,36 @@ namespace nova::renderer::rhi {
             return;
         }
 
+        {
+            // Mesh shaders are optional. The mesh shader path binds each mesh's meshlet buffers with push descriptors, so we need both
+            // extensions
+            // TODO: Update as more GPUs support mesh shaders
+            uint32_t extension_count;
+            vkEnumerateDeviceExtensionProperties(gpu.phys_device, nullptr, &extension_count, nullptr);
+            std::vector<vk::ExtensionProperties> available_extensions(extension_count);
+            vkEnumerateDeviceExtensionProperties(gpu.phys_device, nullptr, &extension_count, available_extensions.data());
+
+            const auto has_extension = [&](const char* ext_name) {
+                return std::find_if(available_extensions.begin(), available_extensions.end(), [&](const vk::ExtensionProperties& ext_props) {
+                           return strcmp(ext_name, ext_props.extensionName) == 0;
+                       }) != available_extensions.end();
+            };
+
+            info.supports_mesh_shaders = has_extension(VK_NV_MESH_SHADER_EXTENSION_NAME) &&
+                                         has_extension(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+            if(info.supports_mesh_shaders) {
+                device_extensions.push_back(VK_NV_MESH_SHADER_EXTENSION_NAME);
+                device_extensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+            }
+
+            // The memory budget extension makes our VRAM budgets account for other programs, but older and low-end GPUs may not have it.
+            // get_memory_stats falls back to VMA's own numbers without it
+            vk_info.supports_memory_budget = has_extension(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+            if(vk_info.supports_memory_budget) {
+                device_extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+            }
+        }
+
         PROFILE_VOID_EXPR(vkGetPhysicalDeviceFeatures(gpu.phys_device, &gpu.supported_features),
                           VulkanRenderDevice,
                           vkGetPhysicalDeviceFeatures);
@@ -1522,13 +2256,16 @@ namespace nova::renderer::rhi {
         descriptor_indexing_features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
         device_create_info.pNext = &descriptor_indexing_features;
 
+        const auto mesh_shader_features = vk::PhysicalDeviceMeshShaderFeaturesNV().setTaskShader(true).setMeshShader(true);
+
         const auto dev_12_features = vk::PhysicalDeviceVulkan12Features()
                                          .setDescriptorIndexing(true)
                                          .setShaderSampledImageArrayNonUniformIndexing(true)
                                          .setRuntimeDescriptorArray(true)
                                          .setDescriptorBindingVariableDescriptorCount(true)
                                          .setDescriptorBindingPartiallyBound(true)
-                                         .setDescriptorBindingSampledImageUpdateAfterBind(true);
+                                         .setDescriptorBindingSampledImageUpdateAfterBind(true)
+                                         .setPNext(info.supports_mesh_shaders ? &mesh_shader_features : nullptr);
 
         device_create_info.pNext = &dev_12_features;
 
@@ -1598,24 +2335,25 @@ namespace nova::renderer::rhi {
 
     void VulkanRenderDevice::create_per_thread_command_pools() {
         ZoneScoped;
-        const uint32_t num_threads = 1; // TODO: Make this real
-        command_pools_by_thread_idx.reserve(num_threads);
+        command_pools_by_thread_idx.reserve(NUM_RENDER_THREADS);
 
-        for(uint32_t i = 0; i < num_threads; i++) {
+        for(uint32_t i = 0; i < NUM_RENDER_THREADS; i++) {
             command_pools_by_thread_idx.push_back(make_new_command_pools());
         }
     }
 
     void VulkanRenderDevice::create_standard_pipeline_layout() {
         standard_push_constants = std::array{
-            // Camera and Material index
-            vk::PushConstantRange().setStageFlags(vk::ShaderStageFlagBits::eAll).setOffset(0).setSize(sizeof(uint32_t) * 2)};
+            // Camera, material, and model matrix index
+            vk::PushConstantRange().setStageFlags(vk::ShaderStageFlagBits::eAll).setOffset(0).setSize(sizeof(uint32_t) * 3)};
 
         const auto flags_per_binding = std::array{vk::DescriptorBindingFlags{},
                                                   vk::DescriptorBindingFlags{},
                                                   vk::DescriptorBindingFlags{},
                                                   vk::DescriptorBindingFlags{},
                                                   vk::DescriptorBindingFlags{},
+                                                  vk::DescriptorBindingFlags{},
+                                                  vk::DescriptorBindingFlags{},
                                                   vk::DescriptorBindingFlagBits::eUpdateAfterBind |
                                                       vk::DescriptorBindingFlagBits::eVariableDescriptorCount |
                                                       vk::DescriptorBindingFlagBits::ePartiallyBound};
@@ -1628,9 +2366,9 @@ namespace nova::renderer::rhi {
                                                        vk::DescriptorType::eUniformBuffer :
                                                        vk::DescriptorType::eStorageBuffer;
 
-        const auto material_buffer_descriptor_type = MATERIAL_BUFFER_SIZE.b_count() < gpu.props.limits.maxUniformBufferRange ?
-                                                         vk::DescriptorType::eUniformBuffer :
-                                                         vk::DescriptorType::eStorageBuffer;
+        // The material buffer grows as the renderpack creates more materials, so it might not stay small enough to be a uniform buffer.
+        // It's a StructuredBuffer in the shaders anyways
+        const auto material_buffer_descriptor_type = vk::DescriptorType::eStorageBuffer;
 
         // Binding for the array of material parameter buffers. Nova uses a variable-length, partially-bound
         const std::vector<vk::DescriptorSetLayoutBinding> bindings = std::array{// Camera data buffer
@@ -1663,11 +2401,23 @@ namespace nova::renderer::rhi {
                                                                                     .setDescriptorType(vk::DescriptorType::eSampler)
                                                                                     .setDescriptorCount(1)
                                                                                     .setStageFlags(vk::ShaderStageFlagBits::eAll),
-                                                                                // Textures array
+                                                                                // Virtual texture info buffer
                                                                                 vk::DescriptorSetLayoutBinding()
                                                                                     .setBinding(5)
+                                                                                    .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                                                                                    .setDescriptorCount(1)
+                                                                                    .setStageFlags(vk::ShaderStageFlagBits::eAll),
+                                                                                // Virtual texture feedback buffer
+                                                                                vk::DescriptorSetLayoutBinding()
+                                                                                    .setBinding(6)
+                                                                                    .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                                                                                    .setDescriptorCount(1)
+                                                                                    .setStageFlags(vk::ShaderStageFlagBits::eAll),
+                                                                                // Textures array
+                                                                                vk::DescriptorSetLayoutBinding()
+                                                                                    .setBinding(7)
                                                                                     .setDescriptorType(vk::DescriptorType::eSampledImage)
-                                                                                    .setDescriptorCount(MAX_NUM_TEXTURES)
+                                                                                    .setDescriptorCount(info.max_num_textures)
                                                                                     .setStageFlags(vk::ShaderStageFlagBits::eAll)};
 
         const auto dsl_layout_create = vk::DescriptorSetLayoutCreateInfo()
@@ -1678,18 +2428,44 @@ namespace nova::renderer::rhi {
 
         device.createDescriptorSetLayout(&dsl_layout_create, &vk_internal_allocator, &standard_set_layout);
 
+        std::vector<vk::DescriptorSetLayout> standard_set_layouts{standard_set_layout};
+
+        if(info.supports_mesh_shaders) {
+            // Set 1 holds the geometry of the mesh that the mesh shader path is drawing. It's a push descriptor set, since it changes for
+            // every mesh
+            std::array<vk::DescriptorSetLayoutBinding, 4> meshlet_bindings;
+            for(uint32_t i = 0; i < meshlet_bindings.size(); i++) {
+                meshlet_bindings[i] = vk::DescriptorSetLayoutBinding()
+                                          .setBinding(i)
+                                          .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                                          .setDescriptorCount(1)
+                                          .setStageFlags(vk::ShaderStageFlagBits::eTaskNV | vk::ShaderStageFlagBits::eMeshNV);
+            }
+
+            const auto meshlet_layout_create = vk::DescriptorSetLayoutCreateInfo()
+                                                   .setFlags(vk::DescriptorSetLayoutCreateFlagBits::ePushDescriptorKHR)
+                                                   .setBindingCount(static_cast<uint32_t>(meshlet_bindings.size()))
+                                                   .setPBindings(meshlet_bindings.data());
+
+            device.createDescriptorSetLayout(&meshlet_layout_create, &vk_internal_allocator, &meshlet_set_layout);
+
+            standard_set_layouts.push_back(meshlet_set_layout);
+        }
+
         const auto pipeline_layout_create = vk::PipelineLayoutCreateInfo()
-                                                .setSetLayoutCount(1)
-                                                .setPSetLayouts(&standard_set_layout)
+                                                .setSetLayoutCount(static_cast<uint32_t>(standard_set_layouts.size()))
+                                                .setPSetLayouts(standard_set_layouts.data())
                                                 .setPushConstantRangeCount(static_cast<uint32_t>(standard_push_constants.size()))
                                                 .setPPushConstantRanges(standard_push_constants.data());
 
         device.createPipelineLayout(&pipeline_layout_create, &vk_internal_allocator, &standard_pipeline_layout);
 
-        const auto& pool = create_descriptor_pool(std::array{std::pair{DescriptorType::StorageBuffer, 5_u32 * 1024},
-                                                             std::pair{DescriptorType::UniformBuffer, 5_u32 * 1024},
-                                                             std::pair{DescriptorType::Texture, MAX_NUM_TEXTURES * 1024},
-                                                             std::pair{DescriptorType::Sampler, 3_u32 * 1024}},
+        // The pool only holds the standard sets, one for each in-flight frame. Everything else comes from the descriptor allocator
+        const auto num_frames = settings->max_in_flight_frames;
+        const auto& pool = create_descriptor_pool(std::array{std::pair{DescriptorType::StorageBuffer, 4 * num_frames},
+                                                             std::pair{DescriptorType::UniformBuffer, num_frames},
+                                                             std::pair{DescriptorType::Texture, info.max_num_textures * num_frames},
+                                                             std::pair{DescriptorType::Sampler, 3 * num_frames}},
                                                   internal_allocator);
 
         standard_descriptor_set_pool = *pool;
@@ -1718,6 +2494,44 @@ namespace nova::renderer::rhi {
         }
     }
 
+    void VulkanRenderDevice::create_standard_descriptor_sets() {
+        ZoneScoped;
+        const auto num_frames = settings->max_in_flight_frames;
+
+        const std::vector<vk::DescriptorSetLayout> layouts(num_frames, standard_set_layout);
+        const std::vector<uint32_t> variable_set_counts(num_frames, info.max_num_textures);
+
+        const auto count_allocate_info = vk::DescriptorSetVariableDescriptorCountAllocateInfo()
+                                             .setPDescriptorCounts(variable_set_counts.data())
+                                             .setDescriptorSetCount(static_cast<uint32_t>(variable_set_counts.size()));
+
+        const auto allocate_info = vk::DescriptorSetAllocateInfo()
+                                       .setDescriptorPool(standard_descriptor_set_pool)
+                                       .setDescriptorSetCount(static_cast<uint32_t>(layouts.size()))
+                                       .setPSetLayouts(layouts.data())
+                                       .setPNext(&count_allocate_info);
+
+        standard_descriptor_sets.resize(num_frames);
+        device.allocateDescriptorSets(&allocate_info, standard_descriptor_sets.data());
+
+        standard_set_bindings_per_frame.resize(num_frames);
+        dirty_texture_slots_per_frame.resize(num_frames);
+
+        if(settings->debug.enabled) {
+            for(uint32_t i = 0; i < num_frames; i++) {
+                const auto set_name = fmt::format("Standard descriptor set {}", i);
+
+                vk::DebugUtilsObjectNameInfoEXT object_name = {};
+                object_name.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT;
+                object_name.objectType = VK_OBJECT_TYPE_DESCRIPTOR_SET;
+                object_name.objectHandle = reinterpret_cast<uint64_t>(static_cast<VkDescriptorSet>(standard_descriptor_sets[i]));
+                object_name.pObjectName = set_name.c_str();
+
+                NOVA_CHECK_RESULT(vkSetDebugUtilsObjectNameEXT(device, &object_name));
+            }
+        }
+    }
+
     std::unordered_map<uint32_t, vk::CommandPool> VulkanRenderDevice::make_new_command_pools() const {
         ZoneScoped;
         std::vector<uint32_t> queue_indices{&internal_allocator};
@@ -1764,13 +2578,46 @@ namespace nova::renderer::rhi {
         return VK_MAX_MEMORY_TYPES;
     }
 
-    vk::ImageView VulkanRenderDevice::image_view_for_image(const RhiImage* image) {
-        // TODO: This method is terrible. We shouldn't tie image views to images, we should let everything that wants
-        // to use the image create its own image view
+    vk::ImageView VulkanRenderDevice::get_image_view(VulkanImage& image, const RhiImageRange& range, const vk::Format format) {
+        if(format == image.format && range == RhiImageRange{0, image.num_mip_levels, 0, image.num_array_layers}) {
+            return image.image_view;
+        }
 
-        const auto* vk_image = static_cast<const VulkanImage*>(image);
+        std::lock_guard lock{image_view_mutex};
+
+        for(const auto& range_view : image.range_views) {
+            if(range_view.range == range && range_view.format == format) {
+                return range_view.view;
+            }
+        }
 
-        return vk_image->image_view;
+        const auto view = create_image_view(image, range, format);
+        image.range_views.push_back({range, format, view});
+
+        return view;
+    }
+
+    vk::ImageView VulkanRenderDevice::create_image_view(const VulkanImage& image,
+                                                        const RhiImageRange& range,
+                                                        const vk::Format format) const {
+        ZoneScoped;
+        const auto view_type = range.num_array_layers > 1 ? vk::ImageViewType::e2DArray : vk::ImageViewType::e2D;
+
+        const auto create_info = vk::ImageViewCreateInfo()
+                                     .setImage(image.image)
+                                     .setViewType(view_type)
+                                     .setFormat(format)
+                                     .setSubresourceRange(vk::ImageSubresourceRange()
+                                                              .setAspectMask(image.aspect)
+                                                              .setBaseMipLevel(range.base_mip_level)
+                                                              .setLevelCount(range.num_mip_levels)
+                                                              .setBaseArrayLayer(range.base_array_layer)
+                                                              .setLayerCount(range.num_array_layers));
+
+        vk::ImageView view;
+        device.createImageView(&create_info, &vk_internal_allocator, &view);
+
+        return view;
     }
 
     vk::CommandBufferLevel VulkanRenderDevice::to_vk_command_buffer_level(const RhiRenderCommandList::Level level) {
@@ -1813,10 +2660,13 @@ namespace nova::renderer::rhi {
 
     std::optional<vk::ShaderModule> VulkanRenderDevice::create_shader_module(const std::vector<uint32_t>& spirv) const {
         ZoneScoped;
+        // Reflection reads the unstripped SPIR-V in the pipeline state, so the driver is the only thing that sees the stripped shader
+        const auto stripped_spirv = renderpack::get_spirv_optimizer().strip(spirv);
+
         vk::ShaderModuleCreateInfo shader_module_create_info = {};
         shader_module_create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        shader_module_create_info.pCode = spirv.data();
-        shader_module_create_info.codeSize = spirv.size() * 4;
+        shader_module_create_info.pCode = stripped_spirv.data();
+        shader_module_create_info.codeSize = stripped_spirv.size() * 4;
 
         vk::ShaderModule module;
         const vk::AllocationCallbacks& vk_alloc = wrap_allocator(internal_allocator);
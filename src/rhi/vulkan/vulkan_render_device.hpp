@@ -1,5 +1,11 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <span>
+#include <unordered_set>
+
 #include <vk_mem_alloc.h>
 #include <vulkan/vulkan.hpp>
 
@@ -7,6 +13,10 @@
 #include "vulkan_swapchain.hpp"
 
 namespace nova {
+    namespace mem {
+        class FrameArena;
+    }
+
     namespace renderer {
         class NovaWindow;
         class NovaSettingsAccessManager;
@@ -14,8 +24,44 @@ namespace nova {
 }
 
 namespace nova::renderer::rhi {
+    /*!
+     * \brief Index of the descriptor set that holds the current mesh's geometry for the mesh shader path
+     */
+    constexpr uint32_t MESHLET_DESCRIPTOR_SET_INDEX = 1;
+
+    class VulkanDescriptorAllocator;
+    class VulkanPipelineCache;
+
     struct VulkanDeviceInfo {
         uint64_t max_uniform_buffer_size = 0;
+
+        /*!
+         * \brief Whether we enabled VK_EXT_memory_budget
+         */
+        bool supports_memory_budget = false;
+    };
+
+    /*!
+     * \brief Everything in the standard descriptor set except for the texture table
+     *
+     * We remember what each frame's standard descriptor set was last written with, so that we only rewrite the bindings that changed
+     */
+    struct StandardSetBindings {
+        vk::Buffer camera_buffer;
+        vk::DeviceSize camera_buffer_size = 0;
+
+        vk::Buffer material_buffer;
+        vk::DeviceSize material_buffer_size = 0;
+
+        vk::Sampler point_sampler;
+        vk::Sampler bilinear_sampler;
+        vk::Sampler trilinear_sampler;
+
+        vk::Buffer virtual_texture_info_buffer;
+        vk::DeviceSize virtual_texture_info_buffer_size = 0;
+
+        vk::Buffer virtual_texture_feedback_buffer;
+        vk::DeviceSize virtual_texture_feedback_buffer_size = 0;
     };
 
     struct VulkanInputAssemblerLayout {
@@ -78,10 +124,44 @@ namespace nova::renderer::rhi {
          */
         vk::PipelineLayout standard_pipeline_layout;
 
+        /*!
+         * \brief Layout for the push descriptor set that the mesh shader path reads a mesh's geometry from
+         *
+         * Only valid if the device supports mesh shaders
+         */
+        vk::DescriptorSetLayout meshlet_set_layout;
+
+        /*!
+         * \brief Pool for the standard descriptor sets
+         *
+         * The standard sets have a huge texture array, so they get their own pool
+         */
         vk::DescriptorPool standard_descriptor_set_pool;
 
         /*!
-         * \brief The descriptor set that binds to the standard pipeline layout
+         * \brief Allocates every descriptor set except the standard sets
+         */
+        std::unique_ptr<VulkanDescriptorAllocator> descriptor_allocator;
+
+        /*!
+         * \brief Cache of compiled pipelines, which persists between runs of Nova
+         */
+        std::unique_ptr<VulkanPipelineCache> pipeline_cache;
+
+        /*!
+         * \brief Gets a view of part of an image, creating it if the image doesn't have one for that range and format yet
+         *
+         * Asking for the whole image in the image's own format gives you the image's default view. Views live until the image is destroyed
+         *
+         * \param format The format to view the image as. Anything other than the image's format needs an image which was created with a
+         * mutable format
+         */
+        [[nodiscard]] vk::ImageView get_image_view(VulkanImage& image, const RhiImageRange& range, vk::Format format);
+
+        /*!
+         * \brief The descriptor sets that bind to the standard pipeline layout, one for each in-flight frame
+         *
+         * These sets live as long as the device. Each one is only written when something in it changes
          */
         std::vector<vk::DescriptorSet> standard_descriptor_sets;
 
@@ -90,6 +170,10 @@ namespace nova::renderer::rhi {
         PFN_vkDestroyDebugReportCallbackEXT vkDestroyDebugReportCallbackEXT = nullptr;
         PFN_vkSetDebugUtilsObjectNameEXT vkSetDebugUtilsObjectNameEXT = nullptr;
 
+        // Mesh shader things. Only loaded if the device supports mesh shaders
+        PFN_vkCmdDrawMeshTasksNV vkCmdDrawMeshTasksNV = nullptr;
+        PFN_vkCmdPushDescriptorSetKHR vkCmdPushDescriptorSetKHR = nullptr;
+
         VulkanRenderDevice(NovaSettingsAccessManager& settings, NovaWindow& window);
 
         VulkanRenderDevice(VulkanRenderDevice&& old) noexcept = delete;
@@ -98,7 +182,7 @@ namespace nova::renderer::rhi {
         VulkanRenderDevice(const VulkanRenderDevice& other) = delete;
         VulkanRenderDevice& operator=(const VulkanRenderDevice& other) = delete;
 
-        ~VulkanRenderDevice() = default;
+        ~VulkanRenderDevice();
 
 #pragma region Render engine interface
         void set_num_renderpasses(uint32_t num_renderpasses) override;
@@ -121,6 +205,10 @@ namespace nova::renderer::rhi {
 
         void write_data_to_buffer(const void* data, mem::Bytes num_bytes, const RhiBuffer* buffer) override;
 
+        void write_data_to_buffer(const void* data, mem::Bytes num_bytes, mem::Bytes offset, const RhiBuffer* buffer) override;
+
+        void read_data_from_buffer(void* data, mem::Bytes num_bytes, mem::Bytes offset, const RhiBuffer* buffer) override;
+
         RhiSampler* create_sampler(const RhiSamplerCreateInfo& create_info) override;
 
         RhiImage* create_image(const renderpack::TextureCreateInfo& info) override;
@@ -133,9 +221,9 @@ namespace nova::renderer::rhi {
 
         std::vector<RhiFence*> create_fences(uint32_t num_fences, bool signaled) override;
 
-        void wait_for_fences(std::vector<RhiFence*> fences) override;
+        void wait_for_fences(std::span<RhiFence* const> fences) override;
 
-        void reset_fences(const std::vector<RhiFence*>& fences) override;
+        void reset_fences(std::span<RhiFence* const> fences) override;
 
         void destroy_renderpass(RhiRenderpass* pass) override;
 
@@ -143,6 +231,12 @@ namespace nova::renderer::rhi {
 
         void destroy_texture(RhiImage* resource) override;
 
+        void destroy_sampler(RhiSampler* sampler) override;
+
+        void set_texture_table_slot(uint32_t slot, RhiImage* image) override;
+
+        void destroy_buffer(RhiBuffer* buffer) override;
+
         void destroy_semaphores(std::vector<RhiSemaphore*>& semaphores) override;
 
         void destroy_fences(const std::vector<RhiFence*>& fences) override;
@@ -157,12 +251,33 @@ namespace nova::renderer::rhi {
                                  const std::vector<RhiSemaphore*>& wait_semaphores = {},
                                  const std::vector<RhiSemaphore*>& signal_semaphores = {}) override;
 
+        [[nodiscard]] RhiMemoryStats get_memory_stats() const override;
+
+        void save_pipeline_cache() override;
+
+        bool compile_pipeline_for_renderpass(const RhiPipeline& pipeline, RhiRenderpass& renderpass) override;
+
+        void mark_pipeline_pending(const RhiPipeline& pipeline, RhiRenderpass& renderpass) override;
+
+        std::unique_ptr<RhiRecompiledPipeline> recompile_pipeline_for_renderpass(const RhiPipeline& pipeline,
+                                                                                 RhiRenderpass& renderpass) override;
+
+        void install_recompiled_pipeline(RhiRecompiledPipeline& pipeline) override;
+
+        void begin_frame(uint32_t frame_idx) override;
+
         void end_frame(FrameContext& ctx) override;
 #pragma endregion
 
     public:
         [[nodiscard]] uint32_t get_queue_family_index(QueueType type) const;
 
+        /*!
+         * \brief Gets a pipeline layout with the descriptors and push constants that the pipeline's shaders use
+         *
+         * Layouts come from a cache, so pipelines whose shaders use the same resources share a layout. The returned bindings keep the
+         * names from this pipeline's shaders
+         */
         VulkanPipelineLayoutInfo create_pipeline_layout(const RhiGraphicsPipelineState& state);
 
         /*!
@@ -170,30 +285,86 @@ namespace nova::renderer::rhi {
          *
          * \param state Pipeline state to bake into the PSO
          * \param renderpass The render pas that this pipeline will be used with
+         * \param base_pipeline PSO to derive the new PSO from, or `VK_NULL_HANDLE` to build it from scratch
          * \param allocator Allocator to use for any needed memory
          *
          * \return The new PSO
          */
-        [[nodiscard]] ntl::Result<vk::Pipeline> compile_pipeline_state(const VulkanPipeline& state, const VulkanRenderpass& renderpass);
+        [[nodiscard]] ntl::Result<vk::Pipeline> compile_pipeline_state(const VulkanPipeline& state,
+                                                                      const VulkanRenderpass& renderpass,
+                                                                      vk::Pipeline base_pipeline);
+
+        /*!
+         * \brief Hashes everything that `compile_pipeline_state` bakes into a PSO, except for the renderpass
+         *
+         * Pipelines with equal hashes can share a PSO within a renderpass. Names and fallbacks don't change the PSO, so they aren't hashed
+         */
+        [[nodiscard]] Sha256Digest hash_pipeline_state(const VulkanPipeline& pipeline) const;
+
+        /*!
+         * \brief Finds the PSO for a pipeline's state, compiling it if no other pipeline in the renderpass has the same state, and puts it
+         * in one of the renderpass's caches
+         *
+         * Takes the renderpass's `pipelines_mutex` itself, but doesn't hold it while compiling. The PSO goes into the cache while the
+         * mutex is still held, so that the PSO is always either in a cache or unknown to other threads
+         *
+         * \param pipeline The pipeline to find a PSO for
+         * \param renderpass The renderpass that the PSO renders in
+         * \param derive_from_parent If true, derive the new PSO from the pipeline's parent if the parent is already in the renderpass's
+         * cache. The parent's PSO must stay alive until we're done, so don't derive from parents that may be recompiled meanwhile
+         * \param is_recompile If true, put the PSO in `uninstalled_pipelines` so that it waits to be installed. Otherwise, put it in
+         * `cached_pipelines` so that command lists use it right away
+         *
+         * \return The pipeline's PSO, or an empty optional if we couldn't compile one
+         */
+        [[nodiscard]] std::optional<vk::Pipeline> get_or_compile_pso(const VulkanPipeline& pipeline,
+                                                                     VulkanRenderpass& renderpass,
+                                                                     bool derive_from_parent,
+                                                                     bool is_recompile);
+
+        /*!
+         * \brief Checks if any of a renderpass's pipelines still use a PSO. Must be called with the renderpass's `pipelines_mutex` held
+         */
+        [[nodiscard]] static bool is_pso_in_use(const VulkanRenderpass& renderpass, vk::Pipeline pso);
+
+        /*!
+         * \brief Forgets which state a PSO was made from, so that no new pipelines share it. Must be called with the renderpass's
+         * `pipelines_mutex` held
+         */
+        static void forget_pso(VulkanRenderpass& renderpass, vk::Pipeline pso);
 
         [[nodiscard]] std::optional<vk::DescriptorPool> create_descriptor_pool(
             const std::unordered_map<DescriptorType, uint32_t>& descriptor_capacity);
 
         /*!
-         * \brief Gets the next available descriptor set for the standard pipeline layout
+         * \brief Brings the given frame's standard descriptor set up to date, and returns it
          *
-         * If there are no free descriptor sets for the standard pipeline layout, this method creates a new one
+         * Only the buffer and sampler bindings which are different from the last time this frame's set was updated are written, along
+         * with any texture table slots that changed since then. Must be called after waiting for the frame's fence, since the buffer and
+         * sampler bindings aren't update-after-bind
+         *
+         * \param frame_idx The frame to update the standard set for
+         * \param bindings The buffers and samplers that should be in the set
+         * \param arena Arena to allocate temporary memory from. May be nullptr
          */
-        [[nodiscard]] vk::DescriptorSet get_next_standard_descriptor_set();
+        [[nodiscard]] vk::DescriptorSet update_standard_descriptor_set(uint32_t frame_idx,
+                                                                       const StandardSetBindings& bindings,
+                                                                       mem::FrameArena* arena);
 
         /*!
-         * \brief Lets the render device know that all the provided descriptor sets are no longer in use by the GPU and can be used for
-         * whatever
+         * \brief Allocates descriptor sets which live until they're freed with `free_descriptors`
+         *
+         * \param descriptor_counts Total number of descriptors of each type in all the sets, see
+         * `VulkanDescriptorAllocator::allocate_persistent`
          */
-        void return_standard_descriptor_sets(const std::vector<vk::DescriptorSet>& sets);
+        [[nodiscard]] std::vector<vk::DescriptorSet> create_descriptors(const std::vector<vk::DescriptorSetLayout>& descriptor_set_layouts,
+                                                                        const std::vector<uint32_t>& variable_descriptor_max_counts,
+                                                                        std::span<const vk::DescriptorPoolSize> descriptor_counts) const;
 
-        std::vector<vk::DescriptorSet> create_descriptors(const std::vector<vk::DescriptorSetLayout>& descriptor_set_layouts,
-                                                          const std::vector<uint32_t>& variable_descriptor_max_counts) const;
+        /*!
+         * \brief Frees descriptor sets from `create_descriptors` once the in-flight frames are done with them
+         */
+        void free_descriptors(std::span<const vk::DescriptorSet> sets) const;
 
         [[nodiscard]] vk::Fence get_next_submission_fence();
 
@@ -205,6 +376,16 @@ namespace nova::renderer::rhi {
 
         VmaAllocator vma;
 
+        /*!
+         * \brief Counts up every frame. VMA refreshes its heap budgets when this changes
+         */
+        uint32_t vma_frame_index = 0;
+
+        /*!
+         * \brief Bytes allocated for each `MemoryCategory`. Atomic since resources may be created and destroyed from any thread
+         */
+        std::array<std::atomic<size_t>, NUM_MEMORY_CATEGORIES> memory_usage_per_category = {};
+
         /*!
          * The index in the vector is the thread index, the key in the map is the queue family index
          */
@@ -214,6 +395,90 @@ namespace nova::renderer::rhi {
 
         std::vector<vk::Fence> submission_fences;
 
+        /*!
+         * \brief Guards the texture table and the dirty slot lists, since textures may be created on a different thread than the one
+         * which renders
+         */
+        std::mutex texture_table_mutex;
+
+        struct SamplerCreateInfoHasher {
+            size_t operator()(const RhiSamplerCreateInfo& info) const;
+        };
+
+        struct CachedSampler {
+            VulkanSampler* sampler;
+
+            /*!
+             * \brief How many calls to `create_sampler` returned this sampler without a matching `destroy_sampler`
+             */
+            uint32_t ref_count;
+        };
+
+        /*!
+         * \brief Guards the sampler cache, since any thread can create samplers
+         */
+        std::mutex sampler_cache_mutex;
+
+        /*!
+         * \brief Every live sampler, keyed by the create info it was made from
+         */
+        std::unordered_map<RhiSamplerCreateInfo, CachedSampler, SamplerCreateInfoHasher> sampler_cache;
+
+        /*!
+         * \brief Lets `destroy_sampler` find a sampler's cache entry
+         */
+        std::unordered_map<VulkanSampler*, RhiSamplerCreateInfo> sampler_create_infos;
+
+        /*!
+         * \brief Guards the views of every image's subresource ranges
+         */
+        std::mutex image_view_mutex;
+
+        /*!
+         * \brief The image view in each slot of the bindless texture table
+         */
+        std::vector<vk::ImageView> texture_table;
+
+        /*!
+         * \brief Slots in the texture table that changed since each frame's standard set was last updated
+         */
+        std::vector<std::vector<uint32_t>> dirty_texture_slots_per_frame;
+
+        /*!
+         * \brief What each frame's standard set was last written with. Empty if the set hasn't been written yet
+         */
+        std::vector<std::optional<StandardSetBindings>> standard_set_bindings_per_frame;
+
+        /*!
+         * \brief Guards the pipeline layout cache, since pipelines are created on the worker pool
+         */
+        std::mutex pipeline_layout_cache_mutex;
+
+        /*!
+         * \brief Every pipeline layout we've made, keyed by a hash of its bindings and push constants
+         *
+         * Pipelines whose shaders use the same resources share a layout, so binding one after the other keeps the bound descriptor sets
+         * and push constants
+         */
+        std::map<Sha256Digest, VulkanPipelineLayoutInfo> pipeline_layout_cache;
+
+        struct RetiredPipeline {
+            vk::Pipeline pipeline;
+
+            uint32_t frames_until_destroyed;
+        };
+
+        /*!
+         * \brief Pipelines which recompiled pipelines replaced. In-flight frames may still use them, so we wait for those frames to finish
+         * before destroying them. Only touched on the render thread, by `install_recompiled_pipeline` and `begin_frame`
+         */
+        std::vector<RetiredPipeline> retired_pipelines;
+
+        /*!
+         * \brief Destroys the retired pipelines that no in-flight frame can be using anymore
+         */
+        void destroy_retired_pipelines();
+
 #pragma region Initialization
         std::vector<const char*> enabled_layer_names;
 
@@ -240,6 +505,8 @@ namespace nova::renderer::rhi {
 
         void create_standard_pipeline_layout();
 
+        void create_standard_descriptor_sets();
+
         [[nodiscard]] std::unordered_map<uint32_t, vk::CommandPool> make_new_command_pools() const;
 #pragma endregion
 
@@ -261,17 +528,7 @@ namespace nova::renderer::rhi {
 
         [[nodiscard]] std::optional<vk::ShaderModule> create_shader_module(const std::vector<uint32_t>& spirv) const;
 
-        /*!
-         * \brief Gets the image view associated with the given image
-         *
-         * Nova simplifies things a lot and only has one image view for each image. This is maintained within the
-         * Vulkan backend, since neither DX12 nor OpenGL have a direct equivalent. I may or may not emulate image views
-         * for those APIs if the demand is there, but idk
-         *
-         * The method checks an internal hash map. If there's already an image view for the given image then great,
-         * otherwise one is created on-demand
-         */
-        [[nodiscard]] static vk::ImageView image_view_for_image(const RhiImage* image);
+        [[nodiscard]] vk::ImageView create_image_view(const VulkanImage& image, const RhiImageRange& range, vk::Format format) const;
 
         [[nodiscard]] static vk::CommandBufferLevel to_vk_command_buffer_level(RhiRenderCommandList::Level level);
 
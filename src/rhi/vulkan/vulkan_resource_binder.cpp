@@ -1,7 +1,8 @@
 #include "vulkan_resource_binder.hpp"
 
-#include <rx/core/algorithm/max.h>
-#include <rx/core/log.h>
+#include <Tracy.hpp>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
 
 #include "nova_renderer/rhi/rhi_types.hpp"
 
@@ -10,174 +11,219 @@
 #include "vulkan_utils.hpp"
 
 namespace nova::renderer::rhi {
-    RX_LOG("VulkanResourceBinder", logger);
-
-    template <typename ResourceType>
-    void bind_resource_array(const std::string& binding_name,
-                             const std::vector<ResourceType*>& resources,
-                             std::unordered_map<std::string, std::vector<ResourceType*>>& bound_resources);
+    static auto logger = spdlog::stdout_color_mt("VulkanResourceBinder");
 
     VulkanResourceBinder::VulkanResourceBinder(VulkanRenderDevice& device,
-                                               std::unordered_map<std::string, RhiResourceBindingDescription> bindings,
-                                               std::vector<vk::DescriptorSet> sets,
-                                               vk::PipelineLayout layout,
-                                               rx::memory::allocator& allocator)
+                                               const std::unordered_map<std::string, RhiResourceBindingDescription>& bindings,
+                                               std::vector<vk::DescriptorSetLayout> set_layouts,
+                                               std::vector<std::vector<vk::DescriptorSet>> sets_per_frame,
+                                               const vk::PipelineLayout layout)
         : render_device{&device},
-          allocator{&allocator},
           layout{layout},
-          sets{std::move(sets)},
-          bindings{std::move(bindings)},
-          bound_images{&allocator},
-          bound_buffers{&allocator},
-          bound_samplers{&allocator} {}
+          set_layouts{std::move(set_layouts)},
+          sets_per_frame{std::move(sets_per_frame)},
+          all_frames_mask{(1u << this->sets_per_frame.size()) - 1} {
+        ZoneScoped;
+        descriptors.reserve(bindings.size());
+
+        for(const auto& [name, binding] : bindings) {
+            BoundDescriptor descriptor = {};
+            descriptor.description = binding;
+            descriptor.type = to_vk_descriptor_type(binding.type);
+
+            // Unbounded arrays don't know how many descriptors they'll have until something's bound to them
+            if(!binding.is_unbounded) {
+                update_template_count(descriptor, binding.count);
+            }
+
+            descriptors.emplace(name, std::move(descriptor));
+        }
+    }
+
+    VulkanResourceBinder::~VulkanResourceBinder() {
+        for(auto& [name, descriptor] : descriptors) {
+            destroy_template(descriptor);
+        }
+
+        for(const auto& sets : sets_per_frame) {
+            render_device->free_descriptors(sets);
+        }
+    }
 
     void VulkanResourceBinder::bind_image(const std::string& binding_name, RhiImage* image) {
-        bind_image_array(binding_name, {allocator, std::array{image}});
+        bind_image_array(binding_name, std::vector{image});
     }
 
     void VulkanResourceBinder::bind_buffer(const std::string& binding_name, RhiBuffer* buffer) {
-        bind_buffer_array(binding_name, {allocator, std::array{buffer}});
+        bind_buffer_array(binding_name, std::vector{buffer});
     }
 
     void VulkanResourceBinder::bind_sampler(const std::string& binding_name, RhiSampler* sampler) {
-        bind_sampler_array(binding_name, {allocator, std::array{sampler}});
+        bind_sampler_array(binding_name, std::vector{sampler});
     }
 
     void VulkanResourceBinder::bind_image_array(const std::string& binding_name, const std::vector<RhiImage*>& images) {
-        bind_resource_array(binding_name, images, bound_images);
+        auto* descriptor = find_descriptor(binding_name);
+        if(descriptor == nullptr) {
+            return;
+        }
 
-        dirty = true;
+        std::vector<vk::DescriptorImageInfo> image_infos;
+        image_infos.reserve(images.size());
+
+        for(const RhiImage* image : images) {
+            const auto* vk_image = static_cast<const VulkanImage*>(image);
+            image_infos.emplace_back(
+                vk::DescriptorImageInfo().setImageView(vk_image->image_view).setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal));
+        }
+
+        set_image_infos(*descriptor, std::move(image_infos));
     }
 
     void VulkanResourceBinder::bind_buffer_array(const std::string& binding_name, const std::vector<RhiBuffer*>& buffers) {
+        auto* descriptor = find_descriptor(binding_name);
+        if(descriptor == nullptr) {
+            return;
+        }
+
 #if NOVA_DEBUG
-        buffers.each_fwd([&](const RhiBuffer* buffer) {
-            if(buffer->size > render_device->gpu.props.limits.maxUniformBufferRange) {
-                logger->error("Cannot bind a buffer with a size greater than %u", render_device->gpu.props.limits.maxUniformBufferRange);
+        if(descriptor->type == vk::DescriptorType::eUniformBuffer) {
+            for(const RhiBuffer* buffer : buffers) {
+                if(buffer->size > render_device->gpu.props.limits.maxUniformBufferRange) {
+                    logger->error("Cannot bind a buffer with a size greater than {}", render_device->gpu.props.limits.maxUniformBufferRange);
+                }
             }
-        });
+        }
 #endif
 
-        bind_resource_array(binding_name, buffers, bound_buffers);
+        std::vector<vk::DescriptorBufferInfo> buffer_infos;
+        buffer_infos.reserve(buffers.size());
 
-        dirty = true;
+        for(const RhiBuffer* buffer : buffers) {
+            const auto* vk_buffer = static_cast<const VulkanBuffer*>(buffer);
+            buffer_infos.emplace_back(vk::DescriptorBufferInfo().setBuffer(vk_buffer->buffer).setOffset(0).setRange(vk_buffer->size.b_count()));
+        }
+
+        if(buffer_infos != descriptor->buffer_infos) {
+            descriptor->buffer_infos = std::move(buffer_infos);
+            update_template_count(*descriptor, static_cast<uint32_t>(buffers.size()));
+            descriptor->dirty_frames = all_frames_mask;
+        }
     }
 
     void VulkanResourceBinder::bind_sampler_array(const std::string& binding_name, const std::vector<RhiSampler*>& samplers) {
-        bind_resource_array(binding_name, samplers, bound_samplers);
+        auto* descriptor = find_descriptor(binding_name);
+        if(descriptor == nullptr) {
+            return;
+        }
+
+        std::vector<vk::DescriptorImageInfo> sampler_infos;
+        sampler_infos.reserve(samplers.size());
 
-        dirty = true;
+        for(const RhiSampler* sampler : samplers) {
+            const auto* vk_sampler = static_cast<const VulkanSampler*>(sampler);
+            sampler_infos.emplace_back(vk::DescriptorImageInfo().setSampler(vk_sampler->sampler));
+        }
+
+        set_image_infos(*descriptor, std::move(sampler_infos));
+    }
+
+    void VulkanResourceBinder::bind_image_range(const std::string& binding_name, RhiImage* image, const RhiImageRange& range) {
+        auto* descriptor = find_descriptor(binding_name);
+        if(descriptor == nullptr) {
+            return;
+        }
+
+        auto* vk_image = static_cast<VulkanImage*>(image);
+        const auto view = render_device->get_image_view(*vk_image, range, vk_image->format);
+
+        set_image_infos(*descriptor,
+                        {vk::DescriptorImageInfo().setImageView(view).setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal)});
     }
 
     vk::PipelineLayout VulkanResourceBinder::get_layout() const { return layout; }
 
-    const std::vector<vk::DescriptorSet>& VulkanResourceBinder::get_sets() {
-        if(dirty) {
-            update_all_descriptors();
+    const std::vector<vk::DescriptorSet>& VulkanResourceBinder::get_sets(const uint32_t frame_idx) {
+        ZoneScoped;
+        const auto& sets = sets_per_frame[frame_idx];
+        const auto frame_bit = 1u << frame_idx;
+
+        for(auto& [name, descriptor] : descriptors) {
+            if((descriptor.dirty_frames & frame_bit) == 0 || !descriptor.update_template) {
+                continue;
+            }
+
+            const void* data = descriptor.buffer_infos.empty() ? static_cast<const void*>(descriptor.image_infos.data()) :
+                                                                 static_cast<const void*>(descriptor.buffer_infos.data());
+            render_device->device.updateDescriptorSetWithTemplate(sets[descriptor.description.set], descriptor.update_template, data);
+
+            descriptor.dirty_frames &= ~frame_bit;
         }
 
         return sets;
     }
 
-    void VulkanResourceBinder::update_all_descriptors() {
-        std::vector<vk::WriteDescriptorSet> writes{allocator};
-        writes.reserve(bound_images.size() + bound_samplers.size() + bound_buffers.size());
-
-        std::vector<std::vector<vk::DescriptorImageInfo>> all_image_infos{allocator};
-        all_image_infos.reserve(bound_images.size() + bound_samplers.size());
-
-        std::vector < std::vector<vk::DescriptorBufferInfo>> all_buffer_infos{allocator};
-        all_buffer_infos.reserve(bound_buffers.size());
-
-        bound_images.each_pair([&](const std::string& name, const std::vector<RhiImage*>& images) {
-            const auto& binding = *bindings.find(name);
-            const auto set = sets[binding.set];
-
-            std::vector<vk::DescriptorImageInfo> image_infos{allocator};
-            image_infos.reserve(images.size());
-
-            images.each_fwd([&](const RhiImage* image) {
-                const auto* vk_image = static_cast<const VulkanImage*>(image);
-                auto image_info = vk::DescriptorImageInfo()
-                                      .setImageView(vk_image->image_view)
-                                      .setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal);
-                image_infos.push_back(std::move(image_info));
-            });
-
-            all_image_infos.push_back(std::move(image_infos));
-
-            auto write = vk::WriteDescriptorSet()
-                             .setDstSet(set)
-                             .setDstBinding(binding.binding)
-                             .setDstArrayElement(0)
-                             .setDescriptorCount(static_cast<uint32_t>(images.size()))
-                             .setDescriptorType(vk::DescriptorType::eSampledImage)
-                             .setPImageInfo(all_image_infos.last().data());
-            writes.push_back(std::move(write));
-        });
-
-        bound_samplers.each_pair([&](const std::string& name, const std::vector<RhiSampler*>& samplers) {
-            const auto& binding = *bindings.find(name);
-            const auto set = sets[binding.set];
-
-            std::vector<vk::DescriptorImageInfo> sampler_infos{allocator};
-            sampler_infos.reserve(samplers.size());
-
-            samplers.each_fwd([&](const RhiSampler* sampler) {
-                const auto* vk_sampler = static_cast<const VulkanSampler*>(sampler);
-                auto sampler_info = vk::DescriptorImageInfo().setSampler(vk_sampler->sampler);
-                sampler_infos.push_back(std::move(sampler_info));
-            });
-
-            all_image_infos.push_back(std::move(sampler_infos));
-
-            auto write = vk::WriteDescriptorSet()
-                             .setDstSet(set)
-                             .setDstBinding(binding.binding)
-                             .setDstArrayElement(0)
-                             .setDescriptorCount(static_cast<uint32_t>(samplers.size()))
-                             .setDescriptorType(vk::DescriptorType::eSampler)
-                             .setPImageInfo(all_image_infos.last().data());
-            writes.push_back(std::move(write));
-        });
-
-        bound_buffers.each_pair([&](const std::string& name, const std::vector<RhiBuffer*>& buffers) {
-            const auto& binding = *bindings.find(name);
-            const auto set = sets[binding.set];
-
-            std::vector<vk::DescriptorBufferInfo> buffer_infos{allocator};
-            buffer_infos.reserve(buffers.size());
-
-            buffers.each_fwd([&](const RhiBuffer* buffer) {
-                const auto* vk_buffer = static_cast<const VulkanBuffer*>(buffer);
-                auto buffer_info = vk::DescriptorBufferInfo().setBuffer(vk_buffer->buffer).setOffset(0).setRange(vk_buffer->size.b_count());
-                buffer_infos.push_back(std::move(buffer_info));
-            });
-
-            all_buffer_infos.push_back(std::move(buffer_infos));
-
-            auto write = vk::WriteDescriptorSet()
-                             .setDstSet(set)
-                             .setDstBinding(binding.binding)
-                             .setDstArrayElement(0)
-                             .setDescriptorCount(static_cast<uint32_t>(buffers.size()))
-                             .setDescriptorType(vk::DescriptorType::eUniformBuffer)
-                             .setPBufferInfo(all_buffer_infos.last().data());
-            writes.push_back(std::move(write));
-        });
-
-        render_device->device.updateDescriptorSets(static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    VulkanResourceBinder::BoundDescriptor* VulkanResourceBinder::find_descriptor(const std::string& binding_name) {
+        if(const auto itr = descriptors.find(binding_name); itr != descriptors.end()) {
+            return &itr->second;
+        }
+
+        logger->error("Pipeline has no binding named {}", binding_name);
+        return nullptr;
+    }
+
+    void VulkanResourceBinder::set_image_infos(BoundDescriptor& descriptor, std::vector<vk::DescriptorImageInfo> image_infos) {
+        if(image_infos != descriptor.image_infos) {
+            const auto count = static_cast<uint32_t>(image_infos.size());
+            descriptor.image_infos = std::move(image_infos);
+            update_template_count(descriptor, count);
+            descriptor.dirty_frames = all_frames_mask;
+        }
     }
 
-    template <typename ResourceType>
-    void bind_resource_array(const std::string& binding_name,
-                             const std::vector<ResourceType*>& resources,
-                             std::unordered_map<std::string, std::vector<ResourceType*>>& bound_resources) {
-        if(auto* bound_data = bound_resources.find(binding_name)) {
-            *bound_data = resources;
+    void VulkanResourceBinder::update_template_count(BoundDescriptor& descriptor, const uint32_t count) const {
+        if(count == descriptor.template_count && descriptor.update_template) {
+            return;
+        }
+
+        destroy_template(descriptor);
+
+        if(count == 0) {
+            return;
+        }
+
+        const auto is_buffer = descriptor.type == vk::DescriptorType::eUniformBuffer ||
+                               descriptor.type == vk::DescriptorType::eStorageBuffer;
+        const auto stride = is_buffer ? sizeof(vk::DescriptorBufferInfo) : sizeof(vk::DescriptorImageInfo);
+
+        const auto entry = vk::DescriptorUpdateTemplateEntry()
+                               .setDstBinding(descriptor.description.binding)
+                               .setDstArrayElement(0)
+                               .setDescriptorCount(count)
+                               .setDescriptorType(descriptor.type)
+                               .setOffset(0)
+                               .setStride(stride);
+
+        const auto create_info = vk::DescriptorUpdateTemplateCreateInfo()
+                                     .setDescriptorUpdateEntryCount(1)
+                                     .setPDescriptorUpdateEntries(&entry)
+                                     .setTemplateType(vk::DescriptorUpdateTemplateType::eDescriptorSet)
+                                     .setDescriptorSetLayout(set_layouts[descriptor.description.set])
+                                     .setPipelineBindPoint(vk::PipelineBindPoint::eGraphics)
+                                     .setPipelineLayout(layout)
+                                     .setSet(descriptor.description.set);
+
+        render_device->device.createDescriptorUpdateTemplate(&create_info,
+                                                             &render_device->vk_internal_allocator,
+                                                             &descriptor.update_template);
+        descriptor.template_count = count;
+    }
 
-        } else {
-            bound_resources.insert(binding_name, resources);
+    void VulkanResourceBinder::destroy_template(BoundDescriptor& descriptor) const {
+        if(descriptor.update_template) {
+            render_device->device.destroyDescriptorUpdateTemplate(descriptor.update_template, &render_device->vk_internal_allocator);
+            descriptor.update_template = vk::DescriptorUpdateTemplate{};
+            descriptor.template_count = 0;
         }
     }
 } // namespace nova::renderer::rhi
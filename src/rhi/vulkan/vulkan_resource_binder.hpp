@@ -1,6 +1,5 @@
 #pragma once
 
-#include <rx/core/deferred_function.h>
 #include <vulkan/vulkan.hpp>
 
 #include "nova_renderer/rhi/resource_binder.hpp"
@@ -19,23 +18,34 @@ namespace nova::renderer::rhi {
      * \brief Binding resources in Vulkan!
      *
      * This is basically a thing wrapper around descriptor sets. The constructor creates the descriptor sets, the destructor destroys them
+     *
+     * Each in-flight frame gets its own copy of the descriptor sets, so we never have to write to a set that the GPU might be reading.
+     * Every binding remembers which frames' sets are out of date, and writes itself to a frame's sets with a descriptor update template
+     * the next time that frame asks for them. Binding the same resources that are already bound doesn't dirty anything
      */
     class VulkanResourceBinder final : public RhiResourceBinder {
     public:
 #pragma region Lifecycle
+        /*!
+         * \param device The device to write descriptors with
+         * \param bindings All the bindings in the pipeline layout, from shader reflection
+         * \param set_layouts The layout of each descriptor set
+         * \param sets_per_frame The descriptor sets for each in-flight frame. Each frame must have one set for every set layout
+         * \param layout The pipeline layout that the descriptor sets are for
+         */
         VulkanResourceBinder(VulkanRenderDevice& device,
-                             std::unordered_map<std::string, RhiResourceBindingDescription> bindings,
-                             std::vector<vk::DescriptorSet> sets,
-                             vk::PipelineLayout layout,
-                             rx::memory::allocator& allocator);
+                             const std::unordered_map<std::string, RhiResourceBindingDescription>& bindings,
+                             std::vector<vk::DescriptorSetLayout> set_layouts,
+                             std::vector<std::vector<vk::DescriptorSet>> sets_per_frame,
+                             vk::PipelineLayout layout);
 
         VulkanResourceBinder(const VulkanResourceBinder& other) = delete;
         VulkanResourceBinder& operator=(const VulkanResourceBinder& other) = delete;
 
         VulkanResourceBinder(VulkanResourceBinder&& old) noexcept = default;
-        VulkanResourceBinder& operator=(VulkanResourceBinder&& old) noexcept = default;
+        VulkanResourceBinder& operator=(VulkanResourceBinder&& old) noexcept = delete;
 
-        ~VulkanResourceBinder() override = default;
+        ~VulkanResourceBinder() override;
 #pragma endregion
 
 #pragma region RhiResourceBinder
@@ -50,35 +60,84 @@ namespace nova::renderer::rhi {
         void bind_buffer_array(const std::string& binding_name, const std::vector<RhiBuffer*>& buffers) override;
 
         void bind_sampler_array(const std::string& binding_name, const std::vector<RhiSampler*>& samplers) override;
+
+        void bind_image_range(const std::string& binding_name, RhiImage* image, const RhiImageRange& range) override;
 #pragma endregion
 
         [[nodiscard]] vk::PipelineLayout get_layout() const;
 
-        [[nodiscard]] const std::vector<vk::DescriptorSet>& get_sets();
+        /*!
+         * \brief Gets the descriptor sets for the given frame, writing any bindings that changed since that frame last used them
+         *
+         * Only call this after waiting for the frame's fence
+         */
+        [[nodiscard]] const std::vector<vk::DescriptorSet>& get_sets(uint32_t frame_idx);
 
     private:
-        bool dirty = false;
+        /*!
+         * \brief Everything we need to write one binding to a descriptor set
+         */
+        struct BoundDescriptor {
+            RhiResourceBindingDescription description;
 
-        VulkanRenderDevice* render_device;
+            vk::DescriptorType type;
+
+            /*!
+             * \brief Template which writes `template_count` descriptors to this binding from `image_infos` or `buffer_infos`
+             */
+            vk::DescriptorUpdateTemplate update_template;
+
+            uint32_t template_count = 0;
 
-        rx::memory::allocator* allocator;
+            std::vector<vk::DescriptorImageInfo> image_infos;
+
+            std::vector<vk::DescriptorBufferInfo> buffer_infos;
+
+            /*!
+             * \brief Bitmask of the frames whose descriptor sets don't have the current value of this binding
+             */
+            uint32_t dirty_frames = 0;
+        };
+
+        VulkanRenderDevice* render_device;
 
         /*!
          * \brief Layout for pipelines that can access this binder's resources
          */
         vk::PipelineLayout layout;
 
+        std::vector<vk::DescriptorSetLayout> set_layouts;
+
         /*!
-         * \brief Descriptor sets for this binder
+         * \brief Descriptor sets for this binder, for each in-flight frame
          */
-        std::vector<vk::DescriptorSet> sets;
+        std::vector<std::vector<vk::DescriptorSet>> sets_per_frame;
 
-        std::unordered_map<std::string, RhiResourceBindingDescription> bindings;
+        /*!
+         * \brief Bitmask with a bit set for every in-flight frame
+         */
+        uint32_t all_frames_mask;
 
-        std::unordered_map<std::string, std::vector<RhiImage*>> bound_images;
-        std::unordered_map<std::string, std::vector<RhiBuffer*>> bound_buffers;
-        std::unordered_map<std::string, std::vector<RhiSampler*>> bound_samplers;
+        std::unordered_map<std::string, BoundDescriptor> descriptors;
+
+        /*!
+         * \brief Finds the descriptor for a binding, logging an error if there isn't one
+         */
+        [[nodiscard]] BoundDescriptor* find_descriptor(const std::string& binding_name);
+
+        /*!
+         * \brief Sets the image descriptors of a binding, dirtying it if they changed
+         */
+        void set_image_infos(BoundDescriptor& descriptor, std::vector<vk::DescriptorImageInfo> image_infos);
+
+        /*!
+         * \brief Makes sure the descriptor's update template writes as many descriptors as the descriptor holds
+         *
+         * Templates are created up front from the reflection data. This only does anything when an array binding gets a different
+         * number of resources than the template was made for
+         */
+        void update_template_count(BoundDescriptor& descriptor, uint32_t count) const;
 
-        void update_all_descriptors();
+        void destroy_template(BoundDescriptor& descriptor) const;
     };
 } // namespace nova::renderer::rhi
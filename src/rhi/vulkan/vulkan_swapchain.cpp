@@ -1,5 +1,7 @@
 #include "vulkan_swapchain.hpp"
 
+#include <array>
+
 #include <rx/core/log.h>
 
 #include "Tracy.hpp"
@@ -43,19 +45,31 @@ namespace nova::renderer::rhi {
 
         // move the swapchain images into the correct layout cause I guess they aren't for some reason?
         transition_swapchain_images_into_color_attachment_layout(vk_images);
-    }
 
-    uint8_t VulkanSwapchain::acquire_next_swapchain_image(rx::memory::allocator& allocator) {
-        ZoneScoped;        auto* fence = render_device->create_fence(false, allocator);
-        auto* vk_fence = static_cast<VulkanFence*>(fence);
+        vk::FenceCreateInfo fence_create_info = {};
+        fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        acquire_fence = new VulkanFence;
+        vkCreateFence(render_device->device, &fence_create_info, nullptr, &acquire_fence->fence);
+    }
 
+    uint8_t VulkanSwapchain::acquire_next_swapchain_image(rx::memory::allocator& /* allocator */) {
+        ZoneScoped;
         uint32_t acquired_image_idx;
         const auto acquire_result = vkAcquireNextImageKHR(render_device->device,
                                                           swapchain,
                                                           std::numeric_limits<uint64_t>::max(),
                                                           VK_NULL_HANDLE,
-                                                          vk_fence->fence,
+                                                          acquire_fence->fence,
                                                           &acquired_image_idx);
+
+        // The fence is only signaled if we got an image. Block until we have it in order to mimic D3D12, then reset the fence so the next
+        // frame can use it again. TODO: Reevaluate this decision
+        if(acquire_result == VK_SUCCESS || acquire_result == VK_SUBOPTIMAL_KHR) {
+            const std::array<RhiFence*, 1> acquire_fences = {acquire_fence};
+            render_device->wait_for_fences(acquire_fences);
+            render_device->reset_fences(acquire_fences);
+        }
+
         if(acquire_result == VK_ERROR_OUT_OF_DATE_KHR || acquire_result == VK_SUBOPTIMAL_KHR) {
             // TODO: Recreate the swapchain and all screen-relative textures
             logger->error("Swapchain out of date! One day you'll write the code to recreate it");
@@ -65,13 +79,6 @@ namespace nova::renderer::rhi {
             logger->error("%s:%u=>%s", __FILE__, __LINE__, to_string(acquire_result));
         }
 
-        // Block until we have the swapchain image in order to mimic D3D12. TODO: Reevaluate this decision
-        std::vector<RhiFence*> fences;
-        fences.push_back(vk_fence);
-        render_device->wait_for_fences(fences);
-
-        render_device->destroy_fences(fences, allocator);
-
         return static_cast<uint8_t>(acquired_image_idx);
     }
 
@@ -191,6 +198,10 @@ namespace nova::renderer::rhi {
             delete f;
         });
         fences.clear();
+
+        vkDestroyFence(render_device->device, acquire_fence->fence, nullptr);
+        delete acquire_fence;
+        acquire_fence = nullptr;
     }
 
     uint32_t VulkanSwapchain::get_num_images() const { return num_swapchain_images; }
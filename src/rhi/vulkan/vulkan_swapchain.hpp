@@ -10,6 +10,7 @@ namespace nova::renderer::rhi {
     struct RhiFence;
     struct RhiFramebuffer;
     struct RhiImage;
+    struct VulkanFence;
 
     class VulkanRenderDevice;
 
@@ -55,6 +56,11 @@ namespace nova::renderer::rhi {
 
         uint32_t num_swapchain_images;
 
+        /*!
+         * \brief Signaled when the swapchain image we asked for is ready. Reused every frame, so acquiring an image doesn't create a fence
+         */
+        VulkanFence* acquire_fence = nullptr;
+
 #pragma region Initialization
         static vk::SurfaceFormatKHR choose_surface_format(const std::vector<vk::SurfaceFormatKHR>& formats);
 
@@ -257,6 +257,45 @@ namespace nova::renderer::rhi {
             case PixelFormat::Depth24Stencil8:
                 return VK_FORMAT_D24_UNORM_S8_UINT;
 
+            case PixelFormat::Rgba8Srgb:
+                return VK_FORMAT_R8G8B8A8_SRGB;
+
+            case PixelFormat::Bc1Rgba:
+                return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+
+            case PixelFormat::Bc1RgbaSrgb:
+                return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+
+            case PixelFormat::Bc2Rgba:
+                return VK_FORMAT_BC2_UNORM_BLOCK;
+
+            case PixelFormat::Bc2RgbaSrgb:
+                return VK_FORMAT_BC2_SRGB_BLOCK;
+
+            case PixelFormat::Bc3Rgba:
+                return VK_FORMAT_BC3_UNORM_BLOCK;
+
+            case PixelFormat::Bc3RgbaSrgb:
+                return VK_FORMAT_BC3_SRGB_BLOCK;
+
+            case PixelFormat::Bc4R:
+                return VK_FORMAT_BC4_UNORM_BLOCK;
+
+            case PixelFormat::Bc5Rg:
+                return VK_FORMAT_BC5_UNORM_BLOCK;
+
+            case PixelFormat::Bc6hRgbUfloat:
+                return VK_FORMAT_BC6H_UFLOAT_BLOCK;
+
+            case PixelFormat::Bc6hRgbSfloat:
+                return VK_FORMAT_BC6H_SFLOAT_BLOCK;
+
+            case PixelFormat::Bc7Rgba:
+                return VK_FORMAT_BC7_UNORM_BLOCK;
+
+            case PixelFormat::Bc7RgbaSrgb:
+                return VK_FORMAT_BC7_SRGB_BLOCK;
+
             default:
                 logger->error("Unknown pixel format, returning RGBA8");
                 return VK_FORMAT_R8G8B8A8_UNORM;
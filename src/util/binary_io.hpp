@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <vector>
+
+namespace nova::renderer {
+    /*!
+     * \brief Reads values out of a blob of bytes, and fails gracefully if the blob is too short
+     */
+    class BinaryReader {
+    public:
+        explicit BinaryReader(const std::vector<uint8_t>& data) : data{data} {}
+
+        template <typename ValueType>
+        [[nodiscard]] std::optional<ValueType> read() {
+            ValueType value;
+            if(!read_bytes(&value, sizeof(ValueType))) {
+                return std::nullopt;
+            }
+
+            return value;
+        }
+
+        [[nodiscard]] bool read_bytes(void* dest, const size_t size) {
+            if(data.size() - offset < size) {
+                return false;
+            }
+
+            std::memcpy(dest, data.data() + offset, size);
+            offset += size;
+
+            return true;
+        }
+
+        [[nodiscard]] size_t get_num_remaining_bytes() const { return data.size() - offset; }
+
+    private:
+        const std::vector<uint8_t>& data;
+
+        size_t offset = 0;
+    };
+
+    /*!
+     * \brief Appends the bytes of a trivially copyable value to a blob
+     */
+    template <typename ValueType>
+    void write_value(std::vector<uint8_t>& data, const ValueType& value) {
+        const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+        data.insert(data.end(), bytes, bytes + sizeof(ValueType));
+    }
+} // namespace nova::renderer
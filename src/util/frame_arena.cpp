@@ -0,0 +1,61 @@
+#include "nova_renderer/util/frame_arena.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <new>
+
+#include <Tracy.hpp>
+
+namespace nova::mem {
+    FrameArena::FrameArena(const Bytes size) : memory{std::make_unique<std::byte[]>(size.b_count())}, capacity{size.b_count()} {}
+
+    FrameArena::~FrameArena() { free_heap_allocations(); }
+
+    void* FrameArena::allocate(const size_t num_bytes, const size_t alignment) {
+        num_requested_bytes += num_bytes + alignment - 1;
+
+        // Align the address rather than the offset, since the arena's memory is only aligned to the default new alignment
+        const auto base_address = reinterpret_cast<uintptr_t>(memory.get());
+        const auto aligned_head = ((base_address + head + alignment - 1) & ~(alignment - 1)) - base_address;
+        if(aligned_head + num_bytes <= capacity) {
+            head = aligned_head + num_bytes;
+            return memory.get() + aligned_head;
+        }
+
+        // Out of space. Fall back to the heap for now, and remember to grow when we're reset
+        auto* heap_memory = ::operator new(num_bytes, std::align_val_t{alignment});
+        heap_allocations.push_back({heap_memory, alignment});
+
+        return heap_memory;
+    }
+
+    void FrameArena::reset() {
+        ZoneScoped;
+        if(!heap_allocations.empty()) {
+            free_heap_allocations();
+
+            // Nothing allocated from the arena can be alive after a reset, so this is the one time we can safely reallocate it
+            capacity = std::bit_ceil(std::max(num_requested_bytes, capacity * 2));
+            memory = std::make_unique<std::byte[]>(capacity);
+        }
+
+        head = 0;
+        num_requested_bytes = 0;
+    }
+
+    Bytes FrameArena::get_num_allocated_bytes() const { return num_requested_bytes; }
+
+    Bytes FrameArena::get_capacity() const { return capacity; }
+
+    size_t FrameArena::get_num_heap_allocations() const { return heap_allocations.size(); }
+
+    void FrameArena::free_heap_allocations() {
+        for(const auto& [heap_memory, alignment] : heap_allocations) {
+            ::operator delete(heap_memory, std::align_val_t{alignment});
+        }
+
+        // clear() keeps the vector's capacity, so the next overflow doesn't need to grow it again
+        heap_allocations.clear();
+    }
+} // namespace nova::mem
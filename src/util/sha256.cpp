@@ -0,0 +1,126 @@
+#include "sha256.hpp"
+
+#include <algorithm>
+
+namespace nova::renderer {
+    constexpr std::array<uint32_t, 64> ROUND_CONSTANTS = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be,
+        0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa,
+        0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85,
+        0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+        0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f,
+        0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+    static uint32_t rotate_right(const uint32_t value, const uint32_t amount) { return (value >> amount) | (value << (32 - amount)); }
+
+    Sha256::Sha256() : state{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19}, block{} {}
+
+    void Sha256::update(const std::span<const uint8_t> data) {
+        total_size += data.size();
+
+        for(const auto byte : data) {
+            block[block_size] = byte;
+            block_size++;
+
+            if(block_size == block.size()) {
+                process_block();
+                block_size = 0;
+            }
+        }
+    }
+
+    void Sha256::update(const std::string_view data) {
+        update(std::span{reinterpret_cast<const uint8_t*>(data.data()), data.size()});
+    }
+
+    void Sha256::update_with_length(const std::string_view data) {
+        update_value(static_cast<uint64_t>(data.size()));
+        update(data);
+    }
+
+    Sha256Digest Sha256::finish() {
+        const auto total_bits = total_size * 8;
+
+        // Pad with a single 1 bit, then zeros until there's just enough room for the length at the end of a block
+        block[block_size] = 0x80;
+        block_size++;
+
+        if(block_size > 56) {
+            std::fill(block.begin() + block_size, block.end(), uint8_t{0});
+            process_block();
+            block_size = 0;
+        }
+
+        std::fill(block.begin() + block_size, block.begin() + 56, uint8_t{0});
+        for(uint32_t i = 0; i < 8; i++) {
+            block[63 - i] = static_cast<uint8_t>(total_bits >> (i * 8));
+        }
+        process_block();
+
+        Sha256Digest digest;
+        for(uint32_t i = 0; i < state.size(); i++) {
+            digest[i * 4 + 0] = static_cast<uint8_t>(state[i] >> 24);
+            digest[i * 4 + 1] = static_cast<uint8_t>(state[i] >> 16);
+            digest[i * 4 + 2] = static_cast<uint8_t>(state[i] >> 8);
+            digest[i * 4 + 3] = static_cast<uint8_t>(state[i]);
+        }
+
+        return digest;
+    }
+
+    void Sha256::process_block() {
+        std::array<uint32_t, 64> schedule;
+        for(uint32_t i = 0; i < 16; i++) {
+            schedule[i] = (static_cast<uint32_t>(block[i * 4]) << 24) | (static_cast<uint32_t>(block[i * 4 + 1]) << 16) |
+                          (static_cast<uint32_t>(block[i * 4 + 2]) << 8) | static_cast<uint32_t>(block[i * 4 + 3]);
+        }
+
+        for(uint32_t i = 16; i < 64; i++) {
+            const auto s0 = rotate_right(schedule[i - 15], 7) ^ rotate_right(schedule[i - 15], 18) ^ (schedule[i - 15] >> 3);
+            const auto s1 = rotate_right(schedule[i - 2], 17) ^ rotate_right(schedule[i - 2], 19) ^ (schedule[i - 2] >> 10);
+            schedule[i] = schedule[i - 16] + s0 + schedule[i - 7] + s1;
+        }
+
+        auto [a, b, c, d, e, f, g, h] = state;
+
+        for(uint32_t i = 0; i < 64; i++) {
+            const auto s1 = rotate_right(e, 6) ^ rotate_right(e, 11) ^ rotate_right(e, 25);
+            const auto choice = (e & f) ^ (~e & g);
+            const auto temp1 = h + s1 + choice + ROUND_CONSTANTS[i] + schedule[i];
+            const auto s0 = rotate_right(a, 2) ^ rotate_right(a, 13) ^ rotate_right(a, 22);
+            const auto majority = (a & b) ^ (a & c) ^ (b & c);
+            const auto temp2 = s0 + majority;
+
+            h = g;
+            g = f;
+            f = e;
+            e = d + temp1;
+            d = c;
+            c = b;
+            b = a;
+            a = temp1 + temp2;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+
+    std::string to_hex_string(const Sha256Digest& digest) {
+        constexpr auto* HEX_DIGITS = "0123456789abcdef";
+
+        std::string hex;
+        hex.reserve(digest.size() * 2);
+        for(const auto byte : digest) {
+            hex.push_back(HEX_DIGITS[byte >> 4]);
+            hex.push_back(HEX_DIGITS[byte & 0xF]);
+        }
+
+        return hex;
+    }
+} // namespace nova::renderer
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace nova::renderer {
+    using Sha256Digest = std::array<uint8_t, 32>;
+
+    /*!
+     * \brief Incremental SHA-256, for when a hash collision would mean using the wrong data
+     *
+     * `std::hash` and FNV are fine for hash tables, but the on-disk caches key their entries by content, and a collision there would hand
+     * back the wrong shader. SHA-256 makes that impossible in practice
+     */
+    class Sha256 {
+    public:
+        Sha256();
+
+        void update(std::span<const uint8_t> data);
+
+        void update(std::string_view data);
+
+        /*!
+         * \brief Hashes a value's bytes. Only use this for types with no padding, like integers
+         */
+        template <typename ValueType>
+        void update_value(const ValueType& value) {
+            update(std::span{reinterpret_cast<const uint8_t*>(&value), sizeof(ValueType)});
+        }
+
+        /*!
+         * \brief Hashes a string's length and then its contents, so that e.g. "ab" + "c" and "a" + "bc" hash differently
+         */
+        void update_with_length(std::string_view data);
+
+        /*!
+         * \brief Finishes hashing and returns the digest. The hasher can't be used after this
+         */
+        [[nodiscard]] Sha256Digest finish();
+
+    private:
+        std::array<uint32_t, 8> state;
+
+        std::array<uint8_t, 64> block;
+
+        size_t block_size = 0;
+
+        uint64_t total_size = 0;
+
+        void process_block();
+    };
+
+    [[nodiscard]] std::string to_hex_string(const Sha256Digest& digest);
+} // namespace nova::renderer
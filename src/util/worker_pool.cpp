@@ -0,0 +1,76 @@
+#include "nova_renderer/util/worker_pool.hpp"
+
+#include <algorithm>
+
+#include <Tracy.hpp>
+
+namespace nova::renderer {
+    WorkerPool::WorkerPool(const uint32_t num_threads) {
+        threads.reserve(num_threads);
+        for(uint32_t i = 0; i < num_threads; i++) {
+            threads.emplace_back([this](const std::stop_token& stop_token) { worker_thread(stop_token); });
+        }
+    }
+
+    WorkerPool::~WorkerPool() {
+        for(auto& thread : threads) {
+            thread.request_stop();
+        }
+        threads.clear();
+    }
+
+    void WorkerPool::submit(std::function<void()> job, const float priority) {
+        {
+            std::lock_guard lock{jobs_mutex};
+            jobs.emplace_back(Job{std::move(job), priority, next_sequence++});
+            std::push_heap(jobs.begin(), jobs.end(), &WorkerPool::runs_after);
+        }
+
+        jobs_cv.notify_one();
+    }
+
+    void WorkerPool::wait_idle() {
+        ZoneScoped;
+        std::unique_lock lock{jobs_mutex};
+        idle_cv.wait(lock, [&] { return jobs.empty() && num_running_jobs == 0; });
+    }
+
+    uint32_t WorkerPool::get_num_threads() const { return static_cast<uint32_t>(threads.size()); }
+
+    void WorkerPool::worker_thread(const std::stop_token& stop_token) {
+        while(true) {
+            Job job;
+
+            {
+                std::unique_lock lock{jobs_mutex};
+                if(!jobs_cv.wait(lock, stop_token, [&] { return !jobs.empty(); })) {
+                    return;
+                }
+
+                std::pop_heap(jobs.begin(), jobs.end(), &WorkerPool::runs_after);
+                job = std::move(jobs.back());
+                jobs.pop_back();
+
+                num_running_jobs++;
+            }
+
+            job.work();
+
+            {
+                std::lock_guard lock{jobs_mutex};
+                num_running_jobs--;
+                if(jobs.empty() && num_running_jobs == 0) {
+                    idle_cv.notify_all();
+                }
+            }
+        }
+    }
+
+    bool WorkerPool::runs_after(const Job& a, const Job& b) {
+        if(a.priority != b.priority) {
+            return a.priority < b.priority;
+        }
+
+        return a.sequence > b.sequence;
+    }
+} // namespace nova::renderer
@@ -0,0 +1,119 @@
+/*!
+ * \brief Counts how many times Nova allocates from the heap while it renders frames
+ *
+ * Nova's per-frame memory comes from frame arenas, so once the arenas have grown to fit a frame's allocations, rendering a frame shouldn't
+ * touch the heap at all. This benchmark replaces the global allocation functions with ones that count allocations, renders some frames to
+ * let everything warm up, then checks that the next frames don't allocate
+ *
+ * Unlike the other tests this one needs a GPU and a window, so it isn't registered with CTest. Run it by hand:
+ *
+ *     nova-frame-allocation-benchmark <data directory> <renderpack name> [number of frames]
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include "nova_renderer/filesystem/virtual_filesystem.hpp"
+#include "nova_renderer/nova_renderer.hpp"
+
+static std::atomic<bool> is_counting_allocations = false;
+static std::atomic<uint64_t> num_allocations = 0;
+
+void* counted_allocate(const size_t num_bytes, const size_t alignment) {
+    if(is_counting_allocations) {
+        ++num_allocations;
+    }
+
+    void* memory = nullptr;
+    if(alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+        memory = std::malloc(num_bytes == 0 ? 1 : num_bytes);
+
+    } else {
+        memory = _aligned_malloc(num_bytes == 0 ? 1 : num_bytes, alignment);
+    }
+
+    if(memory == nullptr) {
+        throw std::bad_alloc{};
+    }
+
+    return memory;
+}
+
+void* operator new(const size_t num_bytes) { return counted_allocate(num_bytes, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+
+void* operator new[](const size_t num_bytes) { return counted_allocate(num_bytes, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+
+void* operator new(const size_t num_bytes, const std::align_val_t alignment) {
+    return counted_allocate(num_bytes, static_cast<size_t>(alignment));
+}
+
+void* operator new[](const size_t num_bytes, const std::align_val_t alignment) {
+    return counted_allocate(num_bytes, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+
+void operator delete[](void* memory) noexcept { std::free(memory); }
+
+void operator delete(void* memory, size_t /* num_bytes */) noexcept { std::free(memory); }
+
+void operator delete[](void* memory, size_t /* num_bytes */) noexcept { std::free(memory); }
+
+void operator delete(void* memory, std::align_val_t /* alignment */) noexcept { _aligned_free(memory); }
+
+void operator delete[](void* memory, std::align_val_t /* alignment */) noexcept { _aligned_free(memory); }
+
+void operator delete(void* memory, size_t /* num_bytes */, std::align_val_t /* alignment */) noexcept { _aligned_free(memory); }
+
+void operator delete[](void* memory, size_t /* num_bytes */, std::align_val_t /* alignment */) noexcept { _aligned_free(memory); }
+
+int main(const int argc, const char** argv) {
+    if(argc < 3) {
+        std::printf("Usage: %s <data directory> <renderpack name> [number of frames]\n", argv[0]);
+        return 1;
+    }
+
+    const uint32_t num_frames = argc > 3 ? static_cast<uint32_t>(std::stoul(argv[3])) : 1000;
+
+    nova::filesystem::VirtualFilesystem::get_instance()->add_resource_root(argv[1]);
+
+    nova::renderer::NovaSettings settings;
+    nova::renderer::NovaRenderer renderer{settings};
+    renderer.load_renderpack(argv[2]);
+
+    // Render until every pipeline is compiled, and then a few more frames so that every in-flight frame's arena has grown to fit
+    uint32_t num_warmup_frames = 0;
+    while(true) {
+        renderer.execute_frame();
+        num_warmup_frames++;
+
+        const auto progress = renderer.get_pipeline_compile_progress();
+        if(progress.num_compiled + progress.num_failed == progress.num_total) {
+            break;
+        }
+    }
+
+    for(uint32_t i = 0; i < settings.max_in_flight_frames * 4; i++) {
+        renderer.execute_frame();
+        num_warmup_frames++;
+    }
+
+    is_counting_allocations = true;
+    for(uint32_t i = 0; i < num_frames; i++) {
+        renderer.execute_frame();
+    }
+    is_counting_allocations = false;
+
+    const auto total_allocations = num_allocations.load();
+    std::printf("Rendered %u warmup frames, then %u frames with %llu heap allocations (%.2f per frame)\n",
+                num_warmup_frames,
+                num_frames,
+                static_cast<unsigned long long>(total_allocations),
+                static_cast<double>(total_allocations) / num_frames);
+
+    return total_allocations == 0 ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+/*!
+ * \brief Checks that the meshlet builder respects its limits, covers every triangle, and is deterministic
+ *
+ * This only touches the CPU side of meshlet building, so it doesn't need a GPU
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "../src/renderer/meshlet_builder.hpp"
+
+using namespace nova::renderer;
+
+static uint32_t num_failures = 0;
+
+#define NOVA_CHECK(condition)                                                                                                              \
+    do {                                                                                                                                   \
+        if(!(condition)) {                                                                                                                 \
+            std::printf("%s:%d: Check failed: %s\n", __FILE__, __LINE__, #condition);                                                     \
+            num_failures++;                                                                                                                \
+        }                                                                                                                                  \
+    } while(false)
+
+/*!
+ * \brief A flat grid with a little bit of height variation, so that the meshlets get non-trivial normal cones
+ */
+struct GridMesh {
+    std::vector<FullVertex> vertices;
+    std::vector<uint32_t> indices;
+
+    MeshData get_mesh_data() const {
+        MeshData mesh_data;
+        mesh_data.num_vertex_attributes = 7;
+        mesh_data.num_indices = static_cast<uint32_t>(indices.size());
+        mesh_data.vertex_data_ptr = vertices.data();
+        mesh_data.vertex_data_size = vertices.size() * sizeof(FullVertex);
+        mesh_data.index_data_ptr = indices.data();
+        mesh_data.index_data_size = indices.size() * sizeof(uint32_t);
+
+        return mesh_data;
+    }
+};
+
+GridMesh make_grid_mesh(const uint32_t size) {
+    GridMesh mesh;
+    mesh.vertices.reserve((size + 1) * (size + 1));
+    for(uint32_t y = 0; y <= size; y++) {
+        for(uint32_t x = 0; x <= size; x++) {
+            FullVertex vertex{};
+            vertex.position = glm::vec3{static_cast<float>(x), static_cast<float>((x * 7 + y * 3) % 5) * 0.1f, static_cast<float>(y)};
+            mesh.vertices.push_back(vertex);
+        }
+    }
+
+    mesh.indices.reserve(size * size * 6);
+    for(uint32_t y = 0; y < size; y++) {
+        for(uint32_t x = 0; x < size; x++) {
+            const auto corner = y * (size + 1) + x;
+            mesh.indices.insert(mesh.indices.end(), {corner, corner + size + 1, corner + 1});
+            mesh.indices.insert(mesh.indices.end(), {corner + 1, corner + size + 1, corner + size + 2});
+        }
+    }
+
+    return mesh;
+}
+
+/*!
+ * \brief Checks that every meshlet is within the limits, and that unpacking the meshlets gives back the original index buffer
+ */
+void check_meshlets(const GridMesh& mesh, const MeshletData& data, const uint32_t max_vertices, const uint32_t max_primitives) {
+    NOVA_CHECK(!data.meshlets.empty());
+
+    std::vector<uint32_t> unpacked_indices;
+    unpacked_indices.reserve(mesh.indices.size());
+
+    uint32_t expected_vertex_offset = 0;
+    uint32_t expected_primitive_offset = 0;
+    for(const auto& meshlet : data.meshlets) {
+        NOVA_CHECK(meshlet.vertex_count > 0);
+        NOVA_CHECK(meshlet.vertex_count <= max_vertices);
+        NOVA_CHECK(meshlet.primitive_count > 0);
+        NOVA_CHECK(meshlet.primitive_count <= max_primitives);
+
+        // Meshlets are packed one after another
+        NOVA_CHECK(meshlet.vertex_offset == expected_vertex_offset);
+        NOVA_CHECK(meshlet.primitive_offset == expected_primitive_offset);
+        expected_vertex_offset += meshlet.vertex_count;
+        expected_primitive_offset += meshlet.primitive_count;
+
+        NOVA_CHECK(meshlet.bounding_sphere.w >= 0);
+
+        for(uint32_t i = 0; i < meshlet.primitive_count; i++) {
+            const auto triangle = data.primitives[meshlet.primitive_offset + i];
+            NOVA_CHECK((triangle >> 24) == 0);
+
+            for(uint32_t corner = 0; corner < 3; corner++) {
+                const auto local_idx = (triangle >> (corner * 8)) & 0xFF;
+                NOVA_CHECK(local_idx < meshlet.vertex_count);
+                unpacked_indices.push_back(data.vertex_indices[meshlet.vertex_offset + local_idx]);
+            }
+        }
+    }
+
+    NOVA_CHECK(expected_vertex_offset == data.vertex_indices.size());
+    NOVA_CHECK(expected_primitive_offset == data.primitives.size());
+    NOVA_CHECK(unpacked_indices == mesh.indices);
+}
+
+bool is_same_meshlet_data(const MeshletData& a, const MeshletData& b) {
+    return a.meshlets.size() == b.meshlets.size() &&
+           std::memcmp(a.meshlets.data(), b.meshlets.data(), a.meshlets.size() * sizeof(Meshlet)) == 0 &&
+           a.vertex_indices == b.vertex_indices && a.primitives == b.primitives;
+}
+
+int main() {
+    const auto mesh = make_grid_mesh(40);
+    const auto mesh_data = mesh.get_mesh_data();
+
+    // Default limits, where a meshlet fills up on vertices first
+    {
+        const auto data = build_meshlets(mesh_data);
+        check_meshlets(mesh, data, MAX_MESHLET_VERTICES, MAX_MESHLET_PRIMITIVES);
+        NOVA_CHECK(is_same_meshlet_data(data, build_meshlets(mesh_data)));
+    }
+
+    // Small primitive limit, where a meshlet fills up on primitives first
+    {
+        const auto data = build_meshlets(mesh_data, 256, 10);
+        check_meshlets(mesh, data, 256, 10);
+        NOVA_CHECK(is_same_meshlet_data(data, build_meshlets(mesh_data, 256, 10)));
+    }
+
+    // Smallest limits which still fit a triangle
+    {
+        const auto data = build_meshlets(mesh_data, 3, 1);
+        check_meshlets(mesh, data, 3, 1);
+        NOVA_CHECK(data.meshlets.size() == mesh.indices.size() / 3);
+    }
+
+    // Largest limits which still fit in the packed indices
+    {
+        const auto data = build_meshlets(mesh_data, MAX_MESHLET_LOCAL_INDICES, MAX_MESHLET_LOCAL_INDICES);
+        check_meshlets(mesh, data, MAX_MESHLET_LOCAL_INDICES, MAX_MESHLET_LOCAL_INDICES);
+    }
+
+    // Invalid limits give no meshlets rather than meshlets which overflow the packed indices or can't hold a triangle
+    NOVA_CHECK(build_meshlets(mesh_data, MAX_MESHLET_LOCAL_INDICES + 1, 10).meshlets.empty());
+    NOVA_CHECK(build_meshlets(mesh_data, 64, MAX_MESHLET_LOCAL_INDICES + 1).meshlets.empty());
+    NOVA_CHECK(build_meshlets(mesh_data, 64, 0).meshlets.empty());
+    NOVA_CHECK(build_meshlets(mesh_data, 2, 10).meshlets.empty());
+    NOVA_CHECK(build_meshlets(mesh_data, 0, 10).meshlets.empty());
+
+    // Empty meshes give no meshlets
+    NOVA_CHECK(build_meshlets(MeshData{}).meshlets.empty());
+
+    if(num_failures > 0) {
+        std::printf("%u checks failed\n", num_failures);
+        return 1;
+    }
+
+    std::printf("All meshlet builder checks passed\n");
+    return 0;
+}
@@ -0,0 +1,90 @@
+/*!
+ * \brief Times how long it takes to load a renderpack's data, and checks that every load produces the same data
+ *
+ * This only runs `load_renderpack_data`, which parses the renderpack and compiles its shaders on the CPU, so it doesn't need a GPU. The
+ * first load parses on the calling thread and every other load uses the worker pool, so the check also covers parsing in parallel. Later
+ * loads may hit the shader cache that the first load filled, which is why we report the minimum and the median rather than the mean
+ *
+ * There's no renderpack in the repo to load, so this isn't registered with CTest. Run it by hand:
+ *
+ *     nova-renderpack-load-benchmark <data directory> <renderpack name> [number of loads]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "nova_renderer/constants.hpp"
+#include "nova_renderer/filesystem/virtual_filesystem.hpp"
+#include "nova_renderer/loading/renderpack_loading.hpp"
+#include "nova_renderer/util/worker_pool.hpp"
+
+using namespace nova::renderer;
+
+int main(const int argc, const char** argv) {
+    if(argc < 3) {
+        std::printf("Usage: %s <data directory> <renderpack name> [number of loads]\n", argv[0]);
+        return 1;
+    }
+
+    const uint32_t num_loads = std::max(argc > 3 ? static_cast<uint32_t>(std::stoul(argv[3])) : 10u, 2u);
+
+    // Same setup that NovaRenderer does, without the window or the device
+    auto* vfs = nova::filesystem::VirtualFilesystem::get_instance();
+    vfs->add_resource_root(argv[1]);
+    vfs->add_resource_root(vfs->get_folder_accessor(RENDERPACK_DIRECTORY));
+
+    if(vfs->get_folder_accessor(argv[2]) == nullptr) {
+        std::printf("Could not find renderpack %s in %s\n", argv[2], argv[1]);
+        return 1;
+    }
+
+    WorkerPool worker_pool{std::max(std::thread::hardware_concurrency(), 1u)};
+
+    std::vector<double> load_times_ms;
+    load_times_ms.reserve(num_loads);
+
+    renderpack::RenderpackData first_data;
+    uint32_t num_mismatches = 0;
+
+    for(uint32_t i = 0; i < num_loads; i++) {
+        const auto start_time = std::chrono::steady_clock::now();
+        auto data = renderpack::load_renderpack_data(argv[2], i == 0 ? nullptr : &worker_pool);
+        const auto end_time = std::chrono::steady_clock::now();
+
+        load_times_ms.push_back(std::chrono::duration<double, std::milli>(end_time - start_time).count());
+
+        if(i == 0) {
+            first_data = std::move(data);
+
+        } else if(data != first_data) {
+            std::printf("Load %u produced different data than the first load\n", i);
+            num_mismatches++;
+        }
+    }
+
+    const auto first_load_time_ms = load_times_ms[0];
+    std::sort(load_times_ms.begin(), load_times_ms.end());
+    const auto median_ms = load_times_ms.size() % 2 == 0 ?
+                               (load_times_ms[load_times_ms.size() / 2 - 1] + load_times_ms[load_times_ms.size() / 2]) / 2 :
+                               load_times_ms[load_times_ms.size() / 2];
+
+    std::printf("Loaded renderpack %s %u times with %u worker threads: first %.2f ms, min %.2f ms, median %.2f ms\n",
+                argv[2],
+                num_loads,
+                worker_pool.get_num_threads(),
+                first_load_time_ms,
+                load_times_ms.front(),
+                median_ms);
+    std::printf("%u pipelines, %u materials, %u renderpasses. %u loads differed from the first\n",
+                static_cast<uint32_t>(first_data.pipelines.size()),
+                static_cast<uint32_t>(first_data.materials.size()),
+                static_cast<uint32_t>(first_data.graph_data.passes.size()),
+                num_mismatches);
+
+    return num_mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,258 @@
+/*!
+ * \brief Checks which pages the virtual texture page cache requests, in what order, and which pages it evicts
+ *
+ * The page cache is CPU-side bookkeeping only, so this doesn't need a GPU
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "../src/renderer/virtual_texture_page_cache.hpp"
+
+using namespace nova::renderer;
+
+static uint32_t num_failures = 0;
+
+#define NOVA_CHECK(condition)                                                                                                              \
+    do {                                                                                                                                   \
+        if(!(condition)) {                                                                                                                 \
+            std::printf("%s:%d: Check failed: %s\n", __FILE__, __LINE__, #condition);                                                     \
+            num_failures++;                                                                                                                \
+        }                                                                                                                                  \
+    } while(false)
+
+std::vector<uint32_t> pack_feedback(const std::vector<VirtualPageId>& pages) {
+    std::vector<uint32_t> feedback;
+    feedback.reserve(pages.size());
+    for(const auto& page : pages) {
+        feedback.push_back(page.pack());
+    }
+
+    return feedback;
+}
+
+/*!
+ * \brief Repeated feedback entries are counted once per entry, and every coarser page that covers a requested page is requested too
+ */
+void check_feedback_dedup_and_ancestors() {
+    VirtualTexturePageCache cache{4, 4, 2};
+    cache.add_texture(0, 3);
+
+    const auto busy_page = VirtualPageId{0, 0, 3, 2};
+    const auto quiet_page = VirtualPageId{0, 0, 2, 2};
+    const auto unknown_texture_page = VirtualPageId{7, 0, 1, 1};
+
+    std::vector<VirtualPageId> pages(5, busy_page);
+    pages.push_back(quiet_page);
+    pages.push_back(unknown_texture_page);
+    cache.process_feedback(pack_feedback(pages), 0);
+
+    // Both mip 0 pages share a parent in mip 1, which in turn lives in the texture's last mip
+    const auto requests = cache.take_page_requests(16);
+    NOVA_CHECK(requests.size() == 4);
+    if(requests.size() == 4) {
+        NOVA_CHECK(requests[0] == (VirtualPageId{0, 2, 0, 0}));
+        NOVA_CHECK(requests[1] == (VirtualPageId{0, 1, 1, 1}));
+        NOVA_CHECK(requests[2] == busy_page);
+        NOVA_CHECK(requests[3] == quiet_page);
+    }
+
+    // Pages that were handed out aren't handed out again until they're mapped or cancelled, even if later feedback wants them
+    cache.process_feedback(pack_feedback(pages), 1);
+    NOVA_CHECK(cache.take_page_requests(16).empty());
+
+    cache.cancel_request(quiet_page);
+    cache.process_feedback(pack_feedback(pages), 2);
+    const auto retried_requests = cache.take_page_requests(16);
+    NOVA_CHECK(retried_requests.size() == 1);
+    if(retried_requests.size() == 1) {
+        NOVA_CHECK(retried_requests[0] == quiet_page);
+    }
+
+    // Resident pages are never requested
+    NOVA_CHECK(cache.map_page(busy_page, 3).has_value());
+    cache.cancel_request(VirtualPageId{0, 1, 1, 1});
+    cache.cancel_request(VirtualPageId{0, 2, 0, 0});
+    cache.process_feedback(pack_feedback({busy_page}), 3);
+    const auto ancestor_requests = cache.take_page_requests(16);
+    NOVA_CHECK(ancestor_requests.size() == 2);
+    for(const auto& page : ancestor_requests) {
+        NOVA_CHECK(page.mip > 0);
+    }
+}
+
+/*!
+ * \brief Coarser pages come before finer pages no matter how often the finer pages were requested, then the most requested pages win
+ */
+void check_coarse_first_ordering() {
+    VirtualTexturePageCache cache{4, 4, 2};
+    cache.add_texture(1, 2);
+
+    const auto fine_page = VirtualPageId{1, 0, 0, 0};
+    const auto lonely_coarse_page = VirtualPageId{1, 1, 5, 5};
+
+    std::vector<VirtualPageId> pages(100, fine_page);
+    pages.push_back(lonely_coarse_page);
+    cache.process_feedback(pack_feedback(pages), 0);
+
+    const auto first_requests = cache.take_page_requests(2);
+    NOVA_CHECK(first_requests.size() == 2);
+    if(first_requests.size() == 2) {
+        NOVA_CHECK(first_requests[0] == fine_page.parent());
+        NOVA_CHECK(first_requests[1] == lonely_coarse_page);
+    }
+
+    const auto second_requests = cache.take_page_requests(2);
+    NOVA_CHECK(second_requests.size() == 1);
+    if(second_requests.size() == 1) {
+        NOVA_CHECK(second_requests[0] == fine_page);
+    }
+}
+
+/*!
+ * \brief A full cache evicts its least recently used page, but only once that page is older than the eviction delay
+ */
+void check_lru_eviction() {
+    constexpr uint32_t EVICTION_DELAY_FRAMES = 2;
+    VirtualTexturePageCache cache{2, 1, EVICTION_DELAY_FRAMES};
+    cache.add_texture(0, 1);
+
+    const auto page_a = VirtualPageId{0, 0, 0, 0};
+    const auto page_b = VirtualPageId{0, 0, 1, 0};
+    const auto page_c = VirtualPageId{0, 0, 2, 0};
+    const auto page_d = VirtualPageId{0, 0, 3, 0};
+
+    const auto mapping_a = cache.map_page(page_a, 0);
+    const auto mapping_b = cache.map_page(page_b, 1);
+    NOVA_CHECK(mapping_a.has_value() && !mapping_a->evicted_page);
+    NOVA_CHECK(mapping_b.has_value() && !mapping_b->evicted_page);
+    NOVA_CHECK(mapping_a && mapping_b && mapping_a->physical_page != mapping_b->physical_page);
+    NOVA_CHECK(cache.get_num_free_pages() == 0);
+
+    // Page A was used within the eviction delay, so the GPU might still be reading it
+    NOVA_CHECK(!cache.map_page(page_c, EVICTION_DELAY_FRAMES).has_value());
+    NOVA_CHECK(cache.find_page(page_a).has_value());
+
+    const auto mapping_c = cache.map_page(page_c, EVICTION_DELAY_FRAMES + 1);
+    NOVA_CHECK(mapping_c.has_value());
+    if(mapping_c && mapping_a) {
+        NOVA_CHECK(mapping_c->evicted_page == page_a);
+        NOVA_CHECK(mapping_c->physical_page == mapping_a->physical_page);
+    }
+    NOVA_CHECK(!cache.find_page(page_a).has_value());
+
+    // Feedback counts as a use, so page B moves in front of page C and C becomes the eviction candidate
+    cache.process_feedback(pack_feedback({page_b}), 4);
+    NOVA_CHECK(!cache.map_page(page_d, 5).has_value());
+
+    const auto mapping_d = cache.map_page(page_d, 6);
+    NOVA_CHECK(mapping_d.has_value());
+    if(mapping_d && mapping_c) {
+        NOVA_CHECK(mapping_d->evicted_page == page_c);
+        NOVA_CHECK(mapping_d->physical_page == mapping_c->physical_page);
+    }
+    NOVA_CHECK(cache.find_page(page_b).has_value());
+}
+
+/*!
+ * \brief Pinned pages stay in the cache no matter how old they get
+ */
+void check_pinned_pages() {
+    {
+        VirtualTexturePageCache cache{1, 1, 0};
+        cache.add_texture(0, 1);
+
+        const auto pinned_page = VirtualPageId{0, 0, 0, 0};
+        NOVA_CHECK(cache.map_page(pinned_page, 0, true).has_value());
+
+        // The only page is pinned, so there's nothing to evict
+        NOVA_CHECK(!cache.map_page(VirtualPageId{0, 0, 1, 0}, 1000).has_value());
+        NOVA_CHECK(cache.find_page(pinned_page).has_value());
+    }
+
+    // Mapping a resident page again with the pin flag pins it
+    {
+        VirtualTexturePageCache cache{2, 1, 0};
+        cache.add_texture(0, 1);
+
+        const auto page_a = VirtualPageId{0, 0, 0, 0};
+        const auto page_b = VirtualPageId{0, 0, 1, 0};
+
+        const auto mapping_a = cache.map_page(page_a, 0);
+        const auto pinned_mapping_a = cache.map_page(page_a, 0, true);
+        NOVA_CHECK(pinned_mapping_a.has_value() && !pinned_mapping_a->evicted_page);
+        NOVA_CHECK(mapping_a && pinned_mapping_a && mapping_a->physical_page == pinned_mapping_a->physical_page);
+
+        NOVA_CHECK(cache.map_page(page_b, 1).has_value());
+
+        const auto mapping_c = cache.map_page(VirtualPageId{0, 0, 2, 0}, 10);
+        NOVA_CHECK(mapping_c.has_value());
+        if(mapping_c) {
+            NOVA_CHECK(mapping_c->evicted_page == page_b);
+        }
+        NOVA_CHECK(cache.find_page(page_a).has_value());
+    }
+}
+
+/*!
+ * \brief Removing a texture frees its pages, pinned or not, and forgets its requests, while other textures are left alone
+ */
+void check_remove_texture() {
+    VirtualTexturePageCache cache{2, 2, 0};
+    cache.add_texture(0, 1);
+    cache.add_texture(1, 1);
+
+    const auto pinned_page = VirtualPageId{0, 0, 0, 0};
+    const auto unpinned_page = VirtualPageId{0, 0, 1, 0};
+    const auto other_texture_page = VirtualPageId{1, 0, 0, 0};
+
+    NOVA_CHECK(cache.map_page(pinned_page, 0, true).has_value());
+    NOVA_CHECK(cache.map_page(unpinned_page, 0).has_value());
+    NOVA_CHECK(cache.map_page(other_texture_page, 0).has_value());
+    NOVA_CHECK(cache.get_num_free_pages() == 1);
+
+    const auto requested_page = VirtualPageId{0, 0, 2, 0};
+    const auto other_requested_page = VirtualPageId{1, 0, 2, 0};
+    cache.process_feedback(pack_feedback({requested_page, other_requested_page}), 1);
+
+    cache.remove_texture(0);
+
+    NOVA_CHECK(cache.get_num_free_pages() == 3);
+    NOVA_CHECK(!cache.find_page(pinned_page).has_value());
+    NOVA_CHECK(!cache.find_page(unpinned_page).has_value());
+    NOVA_CHECK(cache.find_page(other_texture_page).has_value());
+
+    const auto requests = cache.take_page_requests(16);
+    NOVA_CHECK(requests.size() == 1);
+    if(requests.size() == 1) {
+        NOVA_CHECK(requests[0] == other_requested_page);
+    }
+
+    // Feedback for the removed texture is ignored
+    cache.process_feedback(pack_feedback({requested_page}), 2);
+    NOVA_CHECK(cache.take_page_requests(16).empty());
+
+    // Every freed page can be used again, and none of them evict anything
+    for(uint32_t i = 0; i < 3; i++) {
+        const auto mapping = cache.map_page(VirtualPageId{1, 0, 3, i}, 3);
+        NOVA_CHECK(mapping.has_value() && !mapping->evicted_page);
+    }
+    NOVA_CHECK(cache.get_num_free_pages() == 0);
+}
+
+int main() {
+    check_feedback_dedup_and_ancestors();
+    check_coarse_first_ordering();
+    check_lru_eviction();
+    check_pinned_pages();
+    check_remove_texture();
+
+    if(num_failures > 0) {
+        std::printf("%u checks failed\n", num_failures);
+        return 1;
+    }
+
+    std::printf("All virtual texture page cache checks passed\n");
+    return 0;
+}